@@ -0,0 +1,814 @@
+/*
+ AVX Lift-Time Constant Folding
+*/
+
+#include "avx_consteval.h"
+#include "avx_constpool.h"
+#include "avx_helpers.h"
+#include "avx_idiom.h"
+#include "avx_regmap.h"
+#include "avx_state.h"
+#include "avx_utils.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../common/warn_off.h"
+#include <intel.hpp>
+#include "../common/warn_on.h"
+
+#include <cmath>
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Evaluator
+//-----------------------------------------------------------------------------
+
+uint64 get_elem(const vconst_t &v, int i, int es) {
+    uint64 x = 0;
+    memcpy(&x, &v.b[i * es], es);  // host and target are both little-endian here
+    return x;
+}
+
+void put_elem(vconst_t &v, int i, int es, uint64 x) { memcpy(&v.b[i * es], &x, es); }
+
+int64 sext(uint64 x, int es) {
+    int sh = 64 - es * 8;
+    return (int64) (x << sh) >> sh;
+}
+
+// Saturation is only defined for byte/word/dword results
+uint64 sat_s(int64 v, int es) {
+    int64 hi = (int64(1) << (es * 8 - 1)) - 1;
+    int64 lo = -hi - 1;
+    return (uint64) (v < lo ? lo : (v > hi ? hi : v));
+}
+
+uint64 sat_u(int64 v, int es) {
+    int64 hi = (int64(1) << (es * 8)) - 1;
+    return (uint64) (v < 0 ? 0 : (v > hi ? hi : v));
+}
+
+enum binop_t {
+    BO_AND, BO_ANDN, BO_OR, BO_XOR,
+    BO_ADD, BO_SUB, BO_ADDS, BO_SUBS, BO_ADDUS, BO_SUBUS,
+    BO_MULLO, BO_MULHI, BO_MULHIU, BO_MULUDQ, BO_MULDQ,
+    BO_MINS, BO_MAXS, BO_MINU, BO_MAXU, BO_AVG,
+    BO_CMPEQ, BO_CMPGT,
+    BO_SLL, BO_SRL, BO_SRA,
+};
+
+uint64 binop(binop_t op, uint64 x, uint64 y, int es) {
+    int bits = es * 8;
+    int64 sx = sext(x, es);
+    int64 sy = sext(y, es);
+    switch (op) {
+        case BO_AND: return x & y;
+        case BO_ANDN: return ~x & y;
+        case BO_OR: return x | y;
+        case BO_XOR: return x ^ y;
+        case BO_ADD: return x + y;
+        case BO_SUB: return x - y;
+        case BO_ADDS: return sat_s(sx + sy, es);
+        case BO_SUBS: return sat_s(sx - sy, es);
+        case BO_ADDUS: return sat_u((int64) (x + y), es);
+        case BO_SUBUS: return x > y ? x - y : 0;
+        case BO_MULLO: return x * y;
+        case BO_MULHI: return (uint64) ((sx * sy) >> bits);
+        case BO_MULHIU: return (x * y) >> bits;
+        case BO_MULUDQ: return (x & 0xFFFFFFFF) * (y & 0xFFFFFFFF);
+        case BO_MULDQ: return (uint64) ((int64) (int32) x * (int64) (int32) y);
+        case BO_MINS: return sx < sy ? x : y;
+        case BO_MAXS: return sx > sy ? x : y;
+        case BO_MINU: return x < y ? x : y;
+        case BO_MAXU: return x > y ? x : y;
+        case BO_AVG: return (x + y + 1) >> 1;
+        case BO_CMPEQ: return x == y ? ~uint64(0) : 0;
+        case BO_CMPGT: return sx > sy ? ~uint64(0) : 0;
+        // Counts past the element width clear it, or fill it with the sign
+        case BO_SLL: return y >= (uint64) bits ? 0 : x << y;
+        case BO_SRL: return y >= (uint64) bits ? 0 : x >> y;
+        case BO_SRA: return (uint64) (sx >> (y >= (uint64) bits ? bits - 1 : (int) y));
+    }
+    return 0;
+}
+
+struct binop_desc_t {
+    uint16 itype;
+    binop_t op;
+    uint8 es;
+};
+
+// Element-wise ops on (Op2, Op3). Bitwise ops don't care about the element.
+const binop_desc_t k_binops[] = {
+    {NN_vpand, BO_AND, 8}, {NN_vpandd, BO_AND, 8}, {NN_vpandq, BO_AND, 8},
+    {NN_vandps, BO_AND, 8}, {NN_vandpd, BO_AND, 8},
+    {NN_vpandn, BO_ANDN, 8}, {NN_vpandnd, BO_ANDN, 8}, {NN_vpandnq, BO_ANDN, 8},
+    {NN_vandnps, BO_ANDN, 8}, {NN_vandnpd, BO_ANDN, 8},
+    {NN_vpor, BO_OR, 8}, {NN_vpord, BO_OR, 8}, {NN_vporq, BO_OR, 8},
+    {NN_vorps, BO_OR, 8}, {NN_vorpd, BO_OR, 8},
+    {NN_vpxor, BO_XOR, 8}, {NN_vpxord, BO_XOR, 8}, {NN_vpxorq, BO_XOR, 8},
+    {NN_vxorps, BO_XOR, 8}, {NN_vxorpd, BO_XOR, 8},
+    {NN_vpaddb, BO_ADD, 1}, {NN_vpaddw, BO_ADD, 2}, {NN_vpaddd, BO_ADD, 4}, {NN_vpaddq, BO_ADD, 8},
+    {NN_vpsubb, BO_SUB, 1}, {NN_vpsubw, BO_SUB, 2}, {NN_vpsubd, BO_SUB, 4}, {NN_vpsubq, BO_SUB, 8},
+    {NN_vpaddsb, BO_ADDS, 1}, {NN_vpaddsw, BO_ADDS, 2},
+    {NN_vpsubsb, BO_SUBS, 1}, {NN_vpsubsw, BO_SUBS, 2},
+    {NN_vpaddusb, BO_ADDUS, 1}, {NN_vpaddusw, BO_ADDUS, 2},
+    {NN_vpsubusb, BO_SUBUS, 1}, {NN_vpsubusw, BO_SUBUS, 2},
+    {NN_vpmullw, BO_MULLO, 2}, {NN_vpmulld, BO_MULLO, 4}, {NN_vpmullq, BO_MULLO, 8},
+    {NN_vpmulhw, BO_MULHI, 2}, {NN_vpmulhuw, BO_MULHIU, 2},
+    {NN_vpmuludq, BO_MULUDQ, 8}, {NN_vpmuldq, BO_MULDQ, 8},
+    {NN_vpminsb, BO_MINS, 1}, {NN_vpminsw, BO_MINS, 2}, {NN_vpminsd, BO_MINS, 4}, {NN_vpminsq, BO_MINS, 8},
+    {NN_vpmaxsb, BO_MAXS, 1}, {NN_vpmaxsw, BO_MAXS, 2}, {NN_vpmaxsd, BO_MAXS, 4}, {NN_vpmaxsq, BO_MAXS, 8},
+    {NN_vpminub, BO_MINU, 1}, {NN_vpminuw, BO_MINU, 2}, {NN_vpminud, BO_MINU, 4}, {NN_vpminuq, BO_MINU, 8},
+    {NN_vpmaxub, BO_MAXU, 1}, {NN_vpmaxuw, BO_MAXU, 2}, {NN_vpmaxud, BO_MAXU, 4}, {NN_vpmaxuq, BO_MAXU, 8},
+    {NN_vpavgb, BO_AVG, 1}, {NN_vpavgw, BO_AVG, 2},
+    {NN_vpcmpeqb, BO_CMPEQ, 1}, {NN_vpcmpeqw, BO_CMPEQ, 2}, {NN_vpcmpeqd, BO_CMPEQ, 4}, {NN_vpcmpeqq, BO_CMPEQ, 8},
+    {NN_vpcmpgtb, BO_CMPGT, 1}, {NN_vpcmpgtw, BO_CMPGT, 2}, {NN_vpcmpgtd, BO_CMPGT, 4}, {NN_vpcmpgtq, BO_CMPGT, 8},
+    {NN_vpsllvw, BO_SLL, 2}, {NN_vpsllvd, BO_SLL, 4}, {NN_vpsllvq, BO_SLL, 8},
+    {NN_vpsrlvw, BO_SRL, 2}, {NN_vpsrlvd, BO_SRL, 4}, {NN_vpsrlvq, BO_SRL, 8},
+    {NN_vpsravw, BO_SRA, 2}, {NN_vpsravd, BO_SRA, 4}, {NN_vpsravq, BO_SRA, 8},
+};
+
+// Shifts of every element by one count: an immediate or the low qword of Op3
+const binop_desc_t k_shifts[] = {
+    {NN_vpsllw, BO_SLL, 2}, {NN_vpslld, BO_SLL, 4}, {NN_vpsllq, BO_SLL, 8},
+    {NN_vpsrlw, BO_SRL, 2}, {NN_vpsrld, BO_SRL, 4}, {NN_vpsrlq, BO_SRL, 8},
+    {NN_vpsraw, BO_SRA, 2}, {NN_vpsrad, BO_SRA, 4}, {NN_vpsraq, BO_SRA, 8},
+};
+
+struct widen_desc_t {
+    uint16 itype;
+    uint8 src_es;
+    uint8 dst_es;
+    bool is_signed;
+};
+
+const widen_desc_t k_widens[] = {
+    {NN_vpmovzxbw, 1, 2, false}, {NN_vpmovzxbd, 1, 4, false}, {NN_vpmovzxbq, 1, 8, false},
+    {NN_vpmovzxwd, 2, 4, false}, {NN_vpmovzxwq, 2, 8, false}, {NN_vpmovzxdq, 4, 8, false},
+    {NN_vpmovsxbw, 1, 2, true}, {NN_vpmovsxbd, 1, 4, true}, {NN_vpmovsxbq, 1, 8, true},
+    {NN_vpmovsxwd, 2, 4, true}, {NN_vpmovsxwq, 2, 8, true}, {NN_vpmovsxdq, 4, 8, true},
+};
+
+void unpack(const vconst_t &a, const vconst_t &b, int width, int es, bool high, vconst_t *out) {
+    int per_lane = XMM_SIZE / es;
+    int half = per_lane / 2;
+    for (int l = 0; l < width / XMM_SIZE; l++) {
+        int base = l * per_lane + (high ? half : 0);
+        for (int k = 0; k < half; k++) {
+            put_elem(*out, l * per_lane + 2 * k, es, get_elem(a, base + k, es));
+            put_elem(*out, l * per_lane + 2 * k + 1, es, get_elem(b, base + k, es));
+        }
+    }
+}
+
+void pack(const vconst_t &a, const vconst_t &b, int width, int src_es, bool is_unsigned, vconst_t *out) {
+    int dst_es = src_es / 2;
+    int n = XMM_SIZE / src_es;
+    for (int l = 0; l < width / XMM_SIZE; l++) {
+        for (int k = 0; k < 2 * n; k++) {
+            const vconst_t &s = k < n ? a : b;
+            int64 v = sext(get_elem(s, l * n + k % n, src_es), src_es);
+            put_elem(*out, l * 2 * n + k, dst_es, is_unsigned ? sat_u(v, dst_es) : sat_s(v, dst_es));
+        }
+    }
+}
+
+// vpermd/vpermq/vpermb/...: full-width table lookup, indices in Op2
+void permute_var(const vconst_t &idx, const vconst_t &data, int width, int es, vconst_t *out) {
+    int n = width / es;
+    for (int i = 0; i < n; i++)
+        put_elem(*out, i, es, get_elem(data, (int) (get_elem(idx, i, es) & (n - 1)), es));
+}
+
+// Per-element select: bit (i % 8) of imm (vpblendw/d, vblendps/pd)
+void blend_imm(const vconst_t &a, const vconst_t &b, int width, int es, int imm, vconst_t *out) {
+    for (int i = 0; i < width / es; i++)
+        put_elem(*out, i, es, get_elem((imm >> (i % 8)) & 1 ? b : a, i, es));
+}
+
+void copy_chunk(vconst_t *out, int dst_off, const vconst_t &src, int src_off, int size) {
+    memcpy(&out->b[dst_off], &src.b[src_off], size);
+}
+
+} // namespace
+
+bool consteval_eval(uint16 it, int width, const vconst_args_t &args, vconst_t *out) {
+    memset(out->b, 0, sizeof(out->b));
+    const vconst_t *s0 = args.v[0];
+    const vconst_t *s1 = args.v[1];
+    const vconst_t *s2 = args.v[2];
+    const vconst_t *s3 = args.v[3];
+    int imm = args.imm;
+    int lanes = width / XMM_SIZE;
+    if (lanes == 0)
+        return false;
+
+    for (const binop_desc_t &d : k_binops) {
+        if (d.itype != it)
+            continue;
+        if (s1 == nullptr || s2 == nullptr)
+            return false;
+        for (int i = 0; i < width / d.es; i++)
+            put_elem(*out, i, d.es, binop(d.op, get_elem(*s1, i, d.es), get_elem(*s2, i, d.es), d.es));
+        return true;
+    }
+
+    for (const binop_desc_t &d : k_shifts) {
+        if (d.itype != it)
+            continue;
+        if (s1 == nullptr || (imm < 0 && s2 == nullptr))
+            return false;
+        uint64 count = imm >= 0 ? (uint64) imm : get_elem(*s2, 0, 8);
+        for (int i = 0; i < width / d.es; i++)
+            put_elem(*out, i, d.es, binop(d.op, get_elem(*s1, i, d.es), count, d.es));
+        return true;
+    }
+
+    for (const widen_desc_t &d : k_widens) {
+        if (d.itype != it)
+            continue;
+        if (s1 == nullptr)
+            return false;
+        for (int i = 0; i < width / d.dst_es; i++) {
+            uint64 v = get_elem(*s1, i, d.src_es);
+            put_elem(*out, i, d.dst_es, d.is_signed ? (uint64) sext(v, d.src_es) : v);
+        }
+        return true;
+    }
+
+    switch (it) {
+        // moves
+        case NN_vmovdqa: case NN_vmovdqu: case NN_vmovaps: case NN_vmovups:
+        case NN_vmovapd: case NN_vmovupd:
+        case NN_vmovdqa32: case NN_vmovdqa64:
+        case NN_vmovdqu8: case NN_vmovdqu16: case NN_vmovdqu32: case NN_vmovdqu64:
+            if (s1 == nullptr)
+                return false;
+            copy_chunk(out, 0, *s1, 0, width);
+            return true;
+
+        case NN_vpabsb: case NN_vpabsw: case NN_vpabsd: case NN_vpabsq: {
+            if (s1 == nullptr)
+                return false;
+            int es = it == NN_vpabsb ? 1 : it == NN_vpabsw ? 2 : it == NN_vpabsd ? 4 : 8;
+            for (int i = 0; i < width / es; i++) {
+                int64 v = sext(get_elem(*s1, i, es), es);
+                put_elem(*out, i, es, v < 0 ? (uint64) 0 - (uint64) v : (uint64) v);
+            }
+            return true;
+        }
+
+        // byte shifts within each 128-bit lane
+        case NN_vpslldq: case NN_vpsrldq: {
+            if (s1 == nullptr || imm < 0)
+                return false;
+            int n = imm > 16 ? 16 : imm;
+            for (int l = 0; l < lanes; l++)
+                for (int i = 0; i < XMM_SIZE; i++) {
+                    int src = it == NN_vpslldq ? i - n : i + n;
+                    out->b[l * XMM_SIZE + i] = src >= 0 && src < XMM_SIZE ? s1->b[l * XMM_SIZE + src] : 0;
+                }
+            return true;
+        }
+
+        case NN_vpalignr: {
+            if (s1 == nullptr || s2 == nullptr || imm < 0)
+                return false;
+            for (int l = 0; l < lanes; l++)
+                for (int i = 0; i < XMM_SIZE; i++) {
+                    int k = i + imm;  // into Op2:Op3 (Op3 is the low half)
+                    uint8 v = 0;
+                    if (k < XMM_SIZE)
+                        v = s2->b[l * XMM_SIZE + k];
+                    else if (k < 2 * XMM_SIZE)
+                        v = s1->b[l * XMM_SIZE + k - XMM_SIZE];
+                    out->b[l * XMM_SIZE + i] = v;
+                }
+            return true;
+        }
+
+        // in-lane shuffles
+        case NN_vpshufb:
+            if (s1 == nullptr || s2 == nullptr)
+                return false;
+            for (int i = 0; i < width; i++) {
+                uint8 c = s2->b[i];
+                out->b[i] = (c & 0x80) != 0 ? 0 : s1->b[(i & ~15) + (c & 15)];
+            }
+            return true;
+
+        case NN_vpshufd:
+        case NN_vpermilps:
+            if (s1 == nullptr || (imm < 0 && s2 == nullptr))
+                return false;
+            for (int i = 0; i < width / 4; i++) {
+                int sel = imm >= 0 ? (imm >> (2 * (i & 3))) & 3 : (int) (get_elem(*s2, i, 4) & 3);
+                put_elem(*out, i, 4, get_elem(*s1, (i & ~3) + sel, 4));
+            }
+            return true;
+
+        case NN_vpermilpd:
+            if (s1 == nullptr || (imm < 0 && s2 == nullptr))
+                return false;
+            for (int i = 0; i < width / 8; i++) {
+                int sel = imm >= 0 ? (imm >> (i & 7)) & 1 : (int) ((get_elem(*s2, i, 8) >> 1) & 1);
+                put_elem(*out, i, 8, get_elem(*s1, (i & ~1) + sel, 8));
+            }
+            return true;
+
+        case NN_vpshuflw: case NN_vpshufhw: {
+            if (s1 == nullptr || imm < 0)
+                return false;
+            int first = it == NN_vpshuflw ? 0 : 4;
+            for (int i = 0; i < width / 2; i++) {
+                int k = i & 7;
+                int src = k >= first && k < first + 4 ? (i & ~7) + first + ((imm >> (2 * (k - first))) & 3) : i;
+                put_elem(*out, i, 2, get_elem(*s1, src, 2));
+            }
+            return true;
+        }
+
+        case NN_vshufps:
+            if (s1 == nullptr || s2 == nullptr || imm < 0)
+                return false;
+            for (int i = 0; i < width / 4; i++) {
+                int k = i & 3;
+                put_elem(*out, i, 4, get_elem(k < 2 ? *s1 : *s2, (i & ~3) + ((imm >> (2 * k)) & 3), 4));
+            }
+            return true;
+
+        case NN_vshufpd:
+            if (s1 == nullptr || s2 == nullptr || imm < 0)
+                return false;
+            for (int i = 0; i < width / 8; i++)
+                put_elem(*out, i, 8, get_elem((i & 1) == 0 ? *s1 : *s2, (i & ~1) + ((imm >> (i & 7)) & 1), 8));
+            return true;
+
+        case NN_vpunpcklbw: case NN_vpunpckhbw:
+        case NN_vpunpcklwd: case NN_vpunpckhwd:
+        case NN_vpunpckldq: case NN_vpunpckhdq:
+        case NN_vpunpcklqdq: case NN_vpunpckhqdq:
+        case NN_vunpcklps: case NN_vunpckhps:
+        case NN_vunpcklpd: case NN_vunpckhpd: {
+            if (s1 == nullptr || s2 == nullptr)
+                return false;
+            int es = 4;
+            if (it == NN_vpunpcklbw || it == NN_vpunpckhbw) es = 1;
+            else if (it == NN_vpunpcklwd || it == NN_vpunpckhwd) es = 2;
+            else if (it == NN_vpunpcklqdq || it == NN_vpunpckhqdq || it == NN_vunpcklpd || it == NN_vunpckhpd) es = 8;
+            bool high = it == NN_vpunpckhbw || it == NN_vpunpckhwd || it == NN_vpunpckhdq ||
+                        it == NN_vpunpckhqdq || it == NN_vunpckhps || it == NN_vunpckhpd;
+            unpack(*s1, *s2, width, es, high, out);
+            return true;
+        }
+
+        case NN_vpacksswb: case NN_vpackssdw: case NN_vpackuswb: case NN_vpackusdw:
+            if (s1 == nullptr || s2 == nullptr)
+                return false;
+            pack(*s1, *s2, width, it == NN_vpacksswb || it == NN_vpackuswb ? 2 : 4,
+                 it == NN_vpackuswb || it == NN_vpackusdw, out);
+            return true;
+
+        // cross-lane permutes
+        case NN_vpermq: case NN_vpermpd:
+            if (imm >= 0) {
+                if (s1 == nullptr)
+                    return false;
+                for (int i = 0; i < width / 8; i++)
+                    put_elem(*out, i, 8, get_elem(*s1, (i & ~3) + ((imm >> (2 * (i & 3))) & 3), 8));
+                return true;
+            }
+            if (s1 == nullptr || s2 == nullptr)
+                return false;
+            permute_var(*s1, *s2, width, 8, out);
+            return true;
+
+        case NN_vpermd: case NN_vpermps: case NN_vpermw: case NN_vpermb:
+            if (s1 == nullptr || s2 == nullptr)
+                return false;
+            permute_var(*s1, *s2, width, it == NN_vpermb ? 1 : it == NN_vpermw ? 2 : 4, out);
+            return true;
+
+        case NN_vperm2i128: case NN_vperm2f128:
+            if (s1 == nullptr || s2 == nullptr || imm < 0 || width != YMM_SIZE)
+                return false;
+            for (int h = 0; h < 2; h++) {
+                int sel = (imm >> (4 * h)) & 0xF;
+                if ((sel & 8) == 0)
+                    copy_chunk(out, h * XMM_SIZE, (sel & 2) != 0 ? *s2 : *s1, (sel & 1) * XMM_SIZE, XMM_SIZE);
+            }
+            return true;
+
+        // blends
+        case NN_vpblendw:
+            if (s1 == nullptr || s2 == nullptr || imm < 0)
+                return false;
+            blend_imm(*s1, *s2, width, 2, imm, out);
+            return true;
+
+        case NN_vpblendd: case NN_vblendps: case NN_vblendpd:
+            if (s1 == nullptr || s2 == nullptr || imm < 0)
+                return false;
+            blend_imm(*s1, *s2, width, it == NN_vblendpd ? 8 : 4, imm, out);
+            return true;
+
+        case NN_vpblendvb: case NN_vblendvps: case NN_vblendvpd: {
+            if (s1 == nullptr || s2 == nullptr || s3 == nullptr)
+                return false;
+            int es = it == NN_vpblendvb ? 1 : it == NN_vblendvps ? 4 : 8;
+            for (int i = 0; i < width / es; i++) {
+                bool take_b = (s3->b[i * es + es - 1] & 0x80) != 0;
+                put_elem(*out, i, es, get_elem(take_b ? *s2 : *s1, i, es));
+            }
+            return true;
+        }
+
+        case NN_vpternlogd: case NN_vpternlogq: {
+            // Op1 is the first source; the table may not depend on it
+            bool uses_a = ((imm >> 4) & 0xF) != (imm & 0xF);
+            if (s1 == nullptr || s2 == nullptr || imm < 0 || (uses_a && s0 == nullptr))
+                return false;
+            for (int i = 0; i < width; i++)
+                for (int bit = 0; bit < 8; bit++) {
+                    int a = s0 != nullptr ? (s0->b[i] >> bit) & 1 : 0;
+                    int b = (s1->b[i] >> bit) & 1;
+                    int c = (s2->b[i] >> bit) & 1;
+                    out->b[i] |= ((imm >> ((a << 2) | (b << 1) | c)) & 1) << bit;
+                }
+            return true;
+        }
+
+        // broadcasts of the low element (or 128/256-bit block) of Op2
+        case NN_vpbroadcastb: case NN_vpbroadcastw: case NN_vpbroadcastd: case NN_vpbroadcastq:
+        case NN_vbroadcastss: case NN_vbroadcastsd:
+        case NN_vbroadcasti128: case NN_vbroadcastf128:
+        case NN_vbroadcasti32x4: case NN_vbroadcastf32x4:
+        case NN_vbroadcasti64x4: case NN_vbroadcastf64x4: {
+            if (s1 == nullptr)
+                return false;
+            int chunk = 16;
+            if (it == NN_vpbroadcastb) chunk = 1;
+            else if (it == NN_vpbroadcastw) chunk = 2;
+            else if (it == NN_vpbroadcastd || it == NN_vbroadcastss) chunk = 4;
+            else if (it == NN_vpbroadcastq || it == NN_vbroadcastsd) chunk = 8;
+            else if (it == NN_vbroadcasti64x4 || it == NN_vbroadcastf64x4) chunk = 32;
+            if (chunk > width || args.w[1] < chunk)
+                return false;
+            for (int off = 0; off < width; off += chunk)
+                copy_chunk(out, off, *s1, 0, chunk);
+            return true;
+        }
+
+        case NN_vinserti128: case NN_vinsertf128:
+        case NN_vinserti32x4: case NN_vinsertf32x4: case NN_vinserti64x2: case NN_vinsertf64x2:
+        case NN_vinserti32x8: case NN_vinsertf32x8: case NN_vinserti64x4: case NN_vinsertf64x4: {
+            if (s1 == nullptr || s2 == nullptr || imm < 0)
+                return false;
+            int chunk = it == NN_vinserti32x8 || it == NN_vinsertf32x8 ||
+                        it == NN_vinserti64x4 || it == NN_vinsertf64x4 ? YMM_SIZE : XMM_SIZE;
+            if (chunk >= width)
+                return false;
+            copy_chunk(out, 0, *s1, 0, width);
+            copy_chunk(out, (imm & (width / chunk - 1)) * chunk, *s2, 0, chunk);
+            return true;
+        }
+
+        case NN_vextracti128: case NN_vextractf128:
+        case NN_vextracti32x4: case NN_vextractf32x4: case NN_vextracti64x2: case NN_vextractf64x2:
+        case NN_vextracti32x8: case NN_vextractf32x8: case NN_vextracti64x4: case NN_vextractf64x4: {
+            int src_w = args.w[1];
+            if (s1 == nullptr || imm < 0 || src_w <= width)
+                return false;
+            copy_chunk(out, 0, *s1, (imm & (src_w / width - 1)) * width, width);
+            return true;
+        }
+
+        // conversions, only where the result is exact under any MXCSR mode
+        case NN_vcvtdq2ps:
+            if (s1 == nullptr)
+                return false;
+            for (int i = 0; i < width / 4; i++) {
+                int32 v = (int32) get_elem(*s1, i, 4);
+                float f = (float) v;
+                if ((int64) f != v)
+                    return false;
+                uint32 bits;
+                memcpy(&bits, &f, 4);
+                put_elem(*out, i, 4, bits);
+            }
+            return true;
+
+        case NN_vcvtdq2pd:
+            if (s1 == nullptr)
+                return false;
+            for (int i = 0; i < width / 8; i++) {
+                double d = (double) (int32) get_elem(*s1, i, 4);
+                uint64 bits;
+                memcpy(&bits, &d, 8);
+                put_elem(*out, i, 8, bits);
+            }
+            return true;
+
+        case NN_vcvttps2dq:
+            if (s1 == nullptr)
+                return false;
+            for (int i = 0; i < width / 4; i++) {
+                uint32 bits = (uint32) get_elem(*s1, i, 4);
+                float f;
+                memcpy(&f, &bits, 4);
+                // NaN and out-of-range lanes give the integer indefinite value
+                bool indefinite = std::isnan(f) || f >= 2147483648.0f || f < -2147483648.0f;
+                put_elem(*out, i, 4, indefinite ? 0x80000000u : (uint32) (int32) f);
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Known register values
+//-----------------------------------------------------------------------------
+
+// Value of one vector register as written by the instruction at `ea`. It is
+// still current if nothing emitted into the block after `before` (other than the
+// microcode of `ea` itself) may have written the register.
+struct vreg_rec_t {
+    bool known;
+    minsn_t *before;
+    ea_t ea;
+    vconst_t val;
+};
+
+} // namespace
+
+// Records belong to the block under construction of one mba.
+struct consteval_state_t {
+    mba_t *mba = nullptr;
+    ea_t entry = BADADDR;
+    mblock_t *blk = nullptr;
+    vreg_rec_t vregs[32];
+
+    void forget_all() {
+        for (vreg_rec_t &r : vregs)
+            r.known = false;
+    }
+};
+
+namespace {
+
+// The current database's records; null before its lifter activates
+consteval_state_t *cur_state() {
+    avx_state_t *st = avx_state();
+    return st != nullptr ? st->consteval : nullptr;
+}
+
+void reset_if_new_block(consteval_state_t &st, codegen_t &cdg) {
+    if (st.mba == cdg.mba && st.entry == cdg.mba->entry_ea && st.blk == cdg.mb)
+        return;
+    st.mba = cdg.mba;
+    st.entry = cdg.mba->entry_ea;
+    st.blk = cdg.mb;
+    st.forget_all();
+}
+
+// Nested writers of vector state: __writezmm for the register, calls that
+// leave the lifter's model (real calls, helpers other than intrinsics and
+// register accessors), and instructions IDA could not express.
+struct vreg_clobber_visitor_t : public minsn_visitor_t {
+    int idx;
+    bool hit = false;
+    explicit vreg_clobber_visitor_t(int i) : idx(i) {}
+    int idaapi visit_minsn() override {
+        if (curins->opcode == m_ext || curins->opcode == m_icall) {
+            hit = true;
+            return 1;
+        }
+        if (curins->opcode != m_call)
+            return 0;
+        if (curins->l.t != mop_h || curins->l.helper == nullptr) {
+            hit = true;
+            return 1;
+        }
+        const char *name = curins->l.helper;
+        if (streq(name, "__writezmm")) {
+            const mcallinfo_t *ci = curins->d.t == mop_f ? curins->d.f : nullptr;
+            hit = ci == nullptr || ci->args.empty() || ci->args[0].t != mop_n ||
+                  ci->args[0].nnn->value == (uint64) idx;
+        } else if (streq(name, "_mm256_zeroall")) {
+            hit = true;
+        } else {
+            hit = strncmp(name, "_mm", 3) != 0 && strncmp(name, "__read", 6) != 0 && !streq(name, "__writemask");
+        }
+        return hit ? 1 : 0;
+    }
+};
+
+bool clobbers_vreg(minsn_t *ins, int idx) {
+    if (ins->modifies_d() && ins->d.t == mop_r) {
+        const int sizes[3] = {XMM_SIZE, YMM_SIZE, ZMM_SIZE};
+        for (int size : sizes) {
+            mreg_t r = vreg_mreg(idx, size);
+            if (r != mr_none && ins->d.r < r + size && r < ins->d.r + ins->d.size)
+                return true;
+        }
+    }
+    vreg_clobber_visitor_t cv(idx);
+    ins->for_all_insns(cv);
+    return cv.hit;
+}
+
+const vconst_t *known_value(consteval_state_t &st, codegen_t &cdg, int idx) {
+    vreg_rec_t &r = st.vregs[idx];
+    if (!r.known)
+        return nullptr;
+    minsn_t *ins = cdg.mb->tail;
+    for (; ins != nullptr && ins != r.before; ins = ins->prev) {
+        if (ins->ea != r.ea && clobbers_vreg(ins, idx))
+            break;
+    }
+    if (ins != r.before) {
+        r.known = false;
+        return nullptr;
+    }
+    return &r.val;
+}
+
+// Value of operand `n`: a tracked vector register, or a read-only constant
+// in memory. `*w` receives the operand width.
+const vconst_t *operand_value(consteval_state_t &st, codegen_t &cdg, int n, vconst_t *buf, int *w) {
+    const op_t &op = cdg.insn.ops[n];
+    memset(buf->b, 0, sizeof(buf->b));
+    if (op.type == o_reg) {
+        int idx = idiom_vec_index(op, w);
+        if (idx < 0)
+            return nullptr;
+        const vconst_t *v = known_value(st, cdg, idx);
+        if (v == nullptr)
+            return nullptr;
+        memcpy(buf->b, v->b, *w);
+        return buf;
+    }
+    if (op.type == o_mem && !is_embedded_broadcast(cdg.insn, op)) {
+        *w = (int) get_dtype_size(op.dtype);
+        if (*w <= 0 || *w > ZMM_SIZE)
+            return nullptr;
+        const bytevec_t *bytes = const_pool_lookup(op.addr, *w);
+        if (bytes == nullptr)
+            return nullptr;
+        memcpy(buf->b, bytes->begin(), *w);
+        return buf;
+    }
+    return nullptr;
+}
+
+// Same-register xor/andn/sub/cmpgt give zero and cmpeq gives all-ones,
+// whatever the register holds.
+bool eval_self_idiom(const insn_t &insn, int width, vconst_t *out) {
+    if (insn.Op2.type != o_reg || insn.Op3.type != o_reg || insn.Op2.reg != insn.Op3.reg)
+        return false;
+    uint8 fill;
+    switch (insn.itype) {
+        case NN_vpxor: case NN_vpxord: case NN_vpxorq: case NN_vxorps: case NN_vxorpd:
+        case NN_vpandn: case NN_vpandnd: case NN_vpandnq: case NN_vandnps: case NN_vandnpd:
+        case NN_vpsubb: case NN_vpsubw: case NN_vpsubd: case NN_vpsubq:
+        case NN_vpsubsb: case NN_vpsubsw: case NN_vpsubusb: case NN_vpsubusw:
+        case NN_vpcmpgtb: case NN_vpcmpgtw: case NN_vpcmpgtd: case NN_vpcmpgtq:
+            fill = 0;
+            break;
+        case NN_vpcmpeqb: case NN_vpcmpeqw: case NN_vpcmpeqd: case NN_vpcmpeqq:
+            fill = 0xFF;
+            break;
+        default:
+            return false;
+    }
+    memset(out->b, 0, sizeof(out->b));
+    memset(out->b, fill, width);
+    return true;
+}
+
+bool is_plain_move(uint16 it) {
+    return it == NN_vmovdqa || it == NN_vmovdqu || it == NN_vmovaps || it == NN_vmovups ||
+           it == NN_vmovapd || it == NN_vmovupd || it == NN_vmovdqa32 || it == NN_vmovdqa64 ||
+           it == NN_vmovdqu8 || it == NN_vmovdqu16 || it == NN_vmovdqu32 || it == NN_vmovdqu64;
+}
+
+// Literal form of the result: the element type the instruction produces
+void result_type(const insn_t &insn, bool *is_fp, int *elem_size) {
+    switch (insn.itype) {
+        case NN_vcvtdq2ps: *is_fp = true; *elem_size = FLOAT_SIZE; return;
+        case NN_vcvtdq2pd: *is_fp = true; *elem_size = DOUBLE_SIZE; return;
+        case NN_vcvttps2dq: *is_fp = false; *elem_size = DWORD_SIZE; return;
+        default: literal_type_for_insn(insn, is_fp, elem_size); return;
+    }
+}
+
+bool emit_result(codegen_t &cdg, const vconst_t &val, int width) {
+    const op_t &dst = cdg.insn.Op1;
+    mreg_t d = width == ZMM_SIZE ? mr_none : reg2mreg(dst.reg);
+    if (width != ZMM_SIZE && d == mr_none)
+        return false;
+
+    bool is_fp;
+    int elem;
+    result_type(cdg.insn, &is_fp, &elem);
+    bytevec_t bytes;
+    bytes.resize(width);
+    memcpy(bytes.begin(), val.b, width);
+    mreg_t lit = emit_vector_literal(cdg, bytes, width, is_fp, elem);
+    if (lit == mr_none)
+        return false;
+
+    tinfo_t vt = get_type_robust(width, !is_fp, is_fp && elem == DOUBLE_SIZE);
+    if (width == ZMM_SIZE)
+        return emit_zmm_write_call(cdg, dst, lit, vt);
+
+    mop_t src_mop(lit, width);
+    mop_t dst_mop(d, width);
+    src_mop.set_udt();
+    dst_mop.set_udt();
+    mop_t dummy;
+    cdg.emit(m_mov, &src_mop, &dummy, &dst_mop);
+    kreg_free(cdg, lit, width);
+    return true;
+}
+
+} // namespace
+
+consteval_state_t *consteval_init() {
+    consteval_state_t *st = new consteval_state_t();
+    st->forget_all();
+    return st;
+}
+
+void consteval_term(consteval_state_t *st) {
+    delete st;
+}
+
+void consteval_reset(consteval_state_t *st) {
+    if (st == nullptr)
+        return;
+    st->mba = nullptr;
+    st->entry = BADADDR;
+    st->blk = nullptr;
+    st->forget_all();
+}
+
+bool consteval_fold(codegen_t &cdg) {
+    const insn_t &insn = cdg.insn;
+    consteval_state_t *st = cur_state();
+    if (st == nullptr)
+        return false;
+    reset_if_new_block(*st, cdg);
+
+    // Writers of registers other than Op1 that the handlers don't model
+    if (is_gather_insn(insn.itype) || is_vzeroupper(insn.itype) || insn.itype == NN_vzeroall) {
+        st->forget_all();
+        return false;
+    }
+
+    int width = 0;
+    int dst = idiom_vec_index(insn.Op1, &width);
+    if (dst < 0 || has_opmask(insn))
+        return false;
+
+    vconst_t vals[4];
+    vconst_args_t args;
+    args.imm = -1;
+    for (int n = 0; n < 4; n++) {
+        args.v[n] = nullptr;
+        args.w[n] = 0;
+        const op_t &op = insn.ops[n];
+        if (op.type == o_imm)
+            args.imm = (int) (op.value & 0xFF);
+        else if (n > 0 || is_ternary_logic_insn(insn.itype))
+            args.v[n] = operand_value(*st, cdg, n, &vals[n], &args.w[n]);
+    }
+
+    vconst_t val;
+    if (!eval_self_idiom(insn, width, &val) && !consteval_eval(insn.itype, width, args, &val))
+        return false;
+    memset(val.b + width, 0, ZMM_SIZE - width);  // VEX/EVEX writes zero the rest
+
+    minsn_t *before = cdg.mb->tail;
+    bool move = is_plain_move(insn.itype);
+    if (!move) {
+        if (!emit_result(cdg, val, width))
+            return false;
+        DEBUG_LOG("%a: folded to a %d-byte constant", insn.ea, width);
+    }
+
+    vreg_rec_t &r = st->vregs[dst];
+    r.known = true;
+    r.before = before;
+    r.ea = insn.ea;
+    r.val = val;
+    return !move;
+}
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,55 @@
+/*
+ AVX Lift-Time Constant Folding
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "avx_types.h"
+
+// Shuffle-control and lookup-table setup code builds vectors out of
+// immediates, read-only constants and zero idioms, then reshuffles them a
+// few times before first use. When every input of an instruction is known,
+// the lifter evaluates it here and emits the result as a vector literal
+// instead of a chain of intrinsic calls.
+//
+// Known values are tracked per vector register within the block being
+// generated. A value is trusted only while the microcode emitted since its
+// definition contains no other write to that register (or an opaque call).
+
+// Vector value, little-endian.
+struct vconst_t {
+    uint8 b[ZMM_SIZE];
+};
+
+struct vconst_args_t {
+    const vconst_t *v[4];   // value of Op1..Op4, nullptr if unknown or not a vector
+    int w[4];               // operand widths in bytes
+    int imm;                // immediate operand, -1 if none
+};
+
+// Evaluate `itype` for a `width`-byte destination. Integer, bitwise, shuffle
+// and exact conversion semantics only: nothing that depends on MXCSR.
+// Returns false if the instruction is not modeled or an input is missing.
+bool consteval_eval(uint16 itype, int width, const vconst_args_t &args, vconst_t *out);
+
+// Fold the current instruction if all of its inputs are known, emitting the
+// destination as a literal. Plain register moves only record their value and
+// return false, so the handler still emits them.
+bool consteval_fold(codegen_t &cdg);
+
+// Per-database records (avx_state_t::consteval), created when the lifter
+// activates
+struct consteval_state_t;
+consteval_state_t *consteval_init();
+void consteval_term(consteval_state_t *st);
+
+// Forget every known register value. Called when a decompilation starts.
+void consteval_reset(consteval_state_t *st);
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,284 @@
+/*
+ AVX Constant Pool Recognition
+*/
+
+#include "avx_constpool.h"
+#include "avx_helpers.h"
+#include "avx_intrinsic.h"
+#include "avx_types.h"
+#include "avx_state.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../common/warn_off.h"
+#include <bytes.hpp>
+#include <segment.hpp>
+#include "../common/warn_on.h"
+
+#include <map>
+#include <utility>
+
+namespace {
+
+struct pool_entry_t {
+    bool valid;
+    bytevec_t bytes;
+};
+
+// Segments without permission info are accepted by name only.
+bool is_rodata_name(const qstring &name) {
+    static const char *const prefixes[] = {".rodata", ".rdata", "__const", "__literal", ".lit"};
+    for (const char *p : prefixes)
+        if (strncmp(name.c_str(), p, strlen(p)) == 0)
+            return true;
+    return false;
+}
+
+bool is_readonly_range(ea_t ea, int width) {
+    segment_t *seg = getseg(ea);
+    if (seg == nullptr || getseg(ea + width - 1) != seg)
+        return false;
+    if (seg->type == SEG_XTRN || seg->type == SEG_BSS)
+        return false;
+    if (seg->perm != 0)
+        return (seg->perm & SEGPERM_WRITE) == 0;
+    qstring name;
+    get_segm_name(&name, seg);
+    return is_rodata_name(name);
+}
+
+uint64 read_elem(const uchar *p, int size) {
+    uint64 v = 0;
+    memcpy(&v, p, size);  // x86 targets are little-endian
+    return v;
+}
+
+// Smallest element size at which the vector is a splat of one value.
+int splat_granularity(const bytevec_t &b) {
+    for (int g = 1; g <= 8; g *= 2) {
+        bool same = true;
+        for (size_t i = g; i < b.size() && same; i++)
+            same = b[i] == b[i % g];
+        if (same)
+            return g;
+    }
+    return 0;
+}
+
+// NaN/Inf lanes (abs/sign masks read as float) don't print as fp literals.
+bool all_finite(const bytevec_t &b, int elem) {
+    for (size_t i = 0; i < b.size(); i += elem) {
+        uint64 v = read_elem(&b[i], elem);
+        bool nonfinite = elem == 4 ? ((v >> 23) & 0xFF) == 0xFF : ((v >> 52) & 0x7FF) == 0x7FF;
+        if (nonfinite)
+            return false;
+    }
+    return true;
+}
+
+const char *si_suffix(int width) {
+    return width == ZMM_SIZE ? "si512" : (width == YMM_SIZE ? "si256" : "si128");
+}
+
+type_t int_bt(int elem) {
+    switch (elem) {
+        case 1: return BT_INT8;
+        case 2: return BT_INT16;
+        case 8: return BT_INT64;
+        default: return BT_INT32;
+    }
+}
+
+// Emit `icall` defining `dst`; on failure `dst` is released and mr_none
+// returned, so no caller reads a register nothing wrote.
+mreg_t emit_into(codegen_t &cdg, AVXIntrinsic &icall, mreg_t dst, const tinfo_t &vt, int width) {
+    icall.set_return_reg(dst, vt);
+    if (icall.emit() == nullptr) {
+        kreg_free(cdg, dst, width);
+        return mr_none;
+    }
+    return dst;
+}
+
+// Integer literal: setzero, set1 at the splat granularity, or setr lanes.
+mreg_t emit_int_literal(codegen_t &cdg, const bytevec_t &b, int width, int elem) {
+    tinfo_t vt = get_vector_type(width, true, false);
+    mreg_t dst = kreg_alloc(cdg, width, false);
+    if (dst == mr_none) return mr_none;
+
+    const char *pfx = get_size_prefix(width);
+    int g = splat_granularity(b);
+    qstring iname;
+    if (g == 1 && b[0] == 0) {
+        iname.sprnt("_mm%s_setzero_%s", pfx, si_suffix(width));
+        AVXIntrinsic icall(&cdg, iname.c_str());
+        return emit_into(cdg, icall, dst, vt, width);
+    }
+    if (g != 0) {
+        iname.sprnt("_mm%s_set1_%s", pfx, get_set_epi_suffix(width, g));
+        AVXIntrinsic icall(&cdg, iname.c_str());
+        icall.add_argument_imm(read_elem(&b[0], g), int_bt(g));
+        return emit_into(cdg, icall, dst, vt, width);
+    }
+
+    // 512-bit setr only exists for 32/64-bit lanes
+    if (width == ZMM_SIZE && elem < 4)
+        elem = 4;
+    // _mm_setr_epi64 takes __m64 and there is no _mm_setr_epi64x: two
+    // 64-bit lanes go through _mm_set_epi64x, highest lane first
+    if (width == XMM_SIZE && elem == 8) {
+        AVXIntrinsic icall(&cdg, "_mm_set_epi64x");
+        icall.add_argument_imm(read_elem(&b[8], 8), int_bt(8));
+        icall.add_argument_imm(read_elem(&b[0], 8), int_bt(8));
+        return emit_into(cdg, icall, dst, vt, width);
+    }
+    iname.sprnt("_mm%s_setr_%s", pfx, get_set_epi_suffix(width, elem));
+    AVXIntrinsic icall(&cdg, iname.c_str());
+    for (size_t i = 0; i < b.size(); i += elem)
+        icall.add_argument_imm(read_elem(&b[i], elem), int_bt(elem));
+    return emit_into(cdg, icall, dst, vt, width);
+}
+
+mreg_t emit_fp_literal(codegen_t &cdg, const bytevec_t &b, int width, bool is_double) {
+    int elem = is_double ? DOUBLE_SIZE : FLOAT_SIZE;
+    const char *pfx = get_size_prefix(width);
+    const char *sfx = is_double ? "pd" : "ps";
+    tinfo_t vt = get_vector_type(width, false, is_double);
+    tinfo_t et(is_double ? BTF_DOUBLE : BTF_FLOAT);
+
+    // Bit patterns that are not ordinary numbers stay integers, viewed as fp
+    if (!all_finite(b, elem)) {
+        mreg_t bits = emit_int_literal(cdg, b, width, elem);
+        if (bits == mr_none) return mr_none;
+        mreg_t dst = kreg_alloc(cdg, width, false);
+        if (dst == mr_none) {
+            kreg_free(cdg, bits, width);
+            return mr_none;
+        }
+        qstring iname;
+        iname.sprnt("_mm%s_cast%s_%s", pfx, si_suffix(width), sfx);
+        AVXIntrinsic icall(&cdg, iname.c_str());
+        icall.add_argument_reg(bits, get_vector_type(width, true, false));
+        return emit_into(cdg, icall, dst, vt, width);
+    }
+
+    mreg_t dst = kreg_alloc(cdg, width, false);
+    if (dst == mr_none) return mr_none;
+
+    qstring iname;
+    int g = splat_granularity(b);
+    bool zero = g == 1 && b[0] == 0;
+    bool splat = g != 0 && g <= elem;
+    if (zero)
+        iname.sprnt("_mm%s_setzero_%s", pfx, sfx);
+    else if (splat)
+        iname.sprnt("_mm%s_set1_%s", pfx, sfx);
+    else
+        iname.sprnt("_mm%s_setr_%s", pfx, sfx);
+
+    AVXIntrinsic icall(&cdg, iname.c_str());
+    if (!zero) {
+        size_t lanes = splat ? 1 : b.size() / elem;
+        for (size_t i = 0; i < lanes; i++) {
+            mop_t fp;
+            fp.make_fpnum(&b[i * elem], elem);
+            icall.add_argument_mop(fp, et);
+        }
+    }
+    return emit_into(cdg, icall, dst, vt, width);
+}
+
+} // namespace
+
+// One per database, owned through avx_state_t. Keyed by (address, width).
+// Misses are cached too: most o_mem vector operands are re-decoded on every
+// decompilation of the function. Byte patches and segment edits can change
+// what a cached address holds, so those drop the whole cache.
+struct const_pool_t : public event_listener_t {
+    std::map<std::pair<ea_t, int>, pool_entry_t> entries;
+    bool hooked = false;
+
+    ssize_t idaapi on_event(ssize_t code, va_list) override {
+        switch (code) {
+            case idb_event::byte_patched:
+            case idb_event::segm_added:
+            case idb_event::segm_deleted:
+            case idb_event::segm_attrs_updated:
+            case idb_event::segm_moved:
+                entries.clear();
+                break;
+            default:
+                break;
+        }
+        return 0;
+    }
+};
+
+const bytevec_t *const_pool_lookup(ea_t ea, int width) {
+    avx_state_t *st = avx_state();
+    if (st == nullptr || st->pool == nullptr)
+        return nullptr;
+    auto key = std::make_pair(ea, width);
+    auto &entries = st->pool->entries;
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        pool_entry_t e;
+        e.valid = false;
+        if (is_readonly_range(ea, width)) {
+            e.bytes.resize(width);
+            e.valid = get_bytes(e.bytes.begin(), width, ea, GMB_READALL) == width;
+        }
+        it = entries.emplace(key, std::move(e)).first;
+    }
+    return it->second.valid ? &it->second.bytes : nullptr;
+}
+
+mreg_t emit_vector_literal(codegen_t &cdg, const bytevec_t &bytes, int width, bool is_fp, int elem_size) {
+    if (is_fp && (elem_size == FLOAT_SIZE || elem_size == DOUBLE_SIZE))
+        return emit_fp_literal(cdg, bytes, width, elem_size == DOUBLE_SIZE);
+    return emit_int_literal(cdg, bytes, width, elem_size);
+}
+
+mreg_t emit_pool_constant(codegen_t &cdg, ea_t ea, int width, bool is_fp, int elem_size) {
+    if (width != XMM_SIZE && width != YMM_SIZE && width != ZMM_SIZE)
+        return mr_none;
+    const bytevec_t *bytes = const_pool_lookup(ea, width);
+    if (bytes == nullptr)
+        return mr_none;
+    DEBUG_LOG("%a: constant pool load from %a (%d bytes)", cdg.insn.ea, ea, width);
+    return emit_vector_literal(cdg, *bytes, width, is_fp, elem_size);
+}
+
+void literal_type_for_insn(const insn_t &insn, bool *is_fp, int *elem_size) {
+    const char *sfx = insn_elem_suffix(insn);
+    *is_fp = streq(sfx, "ps") || streq(sfx, "pd");
+    if (streq(sfx, "ps")) *elem_size = FLOAT_SIZE;
+    else if (streq(sfx, "pd")) *elem_size = DOUBLE_SIZE;
+    else if (streq(sfx, "b")) *elem_size = 1;
+    else if (streq(sfx, "w") || streq(sfx, "ph")) *elem_size = 2;
+    else if (streq(sfx, "q") || streq(sfx, "qq")) *elem_size = 8;
+    else *elem_size = 4;
+}
+
+mreg_t emit_pool_constant_for_insn(codegen_t &cdg, ea_t ea, int width) {
+    bool is_fp;
+    int elem;
+    literal_type_for_insn(cdg.insn, &is_fp, &elem);
+    return emit_pool_constant(cdg, ea, width, is_fp, elem);
+}
+
+const_pool_t *const_pool_init() {
+    const_pool_t *pool = new const_pool_t();
+    pool->hooked = hook_event_listener(HT_IDB, pool, nullptr);
+    return pool;
+}
+
+void const_pool_term(const_pool_t *pool) {
+    if (pool == nullptr)
+        return;
+    if (pool->hooked)
+        unhook_event_listener(HT_IDB, pool);
+    delete pool;
+}
+
+#endif // IDA_SDK_VERSION >= 750
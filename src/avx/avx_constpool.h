@@ -0,0 +1,43 @@
+/*
+ AVX Constant Pool Recognition
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Vector constants (sign masks, shuffle controls, lookup rows) are usually
+// loaded from .rodata through o_mem operands. Instead of materializing the
+// address and loading through it, the lifter decodes the bytes once and emits
+// the value as a _mm*_setzero_* / _mm*_set1_* / _mm*_setr_* literal, which
+// Hex-Rays can fold into the consumer.
+
+// Bytes of the `width`-byte constant at `ea` if it lives in a read-only,
+// loaded segment; nullptr otherwise. Results (including misses) are cached
+// in the current database's pool (avx_state_t), keyed by address and width.
+const bytevec_t *const_pool_lookup(ea_t ea, int width);
+
+// Emit the read-only constant at `ea` as a vector literal into a fresh kreg.
+// `is_fp`/`elem_size` select the literal form (ps/pd vs epi8..epi64).
+// Returns mr_none if `ea` is not a constant pool entry.
+mreg_t emit_pool_constant(codegen_t &cdg, ea_t ea, int width, bool is_fp, int elem_size);
+
+// Same, taking the element type from the instruction's mnemonic.
+mreg_t emit_pool_constant_for_insn(codegen_t &cdg, ea_t ea, int width);
+
+// Emit `width` bytes of `bytes` as a literal into a fresh kreg, in the form
+// emit_pool_constant would pick, and the element type it reads from a mnemonic.
+mreg_t emit_vector_literal(codegen_t &cdg, const bytevec_t &bytes, int width, bool is_fp, int elem_size);
+void literal_type_for_insn(const insn_t &insn, bool *is_fp, int *elem_size);
+
+// Cache lifetime, one pool per database: hooks that database's byte patches
+// and segment changes, which invalidate it.
+struct const_pool_t;
+const_pool_t *const_pool_init();
+void const_pool_term(const_pool_t *pool);
+
+#endif // IDA_SDK_VERSION >= 750
@@ -3,6 +3,7 @@
 */
 
 #include "avx_debug.h"
+#include "avx_state.h"
 
 #if IDA_SDK_VERSION >= 750
 
@@ -12,16 +13,22 @@
 #include <ua.hpp>
 #include "../common/warn_on.h"
 
-bool g_print_debug_info = false;
+static bool print_debug_info() {
+    avx_state_t *st = avx_state();
+    return st != nullptr && st->print_debug_info;
+}
 
 void set_debug_printing(bool enabled) {
-    g_print_debug_info = enabled;
+    avx_state_t *st = avx_state();
+    if (st == nullptr)
+        return;
+    st->print_debug_info = enabled;
     msg("[AVXLifter] Debug printing %s\n", enabled ? "ENABLED" : "DISABLED");
 }
 
 // Print disassembly for a function
 void print_function_disassembly(ea_t func_ea) {
-    if (!g_print_debug_info)
+    if (!print_debug_info())
         return;
 
     // Safety check: validate address
@@ -72,7 +79,7 @@ void print_function_disassembly(ea_t func_ea) {
 
 // Print microcode for a function at a specific maturity level
 void print_function_microcode(mba_t *mba, const char *stage_name) {
-    if (!g_print_debug_info || !mba || !stage_name)
+    if (!print_debug_info() || !mba || !stage_name)
         return;
 
     // Safety check: validate mba structure
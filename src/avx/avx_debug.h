@@ -16,10 +16,7 @@ void print_function_disassembly(ea_t func_ea);
 // Print microcode for a function at a specific maturity level
 void print_function_microcode(mba_t *mba, const char *stage_name);
 
-// Global flag to control debug printing
-extern bool g_print_debug_info;
-
-// Set debug printing on/off
+// Set debug printing on/off for the current database (avx_state.h)
 void set_debug_printing(bool enabled);
 
 #endif // IDA_SDK_VERSION >= 750
@@ -3,12 +3,19 @@ AVX Helper Functions
 */
 
 #include "avx_helpers.h"
+#include "../common/mem_operand.h"
+#include "avx_constpool.h"
 #include "avx_intrinsic.h"
+#include "avx_regmap.h"
+#include "avx_spill.h"
+#include "avx_state.h"
 #include "avx_types.h"
 
 #if IDA_SDK_VERSION >= 750
 
 #include "../common/warn_off.h"
+#include <bytes.hpp>
+#include <idp.hpp>
 #include <name.hpp>
 #include "../common/warn_on.h"
 
@@ -59,7 +66,7 @@ bool is_mask_reg(const op_t &op) {
     if (op.type == o_kreg)
         return true;
     // Also check for k-registers encoded as o_reg
-    if (op.type == o_reg && op.reg >= R_k0 && op.reg <= R_k7)
+    if (op.type == o_reg && kreg_index(op.reg) >= 0)
         return true;
     return false;
 }
@@ -80,21 +87,7 @@ bool is_avx_512(const insn_t &insn) {
 
 // Map XMM mreg -> matching YMM mreg (same number, wider class)
 mreg_t get_ymm_mreg(mreg_t xmm_mreg) {
-    int xmm_reg = mreg2reg(xmm_mreg, XMM_SIZE);
-    if (xmm_reg == -1) return mr_none;
-
-    qstring xmm_name;
-    if (get_reg_name(&xmm_name, xmm_reg, XMM_SIZE) == -1) return mr_none;
-
-    // Convert "xmmN" to "ymmN"
-    if (xmm_name.length() < 3) return mr_none;
-    qstring ymm_name = "ymm";
-    ymm_name += xmm_name.substr(3);
-
-    int ymm_reg = str2reg(ymm_name.c_str());
-    if (ymm_reg == -1) return mr_none;
-
-    return reg2mreg(ymm_reg);
+    return vreg_mreg(vreg_index_of_mreg(xmm_mreg), YMM_SIZE);
 }
 
 // Clear upper lanes of an XMM destination through the matching YMM
@@ -110,11 +103,25 @@ minsn_t *clear_upper(codegen_t &cdg, mreg_t xmm_mreg, int op_size) {
 
 // Load operand with UDT flag support for large operands (> 8 bytes)
 // For standard sizes (<= 32 bytes), use cdg.load_operand().
-// For 64-byte operands (ZMM), we use emit_zmm_load() which bypasses load_operand().
+// For 64-byte operands (ZMM), we use emit_vector_load() which bypasses load_operand().
 mreg_t load_operand_udt(codegen_t &cdg, int opnum, int size) {
+    // A reload of a vector spilled earlier in this block reuses the spilled value,
+    // and a read-only constant becomes a literal instead of a load
+    if (size > 8) {
+        mreg_t fwd = spill_forward_load(cdg, opnum, size);
+        if (fwd != mr_none)
+            return fwd;
+        const op_t &op = cdg.insn.ops[opnum];
+        if (op.type == o_mem) {
+            mreg_t lit = emit_pool_constant_for_insn(cdg, op.addr, size);
+            if (lit != mr_none)
+                return lit;
+        }
+    }
+
     // For sizes > 32 bytes (ZMM), use the manual emit approach
     if (size > YMM_SIZE) {
-        return emit_zmm_load(cdg, opnum, size);
+        return emit_vector_load(cdg, opnum, size);
     }
 
     mreg_t reg = cdg.load_operand(opnum);
@@ -134,22 +141,163 @@ mreg_t load_operand_udt(codegen_t &cdg, int opnum, int size) {
     return reg;
 }
 
-// Emit a ZMM (64-byte) load from memory using load_effective_address() + manual m_ldx.
+// EVEX embedded broadcast ({1toN}) on a memory operand. On register operands
+// EVEX.b selects rounding/SAE instead, so only memory forms qualify.
+bool is_embedded_broadcast(const insn_t &insn, const op_t &op) {
+    return is_mem_op(op) && (insn.evex_flags & EVEX_b) != 0;
+}
+
+// Element type suffix of an instruction's source operands. For conversions
+// the source type precedes the '2' (vcvtdq2ps reads dwords), otherwise it is
+// the mnemonic suffix (vaddps, vpaddq, vpshufb).
+const char *insn_elem_suffix(const insn_t &insn) {
+    const char *mnem = PH.get_canon_mnem(insn.itype);
+    if (mnem == nullptr) return "";
+    const char *two = strchr(mnem, '2');
+    size_t len = two != nullptr ? (size_t)(two - mnem) : strlen(mnem);
+    static const char *const suffixes[] = {"ps", "pd", "ph", "qq", "dq", "q", "d", "w", "b"};
+    for (const char *sfx : suffixes) {
+        size_t n = strlen(sfx);
+        if (len >= n && strncmp(mnem + len - n, sfx, n) == 0)
+            return sfx;
+    }
+    return "";
+}
+
+namespace {
+
+// Vector length EVEX.L'L encodes (16, 32 or 64), 0 if the instruction is not
+// EVEX. With a memory operand it is the wider of the source and destination.
+int evex_vector_length(const insn_t &insn) {
+    uchar b[16];
+    int n = insn.size <= sizeof(b) ? insn.size : sizeof(b);
+    if (get_bytes(b, n, insn.ea) != n) return 0;
+    int i = 0;
+    while (i < n) {
+        switch (b[i]) {
+            case 0x66: case 0x67: case 0xF2: case 0xF3: case 0xF0:
+            case 0x2E: case 0x36: case 0x3E: case 0x26: case 0x64: case 0x65:
+                i++;
+                continue;
+        }
+        break;
+    }
+    if (i + 3 >= n || b[i] != 0x62) return 0;
+    int ll = (b[i + 3] >> 5) & 3;
+    return ll == 3 ? 0 : XMM_SIZE << ll;
+}
+
+// Element size a conversion writes, from the mnemonic after its last '2'
+// (vcvtpd2ps: 4, vcvtpd2udq: 4, vcvtps2pd: 8). 0 if not a conversion.
+int conversion_dest_elem(const insn_t &insn) {
+    const char *mnem = PH.get_canon_mnem(insn.itype);
+    const char *two = mnem != nullptr ? strrchr(mnem, '2') : nullptr;
+    if (two == nullptr) return 0;
+    const char *d = two + 1;
+    if (*d == 'u') d++;
+    if (strncmp(d, "qq", 2) == 0 || strncmp(d, "pd", 2) == 0) return 8;
+    if (strncmp(d, "dq", 2) == 0 || strncmp(d, "ps", 2) == 0) return 4;
+    if (strncmp(d, "ph", 2) == 0 || strncmp(d, "bf", 2) == 0 || *d == 'w') return 2;
+    return 0;
+}
+
+} // namespace
+
+mreg_t load_embedded_broadcast(codegen_t &cdg, int opidx, int *out_size) {
+    const op_t &op = cdg.insn.ops[opidx];
+    const char *sfx = insn_elem_suffix(cdg.insn);
+    bool is_fp = sfx[0] == 'p';
+
+    // IDA types the operand with its element size; fall back to the suffix
+    int elem = get_dtype_size(op.dtype);
+    if (elem < 2 || elem > 8) {
+        if (streq(sfx, "pd") || streq(sfx, "q") || streq(sfx, "qq")) elem = 8;
+        else if (streq(sfx, "ph") || streq(sfx, "w") || streq(sfx, "b")) elem = 2;
+        else elem = 4;
+    }
+
+    // The broadcast fills the source vector: as many elements as the vector
+    // length holds of the wider of source and destination elements, so a
+    // narrowing vcvtpd2ps xmm, [m64bcst] with L'L=256 reads four doubles.
+    // Without an EVEX prefix to decode, use the widest vector operand.
+    int width = 0;
+    int vl = evex_vector_length(cdg.insn);
+    if (vl != 0) {
+        int dest_elem = qmax(conversion_dest_elem(cdg.insn), elem);
+        width = qmax(XMM_SIZE, vl / dest_elem * elem);
+    } else {
+        for (int i = 0; i < 4; i++)
+            if (is_vector_reg(cdg.insn.ops[i]))
+                width = qmax(width, get_vector_size(cdg.insn.ops[i]));
+    }
+    if (width == 0) return mr_none;
+
+    // A handler may load the same operand twice; the splat is shared as long as
+    // this instruction's set1 is still the one defining it. AVXLifter::apply()
+    // forgets it before each instruction.
+    avx_state_t *st = avx_state();
+    if (st != nullptr && st->bcast_ea == cdg.insn.ea && st->bcast_idx == opidx) {
+        for (minsn_t *ins = cdg.mb->tail; ins != nullptr && ins->ea == cdg.insn.ea; ins = ins->prev) {
+            if (ins->d.t == mop_r && ins->d.r == st->bcast_reg && ins->d.size == width) {
+                *out_size = width;
+                return st->bcast_reg;
+            }
+        }
+    }
+
+    mreg_t scalar = cdg.load_operand(opidx);
+    if (scalar == mr_none) return mr_none;
+
+    type_t bt;
+    const char *tsfx;
+    if (is_fp) {
+        bt = elem == 8 ? BT_FLOAT | BTMT_DOUBLE : (elem == 2 ? BT_FLOAT | BTMT_SHRTFLT : BT_FLOAT | BTMT_FLOAT);
+        tsfx = elem == 8 ? "pd" : (elem == 2 ? "ph" : "ps");
+    } else {
+        bt = elem == 8 ? BT_INT64 : (elem == 2 ? BT_INT16 : BT_INT32);
+        tsfx = get_set_epi_suffix(width, elem);
+    }
+
+    mreg_t dst = kreg_alloc(cdg, width, false);
+    if (dst == mr_none) return mr_none;
+
+    qstring iname;
+    iname.sprnt("_mm%s_set1_%s", get_size_prefix(width), tsfx);
+    tinfo_t vt = get_vector_type(width, !is_fp, is_fp && elem == 8);
+    AVXIntrinsic icall(&cdg, iname.c_str());
+    icall.add_argument_reg(scalar, tinfo_t(bt));
+    icall.set_return_reg(dst, vt);
+    if (icall.emit() == nullptr) {
+        kreg_free(cdg, dst, width);
+        return mr_none;
+    }
+
+    if (st != nullptr) {
+        st->bcast_ea = cdg.insn.ea;
+        st->bcast_idx = opidx;
+        st->bcast_reg = dst;
+    }
+    *out_size = width;
+    return dst;
+}
+
+// Emit a vector (16/32/64-byte) load from memory using load_effective_address() + manual m_ldx.
 // This bypasses cdg.load_operand() which fails verification for 64-byte destinations
 // because it internally verifies before we can set the UDT flag.
 //
 // The approach:
-// 1. Use load_effective_address() to compute pointer (pointer-sized, so verifier-safe)
-// 2. Manually emit m_ldx with UDT-flagged 64-byte destination
+// 1. Compute the pointer via memop_address() (pointer-sized, so verifier-safe;
+//    shared with any other access to the same operand in this instruction)
+// 2. Manually emit m_ldx with UDT-flagged destination
 //
 // m_ldx format: ldx {l=seg, r=off}, d
-// - seg: segment register (size 2, typically DS)
+// - seg: segment register (size 2, SS for stack slots, DS otherwise)
 // - off: memory offset/address (size = address size, 8 for 64-bit)
 // - d: destination register (size = data size, 64 for ZMM)
-mreg_t emit_zmm_load(codegen_t &cdg, int opidx, int zmm_size) {
+mreg_t emit_vector_load(codegen_t &cdg, int opidx, int vec_size) {
     // 1. Compute effective address into a temp register
     // load_effective_address() only works with pointer-sized data, so verifier-safe
-    mreg_t ea_reg = cdg.load_effective_address(opidx);
+    mreg_t ea_reg = memop_address(cdg, opidx);
     if (ea_reg == mr_none) {
         // Not a memory operand or failed
         return mr_none;
@@ -158,11 +306,10 @@ mreg_t emit_zmm_load(codegen_t &cdg, int opidx, int zmm_size) {
     // 2. Determine address size (8 for 64-bit mode)
     int addr_size = inf_is_64bit() ? 8 : 4;
 
-    // 3. Build segment operand (DS, size 2)
-    // In 64-bit mode, segment overrides are mostly ignored except for FS/GS
-    // For simplicity, we use DS (R_ds = 3 in intel.hpp)
+    // 3. Build segment operand (size 2)
+    const op_t &op = cdg.insn.ops[opidx];
     mop_t seg;
-    seg.make_reg(reg2mreg(R_ds), 2);
+    seg.make_reg(memop_segment(cdg.insn, op), 2);
 
     // 4. Build offset operand (the effective address we computed)
     mop_t off;
@@ -170,55 +317,64 @@ mreg_t emit_zmm_load(codegen_t &cdg, int opidx, int zmm_size) {
 
     // 5. Allocate destination register and build UDT-flagged destination operand
     // Note: alloc_kreg with check_size=false allows non-standard sizes
-    mreg_t dst_mreg = cdg.mba->alloc_kreg(zmm_size, false);
+    mreg_t dst_mreg = kreg_alloc(cdg, vec_size, false);
     if (dst_mreg == mr_none) {
         return mr_none;
     }
 
     mop_t dst;
-    dst.make_reg(dst_mreg, zmm_size);
-    dst.set_udt();  // Critical: mark as UDT before any verification
+    dst.make_reg(dst_mreg, vec_size);
+    if (vec_size > 8)
+        dst.set_udt();  // Critical: mark as UDT before any verification
 
     // 6. Emit m_ldx with our mops
     // emit() does NOT internally verify - verification happens later at mba->verify()
     minsn_t *ldx = cdg.emit(m_ldx, &seg, &off, &dst);
     if (ldx == nullptr) {
-        cdg.mba->free_kreg(dst_mreg, zmm_size);
+        kreg_free(cdg, dst_mreg, vec_size);
         return mr_none;
     }
 
     return dst_mreg;
 }
 
-// Emit a vector store to memory using store intrinsics.
-// This bypasses m_stx emission which causes INTERR 50708 for large operands.
+// Emit a vector store to memory.
 //
-// All vector stores (XMM/YMM/ZMM) are emitted as intrinsic calls:
-// - _mm_storeu_ps / _mm256_storeu_ps / _mm512_storeu_ps
+// Register-relative addresses (o_displ/o_phrase: stack slots, heap pointers)
+// become a plain UDT-typed m_stx, so the output reads as *(__m256 *)p = v and
+// the store takes part in Hex-Rays' stack variable and dead-store analysis.
 //
-// This approach works for all memory operand types (global, stack, heap).
+// Global addresses (o_mem) keep the store intrinsic path:
+// - _mm_storeu_ps / _mm256_storeu_ps / _mm512_storeu_ps
+// A raw m_stx to an absolute address trips INTERR 50708.
 bool emit_vector_store_mop(codegen_t &cdg, int opidx, const mop_t &src_mop, const tinfo_t &vec_type, int vec_size) {
-    const op_t &op = opidx == 0 ? cdg.insn.Op1 : (opidx == 1 ? cdg.insn.Op2 : cdg.insn.Op3);
+    const op_t &op = cdg.insn.ops[opidx];
     int addr_size = inf_is_64bit() ? 8 : 4;
 
-    // Get the effective address into a register
-    mreg_t addr_reg;
-
-    if (op.type == o_mem) {
-        // Direct memory reference (global address) - load immediate address
-        addr_reg = cdg.mba->alloc_kreg(addr_size);
-        mop_t addr_imm;
-        addr_imm.make_number(op.addr, addr_size);
-        mop_t addr_dst;
-        addr_dst.make_reg(addr_reg, addr_size);
-        mop_t empty;
-        cdg.emit(m_mov, &addr_imm, &empty, &addr_dst);
-    } else {
-        // o_displ or o_phrase - compute effective address
-        addr_reg = cdg.load_effective_address(opidx);
+    if (op.type != o_mem) {
+        // o_displ or o_phrase - compute effective address and store through it
+        mreg_t addr_reg = memop_address(cdg, opidx);
         if (addr_reg == mr_none) {
             return false;
         }
+
+        mop_t val = src_mop;
+        val.size = vec_size;
+        if (vec_size > 8)
+            val.set_udt();
+        mop_t seg;
+        seg.make_reg(memop_segment(cdg.insn, op), 2);
+        mop_t off;
+        off.make_reg(addr_reg, addr_size);
+        minsn_t *stx = cdg.emit(m_stx, &val, &seg, &off);
+        spill_note_store(cdg, opidx, stx, vec_size);
+        return stx != nullptr;
+    }
+
+    // Direct memory reference (global address) - the address is a constant argument
+    mop_t addr;
+    if (!memop_address_arg(cdg, opidx, &addr)) {
+        return false;
     }
 
     // Determine intrinsic name based on size
@@ -237,12 +393,10 @@ bool emit_vector_store_mop(codegen_t &cdg, int opidx, const mop_t &src_mop, cons
 
     // Build the intrinsic call (void return)
     AVXIntrinsic icall(&cdg, iname);
-    icall.add_argument_reg(addr_reg, ptr_type);
+    icall.add_argument_mop(addr, ptr_type);
     icall.add_argument_mop(src_mop, vec_type);
     icall.emit_void();
 
-    // Don't free addr_reg - it's used in the emitted instruction
-
     return true;
 }
 
@@ -255,16 +409,11 @@ bool emit_vector_store(codegen_t &cdg, int opidx, mreg_t src_mreg, int vec_size)
     return emit_vector_store_mop(cdg, opidx, src_mop, vec_type, vec_size);
 }
 
-// Legacy name for backwards compatibility
-bool emit_zmm_store(codegen_t &cdg, int opidx, mreg_t src_mreg, int zmm_size) {
-    return emit_vector_store(cdg, opidx, src_mreg, zmm_size);
-}
-
 mreg_t widen_loaded_value(codegen_t &cdg, mreg_t loaded_reg, int loaded_size, int want_size) {
     // Nothing to do for register sources (loaded_size==0) or already-wide loads.
     if (loaded_reg == mr_none || loaded_size <= 0 || loaded_size >= want_size)
         return loaded_reg;
-    mreg_t wide = cdg.mba->alloc_kreg(want_size);
+    mreg_t wide = kreg_alloc(cdg, want_size);
     if (wide == mr_none)
         return loaded_reg;  // fall back; caller behaviour unchanged
     mop_t src(loaded_reg, loaded_size);
@@ -278,68 +427,39 @@ mreg_t widen_loaded_value(codegen_t &cdg, mreg_t loaded_reg, int loaded_size, in
 
 int get_zmm_reg_index(const op_t &op) {
     if (!is_zmm_reg(op)) return -1;
-
-    if (op.reg >= R_zmm0 && op.reg <= R_zmm31) return op.reg - R_zmm0;
-    if (op.reg >= R_ymm0 && op.reg <= R_ymm15) return op.reg - R_ymm0;
-    if (op.reg >= R_ymm16 && op.reg <= R_ymm31) return 16 + (op.reg - R_ymm16);
-    if (op.reg >= R_xmm0 && op.reg <= R_xmm15) return op.reg - R_xmm0;
-    if (op.reg >= R_xmm16 && op.reg <= R_xmm31) return 16 + (op.reg - R_xmm16);
-
-    return -1;
-}
-
-static void add_helper_imm_arg(mcallinfo_t *call_info, int &stk_off, uint64 value, type_t bt) {
-    tinfo_t ti(bt);
-    int size = (int) ti.get_size();
-    mcallarg_t ca;
-    ca.make_number(value, size);
-    ca.type = ti;
-    ca.size = size;
-
-    int align = size < 8 ? 8 : size;
-    stk_off = (stk_off + align - 1) & ~(align - 1);
-    ca.argloc.set_stkoff(stk_off);
-    stk_off += ca.size;
-
-    call_info->args.add(ca);
-    call_info->solid_args++;
-}
-
-static void add_helper_reg_arg(mcallinfo_t *call_info, int &stk_off, mreg_t reg, const tinfo_t &ti, int size) {
-    mcallarg_t ca(mop_t(reg, size));
-    ca.type = ti;
-    ca.size = size;
-
-    int align = size < 8 ? 8 : size;
-    stk_off = (stk_off + align - 1) & ~(align - 1);
-    ca.argloc.set_stkoff(stk_off);
-    stk_off += ca.size;
-
-    call_info->args.add(ca);
-    call_info->solid_args++;
+    return vreg_index(op.reg);
 }
 
 bool make_vector_load_mop(codegen_t &cdg, int opidx, mop_t &out_mop, const tinfo_t &vec_type, int vec_size,
                           bool is_int, bool is_double) {
-    const op_t &op = opidx == 0 ? cdg.insn.Op1 : (opidx == 1 ? cdg.insn.Op2 : cdg.insn.Op3);
+    const op_t &op = cdg.insn.ops[opidx];
     if (!is_mem_op(op)) return false;
 
-    int addr_size = inf_is_64bit() ? 8 : 4;
-    mreg_t addr_reg;
-    if (op.type == o_mem) {
-        addr_reg = cdg.mba->alloc_kreg(addr_size);
-        if (addr_reg == mr_none) return false;
-        mop_t addr_imm;
-        addr_imm.make_number(op.addr, addr_size);
-        mop_t addr_dst;
-        addr_dst.make_reg(addr_reg, addr_size);
-        mop_t empty;
-        cdg.emit(m_mov, &addr_imm, &empty, &addr_dst);
-    } else {
-        addr_reg = cdg.load_effective_address(opidx);
-        if (addr_reg == mr_none) return false;
+    // Register-relative operands load with a typed m_ldx; the consumer then
+    // reads *(__m512 *)p directly instead of a nested loadu helper.
+    if (op.type != o_mem) {
+        mreg_t val = spill_forward_load(cdg, opidx, vec_size);
+        if (val == mr_none)
+            val = emit_vector_load(cdg, opidx, vec_size);
+        if (val == mr_none) return false;
+        out_mop.make_reg(val, vec_size);
+        if (vec_size > 8) out_mop.set_udt();
+        return true;
+    }
+
+    // Read-only constants are emitted as literals
+    mreg_t lit = emit_pool_constant(cdg, op.addr, vec_size, !is_int, is_double ? DOUBLE_SIZE : FLOAT_SIZE);
+    if (lit != mr_none) {
+        out_mop.make_reg(lit, vec_size);
+        out_mop.set_udt();
+        return true;
     }
 
+    // Other global addresses keep the loadu helper around an immediate address,
+    // mirroring the store side (see emit_vector_store_mop).
+    mop_t addr;
+    if (!memop_address_arg(cdg, opidx, &addr)) return false;
+
     const char *iname;
     if (vec_size == ZMM_SIZE) {
         iname = is_int ? "_mm512_loadu_si512" : (is_double ? "_mm512_loadu_pd" : "_mm512_loadu_ps");
@@ -352,23 +472,10 @@ bool make_vector_load_mop(codegen_t &cdg, int opidx, mop_t &out_mop, const tinfo
     tinfo_t ptr_type;
     ptr_type.create_ptr(tinfo_t(BT_VOID));
 
-    mcallinfo_t *call_info = (mcallinfo_t *) qalloc(sizeof(mcallinfo_t));
-    new(call_info) mcallinfo_t();
-    call_info->cc = CM_CC_SPECIAL;
-    call_info->flags = FCI_SPLOK | FCI_FINAL | FCI_PROP;
-    call_info->return_type = vec_type;
-
-    int stk_off = 0;
-    add_helper_reg_arg(call_info, stk_off, addr_reg, ptr_type, addr_size);
-
-    minsn_t *call_insn = (minsn_t *) qalloc(sizeof(minsn_t));
-    new(call_insn) minsn_t(cdg.insn.ea);
-    call_insn->opcode = m_call;
-    call_insn->l.make_helper(iname);
-    call_insn->d.t = mop_f;
-    call_insn->d.f = call_info;
-    call_insn->d.size = vec_size;
-    if (vec_size > 8) call_insn->d.set_udt();
+    intrinsic_call_t load(cdg.insn.ea, iname, CM_CC_SPECIAL, 1);
+    load.add_mop(addr, ptr_type, addr.size);
+    load.set_return_type(vec_type);
+    minsn_t *call_insn = load.detach();
 
     out_mop.make_insn(call_insn);
     out_mop.size = vec_size;
@@ -377,35 +484,17 @@ bool make_vector_load_mop(codegen_t &cdg, int opidx, mop_t &out_mop, const tinfo
 }
 
 minsn_t *make_zmm_read_call(codegen_t &cdg, int zmm_index, const tinfo_t &ti) {
-    mcallinfo_t *call_info = (mcallinfo_t *) qalloc(sizeof(mcallinfo_t));
-    new(call_info) mcallinfo_t();
-    call_info->cc = CM_CC_SPECIAL;
-    call_info->flags = FCI_SPLOK | FCI_FINAL | FCI_PROP;
-    call_info->return_type = ti;
-
-    int stk_off = 0;
-    add_helper_imm_arg(call_info, stk_off, (uint64) zmm_index, BT_INT32);
-
-    minsn_t *call_insn = (minsn_t *) qalloc(sizeof(minsn_t));
-    new(call_insn) minsn_t(cdg.insn.ea);
-    call_insn->opcode = m_call;
-    call_insn->l.make_helper("__readzmm");
-    call_insn->d.t = mop_f;
-    call_insn->d.f = call_info;
-    call_insn->d.size = (int) ti.get_size();
-    call_insn->d.set_udt();
-    return call_insn;
+    intrinsic_call_t read(cdg.insn.ea, "__readzmm", CM_CC_SPECIAL, 1);
+    read.add_imm((uint64) zmm_index, tinfo_t(BT_INT32), 4);
+    read.set_return_type(ti);
+    return read.detach();
 }
 
 bool add_zmm_read_arg(codegen_t &cdg, AVXIntrinsic &icall, const op_t &op, const tinfo_t &ti) {
     int zmm_index = get_zmm_reg_index(op);
     if (zmm_index < 0) return false;
 
-    mop_t read_mop;
-    read_mop.make_insn(make_zmm_read_call(cdg, zmm_index, ti));
-    read_mop.size = (int) ti.get_size();
-    read_mop.set_udt();
-    icall.add_argument_mop(read_mop, ti);
+    icall.add_argument_insn(make_zmm_read_call(cdg, zmm_index, ti), ti);
     return true;
 }
 
@@ -421,7 +510,7 @@ bool emit_zmm_write_call(codegen_t &cdg, const op_t &op, mreg_t value_reg, const
     // kreg is reused instead of leaving many large (ZMM/YMM) temporaries live
     // across block boundaries, which trips Hex-Rays INTERR 50920.
     if (ok && is_kreg(value_reg))
-        cdg.mba->free_kreg(value_reg, (int) ti.get_size());
+        kreg_free(cdg, value_reg, (int) ti.get_size());
     return ok;
 }
 
@@ -438,9 +527,8 @@ bool emit_zmm_write_mop(codegen_t &cdg, const op_t &op, const mop_t &value, cons
 // ---- opmask (k0-k7) modeling via __readmask/__writemask helpers ----
 
 int get_kreg_index(const op_t &op) {
-    if (op.type == o_kreg) return op.reg - R_k0;
-    if (op.type == o_reg && op.reg >= R_k0 && op.reg <= R_k7) return op.reg - R_k0;
-    return -1;
+    if (op.type != o_kreg && op.type != o_reg) return -1;
+    return kreg_index(op.reg);
 }
 
 // Integer type wide enough to hold a mask of `num_elements` bits (__mmask8/16/32/64).
@@ -452,32 +540,16 @@ tinfo_t kmask_type_for(int num_elements) {
 }
 
 minsn_t *make_kmask_read_call(codegen_t &cdg, int kidx, const tinfo_t &ti) {
-    mcallinfo_t *call_info = (mcallinfo_t *) qalloc(sizeof(mcallinfo_t));
-    new(call_info) mcallinfo_t();
-    call_info->cc = CM_CC_SPECIAL;
-    call_info->flags = FCI_SPLOK | FCI_FINAL | FCI_PROP;
-    call_info->return_type = ti;
-
-    int stk_off = 0;
-    add_helper_imm_arg(call_info, stk_off, (uint64) kidx, BT_INT32);
-
-    minsn_t *call_insn = (minsn_t *) qalloc(sizeof(minsn_t));
-    new(call_insn) minsn_t(cdg.insn.ea);
-    call_insn->opcode = m_call;
-    call_insn->l.make_helper("__readmask");
-    call_insn->d.t = mop_f;
-    call_insn->d.f = call_info;
-    call_insn->d.size = (int) ti.get_size();
-    return call_insn;
+    intrinsic_call_t read(cdg.insn.ea, "__readmask", CM_CC_SPECIAL, 1);
+    read.add_imm((uint64) kidx, tinfo_t(BT_INT32), 4);
+    read.set_return_type(ti);
+    return read.detach();
 }
 
 bool add_kmask_read_arg(codegen_t &cdg, AVXIntrinsic &icall, const op_t &op, const tinfo_t &ti) {
     int kidx = get_kreg_index(op);
     if (kidx < 0) return false;
-    mop_t read_mop;
-    read_mop.make_insn(make_kmask_read_call(cdg, kidx, ti));
-    read_mop.size = (int) ti.get_size();
-    icall.add_argument_mop(read_mop, ti);
+    icall.add_argument_insn(make_kmask_read_call(cdg, kidx, ti), ti);
     return true;
 }
 
@@ -489,7 +561,7 @@ bool emit_kmask_write_call(codegen_t &cdg, const op_t &op, mreg_t value_reg, con
     write.add_argument_reg(value_reg, ti);
     bool ok = write.emit_void() != nullptr;
     if (ok && is_kreg(value_reg))
-        cdg.mba->free_kreg(value_reg, (int) ti.get_size());
+        kreg_free(cdg, value_reg, (int) ti.get_size());
     return ok;
 }
 
@@ -564,7 +636,8 @@ bool is_zero_masking(const insn_t &insn) {
 // Get the opmask register number (0-7 for k0-k7)
 int get_opmask_reg(const insn_t &insn) {
     if (insn.Op6.type == o_kreg || insn.Op6.type == o_reg) {
-        return insn.Op6.reg - R_k0;
+        int k = kreg_index(insn.Op6.reg);
+        if (k >= 0) return k;
     }
     return 0; // k0 = no masking
 }
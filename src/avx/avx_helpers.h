@@ -11,6 +11,7 @@
 
 #if IDA_SDK_VERSION >= 750
 
+#include "avx_kreg.h"
 #include "avx_types.h"
 
 struct AVXIntrinsic;
@@ -44,6 +45,19 @@ inline const char *get_size_prefix(int size) {
 
 inline int get_vector_bits(int size) { return size * 8; }
 
+// Integer suffix of _mm*_set/set1/setr for `elem`-byte lanes. The 128/256-bit
+// 64-bit forms are spelled epi64x (_mm_set1_epi64 takes an __m64), except
+// that no _mm_setr_epi64x exists: 128-bit setr of 64-bit lanes has to be
+// written as _mm_set_epi64x with the lanes reversed.
+inline const char *get_set_epi_suffix(int size, int elem) {
+    switch (elem) {
+        case 1: return "epi8";
+        case 2: return "epi16";
+        case 8: return size == ZMM_SIZE ? "epi64" : "epi64x";
+        default: return "epi32";
+    }
+}
+
 bool is_avx512_reg(const op_t &op);
 
 bool is_mask_reg(const op_t &op);
@@ -64,13 +78,26 @@ bool store_operand_hack(codegen_t &cdg, int n, const mop_t &mop, int flags = 0,
 // 64-byte operands to pass the microcode verifier.
 mreg_t load_operand_udt(codegen_t &cdg, int opnum, int size);
 
-// Emit a ZMM (64-byte) load from memory using load_effective_address() + manual m_ldx.
+// Element type suffix of the instruction's source ("ps", "pd", "ph", "q",
+// "d", "w", "b", ...), taken from the canonical mnemonic. Empty if unknown.
+const char *insn_elem_suffix(const insn_t &insn);
+
+// EVEX embedded broadcast ({1toN}) memory operand?
+bool is_embedded_broadcast(const insn_t &insn, const op_t &op);
+
+// Load an embedded-broadcast operand as a single _mm*_set1_* of the scalar
+// element, sized to the source vector the instruction reads (EVEX.L'L; the
+// size is returned in *out_size).
+// Only the scalar is read from memory. Returns mr_none on failure.
+mreg_t load_embedded_broadcast(codegen_t &cdg, int opidx, int *out_size);
+
+// Emit a vector load from memory using load_effective_address() + manual UDT m_ldx.
 // This bypasses cdg.load_operand() which fails verification for 64-byte destinations.
 // Returns the destination register containing the loaded value, or mr_none on failure.
-mreg_t emit_zmm_load(codegen_t &cdg, int opidx, int zmm_size = ZMM_SIZE);
+mreg_t emit_vector_load(codegen_t &cdg, int opidx, int vec_size);
 
-// Emit a vector store to memory using load_effective_address() + manual m_stx.
-// This bypasses the ldx->stx conversion approach which fails for global addresses.
+// Emit a vector store to memory. Register-relative addresses get a UDT m_stx;
+// global (o_mem) addresses fall back to a _mm*_storeu_ps call (INTERR 50708).
 // Works for XMM (16-byte), YMM (32-byte), and ZMM (64-byte) sizes.
 // Returns true on success, false on failure.
 bool emit_vector_store(codegen_t &cdg, int opidx, mreg_t src_mreg, int vec_size);
@@ -78,9 +105,6 @@ bool emit_vector_store_mop(codegen_t &cdg, int opidx, const mop_t &src_mop, cons
 bool make_vector_load_mop(codegen_t &cdg, int opidx, mop_t &out_mop, const tinfo_t &vec_type, int vec_size,
                           bool is_int, bool is_double);
 
-// Legacy name for backwards compatibility
-bool emit_zmm_store(codegen_t &cdg, int opidx, mreg_t src_mreg, int zmm_size = ZMM_SIZE);
-
 // Ensure a freshly-loaded narrow value can be read at `want_size` bytes without
 // referencing undefined bytes. If `loaded_size` is positive and smaller than
 // `want_size` (a sub-width MEMORY load, e.g. a scalar m16/m32/m64), zero-extend
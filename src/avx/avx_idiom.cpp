@@ -0,0 +1,655 @@
+/*
+ AVX Idiom Engine - multi-instruction pattern lifting
+*/
+
+#include "avx_idiom.h"
+#include "avx_helpers.h"
+#include "avx_intrinsic.h"
+#include "avx_regmap.h"
+#include "avx_state.h"
+#include "avx_utils.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../common/warn_off.h"
+#include <idp.hpp>
+#include <funcs.hpp>
+#include <xref.hpp>
+#include <intel.hpp>
+#include "../common/warn_on.h"
+
+#include <map>
+#include <string>
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Compiled patterns
+//-----------------------------------------------------------------------------
+enum idiom_opk_t : uint8 {
+    IOK_VOID,       // operand absent
+    IOK_ANY,        // '*'
+    IOK_OPT,        // '?'
+    IOK_VREG,       // %N
+    IOK_VREG_MEM,   // &N
+    IOK_IMM,        // #V[|W...]
+};
+
+struct idiom_opnd_t {
+    idiom_opk_t kind = IOK_VOID;
+    uint8 var = 0;
+    uint8 width = 0;                // 0 = any
+    qvector<uint64> imms;
+};
+
+struct idiom_step_t {
+    qvector<uint16> itypes;
+    bool commutative = false;
+    idiom_opnd_t ops[4];
+};
+
+struct compiled_idiom_t {
+    idiom_t def;
+    qvector<idiom_step_t> steps;
+};
+
+qvector<idiom_t> &pending() {
+    static qvector<idiom_t> v;
+    return v;
+}
+
+qvector<compiled_idiom_t> g_idioms;
+bool g_compiled = false;
+// Idioms whose first step can start at a given itype
+std::map<uint16, qvector<int>> g_by_first;
+int g_max_steps = 0;
+
+std::map<std::string, uint16> build_mnem_map() {
+    std::map<std::string, uint16> m;
+    for (int it = PH.instruc_start; it < PH.instruc_end; it++) {
+        const char *nm = PH.get_canon_mnem((uint16) it);
+        if (nm != nullptr && nm[0] != '\0')
+            m.emplace(nm, (uint16) it);
+    }
+    return m;
+}
+
+bool parse_operand(const char *tok, idiom_opnd_t *op) {
+    while (qisspace(*tok)) tok++;
+    if (*tok == '*') {
+        op->kind = IOK_ANY;
+        return true;
+    }
+    if (*tok == '?') {
+        op->kind = IOK_OPT;
+        return true;
+    }
+    if (*tok == '%' || *tok == '&') {
+        op->kind = *tok == '%' ? IOK_VREG : IOK_VREG_MEM;
+        if (!qisdigit(tok[1]) || tok[1] - '0' >= IDIOM_MAX_VARS)
+            return false;
+        op->var = (uint8)(tok[1] - '0');
+        if (tok[2] == '.') {
+            switch (tok[3]) {
+                case 'x': op->width = XMM_SIZE; break;
+                case 'y': op->width = YMM_SIZE; break;
+                case 'z': op->width = ZMM_SIZE; break;
+                default: return false;
+            }
+        }
+        return true;
+    }
+    if (*tok == '#') {
+        op->kind = IOK_IMM;
+        const char *p = tok + 1;
+        while (*p != '\0') {
+            char *end = nullptr;
+            op->imms.push_back(strtoull(p, &end, 0));
+            if (end == p)
+                return false;
+            p = *end == '|' ? end + 1 : end;
+            if (*end != '|')
+                break;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool compile_idiom(const idiom_t &def, const std::map<std::string, uint16> &mnems, compiled_idiom_t *out) {
+    out->def = def;
+    qstring text(def.pattern);
+    qstrvec_t lines;
+    size_t pos = 0;
+    while (pos <= text.length()) {
+        size_t nl = text.find('\n', pos);
+        if (nl == qstring::npos) nl = text.length();
+        qstring line = text.substr(pos, nl);
+        line.trim2();
+        if (!line.empty())
+            lines.push_back(line);
+        pos = nl + 1;
+    }
+    if (lines.empty() || lines.size() > IDIOM_MAX_STEPS)
+        return false;
+
+    for (const qstring &line : lines) {
+        idiom_step_t step;
+        size_t sp = line.find(' ');
+        qstring mnem = sp == qstring::npos ? line : line.substr(0, sp);
+        qstring rest = sp == qstring::npos ? qstring() : line.substr(sp + 1);
+        if (!mnem.empty() && mnem.last() == '~') {
+            step.commutative = true;
+            mnem.remove_last();
+        }
+        size_t mpos = 0;
+        while (mpos <= mnem.length()) {
+            size_t bar = mnem.find('|', mpos);
+            if (bar == qstring::npos) bar = mnem.length();
+            auto it = mnems.find(mnem.substr(mpos, bar).c_str());
+            if (it == mnems.end()) {
+                msg("[AVXLifter] idiom %s: unknown mnemonic '%s'\n", def.name, mnem.substr(mpos, bar).c_str());
+                return false;
+            }
+            step.itypes.push_back(it->second);
+            mpos = bar + 1;
+        }
+        int n = 0;
+        size_t opos = 0;
+        while (!rest.empty() && opos <= rest.length()) {
+            size_t comma = rest.find(',', opos);
+            if (comma == qstring::npos) comma = rest.length();
+            if (n >= 4 || !parse_operand(rest.substr(opos, comma).c_str(), &step.ops[n])) {
+                msg("[AVXLifter] idiom %s: bad operand in '%s'\n", def.name, line.c_str());
+                return false;
+            }
+            n++;
+            opos = comma + 1;
+        }
+        out->steps.push_back(step);
+    }
+    return true;
+}
+
+void compile_all() {
+    if (g_compiled)
+        return;
+    g_compiled = true;
+    std::map<std::string, uint16> mnems = build_mnem_map();
+    for (const idiom_t &def : pending()) {
+        compiled_idiom_t ci;
+        if (!compile_idiom(def, mnems, &ci))
+            continue;
+        int idx = (int) g_idioms.size();
+        for (uint16 it : ci.steps[0].itypes)
+            g_by_first[it].push_back(idx);
+        g_max_steps = qmax(g_max_steps, (int) ci.steps.size());
+        g_idioms.push_back(ci);
+    }
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Per-function state: decoded window cache and consumed windows
+//-----------------------------------------------------------------------------
+struct idiom_state_t {
+    mba_t *mba = nullptr;
+    std::map<ea_t, insn_t> decoded;
+    // consumed ea -> head ea of the window that lifted it, and the reverse
+    std::map<ea_t, ea_t> consumed;
+    std::map<ea_t, qvector<ea_t>> windows;
+    // head ea -> match found by idiom_match(), waiting for idiom_apply()
+    std::map<ea_t, idiom_match_t> pending;
+    // start ea -> "no idiom starts here", so repeated match() calls are cheap
+    std::map<ea_t, bool> no_match;
+
+    void clear() {
+        mba = nullptr;
+        decoded.clear();
+        consumed.clear();
+        windows.clear();
+        pending.clear();
+        no_match.clear();
+    }
+};
+
+namespace {
+
+// The current database's state; null before its lifter activates
+idiom_state_t *cur_state() {
+    avx_state_t *st = avx_state();
+    return st != nullptr ? st->idiom : nullptr;
+}
+
+idiom_state_t *sync_state(codegen_t &cdg) {
+    idiom_state_t *st = cur_state();
+    if (st != nullptr && st->mba != cdg.mba) {
+        st->clear();
+        st->mba = cdg.mba;
+    }
+    return st;
+}
+
+const insn_t *decode_cached(ea_t ea) {
+    idiom_state_t *st = cur_state();
+    if (st == nullptr)
+        return nullptr;
+    auto it = st->decoded.find(ea);
+    if (it != st->decoded.end())
+        return it->second.ea == BADADDR ? nullptr : &it->second;
+    insn_t insn;
+    if (decode_insn(&insn, ea) <= 0)
+        insn.ea = BADADDR;
+    auto ins = st->decoded.emplace(ea, insn).first;
+    return ins->second.ea == BADADDR ? nullptr : &ins->second;
+}
+
+} // namespace
+
+// Physical vector register index (0-31) and width of a register operand
+int idiom_vec_index(const op_t &op, int *width) {
+    if (!is_vector_reg(op))
+        return -1;
+    int idx = vreg_index(op.reg);
+    if (idx >= 0)
+        *width = vreg_width(op.reg);
+    return idx;
+}
+
+namespace {
+
+int vec_index(const op_t &op, int *width) { return idiom_vec_index(op, width); }
+
+bool match_operand(const idiom_opnd_t &p, const insn_t &insn, int opn, int step, idiom_match_t *m) {
+    const op_t &op = insn.ops[opn];
+    switch (p.kind) {
+        case IOK_VOID:
+            return op.type == o_void;
+        case IOK_ANY:
+            return op.type != o_void;
+        case IOK_OPT:
+            return true;
+        case IOK_IMM:
+            if (op.type != o_imm)
+                return false;
+            for (uint64 v : p.imms)
+                if (op.value == v)
+                    return true;
+            return false;
+        case IOK_VREG:
+        case IOK_VREG_MEM: {
+            if (p.kind == IOK_VREG_MEM && is_mem_op(op)) {
+                // Memory-bound variables are used once, where they are read
+                if (m->reg[p.var] != -1 || m->mem_step[p.var] != -1)
+                    return false;
+                m->mem_step[p.var] = step;
+                m->opidx[p.var] = opn;
+                m->width[p.var] = p.width != 0 ? p.width : get_dtype_size(op.dtype);
+                return true;
+            }
+            int w = 0;
+            int idx = vec_index(op, &w);
+            if (idx < 0 || (p.width != 0 && p.width != w))
+                return false;
+            if (m->mem_step[p.var] != -1)
+                return false;
+            if (m->reg[p.var] == -1) {
+                // Distinct variables name distinct registers
+                for (int v = 0; v < IDIOM_MAX_VARS; v++)
+                    if (m->reg[v] == idx)
+                        return false;
+                m->reg[p.var] = idx;
+            } else if (m->reg[p.var] != idx) {
+                return false;
+            }
+            m->width[p.var] = qmax(m->width[p.var], w);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool match_step(const idiom_step_t &s, const insn_t &insn, int step, idiom_match_t *m) {
+    bool it_ok = false;
+    for (uint16 it : s.itypes)
+        it_ok |= it == insn.itype;
+    if (!it_ok || has_opmask(insn) || insn.segpref == R_fs || insn.segpref == R_gs)
+        return false;
+
+    idiom_match_t saved = *m;
+    bool ok = true;
+    for (int i = 0; i < 4 && ok; i++)
+        ok = match_operand(s.ops[i], insn, i, step, m);
+    if (ok || !s.commutative)
+        return ok;
+
+    // Retry with the two sources swapped
+    *m = saved;
+    static const int order[4] = {0, 2, 1, 3};
+    for (int i = 0; i < 4; i++)
+        if (!match_operand(s.ops[i], insn, order[i], step, m))
+            return false;
+    return true;
+}
+
+// A window may not contain a branch target (it would split the block) and
+// must stay inside one function chunk.
+bool window_is_straight(ea_t next, const range_t &chunk) {
+    if (next >= chunk.end_ea)
+        return false;
+    return get_first_fcref_to(next) == BADADDR;
+}
+
+// VEX/EVEX forms have their own itypes, all spelled with a leading 'v'
+bool is_vex_form(const insn_t &insn) {
+    const char *nm = PH.get_canon_mnem(insn.itype);
+    return nm != nullptr && nm[0] == 'v';
+}
+
+// Registers written by an instruction (vector registers only)
+uint32 vec_regs_written(const insn_t &insn) {
+    uint32 feat = insn.get_canon_feature(PH);
+    uint32 mask = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!has_cf_chg(feat, i))
+            continue;
+        int w = 0;
+        int idx = vec_index(insn.ops[i], &w);
+        if (idx >= 0)
+            mask |= 1u << idx;
+    }
+    return mask;
+}
+
+// Scan forward from `ea` and check that none of the `regs` is read before
+// being overwritten. Gives up (returns false) on branches and after a
+// bounded number of instructions.
+bool regs_dead_after(ea_t ea, uint32 regs, const range_t &chunk) {
+    const int MAX_SCAN = 32;
+    for (int n = 0; n < MAX_SCAN && regs != 0 && ea < chunk.end_ea; n++) {
+        const insn_t *insn = decode_cached(ea);
+        if (insn == nullptr)
+            return false;
+        if (insn->itype == NN_vzeroall)
+            return true;
+        if (is_ret_insn(*insn))
+            return (regs & 0x3) == 0;    // xmm0/xmm1 carry return values
+        if (is_call_insn(*insn)) {
+            // Vector arguments: xmm0-7 on SysV, xmm0-5 with __vectorcall on
+            // Windows. Past them, xmm0-5 are volatile everywhere; the rest
+            // stay tracked even where the ABI clobbers them.
+            uint32 args = inf_get_filetype() == f_PE ? 0x3Fu : 0xFFu;
+            if ((regs & args) != 0)
+                return false;
+            regs &= ~0x3Fu;
+            ea = insn->ea + insn->size;
+            continue;
+        }
+        uint32 feat = insn->get_canon_feature(PH);
+        if ((feat & CF_STOP) != 0 || (feat & CF_JUMP) != 0 || is_basic_block_end(*insn, false))
+            return false;
+        // The VSIB index is a vector read hidden in the memory operand
+        if (is_gather_insn(insn->itype) || is_scatter_insn(insn->itype))
+            return false;
+        bool vex = is_vex_form(*insn);
+        // Merge masking keeps the destination's unselected lanes
+        bool whole = !has_opmask(*insn) || is_zero_masking(*insn);
+        // Legacy blendv/pblendvb/sha256rnds2 read xmm0 implicitly
+        if (!vex && (regs & 1) != 0 && is_vector_reg(insn->Op1))
+            return false;
+        uint32 killed = 0;
+        for (int i = 0; i < UA_MAXOP && insn->ops[i].type != o_void; i++) {
+            const op_t &op = insn->ops[i];
+            int w = 0;
+            int idx = vec_index(op, &w);
+            if (idx < 0 || (regs & (1u << idx)) == 0)
+                continue;
+            if (has_cf_use(feat, i))
+                return false;
+            // An unmasked (or zero-masked) VEX/EVEX write replaces the whole
+            // register; a legacy SSE write keeps the upper lanes, which still
+            // hold our value.
+            if (has_cf_chg(feat, i) && vex && whole)
+                killed |= 1u << idx;
+            else
+                return false;
+        }
+        regs &= ~killed;
+        ea = insn->ea + insn->size;
+    }
+    return regs == 0;
+}
+
+bool try_match_at(ea_t start, idiom_match_t *out) {
+    auto cands = g_by_first.find(decode_cached(start)->itype);
+    if (cands == g_by_first.end())
+        return false;
+    func_t *chunk = get_fchunk(start);
+    if (chunk == nullptr)
+        return false;
+
+    // Decode the longest window once; idioms are tried against it in order
+    const insn_t *win[IDIOM_MAX_STEPS];
+    int nwin = 0;
+    ea_t ea = start;
+    while (nwin < g_max_steps) {
+        if (nwin > 0 && !window_is_straight(ea, *chunk))
+            break;
+        const insn_t *insn = decode_cached(ea);
+        if (insn == nullptr)
+            break;
+        win[nwin++] = insn;
+        ea = insn->ea + insn->size;
+    }
+
+    for (int idx : cands->second) {
+        const compiled_idiom_t &ci = g_idioms[idx];
+        int n = (int) ci.steps.size();
+        if (n > nwin)
+            continue;
+        idiom_match_t m;
+        memset(&m, 0, sizeof(m));
+        for (int v = 0; v < IDIOM_MAX_VARS; v++) {
+            m.reg[v] = -1;
+            m.mem_step[v] = -1;
+            m.opidx[v] = -1;
+        }
+        bool ok = true;
+        for (int s = 0; s < n && ok; s++) {
+            ok = match_step(ci.steps[s], *win[s], s, &m);
+            m.insns[s] = win[s];
+        }
+        if (!ok)
+            continue;
+        m.idiom = &g_idioms[idx].def;
+        m.nsteps = n;
+        m.start_ea = start;
+        m.end_ea = win[n - 1]->ea + win[n - 1]->size;
+        if (ci.def.check != nullptr && !ci.def.check(m))
+            continue;
+
+        uint32 written = 0;
+        for (int s = 0; s < n; s++)
+            written |= vec_regs_written(*win[s]);
+        for (int v = 0; v < IDIOM_MAX_VARS; v++)
+            if ((ci.def.live_out & (1u << v)) != 0 && m.reg[v] >= 0)
+                written &= ~(1u << m.reg[v]);
+        written &= ~m.live_regs;
+        if (written != 0 && !regs_dead_after(m.end_ea, written, *chunk))
+            continue;
+
+        *out = m;
+        return true;
+    }
+    return false;
+}
+
+// Swap the codegen's current instruction while loading another window
+// instruction's memory operand, so addresses come from the right insn.
+struct insn_swap_t {
+    codegen_t &cdg;
+    insn_t saved;
+    insn_swap_t(codegen_t &c, const insn_t &other) : cdg(c), saved(c.insn) { cdg.insn = other; }
+    ~insn_swap_t() { cdg.insn = saved; }
+};
+
+} // namespace
+
+void idiom_registry_t::register_idiom(const idiom_t &idiom) { pending().push_back(idiom); }
+
+idiom_state_t *idiom_init() {
+    return new idiom_state_t();
+}
+
+void idiom_term(idiom_state_t *st) {
+    delete st;
+}
+
+void idiom_reset(idiom_state_t *st) {
+    if (st != nullptr)
+        st->clear();
+}
+
+bool idiom_match(codegen_t &cdg) {
+    compile_all();
+    if (g_idioms.empty())
+        return false;
+    idiom_state_t *st = sync_state(cdg);
+    if (st == nullptr)
+        return false;
+    ea_t ea = cdg.insn.ea;
+
+    // A head seen again means the function is being regenerated: forget the
+    // windows it consumed last time before deciding afresh.
+    auto w = st->windows.find(ea);
+    if (w != st->windows.end()) {
+        for (ea_t c : w->second)
+            st->consumed.erase(c);
+        st->windows.erase(w);
+    }
+    if (st->consumed.count(ea) != 0)
+        return true;
+    if (st->no_match.count(ea) != 0 || g_by_first.count(cdg.insn.itype) == 0)
+        return false;
+
+    st->decoded[ea] = cdg.insn;
+    idiom_match_t m;
+    if (!try_match_at(ea, &m)) {
+        st->no_match[ea] = true;
+        return false;
+    }
+    st->pending[ea] = m;
+    return true;
+}
+
+bool idiom_apply(codegen_t &cdg, merror_t *err) {
+    idiom_state_t *st = cur_state();
+    if (st == nullptr || st->mba != cdg.mba)
+        return false;
+    ea_t ea = cdg.insn.ea;
+    if (st->consumed.count(ea) != 0) {
+        *err = MERR_OK;
+        return true;
+    }
+    auto p = st->pending.find(ea);
+    if (p == st->pending.end())
+        return false;
+    idiom_match_t m = p->second;
+    st->pending.erase(p);
+
+    merror_t r = m.idiom->emit(cdg, m);
+    if (r != MERR_OK) {
+        // Fall back to lifting the head alone; the rest lifts normally
+        DEBUG_LOG("%a: idiom %s failed to emit (%d)", ea, m.idiom->name, r);
+        st->no_match[ea] = true;
+        return false;
+    }
+    qvector<ea_t> &win = st->windows[ea];
+    for (int s = 1; s < m.nsteps; s++) {
+        st->consumed[m.insns[s]->ea] = ea;
+        win.push_back(m.insns[s]->ea);
+    }
+    DEBUG_LOG("%a: idiom %s lifted %d instructions", ea, m.idiom->name, m.nsteps);
+    *err = MERR_OK;
+    return true;
+}
+
+bool idiom_consumed(const codegen_t &cdg) {
+    const idiom_state_t *st = cur_state();
+    return st != nullptr && st->mba == cdg.mba && st->consumed.count(cdg.insn.ea) != 0;
+}
+
+void idiom_release(ea_t ea) {
+    idiom_state_t *st = cur_state();
+    if (st == nullptr)
+        return;
+    auto w = st->windows.find(ea);
+    if (w == st->windows.end())
+        return;
+    for (ea_t c : w->second)
+        st->consumed.erase(c);
+    st->windows.erase(w);
+    st->no_match[ea] = true;
+}
+
+//-----------------------------------------------------------------------------
+// Emitter helpers
+//-----------------------------------------------------------------------------
+mreg_t idiom_var_mreg(const idiom_match_t &m, int var, int width) {
+    // zmm values live in the __readzmm/__writezmm state, not in mregs
+    if (width == ZMM_SIZE)
+        return mr_none;
+    return vreg_mreg(m.reg[var], width);
+}
+
+bool idiom_add_var_arg(codegen_t &cdg, AVXIntrinsic &icall, const idiom_match_t &m, int var, int width,
+                       const tinfo_t &ti) {
+    if (m.mem_step[var] >= 0) {
+        const insn_t &insn = *m.insns[m.mem_step[var]];
+        int opn = m.opidx[var];
+        mreg_t r;
+        {
+            insn_swap_t swap(cdg, insn);
+            int size = width;
+            if (is_embedded_broadcast(insn, insn.ops[opn]))
+                r = load_embedded_broadcast(cdg, opn, &size);
+            else
+                r = load_operand_udt(cdg, opn, width);
+        }
+        if (r == mr_none)
+            return false;
+        icall.add_argument_reg(r, ti);
+        return true;
+    }
+    if (m.reg[var] < 0)
+        return false;
+    if (width == ZMM_SIZE) {
+        icall.add_argument_insn(make_zmm_read_call(cdg, m.reg[var], ti), ti);
+        return true;
+    }
+    icall.add_argument_reg(idiom_var_mreg(m, var, width), ti);
+    return true;
+}
+
+bool idiom_emit_to_var(codegen_t &cdg, AVXIntrinsic &icall, const idiom_match_t &m, int var, int width,
+                       const tinfo_t &ti) {
+    if (m.reg[var] < 0)
+        return false;
+    if (width == ZMM_SIZE) {
+        mreg_t tmp = kreg_alloc(cdg, width, false);
+        if (tmp == mr_none)
+            return false;
+        icall.set_return_reg(tmp, ti);
+        if (icall.emit() == nullptr)
+            return false;
+        AVXIntrinsic write(&cdg, "__writezmm");
+        write.add_argument_imm((uint64) m.reg[var], BT_INT32);
+        write.add_argument_reg(tmp, ti);
+        return write.emit_void() != nullptr;
+    }
+    icall.set_return_reg(idiom_var_mreg(m, var, width), ti);
+    return icall.emit() != nullptr;
+}
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,127 @@
+/*
+ AVX Idiom Engine - multi-instruction pattern lifting
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "avx_types.h"
+
+struct AVXIntrinsic;
+
+// An idiom is a straight-line instruction sequence lifted as one unit. The
+// first instruction of a matching window emits the microcode for the whole
+// sequence; the rest of the window is consumed with no microcode.
+//
+// Patterns are written one instruction per line:
+//
+//   mnem[|mnem...][~] operand, operand, ...
+//
+//   ~        the two source operands (2nd and 3rd) may appear in either order
+//   %N       vector register variable N (0-7). The first use binds it to a
+//            physical register; later uses must name the same register.
+//            Optional width: %N.x (xmm), %N.y (ymm), %N.z (zmm)
+//   &N       same as %N, but the operand may also be a memory operand; the
+//            emitter loads it through the window's instruction
+//   #V       immediate equal to V (C syntax: #1, #0x4E); #V|W lists choices
+//   *        any operand, not captured
+//   ?        any operand or none (for steps whose alternatives differ in arity)
+//
+// Every register written inside the window must either be one of the
+// idiom's live-out variables (or a register the check marks live) or be
+// provably dead after the window.
+
+const int IDIOM_MAX_VARS = 8;
+const int IDIOM_MAX_STEPS = 12;
+
+struct idiom_t;
+
+struct idiom_match_t {
+    const idiom_t *idiom;
+    int nsteps;
+    ea_t start_ea;
+    ea_t end_ea;                        // first address after the window
+    int reg[IDIOM_MAX_VARS];            // physical vector register index, -1 if unbound
+    int width[IDIOM_MAX_VARS];          // widest width the variable was used at
+    int opidx[IDIOM_MAX_VARS];          // for &N bound to memory: operand index ...
+    int mem_step[IDIOM_MAX_VARS];       // ... and window step, -1 otherwise
+    const insn_t *insns[IDIOM_MAX_STEPS];
+    uint32 live_regs;                   // extra live-out physical registers (set by check)
+    int aux[4];                         // scratch the check hands to the emitter
+};
+
+typedef merror_t idiom_emit_t(codegen_t &cdg, const idiom_match_t &m);
+
+// Optional extra check run after the operand constraints matched
+// (immediate values in memory, element types, lane dataflow, ...).
+typedef bool idiom_check_t(idiom_match_t &m);
+
+struct idiom_t {
+    const char *name;
+    const char *pattern;
+    uint8 live_out;                     // bitmask of variables the emitter defines
+    idiom_emit_t *emit;
+    idiom_check_t *check;
+};
+
+class idiom_registry_t {
+public:
+    static void register_idiom(const idiom_t &idiom);
+};
+
+// Registration helper, mirroring REGISTER_COMPONENT.
+#define REGISTER_IDIOM(ID, NAME, PATTERN, LIVE_OUT, EMIT, CHECK)             \
+namespace {                                                                  \
+ struct idiom_registrar_t_##ID {                                             \
+   idiom_registrar_t_##ID() {                                                \
+     idiom_t d = {NAME, PATTERN, LIVE_OUT, EMIT, CHECK};                     \
+     idiom_registry_t::register_idiom(d);                                    \
+   }                                                                         \
+ };                                                                          \
+ static idiom_registrar_t_##ID g_idiom_registrar_##ID;                      \
+}
+
+// Filter hooks. idiom_match() returns true if the instruction starts a
+// matching window or was consumed by one; idiom_apply() then emits it.
+bool idiom_match(codegen_t &cdg);
+bool idiom_apply(codegen_t &cdg, merror_t *err);
+
+// Whether the instruction belongs to a window whose head already emitted it
+bool idiom_consumed(const codegen_t &cdg);
+
+// The microcode emitted for the instruction at `ea` was thrown away: give
+// back the window it consumed, and lift it alone if the function is
+// regenerated.
+void idiom_release(ea_t ea);
+
+// Per-database state (avx_state_t::idiom), created when the lifter activates
+struct idiom_state_t;
+idiom_state_t *idiom_init();
+void idiom_term(idiom_state_t *st);
+
+// Drop all per-function state (decode cache, consumed windows).
+void idiom_reset(idiom_state_t *st);
+
+//----- emitter helpers
+
+// Physical vector register index (0-31) of a register operand, and its width
+int idiom_vec_index(const op_t &op, int *width);
+
+// Microcode register for vector variable `var` viewed at `width` bytes
+// (mr_none for zmm, which is modeled through __readzmm/__writezmm).
+mreg_t idiom_var_mreg(const idiom_match_t &m, int var, int width);
+
+// Pass variable `var` (register or memory) as an argument of `width` bytes.
+bool idiom_add_var_arg(codegen_t &cdg, AVXIntrinsic &icall, const idiom_match_t &m, int var, int width,
+                       const tinfo_t &ti);
+
+// Emit `icall` with its result written to variable `var` at `width` bytes.
+bool idiom_emit_to_var(codegen_t &cdg, AVXIntrinsic &icall, const idiom_match_t &m, int var, int width,
+                       const tinfo_t &ti);
+
+#endif // IDA_SDK_VERSION >= 750
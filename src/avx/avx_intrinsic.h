@@ -11,14 +11,14 @@ AVX Intrinsic Call Builder
 #if IDA_SDK_VERSION >= 750
 
 #include "avx_types.h"
+#include "../common/intrinsic_call.h"
 
 struct ida_local AVXIntrinsic {
     codegen_t *cdg;
-    mcallinfo_t *call_info; // Heap-allocated (IDA allocator)
-    minsn_t *call_insn; // Heap-allocated (IDA allocator)
-    minsn_t *mov_insn; // Heap-allocated (IDA allocator)
-    bool emitted; // Track ownership transfer
-    int stk_off; // Stack offset for arguments to satisfy verification
+    intrinsic_call_t call;
+    mcallinfo_t *call_info; // Owned by the call; exposed for flag tweaks
+    mreg_t return_reg;
+    bool return_fp;
     int virtual_return_zmm_index;
     tinfo_t virtual_return_type;
 
@@ -40,6 +40,9 @@ struct ida_local AVXIntrinsic {
 
     void add_argument_mop(const mop_t &arg, const tinfo_t &arg_ti);
 
+    // Add a nested call (e.g. __readzmm) as an argument, taking ownership of it
+    void add_argument_insn(minsn_t *ins, const tinfo_t &arg_ti);
+
     // Add argument with explicit size (for pointer arguments where type size may not match target)
     void add_argument_reg_with_size(mreg_t mreg, int size);
 
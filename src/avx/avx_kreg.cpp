@@ -0,0 +1,63 @@
+/*
+ AVX Kernel Register Scope
+*/
+
+#include "avx_kreg.h"
+
+#if IDA_SDK_VERSION >= 750
+
+namespace {
+
+// Innermost open scope. Scopes live on the stack of one apply() call, so no
+// database's scope survives into another's.
+KregScope *g_scope = nullptr;
+
+} // namespace
+
+KregScope::KregScope(codegen_t &cdg) : mba(cdg.mba), outer(g_scope) {
+    g_scope = this;
+}
+
+KregScope::~KregScope() {
+    for (const kreg_t &k : live)
+        mba->free_kreg(k.reg, k.size);
+    g_scope = outer;
+}
+
+mreg_t kreg_alloc(codegen_t &cdg, int size, bool check_size) {
+    mreg_t reg = cdg.mba->alloc_kreg(size, check_size);
+    if (reg != mr_none && g_scope != nullptr && g_scope->mba == cdg.mba) {
+        KregScope::kreg_t k = {reg, size};
+        g_scope->live.push_back(k);
+        g_scope->handed_out.push_back(k);
+    }
+    return reg;
+}
+
+void kreg_free(codegen_t &cdg, mreg_t reg, int size) {
+    if (g_scope != nullptr && g_scope->mba == cdg.mba) {
+        for (size_t i = 0; i < g_scope->live.size(); i++) {
+            if (g_scope->live[i].reg == reg) {
+                g_scope->live.erase(g_scope->live.begin() + i);
+                break;
+            }
+        }
+    }
+    cdg.mba->free_kreg(reg, size);
+}
+
+bool kreg_scoped(mreg_t reg, int *avail) {
+    if (g_scope == nullptr)
+        return false;
+    bool found = false;
+    *avail = 0;
+    for (const KregScope::kreg_t &k : g_scope->handed_out) {
+        if (reg >= k.reg && reg < k.reg + k.size) {
+            found = true;
+            *avail = qmax(*avail, int(k.reg + k.size - reg));
+        }
+    }
+    return found;
+}
+
+#endif // IDA_SDK_VERSION >= 750
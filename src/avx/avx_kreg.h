@@ -0,0 +1,61 @@
+/*
+ AVX Kernel Register Scope
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Vector temporaries (kregs) never outlive the microcode of the instruction
+// that allocated them: every value that crosses instructions lives in an
+// xmm/ymm register or in the __readzmm/__writezmm state. A KregScope opened
+// at the top of apply() records each kreg handed out by kreg_alloc() and
+// returns whatever the handler did not free itself when apply() returns, so
+// later instructions reuse the same few kregs instead of growing the mba's
+// register space (and its liveness bitsets) one temporary at a time.
+//
+// One exception: spill forwarding (avx_spill.cpp) may reload the value an
+// earlier instruction of the block stored, and that source can be a kreg
+// its scope has since released. Releasing only makes the number available
+// again; spill_still_valid() refuses to forward once anything after the
+// store redefines the register, so a reused kreg is never read stale.
+
+class KregScope {
+public:
+    explicit KregScope(codegen_t &cdg);
+    ~KregScope();
+
+    KregScope(const KregScope &) = delete;
+    KregScope &operator=(const KregScope &) = delete;
+
+private:
+    struct kreg_t {
+        mreg_t reg;
+        int size;
+    };
+    friend mreg_t kreg_alloc(codegen_t &cdg, int size, bool check_size);
+    friend void kreg_free(codegen_t &cdg, mreg_t reg, int size);
+
+    friend bool kreg_scoped(mreg_t reg, int *avail);
+
+    mba_t *mba;
+    KregScope *outer;
+    qvector<kreg_t> live;
+    qvector<kreg_t> handed_out;   // every allocation, including freed ones
+};
+
+// mba->alloc_kreg / free_kreg, tracked by the active scope. Freeing a kreg
+// early is still fine (and lets the same instruction reuse it); the scope
+// then forgets it.
+mreg_t kreg_alloc(codegen_t &cdg, int size, bool check_size = true);
+void kreg_free(codegen_t &cdg, mreg_t reg, int size);
+
+// Whether `reg` lies in a kreg the active scope handed out, freed or not.
+// *avail is then the most bytes any of those allocations has from `reg` on.
+bool kreg_scoped(mreg_t reg, int *avail);
+
+#endif // IDA_SDK_VERSION >= 750
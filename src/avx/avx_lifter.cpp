@@ -4,6 +4,8 @@
 #include <idp.hpp>
 #include <bytes.hpp>
 #include <funcs.hpp>
+#include <auto.hpp>
+#include <xref.hpp>
 #include <name.hpp>
 #include <typeinf.hpp>
 #include <ua.hpp>
@@ -12,15 +14,27 @@
 #include <map>
 #include "../plugin/component_registry.h"
 #include "avx_types.h"
+#include "avx_state.h"
+#include "avx_regmap.h"
+#include "avx_kreg.h"
 #include "avx_intrinsic.h"
 #include "avx_helpers.h"
 #include "avx_utils.h"
 #include "avx_debug.h"
+#include "avx_constpool.h"
+#include "avx_consteval.h"
+#include "avx_idiom.h"
+#include "avx_memloop.h"
+#include "avx_quarantine.h"
+#include "avx_precheck.h"
+#include "avx_spill.h"
+#include "../common/mem_operand.h"
 #include "handlers/avx_handlers.h"
+#include "../scan/vex_scanner.h"
 
 #if IDA_SDK_VERSION >= 750
 
-// Note: ZMM memory operands are now supported via emit_zmm_load/emit_zmm_store
+// Note: ZMM memory operands are now supported via emit_vector_load/emit_vector_store
 // which bypass cdg.load_operand() and manually emit m_ldx/m_stx with UDT flags.
 // The has_zmm_memory_operand check has been removed.
 
@@ -82,12 +96,10 @@ static merror_t handle_zmm_direct_call(codegen_t &cdg) {
 
 //-----------------------------------------------------------------------------
 // Debug: dump full microcode on demand (gated by AVX_DUMP_MC env var).
-// We stash the mba during codegen so we can dump it from the hxe_interr hook,
-// i.e. at the exact moment the verifier rejects our generated microcode.
+// The lifter stashes the mba during codegen so we can dump it from the
+// hxe_interr hook, i.e. at the exact moment the verifier rejects our
+// generated microcode.
 //-----------------------------------------------------------------------------
-static mba_t *g_cur_mba = nullptr;
-static bool g_dump_mc = false;
-
 static void dump_mba_full(mba_t *mba, const char *tag) {
     if (mba == nullptr) {
         msg("[MCDUMP:%s] mba=null\n", tag);
@@ -209,33 +221,31 @@ static bool avx_supported_itype(uint16 it) {
 // A supported itype that the corpus never feeds a memory *source* (and that is
 // not in the harness allowlist of register/imm-only forms) is a coverage hole.
 //-----------------------------------------------------------------------------
-static bool g_cov = false;
-static qstring g_cov_path;
-static std::map<uint16, uint8> g_cov_seen;  // itype -> bit0:seen  bit1:seen w/ src-mem
+typedef std::map<uint16, uint8> cov_map_t;  // itype -> bit0:seen  bit1:seen w/ src-mem
 
 static bool insn_has_src_mem(const insn_t &insn) {
     return is_mem_op(insn.Op2) || is_mem_op(insn.Op3) || is_mem_op(insn.Op4);
 }
 
-static void cov_record(const insn_t &insn) {
+static void cov_record(cov_map_t &seen, const insn_t &insn) {
     uint8 b = 1;
     if (insn_has_src_mem(insn))
         b |= 2;
-    g_cov_seen[insn.itype] |= b;
+    seen[insn.itype] |= b;
 }
 
-static void cov_flush() {
-    if (!g_cov || g_cov_seen.empty())
+static void cov_flush(const qstring &path, cov_map_t &seen) {
+    if (seen.empty())
         return;
-    FILE *fp = qfopen(g_cov_path.c_str(), "a");
+    FILE *fp = qfopen(path.c_str(), "a");
     if (fp == nullptr)
         return;
-    for (const auto &kv : g_cov_seen) {
+    for (const auto &kv : seen) {
         const char *nm = PH.get_canon_mnem(kv.first);
         qfprintf(fp, "%u\t%s\t%u\n", (unsigned) kv.first, nm ? nm : "?", (unsigned) kv.second);
     }
     qfclose(fp);
-    g_cov_seen.clear();
+    seen.clear();
 }
 
 static void cov_dump_manifest() {
@@ -257,12 +267,512 @@ static void cov_dump_manifest() {
 //-----------------------------------------------------------------------------
 // The microcode filter
 //-----------------------------------------------------------------------------
+typedef merror_t (*lift_fn_t)(codegen_t &cdg);
+
+// Handler for an instruction that reached the end of apply(): not an idiom,
+// not a k-register destination, not folded. Depends on the itype alone.
+static lift_fn_t select_handler(uint16 it) {
+    // conversions
+    if (it == NN_vcvtdq2ps) return handle_vcvtdq2ps;
+    if (it == NN_vcvtsi2ss || it == NN_vcvtsi2sd) return handle_vcvtsi2fp;
+    if (it == NN_vcvtps2pd) return handle_vcvtps2pd;
+    if (it == NN_vcvtss2sd || it == NN_vcvtsd2ss) return handle_vcvtfp2fp;
+    if (it == NN_vcvtpd2ps) return handle_vcvtpd2ps;
+    if (it == NN_vcvttps2dq) return [](codegen_t &c) { return handle_vcvt_ps2dq(c, true); };
+    if (it == NN_vcvtps2dq) return [](codegen_t &c) { return handle_vcvt_ps2dq(c, false); };
+    if (it == NN_vcvttpd2dq) return [](codegen_t &c) { return handle_vcvt_pd2dq(c, true); };
+    if (it == NN_vcvtpd2dq) return [](codegen_t &c) { return handle_vcvt_pd2dq(c, false); };
+    if (it == NN_vcvtdq2pd) return handle_vcvtdq2pd;
+    if (it == NN_vcvtps2udq) return [](codegen_t &c) { return handle_vcvt_ps2udq(c, false); };
+    if (it == NN_vcvttps2udq) return [](codegen_t &c) { return handle_vcvt_ps2udq(c, true); };
+    if (it == NN_vcvtpd2udq) return [](codegen_t &c) { return handle_vcvt_pd2udq(c, false); };
+    if (it == NN_vcvttpd2udq) return [](codegen_t &c) { return handle_vcvt_pd2udq(c, true); };
+    if (it == NN_vcvtudq2ps) return handle_vcvt_udq2ps;
+    if (it == NN_vcvtudq2pd) return handle_vcvt_udq2pd;
+    if (it == NN_vcvtpd2qq) return [](codegen_t &c) { return handle_vcvt_pd2qq(c, false, false); };
+    if (it == NN_vcvtpd2uqq) return [](codegen_t &c) { return handle_vcvt_pd2qq(c, false, true); };
+    if (it == NN_vcvttpd2qq) return [](codegen_t &c) { return handle_vcvt_pd2qq(c, true, false); };
+    if (it == NN_vcvttpd2uqq) return [](codegen_t &c) { return handle_vcvt_pd2qq(c, true, true); };
+    if (it == NN_vcvtps2qq) return [](codegen_t &c) { return handle_vcvt_ps2qq(c, false, false); };
+    if (it == NN_vcvtps2uqq) return [](codegen_t &c) { return handle_vcvt_ps2qq(c, false, true); };
+    if (it == NN_vcvttps2qq) return [](codegen_t &c) { return handle_vcvt_ps2qq(c, true, false); };
+    if (it == NN_vcvttps2uqq) return [](codegen_t &c) { return handle_vcvt_ps2qq(c, true, true); };
+    if (it == NN_vcvtqq2pd) return [](codegen_t &c) { return handle_vcvt_qq2fp(c, true, false); };
+    if (it == NN_vcvtqq2ps) return [](codegen_t &c) { return handle_vcvt_qq2fp(c, false, false); };
+    if (it == NN_vcvtuqq2pd) return [](codegen_t &c) { return handle_vcvt_qq2fp(c, true, true); };
+    if (it == NN_vcvtuqq2ps) return [](codegen_t &c) { return handle_vcvt_qq2fp(c, false, true); };
+    if (it == NN_vcvtpd2ph || it == NN_vcvtph2pd || it == NN_vcvtph2psx || it == NN_vcvtps2phx ||
+        it == NN_vcvtph2w || it == NN_vcvttph2w || it == NN_vcvtph2uw || it == NN_vcvttph2uw ||
+        it == NN_vcvtw2ph || it == NN_vcvtuw2ph ||
+        it == NN_vcvtdq2ph || it == NN_vcvtudq2ph || it == NN_vcvtqq2ph || it == NN_vcvtuqq2ph ||
+        it == NN_vcvtph2dq || it == NN_vcvttph2dq || it == NN_vcvtph2udq || it == NN_vcvttph2udq ||
+        it == NN_vcvtph2qq || it == NN_vcvttph2qq || it == NN_vcvtph2uqq || it == NN_vcvttph2uqq ||
+        it == NN_vcvtph2ps || it == NN_vcvtps2ph)
+        return handle_vcvt_fp16;
+    if (it == NN_vcvtsh2si || it == NN_vcvttsh2si || it == NN_vcvtsh2usi || it == NN_vcvttsh2usi ||
+        it == NN_vcvtsd2usi || it == NN_vcvttsd2usi || it == NN_vcvtss2usi || it == NN_vcvttss2usi ||
+        it == NN_vcvtusi2sd || it == NN_vcvtusi2ss || it == NN_vcvtsi2sh || it == NN_vcvtusi2sh ||
+        it == NN_vcvtsd2sh || it == NN_vcvtsh2sd || it == NN_vcvtss2sh || it == NN_vcvtsh2ss)
+        return handle_vcvt_scalar_ext;
+    if (it == NN_vldmxcsr || it == NN_vstmxcsr) return handle_vmxcsr;
+
+    // SAD (sum of absolute differences)
+    if (is_sad_insn(it)) return handle_vsad;
+
+    // moves
+    if (it == NN_vmovd) return [](codegen_t &c) { return handle_vmov(c, DWORD_SIZE); };
+    if (it == NN_vmovq) return [](codegen_t &c) { return handle_vmov(c, QWORD_SIZE); };
+    if (it == NN_vmovss) return [](codegen_t &c) { return handle_vmov_ss_sd(c, FLOAT_SIZE); };
+    if (it == NN_vmovsd) return [](codegen_t &c) { return handle_vmov_ss_sd(c, DOUBLE_SIZE); };
+    if (it == NN_vmovsh) return handle_vmov_sh;
+    if (it == NN_vmovw) return handle_vmovw;
+    if (it == NN_vmovaps || it == NN_vmovups || it == NN_vmovdqa || it == NN_vmovdqu ||
+        it == NN_vmovapd || it == NN_vmovupd ||
+        it == NN_vmovdqa32 || it == NN_vmovdqa64 ||
+        it == NN_vmovdqu8 || it == NN_vmovdqu16 || it == NN_vmovdqu32 || it == NN_vmovdqu64)
+        return handle_v_mov_ps_dq;
+
+    // compress/expand (masked load/store)
+    if (is_compress_insn(it)) return handle_v_compress;
+    if (is_expand_insn(it)) return handle_v_expand;
+
+    // bitwise (now full 128/256-bit via intrinsics)
+    if (is_bitwise_insn(it)) return handle_v_bitwise;
+
+    // popcount/lzcnt
+    if (is_popcnt_insn(it)) return handle_v_popcnt;
+    if (is_lzcnt_insn(it)) return handle_v_lzcnt;
+
+    // GFNI
+    if (is_gfni_insn(it)) return handle_v_gfni;
+
+    // carryless multiply
+    if (is_pclmul_insn(it)) return handle_v_pclmul;
+
+    // AES
+    if (is_aes_insn(it)) return handle_v_aes;
+
+    // SHA
+    if (is_sha_insn(it)) return handle_v_sha;
+
+    // Cache control
+    if (is_cache_ctrl_insn(it)) return handle_cache_ctrl;
+
+    // scalar math (add/sub/mul/div)
+    if (it == NN_vaddss || it == NN_vsubss || it == NN_vmulss || it == NN_vdivss)
+        return [](codegen_t &c) { return handle_v_math_ss_sd(c, FLOAT_SIZE); };
+    if (it == NN_vaddsd || it == NN_vsubsd || it == NN_vmulsd || it == NN_vdivsd)
+        return [](codegen_t &c) { return handle_v_math_ss_sd(c, DOUBLE_SIZE); };
+    if (is_fp16_scalar_math_insn(it)) return handle_v_math_sh;
+
+    // scalar min/max
+    if (is_scalar_minmax(it)) return handle_v_minmax_ss_sd;
+
+    // packed math (+ min/max + integer add/sub + integer mul)
+    if (is_packed_math_insn(it)) return handle_v_math_p;
+    if (is_fp16_packed_math_insn(it)) return handle_v_math_ph;
+
+    // abs
+    if (is_abs_insn(it)) return handle_v_abs;
+
+    // sign
+    if (is_sign_insn(it)) return handle_v_sign;
+
+    // fma
+    if (is_fma_insn(it)) return handle_v_fma;
+    if (is_fp16_fma_insn(it)) return handle_v_fma_ph;
+
+    // fp16 complex ops
+    if (is_fp16_complex_insn(it)) return handle_v_complex_ph;
+
+    // IFMA / VNNI / BF16
+    if (is_ifma_insn(it)) return handle_v_ifma;
+    if (is_vnni_insn(it)) return handle_v_vnni;
+    if (is_bf16_insn(it)) return handle_v_bf16;
+
+    // shifts
+    if (is_shift_insn(it)) return handle_v_shift;
+    if (is_var_shift_insn(it)) return handle_v_var_shift;
+    if (is_rotate_insn(it)) return handle_v_rotate;
+    if (is_var_rotate_insn(it)) return handle_v_var_rotate;
+    if (is_shift_double_insn(it)) return handle_v_shift_double;
+    if (is_multishift_insn(it)) return handle_v_multishift;
+
+    // shuffles, perms, align
+    if (is_shuffle_insn(it)) return handle_v_shuffle_int;
+    if (is_shuf_lane_insn(it)) return handle_v_shuf_lane;
+    if (it == NN_vblendmps || it == NN_vblendmpd || it == NN_vpblendmb ||
+        it == NN_vpblendmw || it == NN_vpblendmd || it == NN_vpblendmq)
+        return handle_v_blendm;
+    if (it == NN_vpbroadcastmb2q || it == NN_vpbroadcastmw2d)
+        return handle_v_broadcastm;
+    if (it == NN_vbroadcastf32x2 || it == NN_vbroadcasti32x2)
+        return handle_v_broadcast_x2;
+    if (it == NN_vexp2ps || it == NN_vexp2pd ||
+        it == NN_vrcp28ps || it == NN_vrcp28pd || it == NN_vrcp28ss || it == NN_vrcp28sd ||
+        it == NN_vrsqrt28ps || it == NN_vrsqrt28pd || it == NN_vrsqrt28ss || it == NN_vrsqrt28sd)
+        return handle_v_er;
+    if (it == NN_v4fmaddps || it == NN_v4fnmaddps || it == NN_v4fmaddss ||
+        it == NN_v4fnmaddss || it == NN_vp4dpwssd || it == NN_vp4dpwssds)
+        return handle_v_4fma;
+    if (it == NN_vcomish || it == NN_vucomish)
+        return handle_v_comish;
+    if (it == NN_vgatherpf0dps || it == NN_vgatherpf0qps || it == NN_vgatherpf0dpd ||
+        it == NN_vgatherpf0qpd || it == NN_vscatterpf0dps || it == NN_vscatterpf0qps ||
+        it == NN_vscatterpf0dpd || it == NN_vscatterpf0qpd)
+        return handle_v_prefetch_gs;
+    if (is_perm_insn(it)) return handle_v_perm_int;
+    if (is_align_insn(it)) return handle_v_align;
+
+    // gather
+    if (is_gather_insn(it)) return handle_v_gather;
+
+    // scatter
+    if (is_scatter_insn(it)) return handle_v_scatter;
+
+    // horizontal math
+    if (is_horizontal_math(it)) return handle_v_hmath;
+
+    // dot product
+    if (is_dot_product(it)) return handle_v_dot;
+
+    // approximations (rcp, rsqrt)
+    if (is_approx_insn(it)) return handle_vrcp_rsqrt;
+
+    // rounding
+    if (is_round_insn(it)) return handle_vround;
+
+    // fp16 sqrt
+    if (is_fp16_sqrt_insn(it)) return handle_v_sqrt_ph;
+    if (is_fp16_scalar_misc_insn(it)) return handle_v_fp16_scalar_misc;
+
+    // getexp/getmant/fixupimm/scalef/range/reduce
+    if (is_getexp_insn(it)) return handle_v_getexp;
+    if (is_getmant_insn(it)) return handle_v_getmant;
+    if (is_fixupimm_insn(it)) return handle_v_fixupimm;
+    if (is_scalef_insn(it)) return handle_v_scalef;
+    if (is_range_insn(it)) return handle_v_range;
+    if (is_reduce_insn(it)) return handle_v_reduce;
+
+    // broadcasts
+    if (it == NN_vbroadcastss || it == NN_vbroadcastsd) return handle_vbroadcast_ss_sd;
+    if (it == NN_vbroadcastf128) return handle_vbroadcastf128_fp;
+    if (it == NN_vbroadcasti128) return handle_vbroadcasti128_int;
+    if (it == NN_vbroadcastf32x4 || it == NN_vbroadcastf64x4 ||
+        it == NN_vbroadcasti32x4 || it == NN_vbroadcasti64x4)
+        return handle_vbroadcast_x4;
+
+    // packed compares
+    if (is_packed_compare_insn(it)) return handle_vcmp_ps_pd;
+    if (is_packed_int_compare_insn(it)) return handle_vpcmp_int;
+
+    // blend
+    if (it == NN_vblendvps || it == NN_vblendvpd) return handle_vblendv_ps_pd;
+    if (it == NN_vblendps || it == NN_vblendpd) return handle_vblend_imm_ps_pd;
+    if (it == NN_vpblendd || it == NN_vpblendw || it == NN_vpblendvb) return handle_vblend_int;
+
+    // maskmov
+    if (is_maskmov_insn(it)) return handle_vmaskmov_ps_pd;
+    if (is_pmaskmov_int_insn(it)) return handle_vpmaskmov_int;
+
+    // misc
+    if (it == NN_vsqrtss) return handle_vsqrtss;
+    if (it == NN_vsqrtsh) return handle_vsqrt_sh;
+    if (it == NN_vsqrtps || it == NN_vsqrtpd) return handle_vsqrt_ps_pd;
+    if (it == NN_vshufps) return handle_vshufps;
+    if (it == NN_vshufpd) return handle_vshufpd;
+    if (it == NN_vpermpd) return handle_vpermpd;
+    if (it == NN_vmovlhps) return handle_vmovlhps;
+    if (it == NN_vmovhlps) return handle_vmovhlps;
+    if (it == NN_vmovhps || it == NN_vmovlps || it == NN_vmovhpd || it == NN_vmovlpd)
+        return handle_vmovl_h_ps_pd;
+    if (it == NN_vzeroupper) return handle_vzeroupper_nop;
+    if (it == NN_vzeroall) return handle_vzeroall;
+    if (it == NN_vphminposuw) return handle_vphminposuw;
+    if (is_vtest_insn(it)) return handle_vtest_ps_pd;
+
+    // extract/insert
+    if (it == NN_vextractf128 || it == NN_vextracti128 ||
+        it == NN_vextracti32x4 || it == NN_vextracti32x8 || it == NN_vextracti64x4 ||
+        it == NN_vextractf32x4 || it == NN_vextractf32x8 ||
+        it == NN_vextractf64x2 || it == NN_vextractf64x4 || it == NN_vextracti64x2)
+        return handle_vextractf128;
+    if (it == NN_vinsertf128 || it == NN_vinserti128 ||
+        it == NN_vinserti32x4 || it == NN_vinserti32x8 || it == NN_vinserti64x4 ||
+        it == NN_vinsertf32x4 || it == NN_vinsertf64x4 ||
+        it == NN_vinsertf32x8 || it == NN_vinsertf64x2 || it == NN_vinserti64x2)
+        return handle_vinsertf128;
+
+    // movdup
+    if (it == NN_vmovshdup) return handle_vmovshdup;
+    if (it == NN_vmovsldup) return handle_vmovsldup;
+    if (it == NN_vmovddup) return handle_vmovddup;
+
+    // unpack
+    if (is_unpack_insn(it)) return handle_vunpck;
+
+    // scalar approximations (rcp, rsqrt)
+    if (is_scalar_approx_insn(it)) return handle_vrcp_rsqrt_ss;
+
+    // scalar rounding
+    if (is_scalar_round_insn(it)) return handle_vround_ss_sd;
+
+    // scalar sqrt double
+    if (it == NN_vsqrtsd) return handle_vsqrtsd;
+
+    // addsub
+    if (is_addsub_insn(it)) return handle_vaddsubps_pd;
+
+    // broadcast d/q
+    if (is_vpbroadcast_d_q(it)) return handle_vpbroadcast_d_q;
+
+    // permute 128-bit lanes
+    if (is_vperm2_insn(it)) return handle_vperm2f128_i128;
+
+    // permute bytes/words (VBMI)
+    if (is_permutex_insn(it)) return handle_v_permutex;
+
+    // permute from two tables
+    if (is_permutex2_insn(it)) return handle_v_permutex2;
+
+    // ternary logic
+    if (is_ternary_logic_insn(it)) return handle_v_ternary_logic;
+
+    // conflict detection
+    if (is_conflict_insn(it)) return handle_v_conflict;
+
+    // horizontal subtract (including saturated)
+    if (is_phsub_insn(it)) return handle_vphsub_sw;
+
+    // pack
+    if (is_pack_insn(it)) return handle_vpack;
+
+    // fmaddsub/fmsubadd
+    if (is_fmaddsub_insn(it)) return handle_vfmaddsub;
+
+    // move mask to GPR
+    if (is_movmsk_insn(it)) return handle_vmovmsk;
+
+    // non-temporal store
+    if (is_movnt_insn(it)) return handle_vmovnt;
+
+    // mask to vector
+    if (is_mask_to_vec_insn(it)) return handle_v_mask_to_vec;
+
+    // broadcast byte/word
+    if (is_vpbroadcast_b_w(it)) return handle_vpbroadcast_b_w;
+
+    // insert into vector
+    if (is_pinsert_insn(it)) return handle_vpinsert;
+
+    // sign extend
+    if (is_pmovsx_insn(it)) return handle_vpmovsx;
+
+    // zero extend
+    if (is_pmovzx_insn(it)) return handle_vpmovzx;
+
+    // narrow to bytes
+    if (is_pmovwb_insn(it)) return handle_vpmovwb;
+
+    // down-convert packed integers
+    if (is_pmov_down_insn(it)) return handle_vpmov_down;
+
+    // byte shift
+    if (is_byte_shift_insn(it)) return handle_vpslldq_vpsrldq;
+
+    // integer unpack
+    if (is_punpck_insn(it)) return handle_vpunpck;
+
+    // extract float to GPR/mem
+    if (is_extractps_insn(it)) return handle_vextractps;
+
+    // insert single float
+    if (is_insertps_insn(it)) return handle_vinsertps;
+
+    // flag-setting vector tests
+    if (is_ptest_insn(it)) return handle_vptest;
+
+    return nullptr;
+}
+
+// select_handler() is a long chain of itype tests, and the same few dozen
+// itypes make up nearly every vector function; resolve each itype once and
+// keep the answer for the rest of the session. The answer depends on the
+// itype alone, so every database shares the table.
+static lift_fn_t lookup_handler(uint16 it) {
+    static qvector<lift_fn_t> handlers;
+    static qvector<uint8> resolved;
+    if (it >= resolved.size()) {
+        handlers.resize(it + 1, nullptr);
+        resolved.resize(it + 1, 0);
+    }
+    if (!resolved[it]) {
+        handlers[it] = select_handler(it);
+        resolved[it] = 1;
+    }
+    return handlers[it];
+}
+
+//-----------------------------------------------------------------------------
+// Lifting plans
+//
+// Apart from idioms, the quarantine, segment overrides and direct ZMM calls,
+// whether match() takes an instruction depends only on its normalized form:
+// itype, operand kinds and data types, opmask, zeroing and a k-register
+// destination. The same few hundred forms make up nearly every vector
+// function, so the verdict is worked out once per form and kept in the
+// database state, where every later decompilation and refresh finds it.
+//-----------------------------------------------------------------------------
+enum lift_plan_t : uint8 {
+    PLAN_DECLINE,   // left to IDA
+    PLAN_CLAIM,     // always lifted (k-register instructions and destinations)
+    PLAN_LIFT,      // an idiom if one matches, else the itype's handler
+    PLAN_IDIOM,     // only as part of an idiom
+};
+
+static insn_form_t insn_form_of(const insn_t &insn) {
+    uint64 head = insn.itype;
+    if (has_opmask(insn)) head |= 1ULL << 16;
+    if (is_zero_masking(insn)) head |= 1ULL << 17;
+    if (is_mask_reg(insn.Op1)) head |= 1ULL << 18;
+    uint64 ops = 0;
+    for (int i = 0; i < 4; i++)
+        ops |= uint64(insn.ops[i].type | (insn.ops[i].dtype << 8)) << (16 * i);
+    return insn_form_t(head, ops);
+}
+
+// Itypes whose handlers implement masked intrinsics
+static bool opmask_supported(uint16 it) {
+    return is_packed_math_insn(it) || is_fma_insn(it) || is_fmaddsub_insn(it) ||
+           is_ifma_insn(it) || is_vnni_insn(it) || is_bf16_insn(it) ||
+           is_fp16_packed_math_insn(it) || is_fp16_scalar_math_insn(it) ||
+           is_fp16_sqrt_insn(it) || is_fp16_fma_insn(it) ||
+           is_fp16_fmaddsub_insn(it) || is_fp16_complex_insn(it) ||
+           is_fp16_scalar_sqrt_insn(it) || is_fp16_scalar_misc_insn(it) ||
+           is_bitwise_insn(it) || is_shift_insn(it) || is_var_shift_insn(it) ||
+           is_shift_double_insn(it) || is_multishift_insn(it) ||
+           is_rotate_insn(it) || is_var_rotate_insn(it) ||
+           is_shuffle_insn(it) || is_shuf_lane_insn(it) || is_perm_insn(it) || is_permutex_insn(it) ||
+           is_permutex2_insn(it) || is_align_insn(it) || is_blend_insn(it) ||
+           it == NN_vbroadcastss || it == NN_vbroadcastsd ||
+           it == NN_vblendmps || it == NN_vblendmpd || it == NN_vpblendmb ||
+           it == NN_vpblendmw || it == NN_vpblendmd || it == NN_vpblendmq ||
+           is_packed_compare_insn(it) || is_packed_int_compare_insn(it) ||
+           is_scalar_minmax(it) || is_scalar_move(it) ||
+           is_move_insn(it) || is_compress_insn(it) || is_expand_insn(it) ||
+           is_gather_insn(it) || is_scatter_insn(it) || is_addsub_insn(it) ||
+           is_approx_insn(it) || is_round_insn(it) ||
+           is_scalar_approx_insn(it) || is_scalar_round_insn(it) ||
+           is_getexp_insn(it) || is_getmant_insn(it) || is_fixupimm_insn(it) ||
+           is_scalef_insn(it) || is_range_insn(it) || is_reduce_insn(it) ||
+           is_mask_to_vec_insn(it) || is_popcnt_insn(it) || is_lzcnt_insn(it) ||
+           is_gfni_insn(it) || is_fp16_move_insn(it) ||
+           is_ternary_logic_insn(it) || is_conflict_insn(it) ||
+           it == NN_vcvtss2sd || it == NN_vcvtsd2ss;
+}
+
+static lift_plan_t classify_form(const insn_t &insn) {
+    uint16 it = insn.itype;
+
+    // Skip k-register manipulation instructions (kmov/kunpck) - emit NOP
+    // These instructions IDA can't handle natively
+    if (it >= NN_kmovw && it <= NN_kunpckdq)
+        return PLAN_CLAIM;
+
+    // Skip instructions with k-register as destination (compare-to-mask)
+    // e.g., vcmpeqps k1, ymm0, ymm1
+    if (is_mask_reg(insn.Op1))
+        return PLAN_CLAIM;
+
+    // Instructions with k-register masking (EVEX opmask in Op6)
+    // e.g., vaddps zmm0{k1}, zmm1, zmm2
+    // Allow masking only for handlers that implement masked intrinsics.
+    if (has_opmask(insn) && !opmask_supported(it))
+        return PLAN_DECLINE;
+
+    // Skip YMM (256-bit) operations in 32-bit mode.
+    //
+    // While 32-bit x86 with AVX only has YMM0-YMM7 (no REX prefix), the issue is NOT
+    // the register numbers - it's that IDA's Hex-Rays microcode verifier causes
+    // INTERR 50920 ("Temporary registers cannot cross block boundaries") when we
+    // emit 256-bit kregs and intrinsic calls in 32-bit mode.
+    //
+    // This appears to be a fundamental limitation in Hex-Rays' 32-bit microcode
+    // representation - the verifier doesn't properly handle 256-bit temporaries.
+    //
+    // By declining, we let IDA show these as __asm blocks, which preserves
+    // the instruction visibility. XMM (128-bit) operations work fine in 32-bit.
+    if (!inf_is_64bit()) {
+        bool has_ymm = (insn.Op1.type == o_reg && insn.Op1.dtype == dt_byte32) ||
+                       (insn.Op2.type == o_reg && insn.Op2.dtype == dt_byte32) ||
+                       (insn.Op3.type == o_reg && insn.Op3.dtype == dt_byte32) ||
+                       (insn.Op4.type == o_reg && insn.Op4.dtype == dt_byte32);
+        if (has_ymm)
+            return PLAN_DECLINE;
+    }
+    return avx_match_itype_core(it) ? PLAN_LIFT : PLAN_IDIOM;
+}
+
+static lift_plan_t lift_plan(avx_state_t &st, const insn_t &insn) {
+    insn_form_t form = insn_form_of(insn);
+    auto p = st.plans.find(form);
+    if (p != st.plans.end())
+        return (lift_plan_t) p->second;
+    lift_plan_t plan = classify_form(insn);
+    st.plans[form] = plan;
+    return plan;
+}
+
 struct ida_local AVXLifter : microcode_filter_t {
+    // This database's caches and flags, made current on every entry
+    avx_state_t state;
+
+    // AVX_DUMP_MC: dump callback installed, mba being generated
+    bool dump_mc = false;
+    bool callback_active = false;
+    mba_t *cur_mba = nullptr;
+
+    // AVX_COV: per-itype coverage appended to cov_path at teardown
+    bool cov = false;
+    qstring cov_path;
+    cov_map_t cov_seen;
+
+    // Lazy activation: filter installed once a function with vector code
+    // is about to be decompiled. function start -> has a supported insn.
+    component_registry_t *reg = nullptr;
+    bool active = false;
+    bool indexed = false;
+    std::map<ea_t, bool> vector_funcs;
+
+    // Loop/copy recognition pass, installed with the filter
+    memloop_optimizer_t memloop;
+
+    // INTERR quarantine: the function being lifted and its record, the last
+    // itype lifted in it, and whether its handler is still running
+    ea_t q_func = BADADDR;
+    quarantine_t q;
+    uint16 q_itype = 0;
+    bool lifting = false;
+
     //----- match
     bool match(codegen_t &cdg) override {
         ea_t ea = cdg.insn.ea;
         uint16 it = cdg.insn.itype;
 
+        avx_state_enter(&state);
+
+        // A function that failed under the lifter before keeps its declined
+        // instructions, or all of them, as __asm. One an idiom head already
+        // emitted must still be consumed, or IDA would apply it twice.
+        if (cdg.mba->entry_ea != q_func) {
+            q_func = cdg.mba->entry_ea;
+            q = dump_mc ? quarantine_t() : quarantine_get(q_func);
+            q_itype = 0;
+        }
+        if (q.mode != QM_NONE && q.declines(it) && !idiom_consumed(cdg)) {
+            return false;
+        }
+
         // Segment-overridden (fs/gs) vector memory operands are not safely
         // modelable by our operand-load path: emitting a ZMM/UDT-sized ldx
         // against a segment base crashes microcode generation (INTERR 50757).
@@ -276,76 +786,21 @@ struct ida_local AVXLifter : microcode_filter_t {
             return true;
         }
 
-        // Skip k-register manipulation instructions (kmov/kunpck) - emit NOP
-        // These instructions IDA can't handle natively
-        if (it >= NN_kmovw && it <= NN_kunpckdq) {
-            return true;
+        uint8 plan = lift_plan(state, cdg.insn);
+        if (plan == PLAN_DECLINE) {
+            return false;
         }
-
-        // Skip instructions with k-register as destination (compare-to-mask)
-        // e.g., vcmpeqps k1, ymm0, ymm1
-        if (is_mask_reg(cdg.insn.Op1)) {
+        if (plan == PLAN_CLAIM) {
             return true;
         }
 
-        // Instructions with k-register masking (EVEX opmask in Op6)
-        // e.g., vaddps zmm0{k1}, zmm1, zmm2
-        // Allow masking only for handlers that implement masked intrinsics.
-        if (has_opmask(cdg.insn)) {
-            bool mask_ok = is_packed_math_insn(it) || is_fma_insn(it) || is_fmaddsub_insn(it) ||
-                           is_ifma_insn(it) || is_vnni_insn(it) || is_bf16_insn(it) ||
-                            is_fp16_packed_math_insn(it) || is_fp16_scalar_math_insn(it) ||
-                            is_fp16_sqrt_insn(it) || is_fp16_fma_insn(it) ||
-                            is_fp16_fmaddsub_insn(it) || is_fp16_complex_insn(it) ||
-                            is_fp16_scalar_sqrt_insn(it) || is_fp16_scalar_misc_insn(it) ||
-                            is_bitwise_insn(it) || is_shift_insn(it) || is_var_shift_insn(it) ||
-                            is_shift_double_insn(it) || is_multishift_insn(it) ||
-                            is_rotate_insn(it) || is_var_rotate_insn(it) ||
-                            is_shuffle_insn(it) || is_shuf_lane_insn(it) || is_perm_insn(it) || is_permutex_insn(it) ||
-                            is_permutex2_insn(it) || is_align_insn(it) || is_blend_insn(it) ||
-                            it == NN_vbroadcastss || it == NN_vbroadcastsd ||
-                            it == NN_vblendmps || it == NN_vblendmpd || it == NN_vpblendmb ||
-                            it == NN_vpblendmw || it == NN_vpblendmd || it == NN_vpblendmq ||
-                            is_packed_compare_insn(it) || is_packed_int_compare_insn(it) ||
-                            is_scalar_minmax(it) || is_scalar_move(it) ||
-                            is_move_insn(it) || is_compress_insn(it) || is_expand_insn(it) ||
-                            is_gather_insn(it) || is_scatter_insn(it) || is_addsub_insn(it) ||
-                            is_approx_insn(it) || is_round_insn(it) ||
-                            is_scalar_approx_insn(it) || is_scalar_round_insn(it) ||
-                            is_getexp_insn(it) || is_getmant_insn(it) || is_fixupimm_insn(it) ||
-                            is_scalef_insn(it) || is_range_insn(it) || is_reduce_insn(it) ||
-                            is_mask_to_vec_insn(it) || is_popcnt_insn(it) || is_lzcnt_insn(it) ||
-                            is_gfni_insn(it) || is_fp16_move_insn(it) ||
-                            is_ternary_logic_insn(it) || is_conflict_insn(it) ||
-                            it == NN_vcvtss2sd || it == NN_vcvtsd2ss;
-            if (!mask_ok) {
-                return false;
-            }
-        }
-
-        // Skip YMM (256-bit) operations in 32-bit mode.
-        //
-        // While 32-bit x86 with AVX only has YMM0-YMM7 (no REX prefix), the issue is NOT
-        // the register numbers - it's that IDA's Hex-Rays microcode verifier causes
-        // INTERR 50920 ("Temporary registers cannot cross block boundaries") when we
-        // emit 256-bit kregs and intrinsic calls in 32-bit mode.
-        //
-        // This appears to be a fundamental limitation in Hex-Rays' 32-bit microcode
-        // representation - the verifier doesn't properly handle 256-bit temporaries.
-        //
-        // By returning false, we let IDA show these as __asm blocks, which preserves
-        // the instruction visibility. XMM (128-bit) operations work fine in 32-bit.
-        if (!inf_is_64bit()) {
-            bool has_ymm = (cdg.insn.Op1.type == o_reg && cdg.insn.Op1.dtype == dt_byte32) ||
-                           (cdg.insn.Op2.type == o_reg && cdg.insn.Op2.dtype == dt_byte32) ||
-                           (cdg.insn.Op3.type == o_reg && cdg.insn.Op3.dtype == dt_byte32) ||
-                           (cdg.insn.Op4.type == o_reg && cdg.insn.Op4.dtype == dt_byte32);
-            if (has_ymm) {
-                return false;
-            }
+        // Multi-instruction idioms, and instructions consumed by one
+        if (idiom_match(cdg)) {
+            DEBUG_LOG("%a: MATCH idiom itype=%u", ea, it);
+            return true;
         }
 
-        bool m = avx_match_itype_core(it);
+        bool m = plan == PLAN_LIFT;
 
         if (m) {
             DEBUG_LOG("%a: MATCH itype=%u", ea, it);
@@ -355,14 +810,50 @@ struct ida_local AVXLifter : microcode_filter_t {
 
     //----- apply
     merror_t apply(codegen_t &cdg) override {
+        avx_state_enter(&state);
+        if (dump_mc) cur_mba = cdg.mba;           // stash for the AVX_DUMP_MC interr dumper
+        if (cov) cov_record(cov_seen, cdg.insn);  // coverage-closure accounting
+        state.bcast_ea = BADADDR;
+        memop_reset();
+
+        KregScope kregs(cdg);
+        minsn_t *prev_tail = cdg.mb != nullptr ? cdg.mb->tail : nullptr;
+
+        // An INTERR raised from here on is blamed on this itype
+        q_itype = cdg.insn.itype;
+        lifting = true;
+        merror_t err = lift(cdg);
+        lifting = false;
+
+        // Check what the handler emitted before the verifier sees the whole
+        // function; AVX_DUMP_MC wants the verifier's own verdict instead.
+        if (err == MERR_OK && !dump_mc && cdg.mb != nullptr) {
+            minsn_t *first = prev_tail != nullptr ? prev_tail->next : cdg.mb->head;
+            const char *why = precheck_emitted(cdg, first);
+            if (why != nullptr) {
+                ERROR_LOG("%a: itype %u: %s, left to IDA", cdg.insn.ea, cdg.insn.itype, why);
+                precheck_rollback(cdg, first);
+                idiom_release(cdg.insn.ea);
+                spill_reset(state.spills);
+                err = MERR_INSN;
+            }
+        }
+        return err;
+    }
+
+    merror_t lift(codegen_t &cdg) {
         ea_t ea = cdg.insn.ea;
         uint16 it = cdg.insn.itype;
 
-        if (g_dump_mc) g_cur_mba = cdg.mba;  // stash for the AVX_DUMP_MC interr dumper
-        if (g_cov) cov_record(cdg.insn);     // coverage-closure accounting
-
         TRACE_ENTER("apply");
 
+        vector_type_cache_begin(cdg.mba);
+
+        merror_t idiom_err;
+        if (idiom_apply(cdg, &idiom_err)) {
+            return idiom_err;
+        }
+
         if (is_zmm_direct_call(cdg.insn)) {
             return handle_zmm_direct_call(cdg);
         }
@@ -393,362 +884,47 @@ struct ida_local AVXLifter : microcode_filter_t {
             it != NN_ktestw && it != NN_ktestb && it != NN_ktestq && it != NN_ktestd)
             return handle_k_alu(cdg);
 
-        // kortest/ktest set EFLAGS only — emit NOP (flag effect not modeled).
-        if (it >= NN_kmovw && it <= NN_kunpckdq) {
-            cdg.emit(m_nop, 0, 0, 0, 0, 0);
+        // kortest/ktest set ZF/CF only, modeled like vptest.
+        if (it == NN_kortestw || it == NN_kortestb || it == NN_kortestq || it == NN_kortestd ||
+            it == NN_ktestw || it == NN_ktestb || it == NN_ktestq || it == NN_ktestd)
+            return handle_ktest(cdg);
+        if (it >= NN_kmovw && it <= NN_kunpckdq)
             return MERR_OK;
-        }
 
-        // Handle compare-to-mask instructions (k-register destination) by emitting NOP
-        if (is_mask_reg(cdg.insn.Op1)) {
-            cdg.emit(m_nop, 0, 0, 0, 0, 0);
+        if (is_packed_int_compare_insn(it) && is_mask_reg(cdg.insn.Op1))
+            return handle_vpcmp_int_to_mask(cdg);
+
+        // Remaining k-register destinations are consumed with no microcode
+        if (is_mask_reg(cdg.insn.Op1))
             return MERR_OK;
-        }
 
         if (try_convert_to_sse(cdg)) return MERR_INSN;
 
-        // conversions
-        if (it == NN_vcvtdq2ps) return handle_vcvtdq2ps(cdg);
-        if (it == NN_vcvtsi2ss || it == NN_vcvtsi2sd) return handle_vcvtsi2fp(cdg);
-        if (it == NN_vcvtps2pd) return handle_vcvtps2pd(cdg);
-        if (it == NN_vcvtss2sd || it == NN_vcvtsd2ss) return handle_vcvtfp2fp(cdg);
-        if (it == NN_vcvtpd2ps) return handle_vcvtpd2ps(cdg);
-        if (it == NN_vcvttps2dq) return handle_vcvt_ps2dq(cdg, true);
-        if (it == NN_vcvtps2dq) return handle_vcvt_ps2dq(cdg, false);
-        if (it == NN_vcvttpd2dq) return handle_vcvt_pd2dq(cdg, true);
-        if (it == NN_vcvtpd2dq) return handle_vcvt_pd2dq(cdg, false);
-        if (it == NN_vcvtdq2pd) return handle_vcvtdq2pd(cdg);
-        if (it == NN_vcvtps2udq) return handle_vcvt_ps2udq(cdg, false);
-        if (it == NN_vcvttps2udq) return handle_vcvt_ps2udq(cdg, true);
-        if (it == NN_vcvtpd2udq) return handle_vcvt_pd2udq(cdg, false);
-        if (it == NN_vcvttpd2udq) return handle_vcvt_pd2udq(cdg, true);
-        if (it == NN_vcvtudq2ps) return handle_vcvt_udq2ps(cdg);
-        if (it == NN_vcvtudq2pd) return handle_vcvt_udq2pd(cdg);
-        if (it == NN_vcvtpd2qq) return handle_vcvt_pd2qq(cdg, false, false);
-        if (it == NN_vcvtpd2uqq) return handle_vcvt_pd2qq(cdg, false, true);
-        if (it == NN_vcvttpd2qq) return handle_vcvt_pd2qq(cdg, true, false);
-        if (it == NN_vcvttpd2uqq) return handle_vcvt_pd2qq(cdg, true, true);
-        if (it == NN_vcvtps2qq) return handle_vcvt_ps2qq(cdg, false, false);
-        if (it == NN_vcvtps2uqq) return handle_vcvt_ps2qq(cdg, false, true);
-        if (it == NN_vcvttps2qq) return handle_vcvt_ps2qq(cdg, true, false);
-        if (it == NN_vcvttps2uqq) return handle_vcvt_ps2qq(cdg, true, true);
-        if (it == NN_vcvtqq2pd) return handle_vcvt_qq2fp(cdg, true, false);
-        if (it == NN_vcvtqq2ps) return handle_vcvt_qq2fp(cdg, false, false);
-        if (it == NN_vcvtuqq2pd) return handle_vcvt_qq2fp(cdg, true, true);
-        if (it == NN_vcvtuqq2ps) return handle_vcvt_qq2fp(cdg, false, true);
-        if (it == NN_vcvtpd2ph || it == NN_vcvtph2pd || it == NN_vcvtph2psx || it == NN_vcvtps2phx ||
-            it == NN_vcvtph2w || it == NN_vcvttph2w || it == NN_vcvtph2uw || it == NN_vcvttph2uw ||
-            it == NN_vcvtw2ph || it == NN_vcvtuw2ph ||
-            it == NN_vcvtdq2ph || it == NN_vcvtudq2ph || it == NN_vcvtqq2ph || it == NN_vcvtuqq2ph ||
-            it == NN_vcvtph2dq || it == NN_vcvttph2dq || it == NN_vcvtph2udq || it == NN_vcvttph2udq ||
-            it == NN_vcvtph2qq || it == NN_vcvttph2qq || it == NN_vcvtph2uqq || it == NN_vcvttph2uqq ||
-            it == NN_vcvtph2ps || it == NN_vcvtps2ph)
-            return handle_vcvt_fp16(cdg);
-        if (it == NN_vcvtsh2si || it == NN_vcvttsh2si || it == NN_vcvtsh2usi || it == NN_vcvttsh2usi ||
-            it == NN_vcvtsd2usi || it == NN_vcvttsd2usi || it == NN_vcvtss2usi || it == NN_vcvttss2usi ||
-            it == NN_vcvtusi2sd || it == NN_vcvtusi2ss || it == NN_vcvtsi2sh || it == NN_vcvtusi2sh ||
-            it == NN_vcvtsd2sh || it == NN_vcvtsh2sd || it == NN_vcvtss2sh || it == NN_vcvtsh2ss)
-            return handle_vcvt_scalar_ext(cdg);
-        if (it == NN_vldmxcsr || it == NN_vstmxcsr) return handle_vmxcsr(cdg);
-
-        // SAD (sum of absolute differences)
-        if (is_sad_insn(it)) return handle_vsad(cdg);
-
-        // moves
-        if (it == NN_vmovd) return handle_vmov(cdg, DWORD_SIZE);
-        if (it == NN_vmovq) return handle_vmov(cdg, QWORD_SIZE);
-        if (it == NN_vmovss) return handle_vmov_ss_sd(cdg, FLOAT_SIZE);
-        if (it == NN_vmovsd) return handle_vmov_ss_sd(cdg, DOUBLE_SIZE);
-        if (it == NN_vmovsh) return handle_vmov_sh(cdg);
-        if (it == NN_vmovw) return handle_vmovw(cdg);
-        if (it == NN_vmovaps || it == NN_vmovups || it == NN_vmovdqa || it == NN_vmovdqu ||
-            it == NN_vmovapd || it == NN_vmovupd ||
-            it == NN_vmovdqa32 || it == NN_vmovdqa64 ||
-            it == NN_vmovdqu8 || it == NN_vmovdqu16 || it == NN_vmovdqu32 || it == NN_vmovdqu64)
-            return handle_v_mov_ps_dq(cdg);
-
-        // compress/expand (masked load/store)
-        if (is_compress_insn(it)) return handle_v_compress(cdg);
-        if (is_expand_insn(it)) return handle_v_expand(cdg);
-
-        // bitwise (now full 128/256-bit via intrinsics)
-        if (is_bitwise_insn(it)) return handle_v_bitwise(cdg);
-
-        // popcount/lzcnt
-        if (is_popcnt_insn(it)) return handle_v_popcnt(cdg);
-        if (is_lzcnt_insn(it)) return handle_v_lzcnt(cdg);
-
-        // GFNI
-        if (is_gfni_insn(it)) return handle_v_gfni(cdg);
-
-        // carryless multiply
-        if (is_pclmul_insn(it)) return handle_v_pclmul(cdg);
-
-        // AES
-        if (is_aes_insn(it)) return handle_v_aes(cdg);
-
-        // SHA
-        if (is_sha_insn(it)) return handle_v_sha(cdg);
-
-        // Cache control
-        if (is_cache_ctrl_insn(it)) return handle_cache_ctrl(cdg);
-
-        // scalar math (add/sub/mul/div)
-        if (it == NN_vaddss || it == NN_vsubss || it == NN_vmulss || it == NN_vdivss)
-            return handle_v_math_ss_sd(
-                cdg, FLOAT_SIZE);
-        if (it == NN_vaddsd || it == NN_vsubsd || it == NN_vmulsd || it == NN_vdivsd)
-            return handle_v_math_ss_sd(
-                cdg, DOUBLE_SIZE);
-        if (is_fp16_scalar_math_insn(it)) return handle_v_math_sh(cdg);
-
-        // scalar min/max
-        if (is_scalar_minmax(it)) return handle_v_minmax_ss_sd(cdg);
-
-        // packed math (+ min/max + integer add/sub + integer mul)
-        if (is_packed_math_insn(it)) return handle_v_math_p(cdg);
-        if (is_fp16_packed_math_insn(it)) return handle_v_math_ph(cdg);
-
-        // abs
-        if (is_abs_insn(it)) return handle_v_abs(cdg);
-
-        // sign
-        if (is_sign_insn(it)) return handle_v_sign(cdg);
-
-        // fma
-        if (is_fma_insn(it)) return handle_v_fma(cdg);
-        if (is_fp16_fma_insn(it)) return handle_v_fma_ph(cdg);
-
-        // fp16 complex ops
-        if (is_fp16_complex_insn(it)) return handle_v_complex_ph(cdg);
-
-        // IFMA / VNNI / BF16
-        if (is_ifma_insn(it)) return handle_v_ifma(cdg);
-        if (is_vnni_insn(it)) return handle_v_vnni(cdg);
-        if (is_bf16_insn(it)) return handle_v_bf16(cdg);
-
-        // shifts
-        if (is_shift_insn(it)) return handle_v_shift(cdg);
-        if (is_var_shift_insn(it)) return handle_v_var_shift(cdg);
-        if (is_rotate_insn(it)) return handle_v_rotate(cdg);
-        if (is_var_rotate_insn(it)) return handle_v_var_rotate(cdg);
-        if (is_shift_double_insn(it)) return handle_v_shift_double(cdg);
-        if (is_multishift_insn(it)) return handle_v_multishift(cdg);
-
-        // shuffles, perms, align
-        if (is_shuffle_insn(it)) return handle_v_shuffle_int(cdg);
-        if (is_shuf_lane_insn(it)) return handle_v_shuf_lane(cdg);
-        if (it == NN_vblendmps || it == NN_vblendmpd || it == NN_vpblendmb ||
-            it == NN_vpblendmw || it == NN_vpblendmd || it == NN_vpblendmq)
-            return handle_v_blendm(cdg);
-        if (it == NN_vpbroadcastmb2q || it == NN_vpbroadcastmw2d)
-            return handle_v_broadcastm(cdg);
-        if (it == NN_vbroadcastf32x2 || it == NN_vbroadcasti32x2)
-            return handle_v_broadcast_x2(cdg);
-        if (it == NN_vexp2ps || it == NN_vexp2pd ||
-            it == NN_vrcp28ps || it == NN_vrcp28pd || it == NN_vrcp28ss || it == NN_vrcp28sd ||
-            it == NN_vrsqrt28ps || it == NN_vrsqrt28pd || it == NN_vrsqrt28ss || it == NN_vrsqrt28sd)
-            return handle_v_er(cdg);
-        if (it == NN_v4fmaddps || it == NN_v4fnmaddps || it == NN_v4fmaddss ||
-            it == NN_v4fnmaddss || it == NN_vp4dpwssd || it == NN_vp4dpwssds)
-            return handle_v_4fma(cdg);
-        if (it == NN_vcomish || it == NN_vucomish)
-            return handle_v_comish(cdg);
-        if (it == NN_vgatherpf0dps || it == NN_vgatherpf0qps || it == NN_vgatherpf0dpd ||
-            it == NN_vgatherpf0qpd || it == NN_vscatterpf0dps || it == NN_vscatterpf0qps ||
-            it == NN_vscatterpf0dpd || it == NN_vscatterpf0qpd)
-            return handle_v_prefetch_gs(cdg);
-        if (is_perm_insn(it)) return handle_v_perm_int(cdg);
-        if (is_align_insn(it)) return handle_v_align(cdg);
-
-        // gather
-        if (is_gather_insn(it)) return handle_v_gather(cdg);
-
-        // scatter
-        if (is_scatter_insn(it)) return handle_v_scatter(cdg);
-
-        // horizontal math
-        if (is_horizontal_math(it)) return handle_v_hmath(cdg);
-
-        // dot product
-        if (is_dot_product(it)) return handle_v_dot(cdg);
-
-        // approximations (rcp, rsqrt)
-        if (is_approx_insn(it)) return handle_vrcp_rsqrt(cdg);
-
-        // rounding
-        if (is_round_insn(it)) return handle_vround(cdg);
-
-        // fp16 sqrt
-        if (is_fp16_sqrt_insn(it)) return handle_v_sqrt_ph(cdg);
-        if (is_fp16_scalar_misc_insn(it)) return handle_v_fp16_scalar_misc(cdg);
-
-        // getexp/getmant/fixupimm/scalef/range/reduce
-        if (is_getexp_insn(it)) return handle_v_getexp(cdg);
-        if (is_getmant_insn(it)) return handle_v_getmant(cdg);
-        if (is_fixupimm_insn(it)) return handle_v_fixupimm(cdg);
-        if (is_scalef_insn(it)) return handle_v_scalef(cdg);
-        if (is_range_insn(it)) return handle_v_range(cdg);
-        if (is_reduce_insn(it)) return handle_v_reduce(cdg);
-
-        // broadcasts
-        if (it == NN_vbroadcastss || it == NN_vbroadcastsd) return handle_vbroadcast_ss_sd(cdg);
-        if (it == NN_vbroadcastf128) return handle_vbroadcastf128_fp(cdg);
-        if (it == NN_vbroadcasti128) return handle_vbroadcasti128_int(cdg);
-        if (it == NN_vbroadcastf32x4 || it == NN_vbroadcastf64x4 ||
-            it == NN_vbroadcasti32x4 || it == NN_vbroadcasti64x4)
-            return handle_vbroadcast_x4(cdg);
-
-        // packed compares
-        if (is_packed_compare_insn(it)) return handle_vcmp_ps_pd(cdg);
-        if (is_packed_int_compare_insn(it)) return handle_vpcmp_int(cdg);
-
-        // blend
-        if (it == NN_vblendvps || it == NN_vblendvpd) return handle_vblendv_ps_pd(cdg);
-        if (it == NN_vblendps || it == NN_vblendpd) return handle_vblend_imm_ps_pd(cdg);
-        if (it == NN_vpblendd || it == NN_vpblendw || it == NN_vpblendvb) return handle_vblend_int(cdg);
-
-        // maskmov
-        if (is_maskmov_insn(it)) return handle_vmaskmov_ps_pd(cdg);
-        if (is_pmaskmov_int_insn(it)) return handle_vpmaskmov_int(cdg);
-
-        // misc
-        if (it == NN_vsqrtss) return handle_vsqrtss(cdg);
-        if (it == NN_vsqrtsh) return handle_vsqrt_sh(cdg);
-        if (it == NN_vsqrtps || it == NN_vsqrtpd) return handle_vsqrt_ps_pd(cdg);
-        if (it == NN_vshufps) return handle_vshufps(cdg);
-        if (it == NN_vshufpd) return handle_vshufpd(cdg);
-        if (it == NN_vpermpd) return handle_vpermpd(cdg);
-        if (it == NN_vmovlhps) return handle_vmovlhps(cdg);
-        if (it == NN_vmovhlps) return handle_vmovhlps(cdg);
-        if (it == NN_vmovhps || it == NN_vmovlps || it == NN_vmovhpd || it == NN_vmovlpd)
-            return handle_vmovl_h_ps_pd(cdg);
-        if (it == NN_vzeroupper) return handle_vzeroupper_nop(cdg);
-        if (it == NN_vzeroall) return handle_vzeroall(cdg);
-        if (it == NN_vphminposuw) return handle_vphminposuw(cdg);
-        if (is_vtest_insn(it)) return handle_vtest_ps_pd(cdg);
-
-        // extract/insert
-        if (it == NN_vextractf128 || it == NN_vextracti128 ||
-            it == NN_vextracti32x4 || it == NN_vextracti32x8 || it == NN_vextracti64x4 ||
-            it == NN_vextractf32x4 || it == NN_vextractf32x8 ||
-            it == NN_vextractf64x2 || it == NN_vextractf64x4 || it == NN_vextracti64x2)
-            return handle_vextractf128(cdg);
-        if (it == NN_vinsertf128 || it == NN_vinserti128 ||
-            it == NN_vinserti32x4 || it == NN_vinserti32x8 || it == NN_vinserti64x4 ||
-            it == NN_vinsertf32x4 || it == NN_vinsertf64x4 ||
-            it == NN_vinsertf32x8 || it == NN_vinsertf64x2 || it == NN_vinserti64x2)
-            return handle_vinsertf128(cdg);
-
-        // movdup
-        if (it == NN_vmovshdup) return handle_vmovshdup(cdg);
-        if (it == NN_vmovsldup) return handle_vmovsldup(cdg);
-        if (it == NN_vmovddup) return handle_vmovddup(cdg);
-
-        // unpack
-        if (is_unpack_insn(it)) return handle_vunpck(cdg);
-
-        // scalar approximations (rcp, rsqrt)
-        if (is_scalar_approx_insn(it)) return handle_vrcp_rsqrt_ss(cdg);
-
-        // scalar rounding
-        if (is_scalar_round_insn(it)) return handle_vround_ss_sd(cdg);
-
-        // scalar sqrt double
-        if (it == NN_vsqrtsd) return handle_vsqrtsd(cdg);
-
-        // addsub
-        if (is_addsub_insn(it)) return handle_vaddsubps_pd(cdg);
-
-        // broadcast d/q
-        if (is_vpbroadcast_d_q(it)) return handle_vpbroadcast_d_q(cdg);
-
-        // permute 128-bit lanes
-        if (is_vperm2_insn(it)) return handle_vperm2f128_i128(cdg);
-
-        // permute bytes/words (VBMI)
-        if (is_permutex_insn(it)) return handle_v_permutex(cdg);
+        // Every input a known constant: emit the result as a literal
+        if (consteval_fold(cdg)) return MERR_OK;
 
-        // permute from two tables
-        if (is_permutex2_insn(it)) return handle_v_permutex2(cdg);
-
-        // ternary logic
-        if (is_ternary_logic_insn(it)) return handle_v_ternary_logic(cdg);
-
-        // conflict detection
-        if (is_conflict_insn(it)) return handle_v_conflict(cdg);
-
-        // horizontal subtract (including saturated)
-        if (is_phsub_insn(it)) return handle_vphsub_sw(cdg);
-
-        // pack
-        if (is_pack_insn(it)) return handle_vpack(cdg);
-
-        // fmaddsub/fmsubadd
-        if (is_fmaddsub_insn(it)) return handle_vfmaddsub(cdg);
-
-        // move mask to GPR
-        if (is_movmsk_insn(it)) return handle_vmovmsk(cdg);
-
-        // non-temporal store
-        if (is_movnt_insn(it)) return handle_vmovnt(cdg);
-
-        // mask to vector
-        if (is_mask_to_vec_insn(it)) return handle_v_mask_to_vec(cdg);
-
-        // broadcast byte/word
-        if (is_vpbroadcast_b_w(it)) return handle_vpbroadcast_b_w(cdg);
-
-        // insert into vector
-        if (is_pinsert_insn(it)) return handle_vpinsert(cdg);
-
-        // sign extend
-        if (is_pmovsx_insn(it)) return handle_vpmovsx(cdg);
-
-        // zero extend
-        if (is_pmovzx_insn(it)) return handle_vpmovzx(cdg);
-
-        // narrow to bytes
-        if (is_pmovwb_insn(it)) return handle_vpmovwb(cdg);
-
-        // down-convert packed integers
-        if (is_pmov_down_insn(it)) return handle_vpmov_down(cdg);
-
-        // byte shift
-        if (is_byte_shift_insn(it)) return handle_vpslldq_vpsrldq(cdg);
-
-        // integer unpack
-        if (is_punpck_insn(it)) return handle_vpunpck(cdg);
-
-        // extract float to GPR/mem
-        if (is_extractps_insn(it)) return handle_vextractps(cdg);
-
-        // insert single float
-        if (is_insertps_insn(it)) return handle_vinsertps(cdg);
-
-        // flag-setting vector tests
-        if (is_ptest_insn(it)) return handle_vptest(cdg);
-
-        return MERR_INSN;
+        // Everything else goes to the handler for its itype
+        lift_fn_t handler = lookup_handler(it);
+        return handler != nullptr ? handler(cdg) : MERR_INSN;
     }
 };
 
 //-----------------------------------------------------------------------------
 // Debug callback for printing disassembly and microcode
 //-----------------------------------------------------------------------------
-static bool g_callback_active = false;
+static ssize_t idaapi hexrays_debug_callback(void *ud, hexrays_event_t event, va_list va) {
+    AVXLifter *avx = static_cast<AVXLifter *>(ud);
 
-static ssize_t idaapi hexrays_debug_callback(void *, hexrays_event_t event, va_list va) {
     // Safety check: don't process if we're shutting down
-    if (!g_callback_active)
+    if (!avx->callback_active)
         return 0;
 
     switch (event) {
         case hxe_microcode: {
             // Microcode has just been generated (MMAT_GENERATED). Dump it.
             mba_t *mba = va_arg(va, mba_t *);
-            g_cur_mba = mba;
-            if (g_dump_mc)
+            avx->cur_mba = mba;
+            if (avx->dump_mc)
                 dump_mba_full(mba, "GENERATED");
             break;
         }
@@ -756,9 +932,9 @@ static ssize_t idaapi hexrays_debug_callback(void *, hexrays_event_t event, va_l
             // The verifier (or anything else) raised an internal error. Dump the
             // microcode we were last building so we can see the bad construct.
             int errcode = va_arg(va, int);
-            if (g_dump_mc) {
+            if (avx->dump_mc) {
                 msg("[MCDUMP] hxe_interr errcode=%d -- dumping last mba\n", errcode);
-                dump_mba_full(g_cur_mba, "AT-INTERR");
+                dump_mba_full(avx->cur_mba, "AT-INTERR");
             }
             break;
         }
@@ -769,10 +945,169 @@ static ssize_t idaapi hexrays_debug_callback(void *, hexrays_event_t event, va_l
 }
 
 //-----------------------------------------------------------------------------
-// Component glue
+// Per-function state and INTERR quarantine
+//
+// Every decompilation starts with hxe_flowchart. The lifter's per-function
+// caches (idiom windows, spills, known constants, memory operand addresses,
+// vector types) are dropped there, so none of them outlives the mba and
+// instructions it points to or crosses into another database's function.
+// It also forgets the function lifted last so that an error in a function
+// the lifter never touched is not blamed on it. An error in one it did touch
+// is recorded against the itype it was emitting, or against the whole
+// function if it was not emitting any.
 //-----------------------------------------------------------------------------
-static AVXLifter *g_avx = nullptr;
+static void forget_function_state(AVXLifter *avx) {
+    idiom_reset(avx->state.idiom);
+    spill_reset(avx->state.spills);
+    consteval_reset(avx->state.consteval);
+    memop_reset();
+    avx->state.vtype_mba = nullptr;
+    avx->state.bcast_ea = BADADDR;
+    avx->q_func = BADADDR;
+    avx->q_itype = 0;
+    avx->lifting = false;
+}
+
+static ssize_t idaapi function_callback(void *ud, hexrays_event_t event, va_list va) {
+    AVXLifter *avx = static_cast<AVXLifter *>(ud);
+    switch (event) {
+        case hxe_flowchart:
+            forget_function_state(avx);
+            break;
+        case hxe_interr: {
+            int errcode = va_arg(va, int);
+            if (avx->q_func == BADADDR || avx->q_itype == 0)
+                break;
+            quarantine_t q = quarantine_record(avx->q_func, errcode, avx->q_itype, avx->lifting);
+            if (q.mode == QM_DECLINE)
+                msg("[AVXLifter] %a: INTERR %d while lifting itype %u: declined in this function from now on\n",
+                    avx->q_func, errcode, avx->q_itype);
+            else
+                msg("[AVXLifter] %a: INTERR %d: lifter turned off for this function\n",
+                    avx->q_func, errcode);
+            avx->lifting = false;
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Lazy activation
+//
+// Most databases the loaders open contain no vector code. Until a function
+// that does is decompiled, the component only watches hxe_flowchart, which
+// Hex-Rays raises before generating microcode: the blocks about to be lifted
+// are decoded once per function, and the first function with a supported
+// instruction (or a direct call into ZMM code) activates the filter and
+// everything behind it before its own microcode is generated. Once
+// auto-analysis is done, the first event marks every function a raw-bytes
+// scan (src/scan/vex_scanner) finds vector code in; the others still get the
+// per-function decode.
+//-----------------------------------------------------------------------------
+static bool flowchart_needs_lifter(const qflow_chart_t &fc) {
+    for (int i = 0; i < fc.size(); i++) {
+        const qbasic_block_t &bb = fc.blocks[i];
+        for (ea_t ea = bb.start_ea; ea < bb.end_ea && ea != BADADDR; ea = next_head(ea, bb.end_ea)) {
+            insn_t insn;
+            if (decode_insn(&insn, ea) <= 0) continue;
+            if (avx_supported_itype(insn.itype) || is_zmm_direct_call(insn)) return true;
+        }
+    }
+    return false;
+}
+
+// Mark the functions one scan of the code segments finds vector code in.
+// Callers of ZMM code need the lifter for the call itself. Every other
+// function stays undecided: the scan only sees VEX/EVEX encodings in bytes
+// it could attribute to a function, so the per-function decode still has
+// the last word on them.
+static void seed_vector_funcs(AVXLifter *avx) {
+    vex_index_t index;
+    vex_index_build(&index);
+
+    for (ea_t f : index.funcs)
+        avx->vector_funcs[f] = true;
+    for (ea_t f : index.zmm_funcs) {
+        xrefblk_t xb;
+        for (bool ok = xb.first_to(f, XREF_FAR); ok; ok = xb.next_to()) {
+            func_t *caller = xb.iscode ? get_func(xb.from) : nullptr;
+            if (caller != nullptr)
+                avx->vector_funcs[caller->start_ea] = true;
+        }
+    }
+    DEBUG_LOG("vector index: %" FMT_Z " candidates, %" FMT_Z " confirmed, %" FMT_Z " functions",
+              index.candidates, index.confirmed, index.funcs.size());
+}
+
+static void MicroAvx_activate(AVXLifter *avx) {
+    avx->active = true;
+    avx_state_enter(&avx->state);
+
+    // Opt-in microcode dumper for debugging verifier INTERRs. When AVX_DUMP_MC
+    // is set we install a callback that dumps the full microcode at generation
+    // time and at the moment of any internal error (e.g. INTERR 50920).
+    avx->dump_mc = qgetenv("AVX_DUMP_MC", nullptr);
+    if (avx->dump_mc) {
+        avx->callback_active = true;
+        install_hexrays_callback(hexrays_debug_callback, avx);
+        msg("[AVXLifter] AVX_DUMP_MC set: microcode dumper installed\n");
+    }
+
+    // Coverage-closure: record observed per-itype memory coverage / dump manifest.
+    avx->cov = qgetenv("AVX_COV", &avx->cov_path) && !avx->cov_path.empty();
+    if (avx->cov)
+        msg("[AVXLifter] AVX_COV set: recording itype coverage -> %s\n", avx->cov_path.c_str());
+    cov_dump_manifest();
+
+    regmap_init();
+    avx->state.pool = const_pool_init();
+    avx->state.spills = spill_init();
+    avx->state.idiom = idiom_init();
+    avx->state.consteval = consteval_init();
+    // Fallback for every itype: idiom windows consume scalar instructions and
+    // any k-register destination is claimed, so no fixed itype set covers match().
+    avx->reg->add_microcode_filter(avx, nullptr);
+    avx->memloop.honor_quarantine = !avx->dump_mc;
+    install_optblock_handler(&avx->memloop);
+    install_hexrays_callback(function_callback, avx);
+    // Activation runs inside the first function's hxe_flowchart, which the
+    // callback above has missed; another database may have left state behind
+    forget_function_state(avx);
+}
+
+static ssize_t idaapi activation_callback(void *ud, hexrays_event_t event, va_list va) {
+    if (event != hxe_flowchart)
+        return 0;
+    AVXLifter *avx = static_cast<AVXLifter *>(ud);
+    if (avx->active)
+        return 0;
+    avx_state_enter(&avx->state);
+
+    qflow_chart_t *fc = va_arg(va, qflow_chart_t *);
+    if (fc == nullptr || fc->size() == 0)
+        return 0;
+    if (!avx->indexed && auto_is_ok()) {
+        avx->indexed = true;
+        seed_vector_funcs(avx);
+    }
+    ea_t key = fc->pfn != nullptr ? fc->pfn->start_ea : fc->blocks[0].start_ea;
+    auto p = avx->vector_funcs.find(key);
+    if (p == avx->vector_funcs.end())
+        p = avx->vector_funcs.emplace(key, flowchart_needs_lifter(*fc)).first;
+    if (p->second) {
+        msg("[AVXLifter] Vector code in %a: activating\n", key);
+        MicroAvx_activate(avx);
+        avx->vector_funcs.clear();
+    }
+    return 0;
+}
 
+//-----------------------------------------------------------------------------
+// Component glue
+//-----------------------------------------------------------------------------
 static bool isMicroAvx_avail() {
     // Support both 32-bit (IA-32) and 64-bit (x86-64) binaries
     // In 32-bit mode, only YMM0-YMM7 are available (VEX.R/X/B ignored)
@@ -782,64 +1117,80 @@ static bool isMicroAvx_avail() {
     return true;
 }
 
-static bool isMicroAvx_active() { return g_avx != nullptr; }
+static bool isMicroAvx_active(void *inst) {
+    return inst != nullptr && static_cast<AVXLifter *>(inst)->active;
+}
 
+// Applies to the database whose lifter was entered last.
 extern "C" void set_debug_logging(bool enabled) {
-    debug_logging_enabled = enabled;
+    avx_state_t *st = avx_state();
+    if (st == nullptr)
+        return;
+    st->debug_logging = enabled;
     msg("[AVXLifter] Debug logging set to %s\n", enabled ? "TRUE" : "FALSE");
 
     // Also enable/disable debug printing
     ::set_debug_printing(enabled);
 }
 
-static void MicroAvx_init() {
-    if (g_avx) return;
+// Release every quarantined function of the current database.
+extern "C" size_t clear_quarantine() {
+    size_t count = quarantine_clear();
+    msg("[AVXLifter] Quarantine cleared: %" FMT_Z " function(s) released\n", count);
+    return count;
+}
+
+static void *MicroAvx_init(component_registry_t &reg) {
+    AVXLifter *avx = new AVXLifter();
+    avx_state_enter(&avx->state);
 
     // Enable debug logging temporarily for debugging
-    debug_logging_enabled = true;
+    avx->state.debug_logging = true;
     ::set_debug_printing(true);
 
     msg("[AVXLifter] Initializing AVXLifter component\n");
 
-    // Opt-in microcode dumper for debugging verifier INTERRs. When AVX_DUMP_MC
-    // is set we install a callback that dumps the full microcode at generation
-    // time and at the moment of any internal error (e.g. INTERR 50920).
-    g_dump_mc = qgetenv("AVX_DUMP_MC", nullptr);
-    if (g_dump_mc) {
-        g_callback_active = true;
-        install_hexrays_callback(hexrays_debug_callback, nullptr);
-        msg("[AVXLifter] AVX_DUMP_MC set: microcode dumper installed\n");
-    }
-
-    // Coverage-closure: record observed per-itype memory coverage / dump manifest.
-    g_cov = qgetenv("AVX_COV", &g_cov_path) && !g_cov_path.empty();
-    if (g_cov)
-        msg("[AVXLifter] AVX_COV set: recording itype coverage -> %s\n", g_cov_path.c_str());
-    cov_dump_manifest();
-
-    g_avx = new AVXLifter();
-    install_microcode_filter(g_avx, true);
+    // Nothing else is set up until the first vector function shows up
+    avx->reg = &reg;
+    install_hexrays_callback(activation_callback, avx);
+    quarantine_init();
+    return avx;
 }
 
-static void MicroAvx_done() {
-    if (!g_avx) return;
-
-    cov_flush();  // append this run's observed coverage before teardown
+static void MicroAvx_done(component_registry_t &reg, void *inst) {
+    AVXLifter *avx = static_cast<AVXLifter *>(inst);
+    if (avx == nullptr) return;
 
     msg("[AVXLifter] Terminating AVXLifter component\n");
+    remove_hexrays_callback(activation_callback, avx);
+    quarantine_term();
+
+    if (avx->active) {
+        if (avx->cov)
+            cov_flush(avx->cov_path, avx->cov_seen);  // append this run's observed coverage before teardown
 
-    // Disable callback first to prevent any callbacks during cleanup
-    g_callback_active = false;
+        // Disable callback first to prevent any callbacks during cleanup
+        avx->callback_active = false;
 
-    // Remove microcode filter before removing callback
-    install_microcode_filter(g_avx, false);
+        // Remove microcode filter before removing callback
+        reg.remove_microcode_filter(avx);
+        remove_optblock_handler(&avx->memloop);
+        remove_hexrays_callback(function_callback, avx);
 
-    // Remove debug callback
-    remove_hexrays_callback(hexrays_debug_callback, nullptr);
+        // Remove debug callback
+        if (avx->dump_mc)
+            remove_hexrays_callback(hexrays_debug_callback, avx);
+
+        const_pool_term(avx->state.pool);
+        spill_term(avx->state.spills);
+        idiom_term(avx->state.idiom);
+        consteval_term(avx->state.consteval);
+    }
 
     // Clean up lifter instance
-    delete g_avx;
-    g_avx = nullptr;
+    if (avx_state() == &avx->state)
+        avx_state_enter(nullptr);
+    delete avx;
 }
 
 static const char avx_short_name[] = "avx";
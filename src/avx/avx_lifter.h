@@ -1,17 +1,19 @@
 #pragma once
 
+#include "../plugin/component_registry.h"
+
 #if IDA_SDK_VERSION >= 750
 
 // Check if AVX lifter is available on this platform
 bool isMicroAvx_avail();
 
-// Check if AVX lifter is currently active
-bool isMicroAvx_active();
+// Check if the AVX lifter instance `inst` is active
+bool isMicroAvx_active(void *inst);
 
-// Initialize AVX lifter
-void MicroAvx_init();
+// Initialize the AVX lifter for the registry's database; returns its instance
+void *MicroAvx_init(component_registry_t &reg);
 
-// Terminate AVX lifter
-void MicroAvx_done();
+// Terminate the AVX lifter instance returned by MicroAvx_init
+void MicroAvx_done(component_registry_t &reg, void *inst);
 
 #endif // IDA_SDK_VERSION >= 750
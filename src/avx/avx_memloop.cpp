@@ -0,0 +1,1234 @@
+/*
+ AVX Memory Loop Recognition
+*/
+
+#include "avx_memloop.h"
+#include "avx_types.h"
+#include "avx_quarantine.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../common/warn_off.h"
+#include <intel.hpp>
+#include "../common/warn_on.h"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+int addr_size() { return inf_is_64bit() ? 8 : 4; }
+
+bool is_vec_size(int size) { return size == XMM_SIZE || size == YMM_SIZE || size == ZMM_SIZE; }
+
+bool regs_overlap(mreg_t a, int asz, mreg_t b, int bsz) { return a < b + bsz && b < a + asz; }
+
+// fs/gs-relative accesses are not plain pointers
+bool flat_segment(const mop_t &seg) {
+    return seg.t == mop_r && seg.r != reg2mreg(R_fs) && seg.r != reg2mreg(R_gs);
+}
+
+bool defines_reg(const minsn_t *ins, mreg_t r, int size) {
+    return ins->modifies_d() && ins->d.t == mop_r && regs_overlap(ins->d.r, ins->d.size, r, size);
+}
+
+//-----------------------------------------------------------------------------
+// Address expressions: up to two registers plus a displacement
+//-----------------------------------------------------------------------------
+struct addr_t {
+    mreg_t regs[2];
+    int nregs;
+    sval_t disp;
+};
+
+bool parse_addr_rec(const mop_t &m, addr_t *a, int depth) {
+    if (depth == 0)
+        return false;
+    switch (m.t) {
+        case mop_r:
+            if (m.size != addr_size() || a->nregs == 2)
+                return false;
+            a->regs[a->nregs++] = m.r;
+            return true;
+        case mop_n:
+            a->disp += (sval_t) m.signed_value();
+            return true;
+        case mop_d:
+            if (m.d->opcode == m_add)
+                return parse_addr_rec(m.d->l, a, depth - 1) && parse_addr_rec(m.d->r, a, depth - 1);
+            if (m.d->opcode == m_sub && m.d->r.t == mop_n) {
+                if (!parse_addr_rec(m.d->l, a, depth - 1))
+                    return false;
+                a->disp -= (sval_t) m.d->r.signed_value();
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+bool parse_addr(const mop_t &m, addr_t *a) {
+    a->regs[0] = a->regs[1] = mr_none;
+    a->nregs = 0;
+    a->disp = 0;
+    return parse_addr_rec(m, a, 4);
+}
+
+bool same_regs(const addr_t &a, const addr_t &b) {
+    if (a.nregs != b.nregs)
+        return false;
+    if (a.nregs == 2)
+        return (a.regs[0] == b.regs[0] && a.regs[1] == b.regs[1]) ||
+               (a.regs[0] == b.regs[1] && a.regs[1] == b.regs[0]);
+    return a.nregs == 0 || a.regs[0] == b.regs[0];
+}
+
+//-----------------------------------------------------------------------------
+// Microcode construction
+//-----------------------------------------------------------------------------
+mop_t reg_mop(mreg_t r) { return mop_t(r, addr_size()); }
+
+mop_t num_mop(sval_t v, ea_t ea) {
+    mop_t m;
+    m.make_number((uint64) v, addr_size(), ea);
+    return m;
+}
+
+mop_t binop(mcode_t op, const mop_t &l, const mop_t &r, ea_t ea) {
+    minsn_t *ins = new minsn_t(ea);
+    ins->opcode = op;
+    ins->l = l;
+    ins->r = r;
+    ins->d.size = l.size;
+    mop_t m;
+    m.make_insn(ins);
+    m.size = l.size;
+    return m;
+}
+
+mop_t add_disp(const mop_t &m, sval_t disp, ea_t ea) {
+    return disp == 0 ? m : binop(m_add, m, num_mop(disp, ea), ea);
+}
+
+// `base` (a register or number operand) plus an optional register plus `disp`
+mop_t make_addr(const mop_t &base, mreg_t extra, sval_t disp, ea_t ea) {
+    mop_t m = extra == mr_none ? base : binop(m_add, base, reg_mop(extra), ea);
+    return add_disp(m, disp, ea);
+}
+
+struct libcall_arg_t {
+    mop_t mop;
+    tinfo_t type;
+};
+
+// A helper call, built without a codegen_t since this pass runs after
+// generation. Argument locations follow AVXIntrinsic: dummy stack offsets.
+// Calls returning a value are used as operands (see call_value).
+minsn_t *make_libcall(ea_t ea, const char *name, const qvector<libcall_arg_t> &args,
+                      const tinfo_t &ret = tinfo_t(BT_VOID)) {
+    mcallinfo_t *ci = new mcallinfo_t();
+    ci->cc = CM_CC_SPECIAL;
+    ci->flags = FCI_SPLOK | FCI_FINAL | FCI_PROP;
+    ci->return_type = ret;
+    int stk_off = 0;
+    for (const libcall_arg_t &a : args) {
+        mcallarg_t ca(a.mop);
+        ca.type = a.type;
+        ca.size = (decltype(ca.size)) a.mop.size;
+        ca.argloc.set_stkoff(stk_off);
+        stk_off += qmax(8, a.mop.size);
+        ci->args.add(ca);
+        ci->solid_args++;
+    }
+    minsn_t *call = new minsn_t(ea);
+    call->opcode = m_call;
+    call->l.make_helper(name);
+    call->d.t = mop_f;
+    call->d.f = ci;
+    call->d.size = ret.is_void() ? 0 : (int) ret.get_size();
+    return call;
+}
+
+mop_t call_value(minsn_t *call) {
+    mop_t m;
+    m.make_insn(call);
+    m.size = call->d.size;
+    return m;
+}
+
+tinfo_t void_ptr_type() {
+    tinfo_t t;
+    t.create_ptr(tinfo_t(BT_VOID));
+    return t;
+}
+
+tinfo_t size_type() { return tinfo_t(addr_size() == 8 ? BTF_UINT64 : BTF_UINT32); }
+
+minsn_t *make_mov(const mop_t &src, mreg_t dst, ea_t ea) {
+    minsn_t *ins = new minsn_t(ea);
+    ins->opcode = m_mov;
+    ins->l = src;
+    ins->d = reg_mop(dst);
+    return ins;
+}
+
+//-----------------------------------------------------------------------------
+// Fill values
+//-----------------------------------------------------------------------------
+
+// Byte value of a splat produced by helper call `call`, as an argument for
+// memset. Register sources must survive to the end of `pre` and the loop.
+bool splat_byte(const minsn_t &call, const minsn_t *def, mblock_t *loop, mop_t *out) {
+    if (call.l.t != mop_h || call.d.t != mop_f)
+        return false;
+    const char *name = call.l.helper;
+    const mcallinfo_t *ci = call.d.f;
+    if (strstr(name, "_setzero_") != nullptr) {
+        out->make_number(0, 1);
+        return true;
+    }
+    if (ci->args.empty())
+        return false;
+    const mcallarg_t &a0 = ci->args[0];
+    if (strstr(name, "_xor_") != nullptr && ci->args.size() == 2) {
+        const mcallarg_t &a1 = ci->args[1];
+        if (a0.t == mop_r && a1.t == mop_r && a0.r == a1.r && a0.size == a1.size) {
+            out->make_number(0, 1);
+            return true;
+        }
+        return false;
+    }
+    if (a0.t == mop_n) {
+        int width = 0;
+        if (strstr(name, "_set1_epi8") != nullptr) width = 1;
+        else if (strstr(name, "_set1_epi16") != nullptr) width = 2;
+        else if (strstr(name, "_set1_epi32") != nullptr) width = 4;
+        else if (strstr(name, "_set1_epi64") != nullptr) width = 8;
+        if (width == 0)
+            return false;
+        uint64 v = a0.nnn->value;
+        uint8 b = (uint8) v;
+        for (int i = 1; i < width; i++)
+            if ((uint8) (v >> (8 * i)) != b)
+                return false;
+        out->make_number(b, 1);
+        return true;
+    }
+    if (a0.t == mop_r &&
+        (strstr(name, "_set1_epi8") != nullptr || strstr(name, "_broadcastb_epi8") != nullptr)) {
+        for (const minsn_t *p = def->next; p != nullptr; p = p->next)
+            if (defines_reg(p, a0.r, 1))
+                return false;
+        for (const minsn_t *p = loop->head; p != nullptr; p = p->next)
+            if (defines_reg(p, a0.r, 1))
+                return false;
+        *out = mop_t(a0.r, 1);
+        return true;
+    }
+    return false;
+}
+
+// Find the definition of vector register `v` reaching `from` (inclusive) in
+// the loop's preheader and, if it is a byte splat, the byte it repeats.
+bool splat_byte_before(const minsn_t *from, mblock_t *loop, mreg_t v, int size, mop_t *out) {
+    mreg_t want = v;
+    for (const minsn_t *p = from; p != nullptr; p = p->prev) {
+        if (p->opcode == m_call && p->l.t != mop_h)
+            return false;
+        if (!defines_reg(p, want, size))
+            continue;
+        if (p->d.r != want || p->d.size != size || p->opcode != m_mov)
+            return false;
+        if (p->l.t == mop_r && p->l.size == size) {
+            want = p->l.r;
+            continue;
+        }
+        if (p->l.t == mop_d && p->l.d->opcode == m_call)
+            return splat_byte(*p->l.d, p, loop, out);
+        return false;
+    }
+    return false;
+}
+
+bool find_fill_byte(mblock_t *pre, mblock_t *loop, mreg_t v, int size, mop_t *out) {
+    return splat_byte_before(pre->tail, loop, v, size, out);
+}
+
+// Same for zmm`idx`, which the lifter writes through __writezmm
+bool find_zmm_splat_byte(mblock_t *pre, mblock_t *loop, uint64 idx, mop_t *out) {
+    for (const minsn_t *p = pre->tail; p != nullptr; p = p->prev) {
+        if (p->opcode != m_call)
+            continue;
+        if (p->l.t != mop_h)
+            return false;
+        if (!p->is_helper("__writezmm") || p->d.t != mop_f || p->d.f->args.size() != 2)
+            continue;
+        const mcallarg_t &i = p->d.f->args[0];
+        const mcallarg_t &v = p->d.f->args[1];
+        if (i.t != mop_n || i.nnn->value != idx)
+            continue;
+        if (v.t == mop_d && v.d->opcode == m_call)
+            return splat_byte(*v.d, p, loop, out);
+        if (v.t == mop_r)
+            return splat_byte_before(p->prev, loop, v.r, v.size, out);
+        return false;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Loops
+//-----------------------------------------------------------------------------
+struct access_t {
+    minsn_t *ins;
+    addr_t addr;
+    int size;
+    int pos;
+    int load;       // stores: load that produced the stored value, -1 for fills
+    mreg_t val;     // stores: stored register; loads: destination
+    mreg_t moving;  // induction register in the address
+    mreg_t fixed;   // loop-invariant register in the address, or mr_none
+    sval_t eff;     // offset from the induction register's value at iteration start
+};
+
+struct update_t {
+    mreg_t reg;
+    sval_t delta;
+    int pos;
+};
+
+const update_t *find_update(const qvector<update_t> &ups, mreg_t r) {
+    for (const update_t &u : ups)
+        if (u.reg == r)
+            return &u;
+    return nullptr;
+}
+
+bool classify_access(access_t &a, const qvector<update_t> &ups) {
+    a.moving = a.fixed = mr_none;
+    for (int i = 0; i < a.addr.nregs; i++) {
+        mreg_t r = a.addr.regs[i];
+        const update_t *u = find_update(ups, r);
+        if (u != nullptr) {
+            if (a.moving != mr_none)
+                return false;
+            a.moving = r;
+            a.eff = a.addr.disp + (a.pos > u->pos ? u->delta : 0);
+        } else {
+            if (a.fixed != mr_none)
+                return false;
+            a.fixed = r;
+        }
+    }
+    return a.moving != mr_none;
+}
+
+bool same_shape(const qvector<access_t> &v) {
+    for (const access_t &a : v)
+        if (a.moving != v[0].moving || a.fixed != v[0].fixed)
+            return false;
+    return true;
+}
+
+// The block now falls through to the loop exit
+void drop_back_edge(mblock_t *blk) {
+    blk->succset.del(blk->serial);
+    blk->predset.del(blk->serial);
+    blk->type = BLT_1WAY;
+    blk->mark_lists_dirty();
+    blk->mba->mark_chains_dirty();
+}
+
+mblock_t *preheader(mblock_t *blk) {
+    for (int p : blk->predset)
+        if (p != blk->serial)
+            return blk->mba->get_mblock(p);
+    return nullptr;
+}
+
+// Rewrite a single-block `do { copy/fill W bytes; iv += W } while (iv != end)`
+// loop into one library call followed by the induction registers' final
+// values and a reload of the vector registers the last iteration left behind.
+bool rewrite_loop(mblock_t *blk) {
+    minsn_t *jcc = blk->tail;
+    if (jcc == nullptr || jcc->opcode != m_jnz || jcc->d.t != mop_b || jcc->d.b != blk->serial)
+        return false;
+    if (blk->nsucc() != 2 || blk->npred() != 2)
+        return false;
+    int A = addr_size();
+
+    qvector<access_t> loads, stores;
+    qvector<update_t> ups;
+    std::map<mreg_t, int> value_of;  // vector register -> load holding its value
+    int pos = 0;
+    for (minsn_t *p = blk->head; p != jcc; p = p->next, pos++) {
+        switch (p->opcode) {
+            case m_nop:
+                break;
+            case m_ldx: {
+                if (p->d.t != mop_r || !is_vec_size(p->d.size) || !flat_segment(p->l))
+                    return false;
+                access_t a = {p, {}, p->d.size, pos, -1, p->d.r, mr_none, mr_none, 0};
+                if (!parse_addr(p->r, &a.addr))
+                    return false;
+                value_of[p->d.r] = (int) loads.size();
+                loads.push_back(a);
+                break;
+            }
+            case m_mov: {
+                if (p->l.t != mop_r || p->d.t != mop_r || !is_vec_size(p->d.size) || p->l.size != p->d.size)
+                    return false;
+                auto it = value_of.find(p->l.r);
+                if (it == value_of.end())
+                    return false;
+                value_of[p->d.r] = it->second;
+                break;
+            }
+            case m_stx: {
+                if (p->l.t != mop_r || !is_vec_size(p->l.size) || !flat_segment(p->r))
+                    return false;
+                access_t a = {p, {}, p->l.size, pos, -1, p->l.r, mr_none, mr_none, 0};
+                if (!parse_addr(p->d, &a.addr))
+                    return false;
+                auto it = value_of.find(p->l.r);
+                if (it != value_of.end()) {
+                    if (loads[it->second].size != a.size)
+                        return false;
+                    a.load = it->second;
+                }
+                stores.push_back(a);
+                break;
+            }
+            case m_add:
+            case m_sub: {
+                if (p->d.t != mop_r || p->d.size != A || p->l.t != mop_r || p->l.r != p->d.r ||
+                    p->l.size != A || p->r.t != mop_n || find_update(ups, p->d.r) != nullptr)
+                    return false;
+                sval_t k = (sval_t) p->r.signed_value();
+                ups.push_back({p->d.r, p->opcode == m_add ? k : -k, pos});
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    if (stores.empty() || ups.empty())
+        return false;
+
+    // Either every store copies a loaded value or none does
+    bool is_copy = stores[0].load >= 0;
+    for (const access_t &s : stores)
+        if ((s.load >= 0) != is_copy)
+            return false;
+    if (is_copy) {
+        if (loads.size() != stores.size())
+            return false;
+        qvector<int> used(loads.size(), 0);
+        for (const access_t &s : stores)
+            if (used[s.load]++ != 0)
+                return false;
+    } else {
+        if (!loads.empty())
+            return false;
+        for (const access_t &s : stores) {
+            if (s.val != stores[0].val || s.size != stores[0].size)
+                return false;
+            for (auto &kv : value_of)
+                if (regs_overlap(kv.first, loads[kv.second].size, s.val, s.size))
+                    return false;
+        }
+    }
+
+    for (access_t &a : loads)
+        if (!classify_access(a, ups))
+            return false;
+    for (access_t &a : stores)
+        if (!classify_access(a, ups))
+            return false;
+    if (!same_shape(loads) || !same_shape(stores))
+        return false;
+
+    // Every induction register moves one side, all by the same step
+    sval_t delta = ups[0].delta;
+    for (const update_t &u : ups) {
+        if (u.delta != delta)
+            return false;
+        bool used = u.reg == stores[0].moving || (!loads.empty() && u.reg == loads[0].moving);
+        if (!used)
+            return false;
+    }
+    sval_t step = delta < 0 ? -delta : delta;
+    if (step == 0)
+        return false;
+
+    // Stores cover [eff_min, eff_min + step) exactly, each from the same offset
+    qvector<access_t> sorted = stores;
+    std::sort(sorted.begin(), sorted.end(), [](const access_t &a, const access_t &b) { return a.eff < b.eff; });
+    sval_t eff_min = sorted[0].eff;
+    sval_t next = eff_min;
+    for (const access_t &s : sorted) {
+        if (s.eff != next)
+            return false;
+        next += s.size;
+        if (is_copy && loads[s.load].eff != s.eff)
+            return false;
+    }
+    if (next - eff_min != step)
+        return false;
+
+    // Exit test: jnz C, E with C an induction register and E loop-invariant
+    const mop_t *cmp = nullptr;
+    const mop_t *end = nullptr;
+    for (int side = 0; side < 2 && cmp == nullptr; side++) {
+        const mop_t &a = side == 0 ? jcc->l : jcc->r;
+        const mop_t &b = side == 0 ? jcc->r : jcc->l;
+        if (a.t == mop_r && a.size == A && find_update(ups, a.r) != nullptr &&
+            ((b.t == mop_n && b.size == A) || (b.t == mop_r && b.size == A && find_update(ups, b.r) == nullptr))) {
+            cmp = &a;
+            end = &b;
+        }
+    }
+    if (cmp == nullptr)
+        return false;
+    mreg_t C = cmp->r;
+    mreg_t D = stores[0].moving;
+    mreg_t S = is_copy ? loads[0].moving : mr_none;
+    bool backward = delta < 0;
+    // A backward walk is only expressible when one register drives both sides
+    if (backward && (D != C || (is_copy && S != C)))
+        return false;
+
+    mop_t fill;
+    if (!is_copy) {
+        mblock_t *pre = preheader(blk);
+        if (pre == nullptr || !find_fill_byte(pre, blk, stores[0].val, stores[0].size, &fill))
+            return false;
+    }
+
+    ea_t ea = blk->head->ea;
+    qvector<minsn_t *> out;
+    mop_t E = *end;
+    mop_t bytes = backward ? binop(m_sub, reg_mop(C), E, ea) : binop(m_sub, E, reg_mop(C), ea);
+
+    // Lowest addresses touched: iteration 0 going forward, the last one
+    // (induction value E + step before its update) going backward.
+    mop_t dst_addr, src_addr;
+    if (backward) {
+        dst_addr = make_addr(E, stores[0].fixed, step + eff_min, ea);
+        if (is_copy)
+            src_addr = make_addr(E, loads[0].fixed, step + eff_min, ea);
+    } else {
+        dst_addr = make_addr(reg_mop(D), stores[0].fixed, eff_min, ea);
+        if (is_copy)
+            src_addr = make_addr(reg_mop(S), loads[0].fixed, eff_min, ea);
+    }
+
+    qvector<libcall_arg_t> args;
+    args.push_back({dst_addr, void_ptr_type()});
+    const char *fn;
+    if (is_copy) {
+        // The trip count is only known at run time, so nothing proves the
+        // two ranges apart in either direction
+        args.push_back({src_addr, void_ptr_type()});
+        fn = "memmove";
+    } else {
+        args.push_back({fill, tinfo_t(BTF_UCHAR)});
+        fn = "memset";
+    }
+    args.push_back({bytes, size_type()});
+    out.push_back(make_libcall(ea, fn, args));
+
+    // Induction registers end where the exit test stopped them
+    for (const update_t &u : ups) {
+        if (u.reg == C)
+            continue;
+        minsn_t *adv = new minsn_t(ea);
+        adv->opcode = m_add;
+        adv->l = reg_mop(u.reg);
+        adv->r = binop(m_sub, E, reg_mop(C), ea);
+        adv->d = reg_mop(u.reg);
+        out.push_back(adv);
+    }
+    out.push_back(make_mov(E, C, ea));
+
+    // The last iteration's vector registers hold what it stored
+    if (is_copy) {
+        for (auto &kv : value_of) {
+            const access_t *st = nullptr;
+            for (const access_t &s : stores)
+                if (s.load == kv.second)
+                    st = &s;
+            if (st == nullptr)
+                continue;
+            minsn_t *ld = new minsn_t(ea);
+            ld->opcode = m_ldx;
+            ld->l = st->ins->r;
+            ld->r = make_addr(reg_mop(D), st->fixed, st->eff - delta, ea);
+            ld->d = mop_t(kv.first, st->size);
+            ld->d.set_udt();
+            out.push_back(ld);
+        }
+    }
+
+    DEBUG_LOG("%a: vector %s loop -> %s (step %d)", ea, is_copy ? "copy" : "fill", fn, (int) step);
+
+    for (minsn_t *p = blk->head; p != nullptr;) {
+        minsn_t *nx = blk->remove_from_block(p);
+        delete p;
+        p = nx;
+    }
+    minsn_t *prev = nullptr;
+    for (minsn_t *ins : out) {
+        blk->insert_into_block(ins, prev);
+        prev = ins;
+    }
+
+    drop_back_edge(blk);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Byte scans
+//-----------------------------------------------------------------------------
+
+// Vector width of an intrinsic name and the operation after its _mm prefix
+int intrinsic_width(const char *name) {
+    if (strncmp(name, "_mm512_", 7) == 0) return ZMM_SIZE;
+    if (strncmp(name, "_mm256_", 7) == 0) return YMM_SIZE;
+    if (strncmp(name, "_mm_", 4) == 0) return XMM_SIZE;
+    return 0;
+}
+
+const char *intrinsic_op(const char *name) {
+    int w = intrinsic_width(name);
+    return w == 0 ? nullptr : name + (w == XMM_SIZE ? 4 : 7);
+}
+
+bool is_intrinsic_op(const char *name, const char *op) {
+    const char *o = name != nullptr ? intrinsic_op(name) : nullptr;
+    return o != nullptr && strcmp(o, op) == 0;
+}
+
+const char *helper_of(const minsn_t *ins) {
+    return ins->opcode == m_call && ins->l.t == mop_h && ins->d.t == mop_f ? ins->l.helper : nullptr;
+}
+
+// Helpers a scan body may call: the byte compare, mask extraction, opmask
+// tests and the zmm/opmask register models. None of them touches memory.
+bool is_scan_helper(const char *name) {
+    static const char *const names[] = {"__readzmm", "__writezmm", "__readmask", "__writemask"};
+    static const char *const ops[] = {"cmpeq_epi8", "cmpeq_epi8_mask", "cmp_epi8_mask", "cmp_epu8_mask",
+                                      "testn_epi8_mask", "movemask_epi8"};
+    for (const char *n : names)
+        if (strcmp(name, n) == 0)
+            return true;
+    if (strncmp(name, "_kortest", 8) == 0 || strncmp(name, "_ktest", 6) == 0)
+        return true;
+    for (const char *op : ops)
+        if (is_intrinsic_op(name, op))
+            return true;
+    return false;
+}
+
+struct scan_body_checker_t : public minsn_visitor_t {
+    int idaapi visit_minsn() override {
+        switch (curins->opcode) {
+            case m_call: {
+                const char *name = helper_of(curins);
+                return name != nullptr && is_scan_helper(name) ? 0 : 1;
+            }
+            case m_stx:
+            case m_icall:
+            case m_push:
+            case m_pop:
+            case m_ext:
+            case m_und:
+            case m_ijmp:
+            case m_goto:
+            case m_jtbl:
+            case m_ret:
+                return 1;
+            default:
+                return is_mcode_jcond(curins->opcode) ? 1 : 0;
+        }
+    }
+};
+
+// Registers as the body sees them: microcode registers, plus the zmm and
+// opmask registers the lifter models with __read*/__write* helper calls.
+enum reg_space_t { RS_MREG, RS_ZMM, RS_KMASK };
+
+struct reg_ref_t {
+    reg_space_t space;
+    mreg_t r;   // mreg, or the zmm/opmask index
+    int size;
+};
+
+bool ref_overlaps(const reg_ref_t &a, const reg_ref_t &b) {
+    if (a.space != b.space)
+        return false;
+    return a.space == RS_MREG ? regs_overlap(a.r, a.size, b.r, b.size) : a.r == b.r;
+}
+
+bool ref_covers(const reg_ref_t &w, const reg_ref_t &r) {
+    if (w.space != r.space)
+        return false;
+    return w.space == RS_MREG ? w.r <= r.r && r.r + r.size <= w.r + w.size : w.r == r.r;
+}
+
+bool modeled_ref(const minsn_t *call, bool write, reg_ref_t *out) {
+    const char *name = helper_of(call);
+    if (name == nullptr)
+        return false;
+    reg_space_t space;
+    if (strcmp(name, write ? "__writezmm" : "__readzmm") == 0)
+        space = RS_ZMM;
+    else if (strcmp(name, write ? "__writemask" : "__readmask") == 0)
+        space = RS_KMASK;
+    else
+        return false;
+    const mcallinfo_t *ci = call->d.f;
+    if (ci->args.empty() || ci->args[0].t != mop_n)
+        return false;
+    *out = {space, (mreg_t) ci->args[0].nnn->value, 0};
+    return true;
+}
+
+bool insn_write(const minsn_t *ins, reg_ref_t *out) {
+    if (modeled_ref(ins, true, out))
+        return true;
+    if (ins->modifies_d() && ins->d.t == mop_r) {
+        *out = {RS_MREG, ins->d.r, ins->d.size};
+        return true;
+    }
+    return false;
+}
+
+struct reg_reads_t : public mop_visitor_t {
+    qvector<reg_ref_t> refs;
+    int idaapi visit_mop(mop_t *op, const tinfo_t *, bool is_target) override {
+        reg_ref_t ref;
+        if (op->t == mop_r && !is_target)
+            refs.push_back({RS_MREG, op->r, op->size});
+        else if (op->t == mop_d && modeled_ref(op->d, false, &ref))
+            refs.push_back(ref);
+        return 0;
+    }
+};
+
+// No register is read before the body defines it, except the induction
+// register: every value is recomputed from `iv` and loop invariants, so
+// running the body from any iteration's start reproduces that iteration.
+bool body_recomputes(const qvector<minsn_t *> &body, mreg_t iv) {
+    qvector<reg_ref_t> writes;
+    qvector<size_t> wpos;
+    for (size_t i = 0; i < body.size(); i++) {
+        reg_ref_t w;
+        if (insn_write(body[i], &w)) {
+            writes.push_back(w);
+            wpos.push_back(i);
+        }
+    }
+    reg_ref_t ivref = {RS_MREG, iv, addr_size()};
+    for (size_t i = 0; i < body.size(); i++) {
+        reg_reads_t rd;
+        body[i]->for_all_ops(rd);
+        for (const reg_ref_t &r : rd.refs) {
+            if (ref_overlaps(r, ivref))
+                continue;
+            bool before = false, later = false;
+            for (size_t k = 0; k < writes.size(); k++) {
+                if (wpos[k] < i && ref_covers(writes[k], r))
+                    before = true;
+                else if (wpos[k] >= i && ref_overlaps(writes[k], r))
+                    later = true;
+            }
+            if (later && !before)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Definition of `r` reaching `use` within the block; null if there is none.
+// Fails on a definition of only part of the register.
+bool reaching_def(minsn_t *use, mreg_t r, int size, minsn_t **def) {
+    *def = nullptr;
+    for (minsn_t *p = use->prev; p != nullptr; p = p->prev) {
+        if (!defines_reg(p, r, size))
+            continue;
+        if (p->d.r != r || p->d.size != size)
+            return false;
+        *def = p;
+        return true;
+    }
+    return true;
+}
+
+minsn_t *reaching_model_write(minsn_t *use, const reg_ref_t &ref) {
+    for (minsn_t *p = use->prev; p != nullptr; p = p->prev) {
+        reg_ref_t w;
+        if (modeled_ref(p, true, &w) && w.space == ref.space && w.r == ref.r)
+            return p;
+    }
+    return nullptr;
+}
+
+// What computes operand `m` of top-level instruction `at`, following
+// register moves and the zmm/opmask write helpers
+struct vsrc_t {
+    const minsn_t *ins;  // computing call or ldx; null for a loop invariant
+    minsn_t *at;         // top-level instruction holding `ins`
+    const mop_t *inv;    // the invariant operand (register or __readzmm call)
+};
+
+bool value_source(const mop_t &m, minsn_t *at, vsrc_t *out, int depth = 8) {
+    if (depth == 0)
+        return false;
+    *out = {nullptr, at, &m};
+    if (m.t == mop_r) {
+        minsn_t *def;
+        if (!reaching_def(at, m.r, m.size, &def))
+            return false;
+        if (def == nullptr)
+            return true;
+        if (def->opcode == m_ldx) {
+            *out = {def, def, nullptr};
+            return true;
+        }
+        return def->opcode == m_mov && value_source(def->l, def, out, depth - 1);
+    }
+    if (m.t != mop_d)
+        return false;
+    reg_ref_t ref;
+    if (modeled_ref(m.d, false, &ref)) {
+        minsn_t *w = reaching_model_write(at, ref);
+        if (w == nullptr)
+            return true;
+        return w->d.f->args.size() == 2 && value_source(w->d.f->args[1], w, out, depth - 1);
+    }
+    *out = {m.d, at, nullptr};
+    return true;
+}
+
+struct scan_t {
+    const minsn_t *ldx;  // the scanned load
+    minsn_t *ldx_at;
+    const mop_t *inv;    // vector compared against; null for a zero test
+    int width;
+};
+
+// `cmp` marks the loaded bytes equal to a loop invariant (or zero)
+bool scan_compare(const minsn_t *cmp, minsn_t *at, scan_t *s) {
+    const char *name = helper_of(cmp);
+    if (name == nullptr)
+        return false;
+    const mcallinfo_t *ci = cmp->d.f;
+    bool testn = false;
+    if (is_intrinsic_op(name, "cmpeq_epi8") || is_intrinsic_op(name, "cmpeq_epi8_mask")) {
+        if (ci->args.size() != 2)
+            return false;
+    } else if (is_intrinsic_op(name, "cmp_epi8_mask") || is_intrinsic_op(name, "cmp_epu8_mask")) {
+        // _MM_CMPINT_EQ
+        if (ci->args.size() != 3 || ci->args[2].t != mop_n || ci->args[2].nnn->value != 0)
+            return false;
+    } else if (is_intrinsic_op(name, "testn_epi8_mask")) {
+        if (ci->args.size() != 2)
+            return false;
+        testn = true;
+    } else {
+        return false;
+    }
+
+    vsrc_t a, b;
+    if (!value_source(ci->args[0], at, &a) || !value_source(ci->args[1], at, &b))
+        return false;
+    if (testn) {
+        // testn(v, v) is set for the zero bytes of v
+        if (a.ins == nullptr || a.ins != b.ins)
+            return false;
+        s->inv = nullptr;
+    } else {
+        if (a.ins == nullptr)
+            std::swap(a, b);
+        if (a.ins == nullptr || b.ins != nullptr)
+            return false;
+        s->inv = b.inv;
+    }
+    if (a.ins->opcode != m_ldx)
+        return false;
+    s->ldx = a.ins;
+    s->ldx_at = a.at;
+    s->width = intrinsic_width(name);
+    return a.ins->d.size == s->width;
+}
+
+// `m` holds one bit per scanned byte, set where it matched
+bool scan_mask(const mop_t &m, minsn_t *at, scan_t *s) {
+    vsrc_t v;
+    if (!value_source(m, at, &v) || v.ins == nullptr)
+        return false;
+    const char *name = helper_of(v.ins);
+    if (name == nullptr)
+        return false;
+    if (is_intrinsic_op(name, "movemask_epi8")) {
+        const mcallinfo_t *ci = v.ins->d.f;
+        vsrc_t c;
+        if (ci->args.size() != 1 || !value_source(ci->args[0], v.at, &c) || c.ins == nullptr)
+            return false;
+        const char *cname = helper_of(c.ins);
+        if (!is_intrinsic_op(cname, "cmpeq_epi8") || !scan_compare(c.ins, c.at, s))
+            return false;
+        return intrinsic_width(name) == s->width;
+    }
+    return scan_compare(v.ins, v.at, s);
+}
+
+const mop_t *zero_compared(const minsn_t *ins) {
+    if (ins->r.is_zero())
+        return &ins->l;
+    if (ins->l.is_zero())
+        return &ins->r;
+    return nullptr;
+}
+
+// The loop repeats while the scan mask is zero: `jz mask, #0` or `jcnd zf`
+// with ZF from a test of the mask or from kortest/ktest of one opmask
+bool scan_exit(minsn_t *jcc, scan_t *s) {
+    if (jcc->opcode == m_jz) {
+        const mop_t *x = zero_compared(jcc);
+        return x != nullptr && scan_mask(*x, jcc, s);
+    }
+    if (jcc->opcode != m_jcnd)
+        return false;
+    const minsn_t *def = nullptr;
+    minsn_t *at = jcc;
+    if (jcc->l.t == mop_d) {
+        def = jcc->l.d;
+    } else if (jcc->l.t == mop_r) {
+        minsn_t *d;
+        if (!reaching_def(jcc, jcc->l.r, jcc->l.size, &d) || d == nullptr)
+            return false;
+        at = d;
+        def = d->opcode == m_mov && d->l.t == mop_d ? d->l.d : d;
+    } else {
+        return false;
+    }
+    if (def->opcode == m_setz) {
+        const mop_t *x = zero_compared(def);
+        return x != nullptr && scan_mask(*x, at, s);
+    }
+    const char *name = helper_of(def);
+    if (name == nullptr || (strncmp(name, "_kortestz_", 10) != 0 && strncmp(name, "_ktestz_", 8) != 0))
+        return false;
+    const mcallinfo_t *ci = def->d.f;
+    vsrc_t a, b;
+    if (ci->args.size() != 2 || !value_source(ci->args[0], at, &a) || !value_source(ci->args[1], at, &b) ||
+        a.ins == nullptr || a.ins != b.ins)
+        return false;
+    return scan_mask(ci->args[0], at, s);
+}
+
+// Rewrite a single-block loop that scans W bytes per iteration for a zero
+// byte (or a splatted one) and exits on the first match: strlen / memchr
+// moves the induction register straight to the W-byte block holding the
+// match, and the body then runs once more, leaving every register as the
+// loop's last iteration did.
+bool rewrite_scan(mblock_t *blk) {
+    minsn_t *jcc = blk->tail;
+    if (jcc == nullptr || (jcc->opcode != m_jz && jcc->opcode != m_jcnd) || jcc->d.t != mop_b ||
+        jcc->d.b != blk->serial)
+        return false;
+    if (blk->nsucc() != 2 || blk->npred() != 2)
+        return false;
+    int A = addr_size();
+
+    qvector<minsn_t *> body;
+    scan_body_checker_t checker;
+    for (minsn_t *p = blk->head; p != jcc; p = p->next) {
+        if (p->for_all_insns(checker) != 0)
+            return false;
+        body.push_back(p);
+    }
+    scan_t s;
+    addr_t a;
+    if (!scan_exit(jcc, &s) || !flat_segment(s.ldx->l) || !parse_addr(s.ldx->r, &a))
+        return false;
+
+    // One address register advances by the vector width, the other is invariant
+    mreg_t iv = mr_none, fixed = mr_none;
+    size_t upd_pos = 0;
+    for (int i = 0; i < a.nregs; i++) {
+        int ndefs = 0;
+        for (size_t k = 0; k < body.size(); k++) {
+            if (defines_reg(body[k], a.regs[i], A)) {
+                ndefs++;
+                upd_pos = k;
+            }
+        }
+        if (ndefs == 0) {
+            fixed = a.regs[i];
+            continue;
+        }
+        if (iv != mr_none || ndefs != 1)
+            return false;
+        iv = a.regs[i];
+    }
+    if (iv == mr_none)
+        return false;
+    const minsn_t *upd = body[upd_pos];
+    if ((upd->opcode != m_add && upd->opcode != m_sub) || upd->d.r != iv || upd->d.size != A ||
+        upd->l.t != mop_r || upd->l.r != iv || upd->l.size != A || upd->r.t != mop_n)
+        return false;
+    sval_t delta = (sval_t) upd->r.signed_value();
+    if (upd->opcode == m_sub)
+        delta = -delta;
+    if (delta != s.width || !body_recomputes(body, iv))
+        return false;
+
+    // The load may also sit inside the exit test itself
+    size_t ld_pos = 0;
+    while (ld_pos < body.size() && body[ld_pos] != s.ldx_at)
+        ld_pos++;
+    sval_t eff = a.disp + (ld_pos > upd_pos ? delta : 0);
+
+    bool is_strlen = s.inv == nullptr;
+    mop_t byte;
+    if (!is_strlen) {
+        mblock_t *pre = preheader(blk);
+        reg_ref_t z;
+        if (pre == nullptr)
+            return false;
+        if (s.inv->t == mop_r) {
+            if (!find_fill_byte(pre, blk, s.inv->r, s.inv->size, &byte))
+                return false;
+        } else if (s.inv->t == mop_d && modeled_ref(s.inv->d, false, &z) && z.space == RS_ZMM) {
+            if (!find_zmm_splat_byte(pre, blk, (uint64) z.r, &byte))
+                return false;
+        } else {
+            return false;
+        }
+        is_strlen = byte.t == mop_n && byte.nnn->value == 0;
+    }
+
+    ea_t ea = blk->head->ea;
+    qvector<libcall_arg_t> args;
+    args.push_back({make_addr(reg_mop(iv), fixed, eff, ea), void_ptr_type()});
+    mop_t len;
+    if (is_strlen) {
+        len = call_value(make_libcall(ea, "strlen", args, size_type()));
+    } else {
+        args.push_back({byte, tinfo_t(BTF_UCHAR)});
+        args.push_back({num_mop(-1, ea), size_type()});
+        mop_t hit = call_value(make_libcall(ea, "memchr", args, void_ptr_type()));
+        len = binop(m_sub, hit, make_addr(reg_mop(iv), fixed, eff, ea), ea);
+    }
+    minsn_t *skip = new minsn_t(ea);
+    skip->opcode = m_add;
+    skip->l = reg_mop(iv);
+    skip->r = binop(m_and, len, num_mop(-s.width, ea), ea);
+    skip->d = reg_mop(iv);
+    blk->insert_into_block(skip, nullptr);
+
+    DEBUG_LOG("%a: vector byte scan loop -> %s (step %d)", ea, is_strlen ? "strlen" : "memchr", s.width);
+
+    blk->remove_from_block(jcc);
+    delete jcc;
+    drop_back_edge(blk);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Straight-line copies
+//-----------------------------------------------------------------------------
+// Runs of ymm/zmm copies at least this long become a call. Shorter runs, and
+// the xmm moves that SSE code and IDA's own lifting are full of, stay as is.
+const int MIN_COPY_STORE = YMM_SIZE;
+const sval_t MIN_COPY_BYTES = 64;
+
+struct copy_pair_t {
+    minsn_t *ldx;
+    minsn_t *ldx_at;  // top-level instruction holding `ldx`
+    minsn_t *stx;
+    addr_t src;
+    addr_t dst;
+    int size;
+};
+
+// The ldx whose value `stx` stores, following register moves and the zmm
+// write helper back from a register or __readzmm source
+bool find_copy_source(minsn_t *stx, copy_pair_t *c) {
+    vsrc_t v;
+    if (!value_source(stx->l, stx, &v) || v.ins == nullptr || v.ins->opcode != m_ldx || !flat_segment(v.ins->l)
+     || v.ins->d.size != stx->l.size)
+        return false;
+    c->ldx = const_cast<minsn_t *>(v.ins);
+    c->ldx_at = v.at;
+    return true;
+}
+
+bool is_register_write_helper(const minsn_t *p) {
+    return p->opcode == m_call && (p->is_helper("__writezmm") || p->is_helper("__writemask"));
+}
+
+// Nothing between `from` and `to` (both exclusive) writes memory, except the
+// stores in `allowed`, or redefines a register of `a`.
+bool range_clean(const minsn_t *from, const minsn_t *to, const addr_t &a, const qvector<minsn_t *> &allowed) {
+    if (from == to)
+        return true;
+    for (const minsn_t *p = from->next; p != to; p = p->next) {
+        if (p == nullptr)
+            return false;
+        if (p->opcode == m_stx && !allowed.has(const_cast<minsn_t *>(p)))
+            return false;
+        if ((p->opcode == m_call && !is_register_write_helper(p)) || p->opcode == m_icall ||
+            p->opcode == m_push || p->opcode == m_pop)
+            return false;
+        for (int i = 0; i < a.nregs; i++)
+            if (defines_reg(p, a.regs[i], addr_size()))
+                return false;
+    }
+    return true;
+}
+
+// Source and destination provably do not overlap: both are offsets from the
+// same registers and the offset ranges are apart. Different registers may
+// point anywhere relative to each other.
+bool provably_disjoint(const qvector<copy_pair_t> &g, sval_t lo, sval_t hi, sval_t delta) {
+    return same_regs(g[0].src, g[0].dst) && (hi - delta <= lo || hi <= lo - delta);
+}
+
+// Every load of the group reads bytes no earlier store of the group wrote,
+// so the run copies the original source, as memmove does, however its pairs
+// interleave. A load that follows a store is only known to miss it when
+// both are offsets from the same registers.
+bool loads_read_source(const qvector<copy_pair_t> &g) {
+    qvector<const copy_pair_t *> stored;
+    for (minsn_t *p = g[0].stx; p != nullptr; p = p->next) {
+        for (const copy_pair_t &c : g) {
+            if (p == c.ldx_at) {
+                for (const copy_pair_t *st : stored) {
+                    if (!same_regs(c.src, st->dst) || (c.src.disp < st->dst.disp + st->size
+                                                       && st->dst.disp < c.src.disp + c.size))
+                        return false;
+                }
+            }
+            if (p == c.stx)
+                stored.push_back(&c);
+        }
+        if (p == g.back().stx)
+            break;
+    }
+    return true;
+}
+
+bool group_valid(const qvector<copy_pair_t> &g, sval_t lo, sval_t hi, sval_t delta) {
+    if (hi - lo < MIN_COPY_BYTES)
+        return false;
+    qvector<minsn_t *> allowed;
+    for (const copy_pair_t &c : g)
+        allowed.push_back(c.stx);
+    minsn_t *last = g.back().stx;
+    for (const copy_pair_t &c : g) {
+        if (!range_clean(c.ldx_at, last, c.src, allowed) || !range_clean(c.stx, last, c.dst, allowed))
+            return false;
+    }
+    return loads_read_source(g);
+}
+
+mop_t addr_mop(const addr_t &a, sval_t disp, ea_t ea) {
+    if (a.nregs == 0)
+        return num_mop(disp, ea);
+    return make_addr(reg_mop(a.regs[0]), a.nregs == 2 ? a.regs[1] : mr_none, disp, ea);
+}
+
+void emit_group(mblock_t *blk, const qvector<copy_pair_t> &g, sval_t lo, sval_t hi, sval_t delta) {
+    minsn_t *last = g.back().stx;
+    ea_t ea = last->ea;
+    qvector<libcall_arg_t> args;
+    args.push_back({addr_mop(g[0].dst, lo, ea), void_ptr_type()});
+    args.push_back({addr_mop(g[0].src, lo - delta, ea), void_ptr_type()});
+    args.push_back({num_mop(hi - lo, ea), size_type()});
+    const char *fn = provably_disjoint(g, lo, hi, delta) ? "memcpy" : "memmove";
+    blk->insert_into_block(make_libcall(ea, fn, args), last);
+    for (const copy_pair_t &c : g) {
+        blk->remove_from_block(c.stx);
+        delete c.stx;
+    }
+    DEBUG_LOG("%a: %d vector copy pair(s) -> %s(%d bytes)", ea, (int) g.size(), fn, (int) (hi - lo));
+}
+
+// Group consecutive ymm/zmm copy pairs into contiguous runs and lift each
+// run of at least MIN_COPY_BYTES as one memcpy (memmove unless source and
+// destination provably do not overlap) at the position of its last store.
+int rewrite_copies(mblock_t *blk) {
+    qvector<copy_pair_t> pairs;
+    for (minsn_t *p = blk->head; p != nullptr; p = p->next) {
+        if (p->opcode != m_stx || !is_vec_size(p->l.size) || p->l.size < MIN_COPY_STORE || !flat_segment(p->r))
+            continue;
+        copy_pair_t c;
+        c.stx = p;
+        c.size = p->l.size;
+        if (!find_copy_source(p, &c) || !parse_addr(c.ldx->r, &c.src) || !parse_addr(p->d, &c.dst))
+            continue;
+        pairs.push_back(c);
+    }
+
+    int changes = 0;
+    size_t i = 0;
+    while (i < pairs.size()) {
+        qvector<copy_pair_t> g;
+        g.push_back(pairs[i]);
+        sval_t delta = pairs[i].dst.disp - pairs[i].src.disp;
+        sval_t lo = pairs[i].dst.disp;
+        sval_t hi = lo + pairs[i].size;
+        size_t j = i + 1;
+        for (; j < pairs.size(); j++) {
+            const copy_pair_t &c = pairs[j];
+            if (!same_regs(c.src, g[0].src) || !same_regs(c.dst, g[0].dst) || c.dst.disp - c.src.disp != delta)
+                break;
+            if (c.dst.disp == hi)
+                hi += c.size;
+            else if (c.dst.disp + c.size == lo)
+                lo = c.dst.disp;
+            else
+                break;
+            g.push_back(c);
+        }
+        if (group_valid(g, lo, hi, delta)) {
+            emit_group(blk, g, lo, hi, delta);
+            changes++;
+        }
+        i = j;
+    }
+    return changes;
+}
+
+bool is_self_loop(const mblock_t *blk) {
+    for (int s : blk->succset)
+        if (s == blk->serial)
+            return true;
+    return false;
+}
+
+} // namespace
+
+int idaapi memloop_optimizer_t::func(mblock_t *blk) {
+    mba_maturity_t mat = blk->mba->maturity;
+    if (mat < MMAT_PREOPTIMIZED || mat > MMAT_CALLS || blk->head == nullptr)
+        return 0;
+    if (honor_quarantine && quarantine_get(blk->mba->entry_ea).mode == QM_OFF)
+        return 0;
+    if (rewrite_loop(blk) || rewrite_scan(blk))
+        return 1;
+    // Unrecognized loops keep their per-iteration loads and stores
+    if (is_self_loop(blk))
+        return 0;
+    int changes = rewrite_copies(blk);
+    if (changes != 0)
+        blk->mark_lists_dirty();
+    return changes;
+}
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,44 @@
+/*
+ AVX Memory Loop Recognition
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Block-level pass over the generated microcode that turns inlined vector
+// copy, fill and byte-scan code into library calls:
+//
+//  - single-block self-loops whose body is only vector load/store pairs (or
+//    stores of a loop-invariant splat) plus induction updates, exiting on
+//    `jnz iv, end`, become memmove / memset and the block loses its back
+//    edge (the trip count is unknown, so a copy is never proven apart from
+//    its source);
+//  - single-block loops that compare W bytes per iteration against zero or a
+//    splatted byte (cmpeq + movemask, or an AVX-512 compare/testn into an
+//    opmask + kortest) and exit on the first match become strlen / memchr:
+//    the induction register jumps to the block holding the match and the
+//    body runs once more, so registers leave the loop as they did before;
+//  - straight-line ymm/zmm ldx/stx copy pairs outside such loops (struct
+//    copies), storing a register or a __readzmm result, become one memmove
+//    per contiguous run of at least 64 bytes, or memcpy when source and
+//    destination are provably apart. The run may interleave its loads and
+//    stores only where no load can read bytes the run already stored, which
+//    needs source and destination based on the same registers.
+//
+// Runs during local optimization (up to MMAT_CALLS); the matchers follow the
+// kreg moves the lifter emits for vector loads, and wait for Hex-Rays to fold
+// cmp+jnz into a two-operand jnz.
+
+// Installed by each database's lifter on activation, with that lifter's view
+// of the quarantine (ignored under AVX_DUMP_MC).
+struct memloop_optimizer_t : public optblock_t {
+    bool honor_quarantine = true;
+    int idaapi func(mblock_t *blk) override;
+};
+
+#endif // IDA_SDK_VERSION >= 750
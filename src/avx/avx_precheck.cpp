@@ -0,0 +1,127 @@
+/*
+ AVX Emission Pre-Verifier
+*/
+
+#include "avx_precheck.h"
+#include "avx_kreg.h"
+#include "avx_types.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../common/warn_off.h"
+#include <intel.hpp>
+#include "../common/warn_on.h"
+
+namespace {
+
+const int GPR_SIZE = 8;
+
+// Sizes mop_t::verify accepts for a value (10/12: long double)
+bool valid_size(int size) {
+    switch (size) {
+        case 1: case 2: case 4: case 8: case 10: case 12:
+        case XMM_SIZE: case YMM_SIZE: case ZMM_SIZE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool has_value(mopt_t t) {
+    return t == mop_r || t == mop_n || t == mop_d || t == mop_S || t == mop_v;
+}
+
+// Accesses [r, r+size) running past the end of a general register
+bool overruns_gpr(mreg_t r, int size) {
+    int last = inf_is_64bit() ? R_r15 : R_di;
+    for (int g = R_ax; g <= last; g++) {
+        mreg_t m = reg2mreg(g);
+        if (m != mr_none && r >= m && r < m + GPR_SIZE)
+            return r + size > m + GPR_SIZE;
+    }
+    return false;
+}
+
+// Helper arguments go in ascending stack slots (intrinsic_call_t::add_slot)
+const char *check_helper_args(const mcallinfo_t &ci) {
+    if (ci.solid_args != int(ci.args.size()))
+        return "helper call with non-solid arguments";
+    sval_t end = 0;
+    for (const mcallarg_t &a : ci.args) {
+        if (!a.argloc.is_stkoff())
+            return "helper argument outside the stack area";
+        sval_t off = a.argloc.stkoff();
+        if (off < end)
+            return "helper arguments overlap";
+        if (a.size > 8 && !a.is_udt())
+            return "wide helper argument without UDT";
+        end = off + a.size;
+    }
+    return nullptr;
+}
+
+struct precheck_visitor_t : public mop_visitor_t {
+    const char *why = nullptr;
+    qvector<std::pair<mreg_t, int>> written;   // kreg ranges defined so far
+
+    bool is_written(mreg_t r, int size) const {
+        for (mreg_t b = r; b < r + size; b++) {
+            bool hit = false;
+            for (const auto &w : written)
+                hit |= b >= w.first && b < w.first + w.second;
+            if (!hit)
+                return false;
+        }
+        return true;
+    }
+
+    int idaapi visit_mop(mop_t *op, const tinfo_t *, bool is_target) override {
+        if (op->t == mop_f && curins != nullptr && curins->l.t == mop_h)
+            why = check_helper_args(*op->f);
+        else if (has_value(op->t) && !valid_size(op->size))
+            why = "bad operand size";
+        else if (has_value(op->t) && op->size > YMM_SIZE && !op->is_udt())
+            why = "64-byte operand without UDT";
+        else if (op->t == mop_r)
+            why = check_reg(*op, is_target);
+        return why != nullptr;
+    }
+
+    const char *check_reg(const mop_t &op, bool is_target) const {
+        if (overruns_gpr(op.r, op.size))
+            return "general register accessed past 8 bytes";
+        int avail;
+        if (!kreg_scoped(op.r, &avail))
+            return nullptr;
+        // A read is only as wide as what this instruction wrote before it
+        if (is_target)
+            return op.size > avail ? "kreg written past its allocation" : nullptr;
+        return is_written(op.r, op.size) ? nullptr : "kreg read before it is written";
+    }
+};
+
+} // namespace
+
+const char *precheck_emitted(codegen_t &cdg, minsn_t *first) {
+    precheck_visitor_t v;
+    for (minsn_t *ins = first; ins != nullptr; ins = ins->next) {
+        v.mba = cdg.mba;
+        v.blk = cdg.mb;
+        v.topins = ins;
+        if (ins->for_all_ops(v) != 0)
+            return v.why;
+        if (ins->modifies_d() && ins->d.t == mop_r)
+            v.written.push_back(std::make_pair(ins->d.r, ins->d.size));
+    }
+    return nullptr;
+}
+
+void precheck_rollback(codegen_t &cdg, minsn_t *first) {
+    for (minsn_t *ins = first; ins != nullptr;) {
+        minsn_t *next = cdg.mb->remove_from_block(ins);
+        delete ins;
+        ins = next;
+    }
+}
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,38 @@
+/*
+ AVX Emission Pre-Verifier
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Hex-Rays verifies microcode only once the whole function is generated, and
+// an INTERR there discards the function. The lifter checks what each
+// instruction emitted right after its handler returns, for the mistakes that
+// end in the common verifier INTERRs (50757, 50920, 50708, 50312):
+//
+//  - operand sizes Hex-Rays has no type for, and 64-byte operands without
+//    the UDT flag;
+//  - a kreg used past the end of every allocation that covers it, or read
+//    before this instruction wrote it (kregs never carry values between
+//    instructions, so such a read is an undefined live-in temporary);
+//  - a general register accessed wider than 8 bytes (e.g. r12.64);
+//  - helper call arguments that are not laid out as ascending,
+//    non-overlapping stack slots.
+//
+// On failure the instruction's microcode is taken out again and the
+// instruction left to IDA, which costs one __asm line instead of the whole
+// function. Must run inside the instruction's KregScope.
+
+// Check the instructions from `first` to the end of the current block.
+// Returns nullptr if they pass, else what is wrong with them.
+const char *precheck_emitted(codegen_t &cdg, minsn_t *first);
+
+// Remove and free the instructions from `first` to the end of the block.
+void precheck_rollback(codegen_t &cdg, minsn_t *first);
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,126 @@
+/*
+ AVX INTERR Quarantine
+*/
+
+#include "avx_quarantine.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../common/warn_off.h"
+#include <netnode.hpp>
+#include <kernwin.hpp>
+#include "../common/warn_on.h"
+
+namespace {
+
+// supval_ea(function start) -> quarantine_t; hash "build" -> BUILD_STAMP
+const char NODE_NAME[] = "$ lifter quarantine";
+const char BUILD_KEY[] = "build";
+
+// Records describe what failed in one version of the lifter; the next one
+// may well lift those instructions fine. CMake passes a hash of the lifter
+// sources, so rebuilding unchanged sources keeps the records.
+#ifndef LIFTER_SOURCE_HASH
+#define LIFTER_SOURCE_HASH 0
+#endif
+const uint64 BUILD_STAMP = LIFTER_SOURCE_HASH;
+
+const char ACTION_CLEAR_QUARANTINE[] = "lifter:clear_quarantine";
+
+// Registered with the kernel: by the first database's lifter, removed with
+// the last one.
+int g_action_users = 0;
+bool g_action_registered = false;
+
+size_t drop_records(netnode &n) {
+    size_t count = 0;
+    for (nodeidx_t i = n.supfirst(); i != BADNODE; i = n.supnext(i)) {
+        mark_cfunc_dirty(node2ea(i), false);
+        count++;
+    }
+    n.kill();
+    return count;
+}
+
+quarantine_t read_record(ea_t func) {
+    quarantine_t q;
+    netnode n(NODE_NAME);
+    if (n != BADNODE && n.supval_ea(func, &q, sizeof(q)) != sizeof(q))
+        q = quarantine_t();
+    return q;
+}
+
+struct clear_quarantine_ah_t : action_handler_t {
+    int idaapi activate(action_activation_ctx_t *) override {
+        size_t count = quarantine_clear();
+        msg("[AVXLifter] Quarantine cleared: %" FMT_Z " function(s) will be lifted in full again\n", count);
+        return 1;
+    }
+
+    action_state_t idaapi update(action_update_ctx_t *) override {
+        return AST_ENABLE_ALWAYS;
+    }
+};
+
+clear_quarantine_ah_t g_clear_ah;
+
+} // namespace
+
+quarantine_t quarantine_get(ea_t func) {
+    return read_record(func);
+}
+
+quarantine_t quarantine_record(ea_t func, int code, uint16 itype, bool in_lift) {
+    quarantine_t q = read_record(func);
+    q.interr = code;
+    q.itype = itype;
+    if (in_lift && !q.declines(itype) && q.ndeclined < QUARANTINE_MAX_DECLINED) {
+        q.declined[q.ndeclined++] = itype;
+        q.mode = QM_DECLINE;
+    } else {
+        q.mode = QM_OFF;
+    }
+
+    netnode n(NODE_NAME, 0, true);
+    n.hashset(BUILD_KEY, &BUILD_STAMP, sizeof(BUILD_STAMP));
+    n.supset_ea(func, &q, sizeof(q));
+    return q;
+}
+
+size_t quarantine_clear() {
+    netnode n(NODE_NAME);
+    return n != BADNODE ? drop_records(n) : 0;
+}
+
+void quarantine_init() {
+    netnode n(NODE_NAME);
+    uint64 stamp = 0;
+    if (n != BADNODE
+     && (n.hashval(BUILD_KEY, &stamp, sizeof(stamp)) != sizeof(stamp) || stamp != BUILD_STAMP)) {
+        size_t count = drop_records(n);
+        if (count != 0)
+            msg("[AVXLifter] Lifter build changed: %" FMT_Z " quarantined function(s) released\n", count);
+    }
+
+    if (g_action_users++ > 0)
+        return;
+    action_desc_t desc = ACTION_DESC_LITERAL(
+        ACTION_CLEAR_QUARANTINE, "Clear AVX lifter quarantine", &g_clear_ah, nullptr,
+        "Lift every function in full again, including those that failed to decompile "
+        "under the lifter", -1);
+    g_action_registered = register_action(desc);
+    if (g_action_registered)
+        attach_action_to_menu("Edit/Other/", ACTION_CLEAR_QUARANTINE, SETMENU_APP);
+    else
+        msg("[AVXLifter] Failed to register the clear quarantine action\n");
+}
+
+void quarantine_term() {
+    if (g_action_users == 0 || --g_action_users > 0 || !g_action_registered)
+        return;
+    detach_action_from_menu("Edit/Other/", ACTION_CLEAR_QUARANTINE);
+    unregister_action(ACTION_CLEAR_QUARANTINE);
+    g_action_registered = false;
+}
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,73 @@
+/*
+ AVX INTERR Quarantine
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Hex-Rays throws away a function that hits an internal error, and every
+// later attempt (F5, refresh, a batch rerun) pays for the same failing
+// decompilation again. A function that failed under the lifter is recorded in
+// the database and lifted in a reduced mode from then on:
+//
+//  - the error fired while the lifter was emitting an instruction: that
+//    itype is declined in the function, so IDA renders it as __asm. Another
+//    error in the same function declines one more, up to
+//    QUARANTINE_MAX_DECLINED;
+//  - the error fired after generation (the verifier, an optimizer pass), or
+//    the list is full: the lifter leaves the whole function to IDA.
+//
+// Records are dropped when a lifter built from different sources opens the
+// database, and on request (Edit > Other > Clear AVX lifter quarantine). The
+// lifter does not honor them while AVX_DUMP_MC is set, so the failure can
+// still be reproduced.
+
+const int QUARANTINE_MAX_DECLINED = 8;
+
+enum quarantine_mode_t : uint8 {
+    QM_NONE,      // not quarantined
+    QM_DECLINE,   // lift everything but the declined itypes
+    QM_OFF,       // lift nothing
+};
+
+// Stored as is in the quarantine netnode, keyed by function start
+struct quarantine_t {
+    uint8 mode = QM_NONE;
+    uint8 ndeclined = 0;
+    uint16 itype = 0;       // last itype lifted before the last error
+    int32 interr = 0;       // last INTERR code
+    uint16 declined[QUARANTINE_MAX_DECLINED] = {};
+
+    bool declines(uint16 it) const {
+        if (mode == QM_OFF)
+            return true;
+        for (int i = 0; i < ndeclined; i++)
+            if (declined[i] == it)
+                return true;
+        return false;
+    }
+};
+
+// Record of the function starting at `func`; mode QM_NONE if it has none.
+quarantine_t quarantine_get(ea_t func);
+
+// Record INTERR `code` in the function starting at `func`. `itype` is the
+// last instruction the lifter handled there and `in_lift` whether it was
+// still emitting it. Returns the function's new record.
+quarantine_t quarantine_record(ea_t func, int code, uint16 itype, bool in_lift);
+
+// Drop every record and the cached pseudocode of the functions they held.
+// Returns the number of records dropped.
+size_t quarantine_clear();
+
+// Per database: drop records left by another lifter build, and register the
+// clear command (kernel-wide, so shared by every open database).
+void quarantine_init();
+void quarantine_term();
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,106 @@
+/*
+ AVX Register Mapping Tables
+*/
+
+#include "avx_regmap.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "avx_types.h"
+
+#include "../common/warn_off.h"
+#include <intel.hpp>
+#include "../common/warn_on.h"
+
+namespace {
+
+struct vreg_info_t {
+    int8 index;
+    uint8 width;
+};
+
+const int k_widths[3] = {XMM_SIZE, YMM_SIZE, ZMM_SIZE};
+
+qvector<vreg_info_t> g_by_reg;     // processor register -> index/width
+qvector<int8> g_by_mreg;           // mreg -> index
+mreg_t g_mregs[3][32];             // [xmm/ymm/zmm][index] -> mreg
+bool g_ready = false;
+
+int width_slot(int width) {
+    switch (width) {
+        case XMM_SIZE: return 0;
+        case YMM_SIZE: return 1;
+        case ZMM_SIZE: return 2;
+        default: return -1;
+    }
+}
+
+// xmm16-31 and ymm16-31 are numbered apart from their low halves
+int vreg_reg(int index, int width) {
+    int base = index & 15;
+    switch (width) {
+        case XMM_SIZE: return (index < 16 ? R_xmm0 : R_xmm16) + base;
+        case YMM_SIZE: return (index < 16 ? R_ymm0 : R_ymm16) + base;
+        default: return R_zmm0 + index;
+    }
+}
+
+} // namespace
+
+void regmap_init() {
+    if (g_ready)
+        return;
+
+    for (int slot = 0; slot < 3; slot++) {
+        int width = k_widths[slot];
+        for (int idx = 0; idx < 32; idx++) {
+            int reg = vreg_reg(idx, width);
+            if (reg >= (int) g_by_reg.size()) {
+                vreg_info_t none = {-1, 0};
+                g_by_reg.resize(reg + 1, none);
+            }
+            g_by_reg[reg].index = (int8) idx;
+            g_by_reg[reg].width = (uint8) width;
+
+            mreg_t mr = reg2mreg(reg);
+            g_mregs[slot][idx] = mr;
+            if (mr == mr_none)
+                continue;
+            if (mr >= (mreg_t) g_by_mreg.size())
+                g_by_mreg.resize(mr + 1, -1);
+            g_by_mreg[mr] = (int8) idx;
+        }
+    }
+    g_ready = true;
+}
+
+int vreg_index(int reg) {
+    if (reg < 0 || reg >= (int) g_by_reg.size())
+        return -1;
+    return g_by_reg[reg].index;
+}
+
+int vreg_width(int reg) {
+    if (reg < 0 || reg >= (int) g_by_reg.size())
+        return 0;
+    return g_by_reg[reg].width;
+}
+
+int vreg_index_of_mreg(mreg_t mr) {
+    if (mr < 0 || mr >= (mreg_t) g_by_mreg.size())
+        return -1;
+    return g_by_mreg[mr];
+}
+
+mreg_t vreg_mreg(int index, int width) {
+    int slot = width_slot(width);
+    if (!g_ready || slot < 0 || index < 0 || index >= 32)
+        return mr_none;
+    return g_mregs[slot][index];
+}
+
+int kreg_index(int reg) {
+    return reg >= R_k0 && reg <= R_k7 ? reg - R_k0 : -1;
+}
+
+#endif // IDA_SDK_VERSION >= 750
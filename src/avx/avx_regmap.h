@@ -0,0 +1,35 @@
+/*
+ AVX Register Mapping Tables
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Dense tables relating x86 processor registers, microcode registers and the
+// 0..31 logical vector index (xmm5, ymm5 and zmm5 all have index 5). Built
+// once at component init, so register mapping in the handlers is an array
+// read rather than reg2mreg/mreg2reg calls or register-name round trips.
+
+void regmap_init();
+
+// Logical index / width in bytes of an xmm, ymm or zmm processor register;
+// -1 / 0 for anything else
+int vreg_index(int reg);
+int vreg_width(int reg);
+
+// Logical index of the vector register starting at `mr`, -1 if none does
+int vreg_index_of_mreg(mreg_t mr);
+
+// mreg of logical vector register `index` viewed at `width` bytes, mr_none
+// if Hex-Rays has no microcode register for it (EVEX-only registers)
+mreg_t vreg_mreg(int index, int width);
+
+// 0..7 for k0..k7, -1 for anything else
+int kreg_index(int reg);
+
+#endif // IDA_SDK_VERSION >= 750
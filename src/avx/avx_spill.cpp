@@ -0,0 +1,268 @@
+/*
+ AVX Spill/Reload Forwarding
+*/
+
+#include "avx_spill.h"
+#include "avx_helpers.h"
+#include "avx_state.h"
+#include "avx_types.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../common/warn_off.h"
+#include <intel.hpp>
+#include "../common/warn_on.h"
+
+namespace {
+
+// One spilled vector slot. `stx` is only dereferenced after it has been found
+// again in the current block. The records are dropped whenever the
+// instructions they point to may be freed (spill_reset), so a new instruction
+// allocated at a recorded address is never mistaken for the spill.
+struct spill_rec_t {
+    minsn_t *stx;
+    ea_t ea;
+    mreg_t base;
+    sval_t disp;
+    int size;
+};
+
+} // namespace
+
+// Records of the function under construction
+struct spill_state_t {
+    qvector<spill_rec_t> recs;
+};
+
+namespace {
+
+// The current database's records; null before its lifter activates
+qvector<spill_rec_t> *cur_spills() {
+    avx_state_t *st = avx_state();
+    return st != nullptr && st->spills != nullptr ? &st->spills->recs : nullptr;
+}
+
+// Enough for the spill traffic of one block; older records are dropped first.
+const size_t MAX_SPILLS = 64;
+
+// Stack slot addressed by an operand: unindexed rsp/rbp base plus displacement.
+bool get_stack_slot(const insn_t &insn, const op_t &op, mreg_t *base, sval_t *disp) {
+    if (op.type != o_displ && op.type != o_phrase)
+        return false;
+    if (x86_index_reg(insn, op) != R_none)
+        return false;
+    int breg = x86_base_reg(insn, op);
+    if (breg != R_sp && breg != R_bp)
+        return false;
+    *base = reg2mreg(breg);
+    *disp = op.type == o_displ ? (sval_t) op.addr : 0;
+    return true;
+}
+
+bool ranges_overlap(sval_t a, int asz, sval_t b, int bsz) { return a < b + bsz && b < a + asz; }
+
+bool reg_overlaps(const mop_t &m, mreg_t r, int size) {
+    return m.t == mop_r && m.r < r + size && r < m.r + m.size;
+}
+
+// Resolve an address operand to base+disp by following simple definitions
+// (mov/add/sub with a constant) backwards from `from` within the block.
+bool resolve_addr(const minsn_t *from, const mop_t &addr, mreg_t base, sval_t *disp, int depth = 4) {
+    if (depth == 0)
+        return false;
+    if (addr.t == mop_r) {
+        if (addr.r == base) {
+            *disp = 0;
+            return true;
+        }
+        for (const minsn_t *p = from->prev; p != nullptr; p = p->prev) {
+            if (!reg_overlaps(p->d, addr.r, addr.size))
+                continue;
+            if (p->d.r != addr.r)
+                return false;
+            if (p->opcode == m_mov)
+                return resolve_addr(p, p->l, base, disp, depth - 1);
+            if ((p->opcode == m_add || p->opcode == m_sub) && p->r.t == mop_n) {
+                sval_t inner;
+                if (!resolve_addr(p, p->l, base, &inner, depth - 1))
+                    return false;
+                sval_t k = (sval_t) p->r.nnn->value;
+                *disp = p->opcode == m_add ? inner + k : inner - k;
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+    if (addr.t == mop_d && (addr.d->opcode == m_add || addr.d->opcode == m_sub) && addr.d->r.t == mop_n) {
+        sval_t inner;
+        if (!resolve_addr(from, addr.d->l, base, &inner, depth - 1))
+            return false;
+        sval_t k = (sval_t) addr.d->r.nnn->value;
+        *disp = addr.d->opcode == m_add ? inner + k : inner - k;
+        return true;
+    }
+    return false;
+}
+
+const spill_rec_t *find_rec(const qvector<spill_rec_t> &spills, const minsn_t *stx) {
+    for (const spill_rec_t &r : spills)
+        if (r.stx == stx && r.ea == stx->ea)
+            return &r;
+    return nullptr;
+}
+
+// Flags nested calls that may write memory or zmm state. A void helper that
+// takes a pointer is a store (storeu, scatter, compressstoreu); anything that
+// is not a helper is an opaque call.
+struct clobber_visitor_t : public minsn_visitor_t {
+    bool writes_mem = false;
+    bool writes_zmm = false;
+    int idaapi visit_minsn() override {
+        if (curins->opcode == m_icall) {
+            writes_mem = true;
+            return 1;
+        }
+        if (curins->opcode != m_call)
+            return 0;
+        if (curins->l.t != mop_h) {
+            writes_mem = true;
+            return 1;
+        }
+        if (curins->is_helper("__writezmm")) {
+            writes_zmm = true;
+            return 0;
+        }
+        const mcallinfo_t *ci = curins->d.t == mop_f ? curins->d.f : nullptr;
+        if (ci == nullptr || !ci->return_type.is_void())
+            return 0;
+        for (const mcallarg_t &a : ci->args) {
+            if (a.type.is_ptr()) {
+                writes_mem = true;
+                return 1;
+            }
+        }
+        return 0;
+    }
+};
+
+bool is_zmm_read(const mop_t &m) { return m.t == mop_d && m.d->is_helper("__readzmm"); }
+
+// Is the value stored by `rec` still in its slot, and still available in the
+// register (or zmm) it came from, at the tail of the current block?
+bool spill_still_valid(mblock_t *blk, const qvector<spill_rec_t> &spills, const spill_rec_t &rec) {
+    int addr_size = inf_is_64bit() ? 8 : 4;
+    bool found = walk_block_back_to(blk, rec.stx, [&](minsn_t *ins) {
+        if (ins->opcode == m_push || ins->opcode == m_pop)
+            return false;
+        if (ins->modifies_d() && reg_overlaps(ins->d, rec.base, addr_size))
+            return false;
+        if (ins->opcode == m_stx) {
+            const spill_rec_t *other = find_rec(spills, ins);
+            sval_t disp;
+            if (other != nullptr) {
+                if (other->base != rec.base || ranges_overlap(other->disp, other->size, rec.disp, rec.size))
+                    return false;
+            } else if (!resolve_addr(ins, ins->d, rec.base, &disp) ||
+                       ranges_overlap(disp, ins->l.size, rec.disp, rec.size)) {
+                return false;
+            }
+        }
+        clobber_visitor_t cv;
+        ins->for_all_insns(cv);
+        return !cv.writes_mem;
+    });
+    if (!found)
+        return false;
+    if (rec.stx->opcode != m_stx || rec.stx->ea != rec.ea || rec.stx->l.size != rec.size)
+        return false;
+    const mop_t *val = &rec.stx->l;
+
+    // Second pass now that the spill is known to be live in this block: a
+    // redefinition of the source register, or any __writezmm for a __readzmm
+    // source, kills forwarding.
+    bool zmm_src = is_zmm_read(*val);
+    return walk_block_back_to(blk, rec.stx, [&](minsn_t *ins) {
+        if (val->t == mop_r && ins->modifies_d() && reg_overlaps(ins->d, val->r, val->size))
+            return false;
+        if (zmm_src) {
+            clobber_visitor_t cv;
+            ins->for_all_insns(cv);
+            if (cv.writes_zmm)
+                return false;
+        }
+        return true;
+    });
+}
+
+} // namespace
+
+spill_state_t *spill_init() {
+    return new spill_state_t();
+}
+
+void spill_term(spill_state_t *st) {
+    delete st;
+}
+
+void spill_reset(spill_state_t *st) {
+    if (st != nullptr)
+        st->recs.clear();
+}
+
+void spill_note_store(codegen_t &cdg, int opidx, minsn_t *stx, int size) {
+    if (stx == nullptr)
+        return;
+    mreg_t base;
+    sval_t disp;
+    if (!get_stack_slot(cdg.insn, cdg.insn.ops[opidx], &base, &disp))
+        return;
+    if (stx->l.t != mop_r && !is_zmm_read(stx->l))
+        return;
+    qvector<spill_rec_t> *spills = cur_spills();
+    if (spills == nullptr)
+        return;
+    if (spills->size() >= MAX_SPILLS)
+        spills->erase(spills->begin());
+    spills->push_back({stx, cdg.insn.ea, base, disp, size});
+}
+
+mreg_t spill_forward_load(codegen_t &cdg, int opidx, int size) {
+    const qvector<spill_rec_t> *spills = cur_spills();
+    if (spills == nullptr || spills->empty())
+        return mr_none;
+    mreg_t base;
+    sval_t disp;
+    if (!get_stack_slot(cdg.insn, cdg.insn.ops[opidx], &base, &disp))
+        return mr_none;
+
+    // Most recent store to the slot wins; an older one is shadowed by it.
+    for (size_t i = spills->size(); i-- > 0;) {
+        const spill_rec_t &rec = (*spills)[i];
+        if (rec.base != base || !ranges_overlap(rec.disp, rec.size, disp, size))
+            continue;
+        if (rec.disp != disp || rec.size != size || !spill_still_valid(cdg.mb, *spills, rec))
+            return mr_none;
+
+        mreg_t dst = kreg_alloc(cdg, size, false);
+        if (dst == mr_none)
+            return mr_none;
+        // Possibly a kreg the storing instruction's scope released (avx_kreg.h)
+        mop_t src = rec.stx->l;
+        mop_t d(dst, size);
+        if (size > 8) {
+            src.set_udt();
+            d.set_udt();
+        }
+        mop_t empty;
+        if (cdg.emit(m_mov, &src, &empty, &d) == nullptr) {
+            kreg_free(cdg, dst, size);
+            return mr_none;
+        }
+        DEBUG_LOG("%a: forwarded vector spill from %a", cdg.insn.ea, rec.ea);
+        return dst;
+    }
+    return mr_none;
+}
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,57 @@
+/*
+ AVX Spill/Reload Forwarding
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Block-local store-to-load forwarding for vector stack slots.
+//
+// -O0 and high register-pressure code spill ymm/zmm values to [rsp+X]/[rbp-X]
+// and reload them a few instructions later. When the reload is in the same
+// block as the spill and nothing in between can have changed the slot or the
+// spilled value, the reload is replaced by a register move of the original
+// value. The spill itself stays a plain m_stx, so Hex-Rays drops it (and the
+// stack variable) once it is dead.
+
+// Record a vector store just emitted as `stx` for operand `opidx`.
+// Only unindexed rsp/rbp-relative slots with a register or __readzmm source
+// are tracked; anything else is ignored.
+void spill_note_store(codegen_t &cdg, int opidx, minsn_t *stx, int size);
+
+// If operand `opidx` reloads a slot spilled earlier in this block and the
+// spill is still valid, emit a move of the spilled value into a fresh kreg
+// and return it. Returns mr_none when the load must go to memory.
+mreg_t spill_forward_load(codegen_t &cdg, int opidx, int size);
+
+// Per-database records (avx_state_t::spills), created when the lifter
+// activates
+struct spill_state_t;
+spill_state_t *spill_init();
+void spill_term(spill_state_t *st);
+
+// Forget every recorded spill. Called when a decompilation starts
+// (hxe_flowchart) and when emitted microcode is taken out again, the two
+// points after which recorded instructions may have been freed.
+void spill_reset(spill_state_t *st);
+
+// Walk back from the tail of `blk` towards `stop` (exclusive), calling `fn`
+// for each instruction. Returns false if `stop` is not in the block or `fn`
+// returned false. Shared by passes that validate block-local facts.
+template <class F>
+bool walk_block_back_to(mblock_t *blk, const minsn_t *stop, F fn) {
+    for (minsn_t *ins = blk->tail; ins != nullptr; ins = ins->prev) {
+        if (ins == stop)
+            return true;
+        if (!fn(ins))
+            return false;
+    }
+    return false;
+}
+
+#endif // IDA_SDK_VERSION >= 750
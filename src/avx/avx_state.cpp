@@ -0,0 +1,28 @@
+/*
+ AVX Lifter Per-Database State
+*/
+
+#include "avx_state.h"
+#include "avx_types.h"
+
+#if IDA_SDK_VERSION >= 750
+
+namespace {
+
+avx_state_t *g_state = nullptr;
+
+} // namespace
+
+avx_state_t *avx_state() {
+    return g_state;
+}
+
+void avx_state_enter(avx_state_t *st) {
+    g_state = st;
+}
+
+bool avx_debug_logging() {
+    return g_state != nullptr && g_state->debug_logging;
+}
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,67 @@
+/*
+ AVX Lifter Per-Database State
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+#include <map>
+
+#if IDA_SDK_VERSION >= 750
+
+struct const_pool_t;
+struct spill_state_t;
+struct idiom_state_t;
+struct consteval_state_t;
+
+// Normalized instruction form: itype and opmask bits, operand kinds and dtypes
+typedef std::pair<uint64, uint64> insn_form_t;
+
+// Everything the AVX lifter remembers about one database. The AVXLifter
+// filter owns an instance (one per plugmod) and makes it current whenever
+// Hex-Rays calls into it, so handlers and helpers several calls deep reach
+// the state of the database being decompiled without taking it as an
+// argument. Tables derived from the processor module alone (register maps,
+// handler selection, compiled idioms) stay process-wide, as does scratch
+// that never outlives one apply() call (the kreg scope, the memory operand
+// address memo).
+struct avx_state_t {
+    bool debug_logging = true;
+    bool print_debug_info = false;
+
+    // get_vector_type() results for the function being decompiled,
+    // indexed by [xmm/ymm/zmm][float/double/int]
+    mba_t *vtype_mba = nullptr;
+    tinfo_t vtypes[3][3];
+
+    // match() verdict per instruction form (avx_lifter.cpp). It depends on
+    // nothing but the form and the database's bitness, so it is never reset.
+    std::map<insn_form_t, uint8> plans;
+
+    // Read-only vector constants (avx_constpool.cpp)
+    const_pool_t *pool = nullptr;
+
+    // What the function being decompiled has lifted so far: vector spills
+    // (avx_spill.cpp), idiom windows (avx_idiom.cpp) and known register
+    // values (avx_consteval.cpp). Created on activation, cleared on every
+    // hxe_flowchart.
+    spill_state_t *spills = nullptr;
+    idiom_state_t *idiom = nullptr;
+    consteval_state_t *consteval = nullptr;
+
+    // Last embedded-broadcast splat of the instruction being lifted
+    // (load_embedded_broadcast), reset by AVXLifter::apply()
+    ea_t bcast_ea = BADADDR;
+    int bcast_idx = -1;
+    mreg_t bcast_reg = mr_none;
+};
+
+// State of the database whose lifter was entered last, nullptr if none.
+avx_state_t *avx_state();
+
+// Make `st` current. A lifter being torn down passes nullptr.
+void avx_state_enter(avx_state_t *st);
+
+#endif // IDA_SDK_VERSION >= 750
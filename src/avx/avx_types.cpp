@@ -3,6 +3,7 @@
 */
 
 #include "avx_types.h"
+#include "avx_state.h"
 
 #if IDA_SDK_VERSION >= 750
 
@@ -10,14 +11,52 @@
 #include <typeinf.hpp>
 #include "../common/warn_on.h"
 
-bool debug_logging_enabled = true;
+namespace {
+
+// Handlers ask for their vector types on every instruction, and each miss is
+// a til lookup by name (or a synthesized UDT); within one function the answer
+// never changes. The cache lives in the database's avx_state_t, since the
+// types come from that database's til.
+int vtype_slot(int size_bytes) {
+    switch (size_bytes) {
+        case XMM_SIZE: return 0;
+        case YMM_SIZE: return 1;
+        case ZMM_SIZE: return 2;
+        default: return -1;
+    }
+}
+
+} // namespace
+
+static tinfo_t resolve_vector_type(int size_bytes, bool is_int, bool is_double);
+
+void vector_type_cache_begin(mba_t *mba) {
+    avx_state_t *st = avx_state();
+    if (st == nullptr || st->vtype_mba == mba)
+        return;
+    st->vtype_mba = mba;
+    for (auto &row : st->vtypes)
+        for (tinfo_t &ti : row)
+            ti.clear();
+}
+
+tinfo_t get_vector_type(int size_bytes, bool is_int, bool is_double) {
+    int slot = vtype_slot(size_bytes);
+    avx_state_t *st = avx_state();
+    if (slot < 0 || st == nullptr || st->vtype_mba == nullptr)
+        return resolve_vector_type(size_bytes, is_int, is_double);
+    tinfo_t &ti = st->vtypes[slot][is_int ? 2 : (is_double ? 1 : 0)];
+    if (ti.empty())
+        ti = resolve_vector_type(size_bytes, is_int, is_double);
+    return ti;
+}
 
 /*
 Resolves or synthesizes vector types (e.g., __m128, __m256i).
 CRITICAL: This function ensures the microcode engine receives valid type information.
 Passing instructions with unknown/void types for data flow can lead to kernel assertions.
 */
-tinfo_t get_vector_type(int size_bytes, bool is_int, bool is_double) {
+static tinfo_t resolve_vector_type(int size_bytes, bool is_int, bool is_double) {
     qstring type_name;
     type_name.cat_sprnt("__m%d", size_bytes * 8);
     if (is_int) type_name.append('i');
@@ -32,7 +71,7 @@ tinfo_t get_vector_type(int size_bytes, bool is_int, bool is_double) {
         if (sz == size_bytes) {
             return ti;
         }
-        if (debug_logging_enabled) {
+        if (avx_debug_logging()) {
             msg("[AVXLifter] Warning: Type '%s' found but size is %" FMT_Z
                 " (expected %d). Ignoring and synthesizing.\n",
                 type_name.c_str(), sz, size_bytes);
@@ -61,7 +100,7 @@ tinfo_t get_vector_type(int size_bytes, bool is_int, bool is_double) {
     // BTF_STRUCT indicates this is a struct (not union/enum)
     ti.create_udt(udt, BTF_STRUCT);
 
-    if (debug_logging_enabled)
+    if (avx_debug_logging())
         msg("[AVXLifter] Created synthetic UDT type for %s (Size: %d)\n", type_name.c_str(), ti.get_size());
 
     return ti;
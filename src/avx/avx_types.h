@@ -23,12 +23,15 @@
 // Type management
 tinfo_t get_vector_type(int size_bytes, bool is_int, bool is_double);
 
-// Debug logging control
-extern bool debug_logging_enabled;
+// Scope get_vector_type()'s cache to the function being decompiled
+void vector_type_cache_begin(mba_t *mba);
+
+// Debug logging control (per database, see avx_state.h)
+bool avx_debug_logging();
 
 #define DEBUG_LOG(fmt, ...)        \
 do {                              \
-if (debug_logging_enabled)      \
+if (avx_debug_logging())        \
  msg("[AVXLifter::DEBUG] " fmt "\n", ##__VA_ARGS__); \
 } while (0)
 
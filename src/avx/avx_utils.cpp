@@ -4,6 +4,7 @@ AVX Utility Functions and Classification
 
 #include "avx_utils.h"
 #include "avx_helpers.h"
+#include "avx_regmap.h"
 
 #if IDA_SDK_VERSION >= 750
 
@@ -675,13 +676,11 @@ mreg_t load_mask_operand(codegen_t &cdg, MaskInfo &mask) {
     }
 
     // Verify it's a valid opmask register (k1-k7, k0 means no masking)
-    if (cdg.insn.Op6.reg < R_k1 || cdg.insn.Op6.reg > R_k7) {
+    int kreg_num = kreg_index(cdg.insn.Op6.reg);
+    if (kreg_num < 1) {
         return mr_none;
     }
 
-    // Get the k-register number (0-7)
-    int kreg_num = cdg.insn.Op6.reg - R_k0;
-
     // Store the k-register number encoded as negative value
     // This signals to add_argument_mask() to pass it as immediate
     mask.mask_reg = (mreg_t)(-(kreg_num + 1));
@@ -24,7 +24,12 @@ struct AvxOpLoader {
     int size;
 
     AvxOpLoader(codegen_t &c, int op_idx, const op_t &op) : cdg(c) {
-        if (is_mem_op(op)) {
+        if (is_embedded_broadcast(c.insn, op)) {
+            // {1toN}: splat the scalar once instead of modeling a full-width read
+            size = 0;
+            reg = load_embedded_broadcast(cdg, op_idx, &size);
+            is_kreg = true;
+        } else if (is_mem_op(op)) {
             size = get_dtype_size(op.dtype);
             // Use load_operand_udt for large operands (> 8 bytes) to set UDT flag
             // This is required for AVX-512 64-byte operands to pass the verifier
@@ -37,7 +42,8 @@ struct AvxOpLoader {
         }
     }
 
-    // Do not free kregs - they are used in emitted microcode
+    // Do not free kregs here - they are used in emitted microcode; the
+    // KregScope around apply() releases them once the instruction is done
     ~AvxOpLoader() = default;
 
     // Disable copy
@@ -181,8 +181,12 @@ merror_t handle_k_alu(codegen_t &cdg);
 
 merror_t handle_kmov(codegen_t &cdg);
 
+merror_t handle_ktest(codegen_t &cdg);
+
 merror_t handle_v_cmp_to_mask(codegen_t &cdg);
 
+merror_t handle_vpcmp_int_to_mask(codegen_t &cdg);
+
 merror_t handle_v_2src_to_mask(codegen_t &cdg);
 
 merror_t handle_v_fpclass_to_mask(codegen_t &cdg);
@@ -76,16 +76,16 @@ merror_t handle_vcvtsi2fp(codegen_t &cdg) {
     mreg_t l = reg2mreg(cdg.insn.Op2.reg);
     mreg_t d = reg2mreg(cdg.insn.Op1.reg);
 
-    mreg_t t_vec = cdg.mba->alloc_kreg(XMM_SIZE);
-    mreg_t t_i2f = cdg.mba->alloc_kreg(src_size);
+    mreg_t t_vec = kreg_alloc(cdg, XMM_SIZE);
+    mreg_t t_i2f = kreg_alloc(cdg, src_size);
 
     cdg.emit(m_mov, XMM_SIZE, l, 0, t_vec, 0);
     cdg.emit(m_i2f, src_size, r, 0, t_i2f, 0);
     cdg.emit(m_f2f, new mop_t(t_i2f, src_size), nullptr, new mop_t(t_vec, dst_size));
     cdg.emit(m_mov, XMM_SIZE, t_vec, 0, d, 0);
 
-    cdg.mba->free_kreg(t_vec, XMM_SIZE);
-    cdg.mba->free_kreg(t_i2f, src_size);
+    kreg_free(cdg, t_vec, XMM_SIZE);
+    kreg_free(cdg, t_i2f, src_size);
 
     clear_upper(cdg, d);
     return MERR_OK;
@@ -99,7 +99,7 @@ merror_t handle_vcvtps2pd(codegen_t &cdg) {
     mreg_t src = r;
     mreg_t t_mem = mr_none;
     if (is_mem_op(cdg.insn.Op2) && src128 == QWORD_SIZE) {
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src_mop(r.reg, QWORD_SIZE);
         mop_t dst_mop(t_mem, XMM_SIZE);
         dst_mop.set_udt();
@@ -115,7 +115,7 @@ merror_t handle_vcvtps2pd(codegen_t &cdg) {
     icall.set_return_reg(d, get_type_robust(src128 * 2, false, true));
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (src128 == QWORD_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -131,7 +131,7 @@ merror_t handle_vcvtfp2fp(codegen_t &cdg) {
     int zmm_alias = is_ss2sd ? get_xmm_reg_index(cdg.insn.Op3) : -1;
     if (zmm_alias >= 0 && previous_insn_is_zmm_call(cdg.insn.ea)) {
         AVXIntrinsic read(&cdg, "__readzmm_f32");
-        mreg_t scalar = cdg.mba->alloc_kreg(FLOAT_SIZE);
+        mreg_t scalar = kreg_alloc(cdg, FLOAT_SIZE);
         if (scalar == mr_none) return MERR_INSN;
         read.add_argument_imm((uint64) zmm_alias, BT_INT32);
         read.set_return_reg(scalar, tinfo_t(BT_FLOAT));
@@ -166,7 +166,7 @@ merror_t handle_vcvtfp2fp(codegen_t &cdg) {
         mreg_t r_reg;
         mreg_t t_mem = mr_none;
         if (is_mem_op(cdg.insn.Op3)) {
-            t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+            t_mem = kreg_alloc(cdg, XMM_SIZE);
             mop_t src_mop(r.reg, src_size);
             mop_t dst_mop(t_mem, XMM_SIZE);
             if (XMM_SIZE > 8) {
@@ -184,17 +184,17 @@ merror_t handle_vcvtfp2fp(codegen_t &cdg) {
         icall.set_return_reg(d, ti_dst);
         icall.emit();
 
-        if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+        if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
         clear_upper(cdg, d);
         return MERR_OK;
     }
 
-    mreg_t t = cdg.mba->alloc_kreg(XMM_SIZE);
+    mreg_t t = kreg_alloc(cdg, XMM_SIZE);
     cdg.emit(m_mov, XMM_SIZE, l, 0, t, 0);
     cdg.emit(m_f2f, new mop_t(r, src_size), nullptr, new mop_t(t, dst_size));
     cdg.emit(m_mov, XMM_SIZE, t, 0, d, 0);
 
-    cdg.mba->free_kreg(t, XMM_SIZE);
+    kreg_free(cdg, t, XMM_SIZE);
 
     clear_upper(cdg, d);
     return MERR_OK;
@@ -265,7 +265,7 @@ merror_t handle_vcvtdq2pd(codegen_t &cdg) {
     mreg_t src = r;
     mreg_t t_mem = mr_none;
     if (is_mem_op(cdg.insn.Op2) && src_size < XMM_SIZE) {
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src_mop(r.reg, src_size);
         mop_t dst_mop(t_mem, XMM_SIZE);
         dst_mop.set_udt();
@@ -282,7 +282,7 @@ merror_t handle_vcvtdq2pd(codegen_t &cdg) {
     icall.set_return_reg(d, get_type_robust(dst_size, false, true));
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (dst_size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -297,13 +297,13 @@ merror_t handle_vmxcsr(codegen_t &cdg) {
     }
 
     if (cdg.insn.itype == NN_vstmxcsr) {
-        mreg_t tmp = cdg.mba->alloc_kreg(DWORD_SIZE);
+        mreg_t tmp = kreg_alloc(cdg, DWORD_SIZE);
         AVXIntrinsic icall(&cdg, "_mm_getcsr");
         icall.set_return_reg_basic(tmp, BT_INT32);
         icall.emit();
         mop_t src(tmp, DWORD_SIZE);
         store_operand_hack(cdg, 0, src);
-        cdg.mba->free_kreg(tmp, DWORD_SIZE);
+        kreg_free(cdg, tmp, DWORD_SIZE);
         return MERR_OK;
     }
 
@@ -585,7 +585,7 @@ merror_t handle_vcvt_fp16(codegen_t &cdg) {
     }
 
     if (is_zmm_reg(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(dst_size, false);
+        mreg_t tmp = kreg_alloc(cdg, dst_size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, ti_dst);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -595,11 +595,11 @@ merror_t handle_vcvt_fp16(codegen_t &cdg) {
         icall.emit();
         if (dst_size == XMM_SIZE) clear_upper(cdg, d);
     } else if (is_mem_op(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(dst_size);
+        mreg_t tmp = kreg_alloc(cdg, dst_size);
         icall.set_return_reg(tmp, ti_dst);
         icall.emit();
         store_operand_hack(cdg, 0, mop_t(tmp, dst_size));
-        cdg.mba->free_kreg(tmp, dst_size);
+        kreg_free(cdg, tmp, dst_size);
     } else {
         return MERR_INSN;
     }
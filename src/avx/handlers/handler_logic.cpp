@@ -6,6 +6,8 @@ AVX Logic and Misc Handlers
 #include "../avx_utils.h"
 #include "../avx_helpers.h"
 #include "../avx_intrinsic.h"
+#include "../avx_regmap.h"
+#include "../../common/mem_operand.h"
 
 #if IDA_SDK_VERSION >= 750
 
@@ -14,13 +16,7 @@ AVX Logic and Misc Handlers
 static int vec_reg_logical_index(const op_t &op) {
     if (op.type != o_reg && op.type != o_xmmreg && op.type != o_ymmreg && op.type != o_zmmreg)
         return -1;
-    int r = op.reg;
-    if (r >= R_xmm0 && r <= R_xmm15) return r - R_xmm0;
-    if (r >= R_xmm16 && r <= R_xmm31) return 16 + (r - R_xmm16);
-    if (r >= R_ymm0 && r <= R_ymm15) return r - R_ymm0;
-    if (r >= R_ymm16 && r <= R_ymm31) return 16 + (r - R_ymm16);
-    if (r >= R_zmm0 && r <= R_zmm31) return r - R_zmm0;
-    return -1;
+    return vreg_index(op.reg);
 }
 
 // Add a 128-bit-source argument for a register operand that may be an EVEX
@@ -36,11 +32,7 @@ static bool add_vec_low128_arg(codegen_t &cdg, AVXIntrinsic &icall, const op_t &
         icall.add_argument_reg(mr, ti);
         return true;
     }
-    mop_t read_mop;
-    read_mop.make_insn(make_zmm_read_call(cdg, idx, ti));
-    read_mop.size = (int) ti.get_size();
-    if (ti.get_size() > 8) read_mop.set_udt();
-    icall.add_argument_mop(read_mop, ti);
+    icall.add_argument_insn(make_zmm_read_call(cdg, idx, ti), ti);
     return true;
 }
 
@@ -719,7 +711,7 @@ merror_t handle_v_shuf_lane(codegen_t &cdg) {
 
         icall.add_argument_imm(imm8, BT_INT8);
 
-        mreg_t tmp = cdg.mba->alloc_kreg(size, false);
+        mreg_t tmp = kreg_alloc(cdg, size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, ti);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -811,7 +803,7 @@ merror_t handle_vpermpd(codegen_t &cdg) {
             icall.add_argument_imm(cdg.insn.Op3.value, BT_INT8);
         }
 
-        mreg_t tmp = cdg.mba->alloc_kreg(size, false);
+        mreg_t tmp = kreg_alloc(cdg, size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, ti);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -1021,25 +1013,10 @@ merror_t handle_vmovlhps(codegen_t &cdg) {
     return MERR_OK;
 }
 
-static mreg_t load_memory_address(codegen_t &cdg, int opidx) {
-    const op_t &op = opidx == 0 ? cdg.insn.Op1 : (opidx == 1 ? cdg.insn.Op2 : cdg.insn.Op3);
-    int addr_size = inf_is_64bit() ? 8 : 4;
-    if (op.type == o_mem) {
-        mreg_t addr = cdg.mba->alloc_kreg(addr_size);
-        mop_t imm;
-        imm.make_number(op.addr, addr_size);
-        mop_t dst(addr, addr_size);
-        mop_t empty;
-        cdg.emit(m_mov, &imm, &empty, &dst);
-        return addr;
-    }
-    return cdg.load_effective_address(opidx);
-}
-
-static void add_pointer_arg(AVXIntrinsic &icall, mreg_t addr) {
+static void add_pointer_arg(AVXIntrinsic &icall, const mop_t &addr) {
     tinfo_t ptr_type;
     ptr_type.create_ptr(tinfo_t(BT_VOID));
-    icall.add_argument_reg(addr, ptr_type);
+    icall.add_argument_mop(addr, ptr_type);
 }
 
 merror_t handle_vmovhlps(codegen_t &cdg) {
@@ -1080,8 +1057,8 @@ merror_t handle_vmovl_h_ps_pd(codegen_t &cdg) {
 
     if (is_mem_op(cdg.insn.Op1)) {
         if (!is_xmm_reg(cdg.insn.Op2)) return MERR_INSN;
-        mreg_t addr = load_memory_address(cdg, 0);
-        if (addr == mr_none) return MERR_INSN;
+        mop_t addr;
+        if (!memop_address_arg(cdg, 0, &addr)) return MERR_INSN;
         mreg_t src = reg2mreg(cdg.insn.Op2.reg);
         AVXIntrinsic icall(&cdg, store_name);
         add_pointer_arg(icall, addr);
@@ -1096,8 +1073,8 @@ merror_t handle_vmovl_h_ps_pd(codegen_t &cdg) {
 
     mreg_t dst = reg2mreg(cdg.insn.Op1.reg);
     mreg_t src = reg2mreg(cdg.insn.Op2.reg);
-    mreg_t addr = load_memory_address(cdg, 2);
-    if (addr == mr_none) return MERR_INSN;
+    mop_t addr;
+    if (!memop_address_arg(cdg, 2, &addr)) return MERR_INSN;
 
     AVXIntrinsic icall(&cdg, load_name);
     icall.add_argument_reg(src, ti);
@@ -1579,30 +1556,13 @@ merror_t handle_cache_ctrl(codegen_t &cdg) {
         default: return MERR_INSN;
     }
 
-    int addr_size = inf_is_64bit() ? 8 : 4;
-    mreg_t addr_reg = mr_none;
-
-    if (op.type == o_mem) {
-        addr_reg = cdg.mba->alloc_kreg(addr_size);
-        mop_t addr_imm;
-        addr_imm.make_number(op.addr, addr_size);
-        mop_t addr_dst;
-        addr_dst.make_reg(addr_reg, addr_size);
-        mop_t empty;
-        cdg.emit(m_mov, &addr_imm, &empty, &addr_dst);
-    } else {
-        addr_reg = cdg.load_effective_address(0);
-    }
-
-    if (addr_reg == mr_none) {
+    mop_t addr;
+    if (!memop_address_arg(cdg, 0, &addr)) {
         return MERR_INSN;
     }
 
-    tinfo_t ptr_type;
-    ptr_type.create_ptr(tinfo_t(BT_VOID));
-
     AVXIntrinsic icall(&cdg, iname);
-    icall.add_argument_reg(addr_reg, ptr_type);
+    add_pointer_arg(icall, addr);
     icall.emit_void();
     return MERR_OK;
 }
@@ -1664,12 +1624,11 @@ merror_t handle_v_align(codegen_t &cdg) {
     return MERR_OK;
 }
 
-// vzeroupper is a microarchitectural optimization with no semantic effect
-// Emit a NOP instruction so it doesn't appear as __asm block
+// vzeroupper is a microarchitectural optimization with no semantic effect.
+// Consume it without emitting anything: compilers place one before nearly
+// every call and return, and an m_nop would be carried through every pass.
 merror_t handle_vzeroupper_nop(codegen_t &cdg) {
-    // Emit a m_nop to consume the instruction without any visible effect
-    // m_nop requires proper arguments: emit(opcode, width, l, r, d, offsize)
-    cdg.emit(m_nop, 0, 0, 0, 0, 0);
+    (void)cdg;
     return MERR_OK;
 }
 
@@ -1710,7 +1669,7 @@ merror_t handle_vbroadcast_ss_sd(codegen_t &cdg) {
         if (!add_vec_low128_arg(cdg, icall, cdg.insn.Op2, src_ti))
             return MERR_INSN;
 
-        mreg_t ret = cdg.mba->alloc_kreg(ZMM_SIZE, false);
+        mreg_t ret = kreg_alloc(cdg, ZMM_SIZE, false);
         if (ret == mr_none) return MERR_INSN;
         icall.set_return_reg(ret, vt);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -1723,7 +1682,7 @@ merror_t handle_vbroadcast_ss_sd(codegen_t &cdg) {
     AvxOpLoader src(cdg, 1, cdg.insn.Op2);
     mreg_t d = size == ZMM_SIZE ? mr_none : reg2mreg(cdg.insn.Op1.reg);
 
-    mreg_t scalar = cdg.mba->alloc_kreg(scalar_size);
+    mreg_t scalar = kreg_alloc(cdg, scalar_size);
 
     // Extract scalar (low element).
     // If src is a vector register, m_mov with scalar_size extracts the low bits.
@@ -1741,7 +1700,7 @@ merror_t handle_vbroadcast_ss_sd(codegen_t &cdg) {
     tinfo_t vt = get_type_robust(size, false, is_double);
     mreg_t ret = d;
     if (size == ZMM_SIZE) {
-        ret = cdg.mba->alloc_kreg(size, false);
+        ret = kreg_alloc(cdg, size, false);
         if (ret == mr_none) return MERR_INSN;
     }
     icall.set_return_reg(ret, vt);
@@ -1752,7 +1711,7 @@ merror_t handle_vbroadcast_ss_sd(codegen_t &cdg) {
         return MERR_INSN;
     }
 
-    cdg.mba->free_kreg(scalar, scalar_size);
+    kreg_free(cdg, scalar, scalar_size);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1765,7 +1724,7 @@ merror_t handle_vbroadcastf128_fp(codegen_t &cdg) {
     tinfo_t vec_type = get_type_robust(YMM_SIZE, false, false);
 
     AVXIntrinsic cast_intr(&cdg, "_mm256_castps128_ps256");
-    mreg_t tmp = cdg.mba->alloc_kreg(YMM_SIZE);
+    mreg_t tmp = kreg_alloc(cdg, YMM_SIZE);
     cast_intr.add_argument_reg(src128, get_type_robust(16, false, false));
     cast_intr.set_return_reg(tmp, vec_type);
     cast_intr.emit();
@@ -1777,7 +1736,7 @@ merror_t handle_vbroadcastf128_fp(codegen_t &cdg) {
     ins_intr.set_return_reg(d, vec_type);
     ins_intr.emit();
 
-    cdg.mba->free_kreg(tmp, YMM_SIZE);
+    kreg_free(cdg, tmp, YMM_SIZE);
     return MERR_OK;
 }
 
@@ -1871,7 +1830,7 @@ merror_t handle_vcmp_ps_pd(codegen_t &cdg) {
     if (is_scalar && is_mem_op(cdg.insn.Op3)) {
         // Scalar compare with memory operand: load scalar, zero-extend to XMM
         AvxOpLoader b_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(b_in.reg, elem_size);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -1905,7 +1864,7 @@ merror_t handle_vcmp_ps_pd(codegen_t &cdg) {
     icall.set_return_reg(d, vt);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -2078,7 +2037,7 @@ merror_t handle_vmaskmov_ps_pd(codegen_t &cdg) {
                                ? (is_double ? "_mm256_setzero_pd" : "_mm256_setzero_ps")
                                : (is_double ? "_mm_setzero_pd" : "_mm_setzero_ps");
         AVXIntrinsic setz_ic(&cdg, setz);
-        mreg_t zero = cdg.mba->alloc_kreg(size);
+        mreg_t zero = kreg_alloc(cdg, size);
         setz_ic.set_return_reg(zero, vt);
         setz_ic.emit();
 
@@ -2092,7 +2051,7 @@ merror_t handle_vmaskmov_ps_pd(codegen_t &cdg) {
         bl.set_return_reg(dst, vt);
         bl.emit();
 
-        cdg.mba->free_kreg(zero, size);
+        kreg_free(cdg, zero, size);
         if (size == XMM_SIZE) clear_upper(cdg, dst);
         return MERR_OK;
     }
@@ -2108,7 +2067,7 @@ merror_t handle_vmaskmov_ps_pd(codegen_t &cdg) {
                             ? (is_double ? "_mm256_blendv_pd" : "_mm256_blendv_ps")
                             : (is_double ? "_mm_blendv_pd" : "_mm_blendv_ps");
     AVXIntrinsic bl(&cdg, blend);
-    mreg_t res = cdg.mba->alloc_kreg(size);
+    mreg_t res = kreg_alloc(cdg, size);
     bl.add_argument_reg(oldv, vt);
     bl.add_argument_reg(src, vt);
     bl.add_argument_reg(mask, vt);
@@ -2116,7 +2075,7 @@ merror_t handle_vmaskmov_ps_pd(codegen_t &cdg) {
     bl.emit();
 
     store_operand_hack(cdg, 0, mop_t(res, size));
-    cdg.mba->free_kreg(res, size);
+    kreg_free(cdg, res, size);
 
     return MERR_OK;
 }
@@ -2281,11 +2240,11 @@ merror_t handle_vextractf128(codegen_t &cdg) {
         }
     } else {
         QASSERT(0xA0902, is_mem_op(cdg.insn.Op1));
-        mreg_t tmp = cdg.mba->alloc_kreg(dst_size);
+        mreg_t tmp = kreg_alloc(cdg, dst_size);
         icall.set_return_reg(tmp, vt_dst);
         icall.emit();
         store_operand_hack(cdg, 0, mop_t(tmp, dst_size));
-        cdg.mba->free_kreg(tmp, dst_size);
+        kreg_free(cdg, tmp, dst_size);
     }
 
     return MERR_OK;
@@ -2380,7 +2339,7 @@ merror_t handle_vinsertf128(codegen_t &cdg) {
 
     // Destination may be ZMM: route the result through a temp + __writezmm.
     if (is_zmm_reg(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(dst_size, false);
+        mreg_t tmp = kreg_alloc(cdg, dst_size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, vt_dst);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -2450,7 +2409,7 @@ merror_t handle_vmovddup(codegen_t &cdg) {
     if (is_mem_op(cdg.insn.Op2) && size == XMM_SIZE) {
         // XMM variant with memory: load 8 bytes, zero-extend to 16 bytes
         AvxOpLoader src_in(cdg, 1, cdg.insn.Op2);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src_mop(src_in.reg, DOUBLE_SIZE);  // 8 bytes loaded
         mop_t dst_mop(t_mem, XMM_SIZE);          // 16 bytes for intrinsic
         if (XMM_SIZE > 8) {
@@ -2478,7 +2437,7 @@ merror_t handle_vmovddup(codegen_t &cdg) {
     icall.set_return_reg(dst, vt);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, dst);
     return MERR_OK;
 }
@@ -2535,13 +2494,13 @@ merror_t handle_vpbroadcast_d_q(codegen_t &cdg) {
         if (gpr == mr_none) return MERR_INSN;
 
         qstring gname;
-        gname.cat_sprnt("_mm%s_set1_epi%d", get_size_prefix(size), is_qword ? 64 : 32);
+        gname.cat_sprnt("_mm%s_set1_%s", get_size_prefix(size), get_set_epi_suffix(size, elem_size));
         AVXIntrinsic gcall(&cdg, gname.c_str());
         tinfo_t gti = get_type_robust(size, true, false);
 
         mreg_t gret = d;
         if (size == ZMM_SIZE) {
-            gret = cdg.mba->alloc_kreg(size, false);
+            gret = kreg_alloc(cdg, size, false);
             if (gret == mr_none) return MERR_INSN;
         }
         gcall.add_argument_reg(gpr, is_qword ? BT_INT64 : BT_INT32);
@@ -2560,7 +2519,7 @@ merror_t handle_vpbroadcast_d_q(codegen_t &cdg) {
     if (is_mem_op(cdg.insn.Op2)) {
         AvxOpLoader src_in(cdg, 1, cdg.insn.Op2);
         // Zero-extend to XMM for intrinsic argument
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t s(src_in.reg, elem_size);
         mop_t dst_op(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -2584,7 +2543,7 @@ merror_t handle_vpbroadcast_d_q(codegen_t &cdg) {
     icall.set_return_reg(d, ti_dst);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -2774,8 +2733,8 @@ merror_t handle_vpmaskmov_int(codegen_t &cdg) {
 
     if (is_mem_op(cdg.insn.Op1)) {
         int size = get_vector_size(cdg.insn.Op3);
-        mreg_t addr = load_memory_address(cdg, 0);
-        if (addr == mr_none) return MERR_INSN;
+        mop_t addr;
+        if (!memop_address_arg(cdg, 0, &addr)) return MERR_INSN;
         mreg_t mask = reg2mreg(cdg.insn.Op2.reg);
         mreg_t src = reg2mreg(cdg.insn.Op3.reg);
 
@@ -2797,8 +2756,8 @@ merror_t handle_vpmaskmov_int(codegen_t &cdg) {
     int size = get_vector_size(cdg.insn.Op1);
     mreg_t dst = reg2mreg(cdg.insn.Op1.reg);
     mreg_t mask = reg2mreg(cdg.insn.Op2.reg);
-    mreg_t addr = load_memory_address(cdg, 2);
-    if (addr == mr_none) return MERR_INSN;
+    mop_t addr;
+    if (!memop_address_arg(cdg, 2, &addr)) return MERR_INSN;
 
     qstring name;
     name.cat_sprnt("_mm%s_maskload_epi%d", get_size_prefix(size), is_qword ? 64 : 32);
@@ -2995,7 +2954,8 @@ merror_t handle_v_mask_to_vec(codegen_t &cdg) {
     }
 
     QASSERT(0xA0A02, cdg.insn.Op2.type == o_kreg || cdg.insn.Op2.type == o_reg);
-    int kreg_num = cdg.insn.Op2.reg - R_k0;
+    int kreg_num = kreg_index(cdg.insn.Op2.reg);
+    if (kreg_num < 0) return MERR_INSN;
     mreg_t mask_reg = (mreg_t)(-(kreg_num + 1));
     int num_elements = size / elem_size;
 
@@ -3029,7 +2989,7 @@ merror_t handle_vpbroadcast_b_w(codegen_t &cdg) {
     if (is_mem_op(cdg.insn.Op2)) {
         AvxOpLoader src_in(cdg, 1, cdg.insn.Op2);
         // Zero-extend to XMM for intrinsic argument
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t s(src_in.reg, elem_size);
         mop_t dst_op(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -3053,7 +3013,7 @@ merror_t handle_vpbroadcast_b_w(codegen_t &cdg) {
     icall.set_return_reg(d, ti_dst);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -3303,11 +3263,11 @@ merror_t handle_vpmov_down(codegen_t &cdg) {
         icall.emit();
         if (dst_size == XMM_SIZE) clear_upper(cdg, d);
     } else if (is_mem_op(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(dst_size);
+        mreg_t tmp = kreg_alloc(cdg, dst_size);
         icall.set_return_reg(tmp, ti_dst);
         icall.emit();
         store_operand_hack(cdg, 0, mop_t(tmp, dst_size));
-        cdg.mba->free_kreg(tmp, dst_size);
+        kreg_free(cdg, tmp, dst_size);
     } else {
         return MERR_INSN;
     }
@@ -3438,12 +3398,12 @@ merror_t handle_vextractps(codegen_t &cdg) {
 
     if (is_mem_op(cdg.insn.Op1)) {
         // Memory destination - extract to temp then store
-        mreg_t tmp = cdg.mba->alloc_kreg(4);
+        mreg_t tmp = kreg_alloc(cdg, 4);
         icall.set_return_reg_basic(tmp, BT_INT32);
         icall.emit();
         mop_t src_mop(tmp, 4);
         store_operand_hack(cdg, 0, src_mop);
-        cdg.mba->free_kreg(tmp, 4);
+        kreg_free(cdg, tmp, 4);
     } else {
         // GPR destination
         mreg_t dst = reg2mreg(cdg.insn.Op1.reg);
@@ -3479,7 +3439,7 @@ static bool add_vec_source(codegen_t &cdg, AVXIntrinsic &icall, int opidx,
 // register (Op1) via __writemask.
 static merror_t finish_mask_result(codegen_t &cdg, AVXIntrinsic &icall, int num_elements) {
     tinfo_t mt = kmask_type_for(num_elements);
-    mreg_t tmp = cdg.mba->alloc_kreg((int) mt.get_size());
+    mreg_t tmp = kreg_alloc(cdg, (int) mt.get_size());
     if (tmp == mr_none) return MERR_INSN;
     icall.set_return_reg(tmp, mt);
     if (icall.emit() == nullptr) return MERR_INSN;
@@ -3531,6 +3491,40 @@ merror_t handle_v_cmp_to_mask(codegen_t &cdg) {
     return finish_mask_result(cdg, icall, num_elements);
 }
 
+// vpcmpeq{b,w,d,q} / vpcmpgt{b,w,d,q} with an opmask destination (EVEX form).
+merror_t handle_vpcmp_int_to_mask(codegen_t &cdg) {
+    const char *op = nullptr, *suf = nullptr;
+    int elem = 4;
+    switch (cdg.insn.itype) {
+        case NN_vpcmpeqb: op = "eq"; suf = "epi8";  elem = 1; break;
+        case NN_vpcmpeqw: op = "eq"; suf = "epi16"; elem = 2; break;
+        case NN_vpcmpeqd: op = "eq"; suf = "epi32"; elem = 4; break;
+        case NN_vpcmpeqq: op = "eq"; suf = "epi64"; elem = 8; break;
+        case NN_vpcmpgtb: op = "gt"; suf = "epi8";  elem = 1; break;
+        case NN_vpcmpgtw: op = "gt"; suf = "epi16"; elem = 2; break;
+        case NN_vpcmpgtd: op = "gt"; suf = "epi32"; elem = 4; break;
+        case NN_vpcmpgtq: op = "gt"; suf = "epi64"; elem = 8; break;
+        default: return MERR_INSN;
+    }
+    int size = get_vector_size(cdg.insn.Op2);
+    int num_elements = size / elem;
+
+    MaskInfo mask = MaskInfo::from_insn(cdg.insn, elem);
+    if (mask.has_mask) load_mask_operand(cdg, mask);
+
+    qstring base;
+    base.cat_sprnt("_mm%s_cmp%s_%s_mask", get_size_prefix(size), op, suf);
+    qstring iname = mask.has_mask ? make_masked_intrinsic_name(base.c_str(), mask) : base;
+    AVXIntrinsic icall(&cdg, iname.c_str());
+    tinfo_t ti = get_type_robust(size, true, false);
+
+    if (mask.has_mask) icall.add_argument_mask(mask.mask_reg, mask.num_elements);
+    if (!add_vec_source(cdg, icall, 1, cdg.insn.Op2, ti)) return MERR_INSN;
+    if (!add_vec_source(cdg, icall, 2, cdg.insn.Op3, ti)) return MERR_INSN;
+
+    return finish_mask_result(cdg, icall, num_elements);
+}
+
 // vptestm{b,w,d,q} / vptestnm{b,w,d,q} / vpshufbitqmb: 2-source -> opmask.
 merror_t handle_v_2src_to_mask(codegen_t &cdg) {
     uint16 it = cdg.insn.itype;
@@ -3630,19 +3624,14 @@ merror_t handle_v_4fma(codegen_t &cdg) {
     // four consecutive source registers
     int base_idx = vec_reg_logical_index(cdg.insn.Op2);
     if (base_idx < 0) return MERR_INSN;
-    for (int i = 0; i < 4; i++) {
-        mop_t rd;
-        rd.make_insn(make_zmm_read_call(cdg, base_idx + i, vt));
-        rd.size = (int) vt.get_size();
-        if (vt.get_size() > 8) rd.set_udt();
-        icall.add_argument_mop(rd, vt);
-    }
+    for (int i = 0; i < 4; i++)
+        icall.add_argument_insn(make_zmm_read_call(cdg, base_idx + i, vt), vt);
     // memory operand (b)
     AvxOpLoader b(cdg, 2, cdg.insn.Op3);
     icall.add_argument_reg(b, mt);
 
     if (is_zmm_reg(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(size, false);
+        mreg_t tmp = kreg_alloc(cdg, size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, vt);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -3712,7 +3701,7 @@ merror_t handle_v_comish(codegen_t &cdg) {
     // Op2 may be a scalar m16 memory load; widen it to XMM width so the call
     // argument does not read undefined upper bytes of the load (INTERR 50920).
     icall.add_argument_reg(widen_loaded_value(cdg, b.reg, b.size, (int) ti.get_size()), ti);
-    mreg_t tmp = cdg.mba->alloc_kreg(4);
+    mreg_t tmp = kreg_alloc(cdg, 4);
     if (tmp == mr_none) return MERR_INSN;
     icall.set_return_reg_basic(tmp, BT_INT32);
     icall.emit();
@@ -3785,7 +3774,7 @@ merror_t handle_v_er(codegen_t &cdg) {
     }
 
     if (is_zmm_reg(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(size, false);
+        mreg_t tmp = kreg_alloc(cdg, size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, vt);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -3856,7 +3845,7 @@ merror_t handle_k_alu(codegen_t &cdg) {
         icall.add_argument_imm(cdg.insn.Op3.value, BT_INT32);
     }
 
-    mreg_t tmp = cdg.mba->alloc_kreg((int) mt.get_size());
+    mreg_t tmp = kreg_alloc(cdg, (int) mt.get_size());
     if (tmp == mr_none) return MERR_INSN;
     icall.set_return_reg(tmp, mt);
     if (icall.emit() == nullptr) return MERR_INSN;
@@ -3875,7 +3864,7 @@ merror_t handle_kmov(codegen_t &cdg) {
     // Materialize the source value into `val`.
     mreg_t val = mr_none;
     if (is_mask_reg(src)) {
-        val = cdg.mba->alloc_kreg(bytes);
+        val = kreg_alloc(cdg, bytes);
         if (val == mr_none) return MERR_INSN;
         AVXIntrinsic rd(&cdg, "__readmask");
         rd.add_argument_imm((uint64) get_kreg_index(src), BT_INT32);
@@ -3901,6 +3890,40 @@ merror_t handle_kmov(codegen_t &cdg) {
     }
 }
 
+// kortest{b,w,d,q} / ktest{b,w,d,q} only update flags. kortest sets ZF when
+// the OR of the two masks is zero and CF when it is all ones; ktest sets ZF
+// when their AND is zero and CF when the second has no bit the first lacks.
+// As with vptest, ZF and CF are the results of the matching
+// _kortest{z,c}/_ktest{z,c} intrinsics, so a loop exiting on kortest keeps
+// its condition.
+merror_t handle_ktest(codegen_t &cdg) {
+    uint16 it = cdg.insn.itype;
+    bool is_or = it == NN_kortestb || it == NN_kortestw || it == NN_kortestd || it == NN_kortestq;
+    int bits = 16;
+    if (it == NN_kortestb || it == NN_ktestb) bits = 8;
+    else if (it == NN_kortestd || it == NN_ktestd) bits = 32;
+    else if (it == NN_kortestq || it == NN_ktestq) bits = 64;
+    tinfo_t mt = kmask_type_for(bits);
+    tinfo_t ti_flag(BT_INT8);
+
+    const char kinds[2] = {'z', 'c'};
+    const mreg_t flags[2] = {mr_zf, mr_cf};
+    for (int i = 0; i < 2; i++) {
+        qstring nm;
+        nm.cat_sprnt("_%s%c_mask%d_u8", is_or ? "kortest" : "ktest", kinds[i], bits);
+        AVXIntrinsic call(&cdg, nm.c_str());
+        call.call_info->flags |= FCI_PURE | FCI_NOSIDE;
+        if (!add_kmask_read_arg(cdg, call, cdg.insn.Op1, mt)) return MERR_INSN;
+        if (!add_kmask_read_arg(cdg, call, cdg.insn.Op2, mt)) return MERR_INSN;
+        call.set_return_reg(flags[i], ti_flag);
+        if (call.emit() == nullptr) return MERR_INSN;
+    }
+    clear_flag(cdg, mr_sf);
+    clear_flag(cdg, mr_of);
+    clear_flag(cdg, mr_pf);
+    return MERR_OK;
+}
+
 // vblendmps/pd, vpblendmb/w/d/q: opmask-controlled blend (dst = k ? b : a).
 // Lowers to _mm*_mask_blend_<suffix>(k, a, b).
 merror_t handle_v_blendm(codegen_t &cdg) {
@@ -3945,7 +3968,7 @@ merror_t handle_v_blendm(codegen_t &cdg) {
     }
 
     if (is_zmm_reg(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(size, false);
+        mreg_t tmp = kreg_alloc(cdg, size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, vt);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -3966,7 +3989,8 @@ merror_t handle_v_broadcastm(codegen_t &cdg) {
     int mask_elems = isq ? 8 : 16;  // __mmask8 vs __mmask16
 
     if (cdg.insn.Op2.type != o_kreg && cdg.insn.Op2.type != o_reg) return MERR_INSN;
-    int kreg_num = cdg.insn.Op2.reg - R_k0;
+    int kreg_num = kreg_index(cdg.insn.Op2.reg);
+    if (kreg_num < 0) return MERR_INSN;
     mreg_t mask_reg = (mreg_t)(-(kreg_num + 1));
 
     qstring nm;
@@ -3977,7 +4001,7 @@ merror_t handle_v_broadcastm(codegen_t &cdg) {
     icall.add_argument_mask(mask_reg, mask_elems);
 
     if (is_zmm_reg(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(size, false);
+        mreg_t tmp = kreg_alloc(cdg, size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, vt);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -4008,7 +4032,7 @@ merror_t handle_v_broadcast_x2(codegen_t &cdg) {
     icall.add_argument_reg(widen_loaded_value(cdg, src.reg, src.size, XMM_SIZE), src_vt);
 
     if (is_zmm_reg(cdg.insn.Op1)) {
-        mreg_t tmp = cdg.mba->alloc_kreg(size, false);
+        mreg_t tmp = kreg_alloc(cdg, size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, vt);
         if (icall.emit() == nullptr) return MERR_INSN;
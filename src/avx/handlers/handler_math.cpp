@@ -52,7 +52,7 @@ merror_t handle_v_math_ss_sd(codegen_t &cdg, int elem_size) {
     // Example: vaddsd xmm0, xmm1, xmm0
     mreg_t r_tmp = mr_none;
     if (r == d && l != d) {
-        r_tmp = cdg.mba->alloc_kreg(elem_size);
+        r_tmp = kreg_alloc(cdg, elem_size);
         if (r_tmp == mr_none) {
             return MERR_INSN;
         }
@@ -91,7 +91,7 @@ merror_t handle_v_minmax_ss_sd(codegen_t &cdg) {
         // Load scalar from memory
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
         // Zero-extend to XMM size for use in intrinsic
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, elem_size);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -130,7 +130,7 @@ merror_t handle_v_minmax_ss_sd(codegen_t &cdg) {
     icall.set_return_reg(d, vt);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -203,7 +203,7 @@ merror_t handle_v_math_sh(codegen_t &cdg) {
     mreg_t t_mem = mr_none;
     if (is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, WORD_SIZE);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -240,7 +240,7 @@ merror_t handle_v_math_sh(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -337,7 +337,7 @@ merror_t handle_v_fma_ph(codegen_t &cdg) {
     mreg_t op3 = op3_in;
     mreg_t t_mem = mr_none;
     if (is_scalar && is_mem_op(cdg.insn.Op3)) {
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(op3_in, WORD_SIZE);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -370,7 +370,7 @@ merror_t handle_v_fma_ph(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -442,7 +442,7 @@ merror_t handle_v_math_p(codegen_t &cdg) {
 
     int size = get_vector_size(cdg.insn.Op1);
 
-    // Note: ZMM memory operands are now handled via emit_zmm_load/emit_zmm_store
+    // Note: ZMM memory operands are now handled via emit_vector_load/emit_vector_store
     // which bypass cdg.load_operand() and manually emit m_ldx/m_stx with UDT flags
 
     const char *fmt = nullptr;
@@ -708,7 +708,7 @@ merror_t handle_v_math_p(codegen_t &cdg) {
             icall.add_argument_reg(r, ti);
         }
 
-        mreg_t tmp = cdg.mba->alloc_kreg(size, false);
+        mreg_t tmp = kreg_alloc(cdg, size, false);
         if (tmp == mr_none) return MERR_INSN;
         icall.set_return_reg(tmp, ti);
         if (icall.emit() == nullptr) return MERR_INSN;
@@ -888,7 +888,7 @@ merror_t handle_v_fma(codegen_t &cdg) {
     if (is_scalar && is_mem_op(cdg.insn.Op3)) {
         // For scalar FMA with memory operand, zero-extend the loaded scalar to XMM size
         // Reuse elem_size for scalar load size
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(op3_in, elem_size);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -932,7 +932,7 @@ merror_t handle_v_fma(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1156,7 +1156,7 @@ merror_t handle_vsqrtss(codegen_t &cdg) {
     mreg_t l = reg2mreg(cdg.insn.Op2.reg);
     mreg_t d = reg2mreg(cdg.insn.Op1.reg);
 
-    mreg_t t = cdg.mba->alloc_kreg(XMM_SIZE);
+    mreg_t t = kreg_alloc(cdg, XMM_SIZE);
     cdg.emit(m_mov, XMM_SIZE, l, 0, t, 0);
 
     AVXIntrinsic icall(&cdg, "fsqrt");
@@ -1165,7 +1165,7 @@ merror_t handle_vsqrtss(codegen_t &cdg) {
     icall.emit();
 
     cdg.emit(m_mov, XMM_SIZE, t, 0, d, 0);
-    cdg.mba->free_kreg(t, XMM_SIZE);
+    kreg_free(cdg, t, XMM_SIZE);
     clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1180,7 +1180,7 @@ merror_t handle_vsqrt_sh(codegen_t &cdg) {
     mreg_t t_mem = mr_none;
     if (is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, WORD_SIZE);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -1216,7 +1216,7 @@ merror_t handle_vsqrt_sh(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1454,7 +1454,7 @@ merror_t handle_v_getexp(codegen_t &cdg) {
         mreg_t t_mem = mr_none;
         if (is_mem_op(cdg.insn.Op3)) {
             AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-            t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+            t_mem = kreg_alloc(cdg, XMM_SIZE);
             mop_t src(r_in.reg, elem_size);
             mop_t dst(t_mem, XMM_SIZE);
             if (XMM_SIZE > 8) {
@@ -1472,7 +1472,7 @@ merror_t handle_v_getexp(codegen_t &cdg) {
         icall.set_return_reg(d, ti);
         icall.emit();
 
-        if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+        if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     } else {
         AvxOpLoader r(cdg, 1, cdg.insn.Op2);
         icall.add_argument_reg(r, ti);
@@ -1533,7 +1533,7 @@ merror_t handle_v_getmant(codegen_t &cdg) {
         mreg_t t_mem = mr_none;
         if (is_mem_op(cdg.insn.Op3)) {
             AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-            t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+            t_mem = kreg_alloc(cdg, XMM_SIZE);
             mop_t src(r_in.reg, elem_size);
             mop_t dst(t_mem, XMM_SIZE);
             if (XMM_SIZE > 8) {
@@ -1552,7 +1552,7 @@ merror_t handle_v_getmant(codegen_t &cdg) {
         icall.set_return_reg(d, ti);
         icall.emit();
 
-        if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+        if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     } else {
         AvxOpLoader r(cdg, 1, cdg.insn.Op2);
         icall.add_argument_reg(r, ti);
@@ -1604,7 +1604,7 @@ merror_t handle_v_fixupimm(codegen_t &cdg) {
     mreg_t t_mem = mr_none;
     if (is_scalar && is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, elem_size);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -1624,7 +1624,7 @@ merror_t handle_v_fixupimm(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1669,7 +1669,7 @@ merror_t handle_v_scalef(codegen_t &cdg) {
     mreg_t t_mem = mr_none;
     if (is_scalar && is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, elem_size);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -1688,7 +1688,7 @@ merror_t handle_v_scalef(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1733,7 +1733,7 @@ merror_t handle_v_range(codegen_t &cdg) {
     mreg_t t_mem = mr_none;
     if (is_scalar && is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, elem_size);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -1753,7 +1753,7 @@ merror_t handle_v_range(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     if (size == XMM_SIZE) clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1808,7 +1808,7 @@ merror_t handle_v_reduce(codegen_t &cdg) {
         mreg_t t_mem = mr_none;
         if (is_mem_op(cdg.insn.Op3)) {
             AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-            t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+            t_mem = kreg_alloc(cdg, XMM_SIZE);
             mop_t src(r_in.reg, elem_size);
             mop_t dst(t_mem, XMM_SIZE);
             if (XMM_SIZE > 8) {
@@ -1827,7 +1827,7 @@ merror_t handle_v_reduce(codegen_t &cdg) {
         icall.set_return_reg(d, ti);
         icall.emit();
 
-        if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+        if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     } else {
         AvxOpLoader r(cdg, 1, cdg.insn.Op2);
         icall.add_argument_reg(r, ti);
@@ -1854,7 +1854,7 @@ merror_t handle_vrcp_rsqrt_ss(codegen_t &cdg) {
     if (is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
         // Zero-extend scalar to XMM for intrinsic
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, FLOAT_SIZE);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -1911,7 +1911,7 @@ merror_t handle_vrcp_rsqrt_ss(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1932,7 +1932,7 @@ merror_t handle_vround_ss_sd(codegen_t &cdg) {
     mreg_t t_mem = mr_none;
     if (is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, elem_size);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -1978,7 +1978,7 @@ merror_t handle_vround_ss_sd(codegen_t &cdg) {
     icall.set_return_reg(d, ti);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -1995,7 +1995,7 @@ merror_t handle_vsqrtsd(codegen_t &cdg) {
     mreg_t t_mem = mr_none;
     if (is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, DOUBLE_SIZE);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -2009,7 +2009,7 @@ merror_t handle_vsqrtsd(codegen_t &cdg) {
     }
 
     // Copy upper bits from src2, compute sqrt on low element
-    mreg_t t = cdg.mba->alloc_kreg(XMM_SIZE);
+    mreg_t t = kreg_alloc(cdg, XMM_SIZE);
     cdg.emit(m_mov, XMM_SIZE, l, 0, t, 0);
 
     AVXIntrinsic icall(&cdg, "fsqrt");
@@ -2018,8 +2018,8 @@ merror_t handle_vsqrtsd(codegen_t &cdg) {
     icall.emit();
 
     cdg.emit(m_mov, XMM_SIZE, t, 0, d, 0);
-    cdg.mba->free_kreg(t, XMM_SIZE);
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    kreg_free(cdg, t, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -6,6 +6,7 @@ AVX Move Handlers
 #include "../avx_utils.h"
 #include "../avx_helpers.h"
 #include "../avx_intrinsic.h"
+#include "../../common/mem_operand.h"
 
 #if IDA_SDK_VERSION >= 750
 
@@ -25,7 +26,7 @@ merror_t handle_vmov_ss_sd(codegen_t &cdg, int data_size) {
         mreg_t t_mem = mr_none;
         if (is_mem_op(cdg.insn.Op3)) {
             AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-            t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+            t_mem = kreg_alloc(cdg, XMM_SIZE);
             mop_t src(r_in.reg, data_size);
             mop_t dst(t_mem, XMM_SIZE);
             if (XMM_SIZE > 8) {
@@ -54,7 +55,7 @@ merror_t handle_vmov_ss_sd(codegen_t &cdg, int data_size) {
         icall.set_return_reg(d, vt);
         icall.emit();
 
-        if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+        if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
         clear_upper(cdg, d, data_size);
         return MERR_OK;
     }
@@ -89,11 +90,11 @@ merror_t handle_vmov_ss_sd(codegen_t &cdg, int data_size) {
 
     QASSERT(0xA0302, is_xmm_reg(cdg.insn.Op1) && is_xmm_reg(cdg.insn.Op2) && is_xmm_reg(cdg.insn.Op3));
     mreg_t d = reg2mreg(cdg.insn.Op1.reg);
-    mreg_t t = cdg.mba->alloc_kreg(XMM_SIZE);
+    mreg_t t = kreg_alloc(cdg, XMM_SIZE);
     cdg.emit(m_mov, XMM_SIZE, reg2mreg(cdg.insn.Op2.reg), 0, t, 0);
     cdg.emit(m_f2f, data_size, reg2mreg(cdg.insn.Op3.reg), 0, t, 0);
     cdg.emit(m_mov, XMM_SIZE, t, 0, d, 0);
-    cdg.mba->free_kreg(t, XMM_SIZE);
+    kreg_free(cdg, t, XMM_SIZE);
     clear_upper(cdg, d, data_size);
     return MERR_OK;
 }
@@ -131,7 +132,7 @@ merror_t handle_vmov_sh(codegen_t &cdg) {
         mreg_t t_mem = mr_none;
         if (is_mem_op(cdg.insn.Op3)) {
             AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-            t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+            t_mem = kreg_alloc(cdg, XMM_SIZE);
             mop_t src(r_in.reg, WORD_SIZE);
             mop_t dst(t_mem, XMM_SIZE);
             if (XMM_SIZE > 8) {
@@ -159,7 +160,7 @@ merror_t handle_vmov_sh(codegen_t &cdg) {
         icall.set_return_reg(d, vt);
         icall.emit();
 
-        if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+        if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
         clear_upper(cdg, d);
         return MERR_OK;
     }
@@ -172,7 +173,7 @@ merror_t handle_vmov_sh(codegen_t &cdg) {
     mreg_t t_mem = mr_none;
     if (is_mem_op(cdg.insn.Op3)) {
         AvxOpLoader r_in(cdg, 2, cdg.insn.Op3);
-        t_mem = cdg.mba->alloc_kreg(XMM_SIZE);
+        t_mem = kreg_alloc(cdg, XMM_SIZE);
         mop_t src(r_in.reg, WORD_SIZE);
         mop_t dst(t_mem, XMM_SIZE);
         if (XMM_SIZE > 8) {
@@ -193,7 +194,7 @@ merror_t handle_vmov_sh(codegen_t &cdg) {
     icall.set_return_reg(d, vt);
     icall.emit();
 
-    if (t_mem != mr_none) cdg.mba->free_kreg(t_mem, XMM_SIZE);
+    if (t_mem != mr_none) kreg_free(cdg, t_mem, XMM_SIZE);
     clear_upper(cdg, d);
     return MERR_OK;
 }
@@ -267,7 +268,7 @@ merror_t handle_vmov(codegen_t &cdg, int data_size) {
         // In 32-bit mode, don't extend to YMM (causes INTERR 50757)
         // Just zero-extend to XMM size
         if (!inf_is_64bit()) {
-            mreg_t tmp = cdg.mba->alloc_kreg(data_size);
+            mreg_t tmp = kreg_alloc(cdg, data_size);
             cdg.emit(m_mov, data_size, l, 0, tmp, 0);
 
             mop_t src(tmp, data_size);
@@ -278,7 +279,7 @@ merror_t handle_vmov(codegen_t &cdg, int data_size) {
             mop_t r;
             cdg.emit(m_xdu, &src, &r, &dst);
 
-            cdg.mba->free_kreg(tmp, data_size);
+            kreg_free(cdg, tmp, data_size);
             return MERR_OK;
         }
 
@@ -286,7 +287,7 @@ merror_t handle_vmov(codegen_t &cdg, int data_size) {
         mreg_t ymm_reg = get_ymm_mreg(xmm_reg);
         if (ymm_reg == mr_none) return MERR_INSN;
 
-        mreg_t tmp = cdg.mba->alloc_kreg(data_size);
+        mreg_t tmp = kreg_alloc(cdg, data_size);
         cdg.emit(m_mov, data_size, l, 0, tmp, 0);
 
         mop_t src(tmp, data_size);
@@ -297,7 +298,7 @@ merror_t handle_vmov(codegen_t &cdg, int data_size) {
         mop_t r;
         cdg.emit(m_xdu, &src, &r, &dst);
 
-        cdg.mba->free_kreg(tmp, data_size);
+        kreg_free(cdg, tmp, data_size);
         return MERR_OK;
     }
 
@@ -393,8 +394,8 @@ merror_t handle_v_mov_ps_dq(codegen_t &cdg) {
             } else {
                 // Memory-to-register masked load
                 QASSERT(0xA0310, is_mem_op(cdg.insn.Op2));
-                mreg_t addr = cdg.load_effective_address(1);
-                if (addr == mr_none) {
+                mop_t addr;
+                if (!memop_address_arg(cdg, 1, &addr)) {
                     return MERR_INSN;
                 }
                 qstring iname;
@@ -409,7 +410,7 @@ merror_t handle_v_mov_ps_dq(codegen_t &cdg) {
                     icall.add_argument_reg(dst, vec_type);
                 }
                 icall.add_argument_mask(mask.mask_reg, mask.num_elements);
-                icall.add_argument_reg(addr, ptr_type);
+                icall.add_argument_mop(addr, ptr_type);
                 icall.set_return_reg(dst, vec_type);
                 icall.emit();
             }
@@ -425,8 +426,8 @@ merror_t handle_v_mov_ps_dq(codegen_t &cdg) {
 
         size = get_vector_size(cdg.insn.Op2);
         mreg_t src = reg2mreg(cdg.insn.Op2.reg);
-        mreg_t addr = cdg.load_effective_address(0);
-        if (addr == mr_none) {
+        mop_t addr;
+        if (!memop_address_arg(cdg, 0, &addr)) {
             return MERR_INSN;
         }
 
@@ -438,7 +439,7 @@ merror_t handle_v_mov_ps_dq(codegen_t &cdg) {
             iname.cat_sprnt("_mm%s_mask_storeu_%s", prefix, pf);
         }
         AVXIntrinsic icall(&cdg, iname.c_str());
-        icall.add_argument_reg(addr, ptr_type);
+        icall.add_argument_mop(addr, ptr_type);
         icall.add_argument_mask(mask.mask_reg, mask.num_elements);
         icall.add_argument_reg(src, vec_type);
         icall.emit_void();
@@ -488,7 +489,7 @@ merror_t handle_v_mov_ps_dq(codegen_t &cdg) {
             // Memory-to-register load
             QASSERT(0xA0310, is_mem_op(cdg.insn.Op2));
 
-            // Use load_operand_udt which handles ZMM via emit_zmm_load()
+            // Use load_operand_udt which handles ZMM via emit_vector_load()
             mreg_t loaded = load_operand_udt(cdg, 1, size);
             if (loaded == mr_none) {
                 return MERR_INSN;
@@ -620,8 +621,8 @@ merror_t handle_v_compress(codegen_t &cdg) {
     }
 
     mreg_t src = reg2mreg(cdg.insn.Op2.reg);
-    mreg_t addr = cdg.load_effective_address(0);
-    if (addr == mr_none) {
+    mop_t addr;
+    if (!memop_address_arg(cdg, 0, &addr)) {
         return MERR_INSN;
     }
 
@@ -631,7 +632,7 @@ merror_t handle_v_compress(codegen_t &cdg) {
     AVXIntrinsic icall(&cdg, iname.c_str());
     tinfo_t ptr_type;
     ptr_type.create_ptr(tinfo_t(BT_VOID));
-    icall.add_argument_reg(addr, ptr_type);
+    icall.add_argument_mop(addr, ptr_type);
     icall.add_argument_mask(mask.mask_reg, mask.num_elements);
     icall.add_argument_reg(src, vec_type);
     icall.emit_void();
@@ -687,8 +688,8 @@ merror_t handle_v_expand(codegen_t &cdg) {
 
     if (is_mem_op(cdg.insn.Op2)) {
         // Memory source: expand load
-        mreg_t addr = cdg.load_effective_address(1);
-        if (addr == mr_none) {
+        mop_t addr;
+        if (!memop_address_arg(cdg, 1, &addr)) {
             return MERR_INSN;
         }
 
@@ -707,7 +708,7 @@ merror_t handle_v_expand(codegen_t &cdg) {
             icall.add_argument_reg(dst, vec_type);
         }
         icall.add_argument_mask(mask.mask_reg, mask.num_elements);
-        icall.add_argument_reg(addr, ptr_type);
+        icall.add_argument_mop(addr, ptr_type);
         icall.set_return_reg(dst, vec_type);
         icall.emit();
     } else if (is_vector_reg(cdg.insn.Op2)) {
@@ -822,7 +823,7 @@ merror_t handle_v_gather(codegen_t &cdg) {
     mreg_t t_base = mr_none;
 
     if (disp != 0) {
-        t_base = cdg.mba->alloc_kreg(8);
+        t_base = kreg_alloc(cdg, 8);
         mop_t l(base, 8);
         mop_t r;
         r.make_number(disp, 8);
@@ -839,7 +840,7 @@ merror_t handle_v_gather(codegen_t &cdg) {
         mreg_t src_merge = dst;
         mreg_t zero = mr_none;
         if (mask_info.is_zeroing) {
-            zero = cdg.mba->alloc_kreg(size);
+            zero = kreg_alloc(cdg, size);
             const char *zero_name = nullptr;
             if (is_int) {
                 zero_name = (size == ZMM_SIZE) ? "_mm512_setzero_si512"
@@ -868,7 +869,7 @@ merror_t handle_v_gather(codegen_t &cdg) {
         icall.add_argument_reg(arg_base, ptr_type);
         icall.add_argument_imm(scale, BT_INT32);
 
-        if (zero != mr_none) cdg.mba->free_kreg(zero, size);
+        if (zero != mr_none) kreg_free(cdg, zero, size);
     } else {
         mreg_t mask_vec = reg2mreg(cdg.insn.Op3.reg);
         icall.add_argument_reg(dst, ti_dst);
@@ -882,7 +883,7 @@ merror_t handle_v_gather(codegen_t &cdg) {
     icall.emit();
 
     if (t_base != mr_none) {
-        cdg.mba->free_kreg(t_base, 8);
+        kreg_free(cdg, t_base, 8);
     }
 
     if (size == XMM_SIZE) clear_upper(cdg, dst);
@@ -958,7 +959,7 @@ merror_t handle_v_scatter(codegen_t &cdg) {
     mreg_t arg_base = base;
     mreg_t t_base = mr_none;
     if (disp != 0) {
-        t_base = cdg.mba->alloc_kreg(8);
+        t_base = kreg_alloc(cdg, 8);
         mop_t l(base, 8);
         mop_t r;
         r.make_number(disp, 8);
@@ -997,7 +998,7 @@ merror_t handle_v_scatter(codegen_t &cdg) {
     icall.emit_void();
 
     if (t_base != mr_none) {
-        cdg.mba->free_kreg(t_base, 8);
+        kreg_free(cdg, t_base, 8);
     }
 
     return MERR_OK;
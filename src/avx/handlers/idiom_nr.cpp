@@ -0,0 +1,368 @@
+/*
+AVX Newton-Raphson Refinement Idioms
+*/
+
+#include "../avx_idiom.h"
+#include "../avx_constpool.h"
+#include "../avx_helpers.h"
+#include "../avx_intrinsic.h"
+#include "../avx_types.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../../common/warn_off.h"
+#include <intel.hpp>
+#include "../../common/warn_on.h"
+
+#include <cmath>
+#include <deque>
+#include <string>
+
+// Fast-math code refines vrsqrtps/vrcpps estimates with one or two
+// Newton-Raphson steps:
+//
+//   rsqrt:  y' = y * (1.5 - 0.5 * x * y * y)     (or 0.5 * y * (3 - x*y*y))
+//   rcp:    y' = y * (2 - x * y)                 (or y + y * (1 - x*y))
+//
+// Compilers contract these into FMAs, reorder the products, and take the
+// constants from .rodata, embedded broadcasts or registers loaded just
+// before. Rather than enumerating the arrangements, the check evaluates the
+// window on a few sample lanes with a perturbed estimate and compares the
+// final register against the refinement formula. Constants must be loaded
+// inside the window or read from read-only memory operands.
+
+namespace {
+
+enum nr_kind_t { NR_RSQRT, NR_RCP };
+
+const int NR_LANES = 4;
+const double NR_X[NR_LANES] = {0.37, 2.5, 17.0, 1234.5};
+const double NR_ERR[NR_LANES] = {3e-4, -7e-4, 1.1e-3, -2e-4};
+
+struct nr_val_t {
+    bool known;
+    double v[NR_LANES];
+};
+
+nr_val_t splat(double c) {
+    nr_val_t r;
+    r.known = true;
+    for (double &d : r.v)
+        d = c;
+    return r;
+}
+
+struct fma_form_t {
+    uint16 itype;
+    int order;      // 132, 213 or 231
+    bool neg_mul;
+    bool neg_add;
+    bool dbl;
+};
+
+const fma_form_t g_fmas[] = {
+    {NN_vfmadd132ps, 132, false, false, false}, {NN_vfmadd213ps, 213, false, false, false},
+    {NN_vfmadd231ps, 231, false, false, false}, {NN_vfmsub132ps, 132, false, true, false},
+    {NN_vfmsub213ps, 213, false, true, false},  {NN_vfmsub231ps, 231, false, true, false},
+    {NN_vfnmadd132ps, 132, true, false, false}, {NN_vfnmadd213ps, 213, true, false, false},
+    {NN_vfnmadd231ps, 231, true, false, false}, {NN_vfnmsub132ps, 132, true, true, false},
+    {NN_vfnmsub213ps, 213, true, true, false},  {NN_vfnmsub231ps, 231, true, true, false},
+    {NN_vfmadd132pd, 132, false, false, true},  {NN_vfmadd213pd, 213, false, false, true},
+    {NN_vfmadd231pd, 231, false, false, true},  {NN_vfmsub132pd, 132, false, true, true},
+    {NN_vfmsub213pd, 213, false, true, true},   {NN_vfmsub231pd, 231, false, true, true},
+    {NN_vfnmadd132pd, 132, true, false, true},  {NN_vfnmadd213pd, 213, true, false, true},
+    {NN_vfnmadd231pd, 231, true, false, true},  {NN_vfnmsub132pd, 132, true, true, true},
+    {NN_vfnmsub213pd, 213, true, true, true},   {NN_vfnmsub231pd, 231, true, true, true},
+};
+
+const fma_form_t *find_fma(uint16 itype) {
+    for (const fma_form_t &f : g_fmas)
+        if (f.itype == itype)
+            return &f;
+    return nullptr;
+}
+
+struct nr_sim_t {
+    nr_val_t regs[32];
+    bool written[32];
+    bool is_double;
+    int approx_steps;   // number of estimate instructions seen
+    nr_kind_t kind;
+    int x_reg;
+    int x_width;
+    nr_val_t y0;
+    int last_dst;
+    int last_width;
+};
+
+// Splat constant from read-only memory. `size` is the bytes the operand reads.
+bool read_const(const insn_t &insn, const op_t &op, int size, bool is_double, nr_val_t *out) {
+    if (op.type != o_mem)
+        return false;
+    int elem = is_double ? DOUBLE_SIZE : FLOAT_SIZE;
+    if (is_embedded_broadcast(insn, op))
+        size = elem;
+    const bytevec_t *b = const_pool_lookup(op.addr, size);
+    if (b == nullptr || size % elem != 0)
+        return false;
+    for (int i = elem; i < size; i++)
+        if ((*b)[i] != (*b)[i % elem])
+            return false;
+    if (is_double) {
+        double d;
+        memcpy(&d, b->begin(), sizeof(d));
+        *out = splat(d);
+    } else {
+        float f;
+        memcpy(&f, b->begin(), sizeof(f));
+        *out = splat(f);
+    }
+    return true;
+}
+
+bool sim_read(const nr_sim_t &s, const insn_t &insn, const op_t &op, int size, nr_val_t *out) {
+    int w;
+    int idx = idiom_vec_index(op, &w);
+    if (idx >= 0) {
+        *out = s.regs[idx];
+        return out->known;
+    }
+    return read_const(insn, op, size, s.is_double, out);
+}
+
+bool sim_write(nr_sim_t &s, const op_t &op, const nr_val_t &v) {
+    int w;
+    int idx = idiom_vec_index(op, &w);
+    if (idx < 0)
+        return false;
+    s.regs[idx] = v;
+    s.written[idx] = true;
+    s.last_dst = idx;
+    s.last_width = w;
+    return true;
+}
+
+double refine(nr_kind_t kind, double x, double y) {
+    return kind == NR_RSQRT ? y * (1.5 - 0.5 * x * y * y) : y * (2.0 - x * y);
+}
+
+bool sim_step(nr_sim_t &s, const insn_t &insn) {
+    int w;
+    if (idiom_vec_index(insn.Op1, &w) < 0)
+        return false;
+    nr_val_t a, b, c, r;
+    r.known = true;
+
+    switch (insn.itype) {
+        case NN_vrsqrtps:
+        case NN_vrsqrt14ps:
+        case NN_vrcpps:
+        case NN_vrcp14ps:
+        case NN_vrsqrt14pd:
+        case NN_vrcp14pd: {
+            // The estimate's input is sampled; it must not have been written earlier in the window
+            int xw;
+            int x = idiom_vec_index(insn.Op2, &xw);
+            if (x < 0 || s.written[x] || s.approx_steps++ != 0)
+                return false;
+            s.kind = (insn.itype == NN_vrcpps || insn.itype == NN_vrcp14ps || insn.itype == NN_vrcp14pd) ? NR_RCP
+                                                                                                        : NR_RSQRT;
+            s.x_reg = x;
+            s.x_width = xw;
+            for (int i = 0; i < NR_LANES; i++) {
+                s.regs[x].v[i] = NR_X[i];
+                double exact = s.kind == NR_RSQRT ? 1.0 / std::sqrt(NR_X[i]) : 1.0 / NR_X[i];
+                s.y0.v[i] = exact * (1.0 + NR_ERR[i]);
+            }
+            s.regs[x].known = true;
+            s.y0.known = true;
+            return sim_write(s, insn.Op1, s.y0);
+        }
+        case NN_vmovaps:
+        case NN_vmovups:
+        case NN_vmovapd:
+        case NN_vmovupd:
+            if ((insn.itype == NN_vmovapd || insn.itype == NN_vmovupd) != s.is_double)
+                return false;
+            if (!sim_read(s, insn, insn.Op2, w, &a))
+                return false;
+            return sim_write(s, insn.Op1, a);
+        case NN_vbroadcastss:
+        case NN_vbroadcastsd:
+            if ((insn.itype == NN_vbroadcastsd) != s.is_double)
+                return false;
+            if (insn.Op2.type != o_mem ||
+                !read_const(insn, insn.Op2, s.is_double ? DOUBLE_SIZE : FLOAT_SIZE, s.is_double, &a))
+                return false;
+            return sim_write(s, insn.Op1, a);
+        case NN_vmulps:
+        case NN_vmulpd:
+        case NN_vaddps:
+        case NN_vaddpd:
+        case NN_vsubps:
+        case NN_vsubpd:
+            if ((insn.itype == NN_vmulpd || insn.itype == NN_vaddpd || insn.itype == NN_vsubpd) != s.is_double)
+                return false;
+            if (!sim_read(s, insn, insn.Op2, w, &a) || !sim_read(s, insn, insn.Op3, w, &b))
+                return false;
+            for (int i = 0; i < NR_LANES; i++) {
+                if (insn.itype == NN_vmulps || insn.itype == NN_vmulpd) r.v[i] = a.v[i] * b.v[i];
+                else if (insn.itype == NN_vaddps || insn.itype == NN_vaddpd) r.v[i] = a.v[i] + b.v[i];
+                else r.v[i] = a.v[i] - b.v[i];
+            }
+            return sim_write(s, insn.Op1, r);
+        default:
+            break;
+    }
+
+    const fma_form_t *f = find_fma(insn.itype);
+    if (f == nullptr || f->dbl != s.is_double)
+        return false;
+    nr_val_t d;
+    if (!sim_read(s, insn, insn.Op1, w, &d) || !sim_read(s, insn, insn.Op2, w, &b) ||
+        !sim_read(s, insn, insn.Op3, w, &c))
+        return false;
+    for (int i = 0; i < NR_LANES; i++) {
+        double m1, m2, add;
+        switch (f->order) {
+            case 132: m1 = d.v[i]; m2 = c.v[i]; add = b.v[i]; break;
+            case 213: m1 = b.v[i]; m2 = d.v[i]; add = c.v[i]; break;
+            default:  m1 = b.v[i]; m2 = c.v[i]; add = d.v[i]; break;
+        }
+        double prod = m1 * m2;
+        r.v[i] = (f->neg_mul ? -prod : prod) + (f->neg_add ? -add : add);
+    }
+    return sim_write(s, insn.Op1, r);
+}
+
+bool close_to(double a, double b) { return std::fabs(a - b) <= 1e-9 * std::fabs(b); }
+
+// Emitter parameters handed over from the check through idiom_match_t::aux
+enum { AUX_KIND, AUX_DOUBLE };
+
+bool is_double_estimate(uint16 itype) { return itype == NN_vrsqrt14pd || itype == NN_vrcp14pd; }
+
+bool check_refinement(idiom_match_t &m) {
+    // Element type comes from the estimate; constants read before it need it
+    bool is_double = false;
+    for (int st = 0; st < m.nsteps; st++)
+        is_double |= is_double_estimate(m.insns[st]->itype);
+
+    nr_sim_t s;
+    memset(&s, 0, sizeof(s));
+    s.is_double = is_double;
+    s.x_reg = s.last_dst = -1;
+    for (int st = 0; st < m.nsteps; st++)
+        if (!sim_step(s, *m.insns[st]))
+            return false;
+    if (s.approx_steps != 1 || s.last_dst < 0)
+        return false;
+
+    // One or two refinement steps, ending in the last destination
+    const nr_val_t &res = s.regs[s.last_dst];
+    bool ok = false;
+    for (int steps = 1; steps <= 2 && !ok; steps++) {
+        ok = true;
+        for (int i = 0; i < NR_LANES && ok; i++) {
+            double y = s.y0.v[i];
+            for (int k = 0; k < steps; k++)
+                y = refine(s.kind, NR_X[i], y);
+            ok = close_to(res.v[i], y);
+        }
+    }
+    if (!ok || s.x_width != s.last_width)
+        return false;
+
+    m.reg[0] = s.x_reg;
+    m.width[0] = s.x_width;
+    m.reg[1] = s.last_dst;
+    m.width[1] = s.last_width;
+    m.aux[AUX_KIND] = s.kind;
+    m.aux[AUX_DOUBLE] = is_double;
+    return true;
+}
+
+// rsqrt: _mm*_invsqrt_ps(x); rcp: _mm*_div_ps(_mm*_set1_ps(1), x)
+merror_t emit_refinement(codegen_t &cdg, const idiom_match_t &m) {
+    bool is_double = m.aux[AUX_DOUBLE] != 0;
+    int width = m.width[0];
+    const char *pfx = get_size_prefix(width);
+    const char *sfx = is_double ? "pd" : "ps";
+    tinfo_t vt = get_vector_type(width, false, is_double);
+    qstring iname;
+
+    if (m.aux[AUX_KIND] == NR_RSQRT) {
+        iname.sprnt("_mm%s_invsqrt_%s", pfx, sfx);
+        AVXIntrinsic icall(&cdg, iname.c_str());
+        if (!idiom_add_var_arg(cdg, icall, m, 0, width, vt))
+            return MERR_INSN;
+        return idiom_emit_to_var(cdg, icall, m, 1, width, vt) ? MERR_OK : MERR_INSN;
+    }
+
+    mreg_t one = kreg_alloc(cdg, width, false);
+    if (one == mr_none)
+        return MERR_INSN;
+    iname.sprnt("_mm%s_set1_%s", pfx, sfx);
+    AVXIntrinsic set1(&cdg, iname.c_str());
+    mop_t fp;
+    if (is_double) {
+        double d = 1.0;
+        fp.make_fpnum(&d, DOUBLE_SIZE);
+        set1.add_argument_mop(fp, tinfo_t(BTF_DOUBLE));
+    } else {
+        float f = 1.0f;
+        fp.make_fpnum(&f, FLOAT_SIZE);
+        set1.add_argument_mop(fp, tinfo_t(BTF_FLOAT));
+    }
+    set1.set_return_reg(one, vt);
+    if (set1.emit() == nullptr)
+        return MERR_INSN;
+
+    iname.sprnt("_mm%s_div_%s", pfx, sfx);
+    AVXIntrinsic div(&cdg, iname.c_str());
+    div.add_argument_reg(one, vt);
+    if (!idiom_add_var_arg(cdg, div, m, 0, width, vt))
+        return MERR_INSN;
+    return idiom_emit_to_var(cdg, div, m, 1, width, vt) ? MERR_OK : MERR_INSN;
+}
+
+//-----------------------------------------------------------------------------
+// Registration
+//-----------------------------------------------------------------------------
+
+// Windows start at the estimate or at a constant load feeding the refinement
+const char *const HEAD_MNEMS = "vrsqrtps|vrsqrt14ps|vrcpps|vrcp14ps|vrsqrt14pd|vrcp14pd|"
+                               "vbroadcastss|vbroadcastsd|vmovaps|vmovups|vmovapd|vmovupd";
+
+const char *const STEP_MNEMS =
+    "vrsqrtps|vrsqrt14ps|vrcpps|vrcp14ps|vrsqrt14pd|vrcp14pd|vbroadcastss|vbroadcastsd|"
+    "vmovaps|vmovups|vmovapd|vmovupd|vmulps|vmulpd|vaddps|vaddpd|vsubps|vsubpd|"
+    "vfmadd132ps|vfmadd213ps|vfmadd231ps|vfmsub132ps|vfmsub213ps|vfmsub231ps|"
+    "vfnmadd132ps|vfnmadd213ps|vfnmadd231ps|vfnmsub132ps|vfnmsub213ps|vfnmsub231ps|"
+    "vfmadd132pd|vfmadd213pd|vfmadd231pd|vfmsub132pd|vfmsub213pd|vfmsub231pd|"
+    "vfnmadd132pd|vfnmadd213pd|vfnmadd231pd|vfnmsub132pd|vfnmsub213pd|vfnmsub231pd";
+
+// Longest windows first: a one-step refinement is a prefix of a two-step one.
+struct nr_registrar_t {
+    nr_registrar_t() {
+        static std::deque<std::string> patterns;
+        for (int n = IDIOM_MAX_STEPS; n >= 3; n--) {
+            std::string p = HEAD_MNEMS;
+            p += " ?, ?, ?, ?";
+            for (int i = 1; i < n; i++) {
+                p += "\n";
+                p += STEP_MNEMS;
+                p += " ?, ?, ?, ?";
+            }
+            patterns.push_back(p);
+            idiom_t d = {"nr_refine", patterns.back().c_str(), 0x2, emit_refinement, check_refinement};
+            idiom_registry_t::register_idiom(d);
+        }
+    }
+};
+
+nr_registrar_t g_nr_registrar;
+
+} // namespace
+
+#endif // IDA_SDK_VERSION >= 750
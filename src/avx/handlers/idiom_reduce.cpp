@@ -0,0 +1,574 @@
+/*
+AVX Reduction Idioms
+*/
+
+#include "../avx_idiom.h"
+#include "../avx_helpers.h"
+#include "../avx_intrinsic.h"
+#include "../avx_kreg.h"
+#include "../avx_regmap.h"
+#include "../avx_types.h"
+#include "../avx_utils.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "../../common/warn_off.h"
+#include <idp.hpp>
+#include <funcs.hpp>
+#include <typeinf.hpp>
+#include <intel.hpp>
+#include "../../common/warn_on.h"
+
+#include <deque>
+#include <string>
+
+// Horizontal reductions of a ymm/zmm register compile to a tree of
+// half-extracts, in-lane shuffles and combining ops:
+//
+//   vextractf128 xmm1, ymm0, 1      vextractf128 xmm1, ymm0, 1
+//   vaddps  xmm0, xmm1, xmm0        vaddps  xmm0, xmm0, xmm1
+//   vmovhlps xmm1, xmm0, xmm0       vpermilpd xmm1, xmm0, 1
+//   vaddps  xmm1, xmm1, xmm0        vaddps  xmm0, xmm0, xmm1
+//   vshufps xmm0, xmm1, xmm1, 55h   vmovshdup xmm1, xmm0
+//   vaddps  xmm0, xmm0, xmm1        vaddss  xmm0, xmm0, xmm1
+//
+// Register roles, shuffle choices and step counts vary between compilers, so
+// the patterns only fix the shape (extract first, then N shuffle/combine
+// steps) and the check runs the window symbolically over 32-bit lanes. Each
+// lane holds the set of source lanes folded into it; the window is a
+// reduction if the final destination's low element covers the whole source.
+//
+// The reduction is lifted as _mm512_reduce_<op>_<type>, the only width the
+// intrinsic exists at; a 256-bit source is widened first, with zeros for add
+// and by repeating it for the idempotent ops. XOR has no reduce intrinsic and
+// is left alone. The scalar is then splatted over the destination xmm, which
+// is only sound because the check proves that nothing after the window reads
+// more than the destination's low element.
+
+namespace {
+
+enum red_op_t { RO_ADD, RO_MIN, RO_MAX, RO_MINU, RO_MAXU, RO_AND, RO_OR };
+
+// Element type of the combine step. RT_BITS (vpand/vpor) is resolved
+// to epi32 or epi64 from the final lane coverage.
+enum red_ty_t { RT_PS, RT_PD, RT_EPI32, RT_EPI64, RT_BITS };
+
+struct combine_t {
+    uint16 itype;
+    red_op_t op;
+    red_ty_t ty;
+    bool scalar;    // ss/sd: only the low element is combined
+    bool hadd;      // horizontal pairwise form
+};
+
+const combine_t g_combines[] = {
+    {NN_vaddps,  RO_ADD,  RT_PS,    false, false},
+    {NN_vaddpd,  RO_ADD,  RT_PD,    false, false},
+    {NN_vaddss,  RO_ADD,  RT_PS,    true,  false},
+    {NN_vaddsd,  RO_ADD,  RT_PD,    true,  false},
+    {NN_vhaddps, RO_ADD,  RT_PS,    false, true},
+    {NN_vhaddpd, RO_ADD,  RT_PD,    false, true},
+    {NN_vminps,  RO_MIN,  RT_PS,    false, false},
+    {NN_vminpd,  RO_MIN,  RT_PD,    false, false},
+    {NN_vminss,  RO_MIN,  RT_PS,    true,  false},
+    {NN_vminsd,  RO_MIN,  RT_PD,    true,  false},
+    {NN_vmaxps,  RO_MAX,  RT_PS,    false, false},
+    {NN_vmaxpd,  RO_MAX,  RT_PD,    false, false},
+    {NN_vmaxss,  RO_MAX,  RT_PS,    true,  false},
+    {NN_vmaxsd,  RO_MAX,  RT_PD,    true,  false},
+    {NN_vpaddd,  RO_ADD,  RT_EPI32, false, false},
+    {NN_vpaddq,  RO_ADD,  RT_EPI64, false, false},
+    {NN_vphaddd, RO_ADD,  RT_EPI32, false, true},
+    {NN_vpminsd, RO_MIN,  RT_EPI32, false, false},
+    {NN_vpminsq, RO_MIN,  RT_EPI64, false, false},
+    {NN_vpmaxsd, RO_MAX,  RT_EPI32, false, false},
+    {NN_vpmaxsq, RO_MAX,  RT_EPI64, false, false},
+    {NN_vpminud, RO_MINU, RT_EPI32, false, false},
+    {NN_vpminuq, RO_MINU, RT_EPI64, false, false},
+    {NN_vpmaxud, RO_MAXU, RT_EPI32, false, false},
+    {NN_vpmaxuq, RO_MAXU, RT_EPI64, false, false},
+    {NN_vpand,   RO_AND,  RT_BITS,  false, false},
+    {NN_vpandd,  RO_AND,  RT_BITS,  false, false},
+    {NN_vpandq,  RO_AND,  RT_BITS,  false, false},
+    {NN_vpor,    RO_OR,   RT_BITS,  false, false},
+    {NN_vpord,   RO_OR,   RT_BITS,  false, false},
+    {NN_vporq,   RO_OR,   RT_BITS,  false, false},
+};
+
+const combine_t *find_combine(uint16 itype) {
+    for (const combine_t &c : g_combines)
+        if (c.itype == itype)
+            return &c;
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Lane simulation
+//-----------------------------------------------------------------------------
+
+// Bit i set: source lane i (32-bit) was folded in. 0 means unknown.
+typedef uint16 lane_t;
+const int MAX_LANES = 16;
+
+struct vreg_t {
+    lane_t l[MAX_LANES];
+};
+
+struct red_sim_t {
+    vreg_t regs[32];
+    bool have_op;
+    red_op_t op;
+    red_ty_t ty;
+    int last_dst;       // destination register of the last combine step
+
+    bool read(const op_t &x, vreg_t *out) const {
+        int w;
+        int idx = idiom_vec_index(x, &w);
+        if (idx < 0)
+            return false;
+        *out = regs[idx];
+        for (int i = w / 4; i < MAX_LANES; i++)
+            out->l[i] = 0;
+        return true;
+    }
+
+    // VEX/EVEX writes zero everything above the destination width
+    bool write(const op_t &x, const vreg_t &v) {
+        int w;
+        int idx = idiom_vec_index(x, &w);
+        if (idx < 0)
+            return false;
+        regs[idx] = v;
+        for (int i = w / 4; i < MAX_LANES; i++)
+            regs[idx].l[i] = 0;
+        return true;
+    }
+};
+
+bool idempotent(red_op_t op) { return op != RO_ADD; }
+
+lane_t fold(red_op_t op, lane_t a, lane_t b) {
+    if (a == 0 || b == 0)
+        return 0;
+    if ((a & b) != 0 && !idempotent(op))
+        return 0;
+    return a | b;
+}
+
+// A 64-bit element is a (lo, hi) lane pair holding the same source elements.
+bool pair_ok(lane_t lo, lane_t hi) { return lo != 0 && (lo & 0xAAAA) == 0 && hi == (lane_t) (lo << 1); }
+
+bool sim_combine(red_sim_t &s, const insn_t &insn, const combine_t &c) {
+    if (s.have_op && (s.op != c.op || (s.ty != c.ty && s.ty != RT_BITS && c.ty != RT_BITS)))
+        return false;
+    if (!s.have_op || s.ty == RT_BITS) {
+        s.op = c.op;
+        s.ty = c.ty;
+        s.have_op = true;
+    }
+
+    vreg_t a, b, d;
+    if (!s.read(insn.Op2, &a) || !s.read(insn.Op3, &b))
+        return false;
+    int w;
+    if (idiom_vec_index(insn.Op1, &w) < 0)
+        return false;
+    int lanes = w / 4;
+    bool wide = c.ty == RT_PD || c.ty == RT_EPI64;
+    memset(&d, 0, sizeof(d));
+
+    if (c.hadd) {
+        // Pairs within each 128-bit lane: dst = {a0+a1, a2+a3, b0+b1, b2+b3}
+        for (int base = 0; base < lanes; base += 4) {
+            if (wide) {
+                for (int k = 0; k < 2; k++) {
+                    const vreg_t &src = k == 0 ? a : b;
+                    if (!pair_ok(src.l[base], src.l[base + 1]) || !pair_ok(src.l[base + 2], src.l[base + 3]))
+                        return false;
+                    d.l[base + 2 * k] = fold(c.op, src.l[base], src.l[base + 2]);
+                    d.l[base + 2 * k + 1] = fold(c.op, src.l[base + 1], src.l[base + 3]);
+                }
+            } else {
+                d.l[base + 0] = fold(c.op, a.l[base + 0], a.l[base + 1]);
+                d.l[base + 1] = fold(c.op, a.l[base + 2], a.l[base + 3]);
+                d.l[base + 2] = fold(c.op, b.l[base + 0], b.l[base + 1]);
+                d.l[base + 3] = fold(c.op, b.l[base + 2], b.l[base + 3]);
+            }
+        }
+    } else {
+        int n = c.scalar ? (wide ? 2 : 1) : lanes;
+        for (int i = 0; i < n; i++) {
+            if (wide && (i & 1) == 0 && a.l[i] != 0 && b.l[i] != 0 &&
+                (!pair_ok(a.l[i], a.l[i + 1]) || !pair_ok(b.l[i], b.l[i + 1])))
+                return false;
+            d.l[i] = fold(c.op, a.l[i], b.l[i]);
+        }
+        // Scalar forms pass the upper lanes of the first source through
+        for (int i = n; c.scalar && i < 4; i++)
+            d.l[i] = a.l[i];
+    }
+    s.last_dst = idiom_vec_index(insn.Op1, &w);
+    return s.write(insn.Op1, d);
+}
+
+// In-lane shuffles and half extracts that move partial results around.
+bool sim_shuffle(red_sim_t &s, const insn_t &insn) {
+    vreg_t a, b, d;
+    memset(&d, 0, sizeof(d));
+    int w;
+    if (idiom_vec_index(insn.Op1, &w) < 0 || !s.read(insn.Op2, &a))
+        return false;
+    uint64 imm;
+    switch (insn.itype) {
+        case NN_vextractf128:
+        case NN_vextracti128:
+        case NN_vextractf32x4:
+        case NN_vextracti32x4:
+        case NN_vextractf64x2:
+        case NN_vextracti64x2:
+        case NN_vextractf64x4:
+        case NN_vextracti64x4:
+        case NN_vextractf32x8:
+        case NN_vextracti32x8: {
+            if (insn.Op3.type != o_imm)
+                return false;
+            int n = w / 4;
+            if ((insn.Op3.value + 1) * n > MAX_LANES)
+                return false;
+            for (int i = 0; i < n; i++)
+                d.l[i] = a.l[(int) insn.Op3.value * n + i];
+            break;
+        }
+        case NN_vmovhlps:
+            if (!s.read(insn.Op3, &b))
+                return false;
+            d.l[0] = b.l[2]; d.l[1] = b.l[3]; d.l[2] = a.l[2]; d.l[3] = a.l[3];
+            break;
+        case NN_vunpckhpd:
+        case NN_vpunpckhqdq:
+            if (!s.read(insn.Op3, &b))
+                return false;
+            d.l[0] = a.l[2]; d.l[1] = a.l[3]; d.l[2] = b.l[2]; d.l[3] = b.l[3];
+            break;
+        case NN_vmovshdup:
+            d.l[0] = d.l[1] = a.l[1];
+            d.l[2] = d.l[3] = a.l[3];
+            break;
+        case NN_vpermilpd:
+            if (insn.Op3.type != o_imm)
+                return false;
+            imm = insn.Op3.value;
+            for (int k = 0; k < 2; k++) {
+                int src = (int) ((imm >> k) & 1) * 2;
+                d.l[2 * k] = a.l[src];
+                d.l[2 * k + 1] = a.l[src + 1];
+            }
+            break;
+        case NN_vshufpd:
+            if (!s.read(insn.Op3, &b) || insn.Op4.type != o_imm)
+                return false;
+            imm = insn.Op4.value;
+            d.l[0] = a.l[(imm & 1) * 2];
+            d.l[1] = a.l[(imm & 1) * 2 + 1];
+            d.l[2] = b.l[((imm >> 1) & 1) * 2];
+            d.l[3] = b.l[((imm >> 1) & 1) * 2 + 1];
+            break;
+        case NN_vpermilps:
+        case NN_vpshufd:
+            if (insn.Op3.type != o_imm)
+                return false;
+            imm = insn.Op3.value;
+            for (int i = 0; i < 4; i++)
+                d.l[i] = a.l[(imm >> (2 * i)) & 3];
+            break;
+        case NN_vshufps:
+            if (!s.read(insn.Op3, &b) || insn.Op4.type != o_imm)
+                return false;
+            imm = insn.Op4.value;
+            d.l[0] = a.l[imm & 3];
+            d.l[1] = a.l[(imm >> 2) & 3];
+            d.l[2] = b.l[(imm >> 4) & 3];
+            d.l[3] = b.l[(imm >> 6) & 3];
+            break;
+        case NN_vpsrldq:
+            if (insn.Op3.type != o_imm || (insn.Op3.value & 3) != 0)
+                return false;
+            for (int i = 0; i + (int) (insn.Op3.value / 4) < 4; i++)
+                d.l[i] = a.l[i + insn.Op3.value / 4];
+            break;
+        case NN_vpsrlq:
+            if (insn.Op3.type != o_imm || insn.Op3.value != 32)
+                return false;
+            d.l[0] = a.l[1];
+            d.l[2] = a.l[3];
+            break;
+        default:
+            return false;
+    }
+    // Only the extracts move data across 128-bit lanes; the in-lane forms
+    // are modeled at xmm width.
+    if (w > XMM_SIZE && insn.itype != NN_vextractf64x4 && insn.itype != NN_vextracti64x4 &&
+        insn.itype != NN_vextractf32x8 && insn.itype != NN_vextracti32x8)
+        return false;
+    return s.write(insn.Op1, d);
+}
+
+//-----------------------------------------------------------------------------
+// Liveness of the result's upper lanes
+//-----------------------------------------------------------------------------
+
+// Bytes of vector operand `n` that `insn` reads when that is only the low
+// element (scalar stores, moves, conversions, compares and the second source
+// of ss/sd arithmetic); 0 if it may read more of the register.
+int low_read_bytes(const insn_t &insn, int n) {
+    if (has_opmask(insn))
+        return 0;
+    bool store = insn.Op1.type != o_reg;
+    switch (insn.itype) {
+        case NN_vmovss:
+            return (store && n == 1) || n == 2 ? FLOAT_SIZE : 0;
+        case NN_vmovsd:
+            return (store && n == 1) || n == 2 ? DOUBLE_SIZE : 0;
+        case NN_vmovd:
+            return n == 1 ? 4 : 0;
+        case NN_vmovq:
+            return n == 1 ? 8 : 0;
+        case NN_vaddss: case NN_vsubss: case NN_vmulss: case NN_vdivss:
+        case NN_vminss: case NN_vmaxss: case NN_vsqrtss: case NN_vcvtss2sd:
+            return n == 2 ? FLOAT_SIZE : 0;
+        case NN_vaddsd: case NN_vsubsd: case NN_vmulsd: case NN_vdivsd:
+        case NN_vminsd: case NN_vmaxsd: case NN_vsqrtsd: case NN_vcvtsd2ss:
+            return n == 2 ? DOUBLE_SIZE : 0;
+        case NN_vcvtss2si: case NN_vcvttss2si:
+            return n == 1 ? FLOAT_SIZE : 0;
+        case NN_vcvtsd2si: case NN_vcvttsd2si:
+            return n == 1 ? DOUBLE_SIZE : 0;
+        case NN_vucomiss: case NN_vcomiss:
+            return n <= 1 ? FLOAT_SIZE : 0;
+        case NN_vucomisd: case NN_vcomisd:
+            return n <= 1 ? DOUBLE_SIZE : 0;
+        default:
+            return 0;
+    }
+}
+
+// The function holding `ea` is declared to return a non-vector value, so a
+// return leaves only the low element of xmm0/xmm1 to the caller
+bool returns_scalar(ea_t ea) {
+    func_t *pfn = get_func(ea);
+    tinfo_t tif;
+    return pfn != nullptr && get_tinfo(&tif, pfn->start_ea) && tif.is_func() && tif.get_rettype().is_scalar();
+}
+
+// Scan forward from `ea`: vector register `reg` is read no further than its
+// low `elem` bytes before a VEX/EVEX instruction writes all of it. Gives up
+// (returns false) on legacy SSE forms, branches, calls and after a bounded
+// number of instructions.
+bool upper_lanes_dead_after(ea_t ea, int reg, int elem, const range_t &chunk) {
+    const int MAX_SCAN = 32;
+    for (int n = 0; n < MAX_SCAN && ea < chunk.end_ea; n++) {
+        insn_t insn;
+        if (decode_insn(&insn, ea) <= 0)
+            return false;
+        if (insn.itype == NN_vzeroall)
+            return true;
+        if (is_ret_insn(insn))
+            return reg > 1 || returns_scalar(ea);
+        uint32 feat = insn.get_canon_feature(PH);
+        if (is_call_insn(insn) || (feat & CF_STOP) != 0 || (feat & CF_JUMP) != 0 || is_basic_block_end(insn, false))
+            return false;
+        if (is_gather_insn(insn.itype) || is_scatter_insn(insn.itype))
+            return false;
+        const char *nm = PH.get_canon_mnem(insn.itype);
+        bool vex = nm != nullptr && nm[0] == 'v';
+        bool written = false;
+        for (int i = 0; i < 4; i++) {
+            int w = 0;
+            if (!is_vector_reg(insn.ops[i]))
+                continue;
+            // Legacy forms keep the bits above 128 and may read xmm0 implicitly
+            if (!vex)
+                return false;
+            if (idiom_vec_index(insn.ops[i], &w) != reg)
+                continue;
+            if (has_cf_use(feat, i)) {
+                int b = low_read_bytes(insn, i);
+                if (b == 0 || b > elem)
+                    return false;
+            }
+            written |= has_cf_chg(feat, i);
+        }
+        if (written)
+            return !has_opmask(insn) || is_zero_masking(insn);
+        ea = insn.ea + insn.size;
+    }
+    return false;
+}
+
+// Emitter parameters handed over from the check through idiom_match_t::aux
+enum { AUX_OP, AUX_TYPE, AUX_DST, AUX_SRC_WIDTH };
+
+bool check_reduction(idiom_match_t &m) {
+    red_sim_t s;
+    memset(&s, 0, sizeof(s));
+    s.last_dst = -1;
+    int src_width = m.width[0];
+    for (int i = 0; i < src_width / 4; i++)
+        s.regs[m.reg[0]].l[i] = (lane_t) (1u << i);
+
+    for (int st = 0; st < m.nsteps; st++) {
+        const insn_t &insn = *m.insns[st];
+        const combine_t *c = find_combine(insn.itype);
+        bool ok = c != nullptr ? sim_combine(s, insn, *c) : sim_shuffle(s, insn);
+        if (!ok)
+            return false;
+    }
+    // The window ends on the combine that completes the reduction
+    if (find_combine(m.insns[m.nsteps - 1]->itype) == nullptr || s.last_dst < 0)
+        return false;
+
+    lane_t all = (lane_t) ((1u << (src_width / 4)) - 1);
+    const vreg_t &f = s.regs[s.last_dst];
+    red_ty_t ty = s.ty;
+    bool full32 = f.l[0] == all;
+    bool full64 = f.l[0] == (all & 0x5555) && f.l[1] == (all & 0xAAAA);
+    if (ty == RT_BITS)
+        ty = full32 ? RT_EPI32 : RT_EPI64;
+    bool wide = ty == RT_PD || ty == RT_EPI64;
+    if (wide ? !full64 : !full32)
+        return false;
+    // The emitter splats the result, so whatever else the window left in the
+    // destination must go unread
+    func_t *chunk = get_fchunk(m.start_ea);
+    if (chunk == nullptr || !upper_lanes_dead_after(m.end_ea, s.last_dst, wide ? 8 : 4, *chunk))
+        return false;
+
+    m.aux[AUX_OP] = s.op;
+    m.aux[AUX_TYPE] = ty;
+    m.aux[AUX_DST] = s.last_dst;
+    m.aux[AUX_SRC_WIDTH] = src_width;
+    m.live_regs = 1u << s.last_dst;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Emission
+//-----------------------------------------------------------------------------
+
+merror_t emit_reduction(codegen_t &cdg, const idiom_match_t &m) {
+    static const char *const op_names[] = {"add", "min", "max", "min", "max", "and", "or"};
+    red_op_t op = (red_op_t) m.aux[AUX_OP];
+    red_ty_t ty = (red_ty_t) m.aux[AUX_TYPE];
+    int dst = m.aux[AUX_DST];
+    int width = m.aux[AUX_SRC_WIDTH];
+    bool is_unsigned = op == RO_MINU || op == RO_MAXU;
+    bool is_int = ty != RT_PS && ty != RT_PD;
+
+    const char *sfx;
+    type_t bt;
+    switch (ty) {
+        case RT_PS:    sfx = "ps"; bt = BTF_FLOAT; break;
+        case RT_PD:    sfx = "pd"; bt = BTF_DOUBLE; break;
+        case RT_EPI64: sfx = is_unsigned ? "epu64" : "epi64"; bt = is_unsigned ? BTF_UINT64 : BTF_INT64; break;
+        default:       sfx = is_unsigned ? "epu32" : "epi32"; bt = is_unsigned ? BTF_UINT32 : BTF_INT32; break;
+    }
+    tinfo_t et(bt);
+    int elem = (int) et.get_size();
+
+    mreg_t d = vreg_mreg(dst, XMM_SIZE);
+    if (d == mr_none)
+        return MERR_INSN;
+
+    // 256-bit source: widen to the 512-bit operand the reduce intrinsic takes
+    tinfo_t vt = get_vector_type(width, is_int, ty == RT_PD);
+    tinfo_t zt = get_vector_type(ZMM_SIZE, is_int, ty == RT_PD);
+    mreg_t src = mr_none;
+    if (width == YMM_SIZE) {
+        const char *widen;
+        if (op == RO_ADD)
+            widen = ty == RT_PS ? "_mm512_zextps256_ps512" : (ty == RT_PD ? "_mm512_zextpd256_pd512" : "_mm512_zextsi256_si512");
+        else
+            widen = ty == RT_PS ? "_mm512_broadcast_f32x8" : (ty == RT_PD ? "_mm512_broadcast_f64x4" : "_mm512_broadcast_i64x4");
+        src = kreg_alloc(cdg, ZMM_SIZE, false);
+        if (src == mr_none)
+            return MERR_INSN;
+        AVXIntrinsic wcall(&cdg, widen);
+        if (!idiom_add_var_arg(cdg, wcall, m, 0, width, vt))
+            return MERR_INSN;
+        wcall.set_return_reg(src, zt);
+        if (wcall.emit() == nullptr)
+            return MERR_INSN;
+    }
+
+    mreg_t scalar = kreg_alloc(cdg, elem, false);
+    if (scalar == mr_none)
+        return MERR_INSN;
+    qstring iname;
+    iname.sprnt("_mm512_reduce_%s_%s", op_names[op], sfx);
+    AVXIntrinsic icall(&cdg, iname.c_str());
+    if (src != mr_none)
+        icall.add_argument_reg(src, zt);
+    else if (!idiom_add_var_arg(cdg, icall, m, 0, width, vt))
+        return MERR_INSN;
+    icall.set_return_reg(scalar, et);
+    if (icall.emit() == nullptr)
+        return MERR_INSN;
+
+    qstring sname;
+    sname.sprnt("_mm_set1_%s", is_int ? get_set_epi_suffix(XMM_SIZE, elem) : sfx);
+    AVXIntrinsic scall(&cdg, sname.c_str());
+    scall.add_argument_reg(scalar, et);
+    scall.set_return_reg(d, get_vector_type(XMM_SIZE, is_int, ty == RT_PD));
+    if (scall.emit() == nullptr)
+        return MERR_INSN;
+    DEBUG_LOG("%a: %s over %d steps (%d-byte result)", cdg.insn.ea, iname.c_str(), m.nsteps, elem);
+    return MERR_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Registration
+//-----------------------------------------------------------------------------
+
+const char *const STEP_MNEMS =
+    "vaddps|vaddpd|vaddss|vaddsd|vhaddps|vhaddpd|vminps|vminpd|vminss|vminsd|vmaxps|vmaxpd|vmaxss|vmaxsd|"
+    "vpaddd|vpaddq|vphaddd|vpminsd|vpminsq|vpmaxsd|vpmaxsq|vpminud|vpminuq|vpmaxud|vpmaxuq|"
+    "vpand|vpandd|vpandq|vpor|vpord|vporq|"
+    "vextractf128|vextracti128|vextractf32x4|vextracti32x4|vextractf64x2|vextracti64x2|"
+    "vmovhlps|vunpckhpd|vpunpckhqdq|vmovshdup|vpermilpd|vshufpd|vpermilps|vpshufd|vshufps|vpsrldq|vpsrlq";
+
+// The first step extracts the upper half of the source (variable 0); the
+// remaining steps are free-form and validated by check_reduction(). Shorter
+// windows are registered first so the match ends at the completing combine.
+struct reduce_registrar_t {
+    reduce_registrar_t() {
+        static std::deque<std::string> patterns;
+        static const struct {
+            const char *name;
+            const char *head;
+            int min_steps;
+            int max_steps;
+        } shapes[] = {
+            {"reduce256", "vextractf128|vextracti128|vextractf32x4|vextracti32x4|vextractf64x2|vextracti64x2 *, %0.y, #1", 2, 7},
+            {"reduce512", "vextractf64x4|vextracti64x4|vextractf32x8|vextracti32x8 *, %0.z, #1", 4, 11},
+        };
+        for (const auto &sh : shapes) {
+            for (int n = sh.min_steps; n <= sh.max_steps; n++) {
+                std::string p = sh.head;
+                for (int i = 0; i < n; i++) {
+                    p += "\n";
+                    p += STEP_MNEMS;
+                    p += " ?, ?, ?, ?";
+                }
+                patterns.push_back(p);
+                idiom_t d = {sh.name, patterns.back().c_str(), 0, emit_reduction, check_reduction};
+                idiom_registry_t::register_idiom(d);
+            }
+        }
+    }
+};
+
+reduce_registrar_t g_reduce_registrar;
+
+} // namespace
+
+#endif // IDA_SDK_VERSION >= 750
@@ -0,0 +1,211 @@
+/*
+ Batch Decompilation Records
+*/
+
+#include "batch_decompile.h"
+
+#include "../common/warn_off.h"
+#include <ida.hpp>
+#include <bytes.hpp>
+#include <funcs.hpp>
+#include <lines.hpp>
+#include <xref.hpp>
+#include "../common/warn_on.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "../scan/vex_scanner.h"
+
+namespace {
+
+// VEX/EVEX instructions among the heads of `pfn`, and how many are 512-bit.
+void count_vector_insns(func_t *pfn, int *vec, int *zmm) {
+    bool is64 = inf_is_64bit();
+    *vec = 0;
+    *zmm = 0;
+    func_item_iterator_t fii;
+    for (bool ok = fii.set(pfn); ok; ok = fii.next_code()) {
+        ea_t ea = fii.current();
+        uint8 buf[16];
+        asize_t size = get_item_size(ea);
+        ssize_t n = get_bytes(buf, qmin(size, (asize_t) sizeof(buf)), ea);
+        // Lead byte after at most two legacy prefixes, as the scanner accepts.
+        for (int skip = 0; skip <= 2 && skip < n; skip++) {
+            uint8 flags = 0;
+            int len = vex_insn_length(buf + skip, size_t(n - skip), is64, &flags);
+            if (len != 0 && skip + len == (int) size) {
+                (*vec)++;
+                if ((flags & VEXC_ZMM) != 0)
+                    (*zmm)++;
+                break;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void json_str(std::string *out, const char *s) {
+    out->push_back('"');
+    for (; *s != '\0'; s++) {
+        uchar c = (uchar) *s;
+        switch (c) {
+            case '"':  out->append("\\\""); break;
+            case '\\': out->append("\\\\"); break;
+            case '\n': out->append("\\n"); break;
+            case '\r': out->append("\\r"); break;
+            case '\t': out->append("\\t"); break;
+            default:
+                if (c < 0x20) {
+                    char esc[8];
+                    qsnprintf(esc, sizeof(esc), "\\u%04x", c);
+                    out->append(esc);
+                } else {
+                    out->push_back((char) c);
+                }
+                break;
+        }
+    }
+    out->push_back('"');
+}
+
+void json_key(std::string *out, const char *key) {
+    out->append(out->size() > 1 ? ",\"" : "\"");
+    out->append(key);
+    out->append("\":");
+}
+
+void json_ea(std::string *out, const char *key, ea_t ea) {
+    char buf[32];
+    qsnprintf(buf, sizeof(buf), "\"0x%llx\"", (unsigned long long) ea);
+    json_key(out, key);
+    out->append(buf);
+}
+
+void json_int(std::string *out, const char *key, long long v) {
+    char buf[32];
+    qsnprintf(buf, sizeof(buf), "%lld", v);
+    json_key(out, key);
+    out->append(buf);
+}
+
+int parse_interr(const char *text) {
+    static const char *const markers[] = { "INTERR", "nternal error" };
+    int found = 0;
+    for (const char *m : markers) {
+        for (const char *p = std::strstr(text, m); p != nullptr; p = std::strstr(p + 1, m)) {
+            const char *q = p + std::strlen(m);
+            while (*q == ' ' || *q == ':')
+                q++;
+            if (*q >= '0' && *q <= '9')
+                found = std::atoi(q);
+        }
+    }
+    return found;
+}
+
+batch_status_t decompile_record(std::string *out, ea_t ea) {
+    std::string &rec = *out;
+    rec = "{";
+    json_ea(&rec, "ea", ea);
+
+    func_t *pfn = get_func(ea);
+    if (pfn == nullptr) {
+        json_key(&rec, "status");
+        json_str(&rec, "nofunc");
+        rec.append("}\n");
+        return BATCH_NOFUNC;
+    }
+
+    qstring name;
+    get_func_name(&name, pfn->start_ea);
+    json_key(&rec, "name");
+    json_str(&rec, name.c_str());
+
+    int vec, zmm;
+    count_vector_insns(pfn, &vec, &zmm);
+
+    hexrays_failure_t hf;
+    auto t0 = std::chrono::steady_clock::now();
+    cfuncptr_t cf = decompile(pfn, &hf, DECOMP_NO_WAIT | DECOMP_NO_CACHE);
+    auto t1 = std::chrono::steady_clock::now();
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+
+    bool interr = hf.code == MERR_INTERR;
+    json_key(&rec, "status");
+    json_str(&rec, cf != nullptr ? "ok" : interr ? "interr" : "error");
+    json_int(&rec, "vector_insns", vec);
+    json_int(&rec, "zmm_insns", zmm);
+    json_int(&rec, "time_us", us);
+
+    if (cf == nullptr) {
+        json_key(&rec, "error");
+        json_str(&rec, hf.desc().c_str());
+        json_ea(&rec, "error_ea", hf.errea);
+        if (interr) {
+            int n = std::atoi(hf.str.c_str());
+            json_int(&rec, "interr", n != 0 ? n : parse_interr(hf.desc().c_str()));
+        }
+    } else {
+        // Vector instructions the lifter left to IDA show up as __asm blocks.
+        const strvec_t &sv = cf->get_pseudocode();
+        std::string code;
+        int asms = 0;
+        code.push_back('[');
+        for (size_t i = 0; i < sv.size(); i++) {
+            qstring line;
+            tag_remove(&line, sv[i].line);
+            if (line.find("__asm") != qstring::npos)
+                asms++;
+            if (i != 0)
+                code.push_back(',');
+            json_str(&code, line.c_str());
+        }
+        code.push_back(']');
+        json_int(&rec, "asm_blocks", asms);
+        json_int(&rec, "warnings", (long long) cf->get_warnings().size());
+        json_int(&rec, "lines", (long long) sv.size());
+        json_key(&rec, "pseudocode");
+        rec.append(code);
+    }
+    rec.append("}\n");
+    return cf != nullptr ? BATCH_OK : interr ? BATCH_INTERR : BATCH_ERROR;
+}
+
+void select_funcs(std::vector<batch_item_t> *out, bool all_funcs, size_t *nvec) {
+    vex_index_t index;
+    vex_index_build(&index);
+
+    eavec_t picked = index.funcs;
+    for (ea_t f : index.zmm_funcs) {
+        xrefblk_t xb;
+        for (bool ok = xb.first_to(f, XREF_FAR); ok; ok = xb.next_to()) {
+            func_t *caller = xb.iscode ? get_func(xb.from) : nullptr;
+            if (caller != nullptr)
+                picked.push_back(caller->start_ea);
+        }
+    }
+    std::sort(picked.begin(), picked.end());
+    picked.erase(std::unique(picked.begin(), picked.end()), picked.end());
+    *nvec = picked.size();
+
+    if (all_funcs) {
+        picked.clear();
+        for (size_t i = 0; i < get_func_qty(); i++) {
+            func_t *pfn = getn_func(i);
+            if (pfn != nullptr)
+                picked.push_back(pfn->start_ea);
+        }
+    }
+
+    out->clear();
+    for (ea_t ea : picked) {
+        batch_item_t it;
+        it.ea = ea;
+        it.zmm = std::binary_search(index.zmm_funcs.begin(), index.zmm_funcs.end(), ea);
+        out->push_back(it);
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ Batch Decompilation Records
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#include <string>
+#include <vector>
+
+#include "batch_queue.h"
+
+// What lifter_batch and lifter_server report per function: one JSON object
+// per line, built here so both tools stream the same format.
+//
+//   {"ea":"0x1000","name":"f","status":"ok","vector_insns":12,"zmm_insns":0,
+//    "time_us":840,"asm_blocks":0,"warnings":0,"lines":9,"pseudocode":[...]}
+//
+// A failure has "error", "error_ea" and, for internal errors, "interr" in
+// place of the pseudocode fields. Tools add "crash" records of their own.
+
+void json_str(std::string *out, const char *s);
+// Members of the object being built in `out`, which starts with "{".
+void json_key(std::string *out, const char *key);
+void json_ea(std::string *out, const char *key, ea_t ea);
+void json_int(std::string *out, const char *key, long long v);
+
+// Internal error number in a message such as "INTERR 50920" or "internal
+// error 50920", or 0.
+int parse_interr(const char *text);
+
+enum batch_status_t {
+    BATCH_OK,
+    BATCH_ERROR,    // decompilation failed
+    BATCH_INTERR,   // the decompiler stopped on an internal error
+    BATCH_NOFUNC,   // no function at the address
+};
+
+// Decompile the function at `ea` and set `rec` to its record, newline
+// included.
+batch_status_t decompile_record(std::string *rec, ea_t ea);
+
+// Functions of the current database the AVX lifter has work in: those the
+// vector index flags plus callers of 512-bit code (their calls pass zmm
+// arguments), sorted. With `all_funcs`, every function instead. `nvec`
+// receives the size of the vector selection either way.
+void select_funcs(std::vector<batch_item_t> *out, bool all_funcs, size_t *nvec);
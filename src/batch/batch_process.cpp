@@ -0,0 +1,108 @@
+/*
+ Batch Worker Processes
+*/
+
+#include "batch_process.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <algorithm>
+#include <cerrno>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+#ifdef _WIN32
+namespace {
+
+std::string quote_arg(const std::string &a) {
+    if (!a.empty() && a.find_first_of(" \t\"") == std::string::npos)
+        return a;
+    std::string q = "\"";
+    size_t slashes = 0;
+    for (char c : a) {
+        if (c == '\\') {
+            slashes++;
+            continue;
+        }
+        q.append(c == '"' ? slashes * 2 + 1 : slashes, '\\');
+        slashes = 0;
+        q.push_back(c);
+    }
+    q.append(slashes * 2, '\\');
+    q.push_back('"');
+    return q;
+}
+
+} // namespace
+
+proc_t spawn_process(const std::vector<std::string> &args) {
+    char exe[MAX_PATH];
+    if (GetModuleFileNameA(nullptr, exe, sizeof(exe)) == 0)
+        return NO_PROC;
+    std::string cmdline;
+    for (const std::string &a : args)
+        cmdline.append(cmdline.empty() ? "" : " ").append(quote_arg(a));
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    if (!CreateProcessA(exe, &cmdline[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &si, &pi))
+        return NO_PROC;
+    CloseHandle(pi.hThread);
+    return pi.hProcess;
+}
+
+int wait_any(const std::vector<proc_t> &procs, int *code) {
+    std::vector<HANDLE> live;
+    std::vector<int> idx;
+    for (size_t i = 0; i < procs.size(); i++) {
+        if (procs[i] != NO_PROC) {
+            live.push_back(procs[i]);
+            idx.push_back((int) i);
+        }
+    }
+    if (live.empty())
+        return -1;
+    DWORD r = WaitForMultipleObjects((DWORD) live.size(), live.data(), FALSE, INFINITE);
+    if (r >= WAIT_OBJECT_0 + live.size())
+        return -1;
+    DWORD exit_code = 0;
+    GetExitCodeProcess(live[r - WAIT_OBJECT_0], &exit_code);
+    CloseHandle(live[r - WAIT_OBJECT_0]);
+    *code = (int) exit_code;
+    return idx[r - WAIT_OBJECT_0];
+}
+#else
+proc_t spawn_process(const std::vector<std::string> &args) {
+    std::vector<char *> argv;
+    for (const std::string &a : args)
+        argv.push_back(const_cast<char *>(a.c_str()));
+    argv.push_back(nullptr);
+    pid_t pid;
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0)
+        return NO_PROC;
+    return pid;
+}
+
+int wait_any(const std::vector<proc_t> &procs, int *code) {
+    if (std::all_of(procs.begin(), procs.end(), [](proc_t p) { return p == NO_PROC; }))
+        return -1;
+    for (;;) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        for (size_t i = 0; i < procs.size(); i++) {
+            if (procs[i] == pid) {
+                *code = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+                return (int) i;
+            }
+        }
+    }
+}
+#endif
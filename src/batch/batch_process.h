@@ -0,0 +1,28 @@
+/*
+ Batch Worker Processes
+*/
+
+#pragma once
+
+// No IDA headers: process control for the supervisors of lifter_batch and
+// lifter_server, which restart workers the decompiler took down.
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+typedef void *proc_t;   // process HANDLE
+const proc_t NO_PROC = nullptr;
+#else
+#include <sys/types.h>
+typedef pid_t proc_t;
+const proc_t NO_PROC = -1;
+#endif
+
+// Start this program again with `args` (args[0] is the program as invoked).
+// Returns NO_PROC on failure. The child inherits open descriptors.
+proc_t spawn_process(const std::vector<std::string> &args);
+
+// Wait for one of the running `procs` (NO_PROC entries are skipped) to exit;
+// returns its index and sets `code` to its exit status, or on POSIX to minus
+// the signal that killed it. Returns -1 if there is nothing to wait for.
+int wait_any(const std::vector<proc_t> &procs, int *code);
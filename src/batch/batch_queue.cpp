@@ -0,0 +1,118 @@
+/*
+ Batch Work Queue
+*/
+
+#include "batch_queue.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+namespace {
+
+// "<16 hex digits> <z|->\n": fixed width, so a shard is one seek and read.
+const size_t RECORD_SIZE = 19;
+
+} // namespace
+
+std::string batch_queue_t::path(const char *name) const {
+    return (std::filesystem::path(dir) / name).string();
+}
+
+std::string batch_queue_t::path(const char *name, int idx) const {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%s.%d", name, idx);
+    return path(buf);
+}
+
+bool batch_queue_t::create(const std::vector<batch_item_t> &items) const {
+    FILE *fp = std::fopen(path("queue").c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+    bool ok = true;
+    for (const batch_item_t &it : items) {
+        char rec[RECORD_SIZE + 1];
+        std::snprintf(rec, sizeof(rec), "%016llx %c\n",
+                      (unsigned long long) it.ea, it.zmm ? 'z' : '-');
+        ok &= std::fwrite(rec, 1, RECORD_SIZE, fp) == RECORD_SIZE;
+    }
+    ok &= std::fclose(fp) == 0;
+    return ok;
+}
+
+size_t batch_queue_t::item_count() const {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path("queue"), ec);
+    return ec ? 0 : size_t(size / RECORD_SIZE);
+}
+
+int batch_queue_t::shard_count() const {
+    return int((item_count() + shard_size - 1) / shard_size);
+}
+
+bool batch_queue_t::read_shard(int shard, std::vector<batch_item_t> *out) const {
+    out->clear();
+    size_t n = item_count();
+    size_t begin = size_t(shard) * shard_size;
+    if (shard < 0 || begin >= n)
+        return false;
+    size_t count = std::min(n - begin, size_t(shard_size));
+
+    FILE *fp = std::fopen(path("queue").c_str(), "rb");
+    if (fp == nullptr)
+        return false;
+    std::vector<char> buf(count * RECORD_SIZE);
+    bool ok = std::fseek(fp, long(begin * RECORD_SIZE), SEEK_SET) == 0
+           && std::fread(buf.data(), 1, buf.size(), fp) == buf.size();
+    std::fclose(fp);
+    if (!ok)
+        return false;
+
+    for (size_t i = 0; i < count; i++) {
+        const char *rec = &buf[i * RECORD_SIZE];
+        batch_item_t it;
+        it.ea = std::strtoull(std::string(rec, 16).c_str(), nullptr, 16);
+        it.zmm = rec[17] == 'z';
+        out->push_back(it);
+    }
+    return true;
+}
+
+bool batch_queue_t::claim(int shard) const {
+    // "x": fail if the file exists, atomically with its creation (C11)
+    FILE *fp = std::fopen(path("shard", shard).c_str(), "wx");
+    if (fp == nullptr)
+        return false;
+    std::fclose(fp);
+    return true;
+}
+
+bool batch_queue_t::write_slot(int slot, const batch_slot_state_t &st) const {
+    // Written aside and renamed over the old state, so the main process never
+    // reads a half-written one even if the worker dies mid-update.
+    std::string tmp = path("slot.tmp", slot);
+    FILE *fp = std::fopen(tmp.c_str(), "w");
+    if (fp == nullptr)
+        return false;
+    bool ok = std::fprintf(fp, "%d %d %d\n", st.shard, st.pos, st.busy ? 1 : 0) > 0;
+    ok &= std::fclose(fp) == 0;
+    std::error_code ec;
+    std::filesystem::rename(tmp, path("slot", slot), ec);
+    return ok && !ec;
+}
+
+bool batch_queue_t::read_slot(int slot, batch_slot_state_t *st) const {
+    FILE *fp = std::fopen(path("slot", slot).c_str(), "r");
+    if (fp == nullptr)
+        return false;
+    int shard, pos, busy;
+    bool ok = std::fscanf(fp, "%d %d %d", &shard, &pos, &busy) == 3;
+    std::fclose(fp);
+    if (!ok)
+        return false;
+    st->shard = shard;
+    st->pos = pos;
+    st->busy = busy != 0;
+    return true;
+}
@@ -0,0 +1,69 @@
+/*
+ Batch Work Queue
+*/
+
+#pragma once
+
+// No IDA headers: plain C++ file handling, shared by the main process and
+// the workers of lifter_batch.cpp.
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The files through which lifter_batch worker processes share one run. All of
+// them live in a work directory the main process creates:
+//
+//   queue        one fixed-width record per selected function, in address
+//                order; shard `i` is records [i*shard_size, (i+1)*shard_size)
+//   shard.<i>    created exclusively by the worker that takes shard `i`, so
+//                workers pull shards as they go instead of being handed a
+//                partition up front
+//   slot.<k>     progress of the worker in slot `k`: the shard it holds, the
+//                position in that shard, and whether that function is being
+//                decompiled right now. The main process reads it when the
+//                worker dies to resume the shard after the function at fault.
+//
+// Only plain files, exclusive creation and rename are used, so a worker that
+// crashes at any point leaves nothing locked.
+
+struct batch_item_t {
+    uint64_t ea;
+    bool zmm;   // function uses 512-bit EVEX code
+};
+
+struct batch_slot_state_t {
+    int shard = -1;     // -1: the worker has not taken a shard yet
+    int pos = 0;        // index in the shard of the next (or current) function
+    bool busy = false;  // the function at `pos` was being decompiled
+};
+
+class batch_queue_t {
+public:
+    batch_queue_t(const std::string &workdir, int per_shard)
+        : dir(workdir), shard_size(per_shard) {}
+
+    // Main process: write the queue file. Returns false on I/O failure.
+    bool create(const std::vector<batch_item_t> &items) const;
+
+    // Number of queued functions and shards, from the queue file size.
+    size_t item_count() const;
+    int shard_count() const;
+
+    // Read the records of `shard` only; the queue is never loaded whole.
+    bool read_shard(int shard, std::vector<batch_item_t> *out) const;
+
+    // Take `shard` for this worker. False if another worker already has it.
+    bool claim(int shard) const;
+
+    // Progress of worker slot `slot`. read_slot() leaves `st` untouched and
+    // returns false if the worker never wrote one.
+    bool write_slot(int slot, const batch_slot_state_t &st) const;
+    bool read_slot(int slot, batch_slot_state_t *st) const;
+
+    std::string path(const char *name) const;
+    std::string path(const char *name, int idx) const;
+
+private:
+    std::string dir;
+    int shard_size;
+};
@@ -0,0 +1,481 @@
+/*
+ Headless Batch Decompilation Driver
+*/
+
+// A standalone program: plain stdio and file descriptors are fine here.
+#define USE_STANDARD_FILE_FUNCTIONS
+
+#include "../common/warn_off.h"
+#include <idalib.hpp>
+#include <ida.hpp>
+#include <auto.hpp>
+#include <funcs.hpp>
+#include <loader.hpp>
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "batch_decompile.h"
+#include "batch_process.h"
+#include "batch_queue.h"
+
+// lifter_batch opens a database through idalib, picks the functions the AVX
+// lifter has work in (the raw-bytes VEX/EVEX index, plus callers of 512-bit
+// code), and decompiles them on N worker processes. Each worker opens its own
+// copy of the analyzed database and pulls shards off the work queue
+// (batch_queue.h) until none are left, appending one JSON line per function
+// to the output as soon as it is decompiled.
+//
+// A worker exits after the first internal error, since the decompiler state
+// is suspect from then on, and may crash outright. Either way the main
+// process restarts it at the function after the one at fault, so a bad
+// function costs one restart and never the rest of its shard.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Worker exit codes; anything else (a signal included) is a crash.
+const int EXIT_DONE = 0;
+const int EXIT_SETUP = 2;    // database or decompiler unavailable
+const int EXIT_INTERR = 3;   // stopped after an internal error
+
+// Restarts in a row that make no progress before a slot is given up.
+const int MAX_STALLS = 3;
+
+struct batch_options_t {
+    std::string self;
+    std::string input;
+    std::string output;       // JSON lines, default <input>.lifter.jsonl
+    std::string workdir;      // default <output>.work
+    std::string plugin = "lifter";
+    int jobs = 0;             // 0: one per hardware thread
+    int shard_size = 16;
+    bool all_funcs = false;
+    bool keep = false;
+    bool verbose = false;
+    // worker mode
+    int slot = -1;
+    batch_slot_state_t resume;
+};
+
+//-----------------------------------------------------------------------------
+// Output
+//-----------------------------------------------------------------------------
+
+// Append-only sink shared by every process of a run. Each record goes out in
+// a single write on a file opened for appending, so lines from concurrent
+// workers never interleave.
+class record_sink_t {
+public:
+    ~record_sink_t() { close(); }
+
+    bool open(const std::string &path, bool truncate) {
+#ifdef _WIN32
+        h = CreateFileA(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        nullptr, truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+        return h != INVALID_HANDLE_VALUE;
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0), 0644);
+        return fd >= 0;
+#endif
+    }
+
+    bool write(const std::string &rec) {
+#ifdef _WIN32
+        DWORD done = 0;
+        return h != INVALID_HANDLE_VALUE
+            && WriteFile(h, rec.data(), (DWORD) rec.size(), &done, nullptr)
+            && done == rec.size();
+#else
+        size_t off = 0;
+        while (fd >= 0 && off < rec.size()) {
+            ssize_t n = ::write(fd, rec.data() + off, rec.size() - off);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            off += (size_t) n;
+        }
+        return fd >= 0;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (h != INVALID_HANDLE_VALUE)
+            CloseHandle(h);
+        h = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE h = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+};
+
+// Last internal error a dead worker logged, from the tail of its log.
+int interr_from_log(const std::string &path) {
+    FILE *fp = std::fopen(path.c_str(), "rb");
+    if (fp == nullptr)
+        return 0;
+    std::vector<char> tail(64 * 1024 + 1);
+    std::fseek(fp, 0, SEEK_END);
+    long size = std::ftell(fp);
+    std::fseek(fp, std::max(0L, size - long(tail.size() - 1)), SEEK_SET);
+    size_t n = std::fread(tail.data(), 1, tail.size() - 1, fp);
+    std::fclose(fp);
+    tail[n] = '\0';
+    std::replace(tail.begin(), tail.begin() + n, '\0', ' ');
+    return parse_interr(tail.data());
+}
+
+//-----------------------------------------------------------------------------
+// Worker
+//-----------------------------------------------------------------------------
+
+int run_worker(const batch_options_t &opt) {
+    batch_queue_t q(opt.workdir, opt.shard_size);
+
+    // The log holds this worker's console output; the main process reads it
+    // for the internal error number if the worker dies. Truncated once, then
+    // both streams append, so neither overwrites what the other wrote.
+    std::string log = q.path("log", opt.slot);
+    if (FILE *fp = std::fopen(log.c_str(), "w"))
+        std::fclose(fp);
+    std::freopen(log.c_str(), "a", stdout);
+    std::freopen(log.c_str(), "a", stderr);
+
+    // A private copy of the database: IDA unpacks a database next to its
+    // file, so workers cannot share one. Leftovers of a crashed predecessor
+    // in this slot go first.
+    std::string prefix = "w." + std::to_string(opt.slot) + ".";
+    std::error_code ec;
+    for (const fs::directory_entry &e : fs::directory_iterator(opt.workdir, ec))
+        if (e.path().filename().string().rfind(prefix, 0) == 0)
+            fs::remove(e.path(), ec);
+    std::string db = q.path("w", opt.slot) + fs::path(opt.input).extension().string();
+    if (!fs::copy_file(opt.input, db, fs::copy_options::overwrite_existing, ec))
+        return EXIT_SETUP;
+
+    if (init_library() != 0)
+        return EXIT_SETUP;
+    enable_console_messages(true);
+    if (open_database(db.c_str(), false) != 0)
+        return EXIT_SETUP;
+    if (!opt.plugin.empty() && find_plugin(opt.plugin.c_str(), true) == nullptr) {
+        std::fprintf(stderr, "lifter_batch: plugin %s not found\n", opt.plugin.c_str());
+        close_database(false);
+        return EXIT_SETUP;
+    }
+    if (!init_hexrays_plugin()) {
+        close_database(false);
+        return EXIT_SETUP;
+    }
+
+    record_sink_t out;
+    if (!out.open(opt.output, false)) {
+        close_database(false);
+        return EXIT_SETUP;
+    }
+
+    int code = EXIT_DONE;
+    int next_shard = 0;
+    int nshards = q.shard_count();
+    batch_slot_state_t st = opt.resume;
+    std::vector<batch_item_t> items;
+    for (;;) {
+        if (st.shard < 0) {
+            while (next_shard < nshards && !q.claim(next_shard))
+                next_shard++;
+            if (next_shard >= nshards)
+                break;
+            st.shard = next_shard++;
+            st.pos = 0;
+        }
+        q.read_shard(st.shard, &items);
+        bool stop = false;
+        while (!stop && st.pos < (int) items.size()) {
+            st.busy = true;
+            q.write_slot(opt.slot, st);
+            std::string rec;
+            stop = decompile_record(&rec, (ea_t) items[st.pos].ea) == BATCH_INTERR;
+            out.write(rec);
+            st.pos++;
+            st.busy = false;
+            q.write_slot(opt.slot, st);
+        }
+        if (stop) {
+            code = EXIT_INTERR;
+            break;
+        }
+        st.shard = -1;
+        st.pos = 0;
+        q.write_slot(opt.slot, st);
+    }
+
+    out.close();
+    close_database(false);
+    fs::remove(db, ec);
+    return code;
+}
+
+//-----------------------------------------------------------------------------
+// Main process
+//-----------------------------------------------------------------------------
+
+proc_t spawn_worker(const batch_options_t &opt, const std::string &base, int slot,
+                    const batch_slot_state_t &resume) {
+    std::vector<std::string> args = {
+        opt.self,
+        "--worker", std::to_string(slot),
+        "--resume", std::to_string(resume.shard), std::to_string(resume.pos),
+        "--work", opt.workdir,
+        "-o", opt.output,
+        "-s", std::to_string(opt.shard_size),
+        "--plugin", opt.plugin,
+        base,
+    };
+    return spawn_process(args);
+}
+
+int run_main(const batch_options_t &opt) {
+    std::error_code ec;
+    if (fs::exists(opt.workdir, ec) && !fs::is_empty(opt.workdir, ec)) {
+        std::fprintf(stderr, "lifter_batch: work directory %s is not empty\n", opt.workdir.c_str());
+        return 1;
+    }
+    fs::create_directories(opt.workdir, ec);
+    if (ec) {
+        std::fprintf(stderr, "lifter_batch: cannot create %s\n", opt.workdir.c_str());
+        return 1;
+    }
+    batch_queue_t q(opt.workdir, opt.shard_size);
+
+    // Analyze once here; workers open the saved result.
+    if (init_library() != 0) {
+        std::fprintf(stderr, "lifter_batch: idalib initialization failed\n");
+        return 1;
+    }
+    enable_console_messages(opt.verbose);
+    if (open_database(opt.input.c_str(), true) != 0) {
+        std::fprintf(stderr, "lifter_batch: cannot open %s\n", opt.input.c_str());
+        return 1;
+    }
+    auto_wait();
+
+    std::vector<batch_item_t> items;
+    size_t nvec;
+    select_funcs(&items, opt.all_funcs, &nvec);
+    std::string base = q.path("base") + (inf_is_64bit() ? ".i64" : ".idb");
+    bool saved = save_database(base.c_str(), DBFL_COMP);
+    size_t nfuncs = get_func_qty();
+    close_database(false);
+    if (!saved || !q.create(items)) {
+        std::fprintf(stderr, "lifter_batch: cannot write to %s\n", opt.workdir.c_str());
+        return 1;
+    }
+
+    record_sink_t out;
+    if (!out.open(opt.output, true)) {
+        std::fprintf(stderr, "lifter_batch: cannot open %s\n", opt.output.c_str());
+        return 1;
+    }
+
+    int nshards = q.shard_count();
+    int jobs = opt.jobs > 0 ? opt.jobs : (int) std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min(jobs, nshards);
+    std::fprintf(stderr, "lifter_batch: %" FMT_Z " of %" FMT_Z " functions (%" FMT_Z " with vector code), "
+                 "%d shards, %d workers\n", items.size(), nfuncs, nvec, nshards, jobs);
+
+    std::vector<proc_t> procs(jobs, NO_PROC);
+    std::vector<batch_slot_state_t> started(jobs);
+    std::vector<int> stalls(jobs, 0);
+    int running = 0;
+
+    // Shards a slot left half done, resumed by the next slot that runs out of
+    // work; slots waiting for one
+    std::vector<batch_slot_state_t> orphans;
+    std::vector<int> idle;
+
+    auto start = [&](int k, const batch_slot_state_t &st) {
+        started[k] = st;
+        procs[k] = spawn_worker(opt, base, k, st);
+        if (procs[k] != NO_PROC)
+            running++;
+        else if (st.shard >= 0)
+            orphans.push_back(st);
+    };
+    for (int k = 0; k < jobs; k++)
+        start(k, started[k]);
+
+    int interrs = 0, crashes = 0, failed = 0;
+    std::vector<batch_item_t> shard;
+    while (running > 0) {
+        int code = 0;
+        int k = wait_any(procs, &code);
+        if (k < 0)
+            break;
+        procs[k] = NO_PROC;
+        running--;
+        if (code == EXIT_DONE) {
+            stalls[k] = 0;
+            if (orphans.empty()) {
+                idle.push_back(k);
+            } else {
+                batch_slot_state_t st = orphans.back();
+                orphans.pop_back();
+                start(k, st);
+            }
+            continue;
+        }
+
+        batch_slot_state_t st = started[k];
+        q.read_slot(k, &st);
+        bool progress = st.shard != started[k].shard || st.pos != started[k].pos || st.busy;
+        if (code == EXIT_INTERR) {
+            interrs++;
+        } else if (code != EXIT_SETUP) {
+            crashes++;
+            // Died inside the decompiler: record the function and skip it.
+            if (st.busy && q.read_shard(st.shard, &shard) && st.pos < (int) shard.size()) {
+                std::string rec = "{";
+                json_ea(&rec, "ea", (ea_t) shard[st.pos].ea);
+                json_key(&rec, "status");
+                json_str(&rec, "crash");
+                json_int(&rec, "exit", code);
+                if (int n = interr_from_log(q.path("log", k)))
+                    json_int(&rec, "interr", n);
+                rec.append("}\n");
+                out.write(rec);
+                st.pos++;
+                st.busy = false;
+            }
+        }
+
+        stalls[k] = progress ? 0 : stalls[k] + 1;
+        if (stalls[k] >= MAX_STALLS) {
+            std::fprintf(stderr, "lifter_batch: worker %d keeps failing (exit %d), see %s\n",
+                         k, code, q.path("log", k).c_str());
+            failed++;
+            // The rest of its shard goes to another slot
+            if (st.shard >= 0) {
+                st.busy = false;
+                if (idle.empty()) {
+                    orphans.push_back(st);
+                } else {
+                    int j = idle.back();
+                    idle.pop_back();
+                    start(j, st);
+                }
+            }
+            continue;
+        }
+        start(k, st);
+    }
+
+    // No slot was left to resume these, or to take the shards nobody
+    // claimed: one record per function not decompiled
+    for (int i = 0; i < nshards; i++) {
+        if (!fs::exists(q.path("shard", i), ec)) {
+            batch_slot_state_t st;
+            st.shard = i;
+            orphans.push_back(st);
+        }
+    }
+    for (const batch_slot_state_t &st : orphans) {
+        if (!q.read_shard(st.shard, &shard))
+            continue;
+        for (size_t i = st.pos; i < shard.size(); i++) {
+            std::string rec = "{";
+            json_ea(&rec, "ea", (ea_t) shard[i].ea);
+            json_key(&rec, "status");
+            json_str(&rec, "skipped");
+            rec.append("}\n");
+            out.write(rec);
+        }
+    }
+
+    std::fprintf(stderr, "lifter_batch: done, %d restarts after INTERR, %d after crashes -> %s\n",
+                 interrs, crashes, opt.output.c_str());
+    out.close();
+    if (!opt.keep && failed == 0)
+        fs::remove_all(opt.workdir, ec);
+    return failed == 0 ? 0 : 1;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: lifter_batch [options] <binary or database>\n"
+        "  -o <file>        JSON lines output (default <input>.lifter.jsonl)\n"
+        "  -j <n>           worker processes (default: one per hardware thread)\n"
+        "  -s <n>           functions per shard (default 16)\n"
+        "  --all            decompile every function, not only those with vector code\n"
+        "  --plugin <name>  plugin the workers load (default lifter, \"\" for none)\n"
+        "  --work <dir>     work directory (default <output>.work)\n"
+        "  --keep           keep the work directory\n"
+        "  -v               show IDA messages while analyzing\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    batch_options_t opt;
+    opt.self = argv[0];
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-o" && more) opt.output = argv[++i];
+        else if (a == "-j" && more) opt.jobs = std::atoi(argv[++i]);
+        else if (a == "-s" && more) opt.shard_size = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--all") opt.all_funcs = true;
+        else if (a == "--plugin" && more) opt.plugin = argv[++i];
+        else if (a == "--work" && more) opt.workdir = argv[++i];
+        else if (a == "--keep") opt.keep = true;
+        else if (a == "-v") opt.verbose = true;
+        else if (a == "--worker" && more) opt.slot = std::atoi(argv[++i]);
+        else if (a == "--resume" && i + 2 < argc) {
+            opt.resume.shard = std::atoi(argv[++i]);
+            opt.resume.pos = std::atoi(argv[++i]);
+        }
+        else if (a[0] != '-' && opt.input.empty()) opt.input = a;
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (opt.input.empty()) {
+        usage();
+        return 1;
+    }
+    if (opt.output.empty())
+        opt.output = opt.input + ".lifter.jsonl";
+    if (opt.workdir.empty())
+        opt.workdir = opt.output + ".work";
+
+    return opt.slot >= 0 ? run_worker(opt) : run_main(opt);
+}
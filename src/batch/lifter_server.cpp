@@ -0,0 +1,424 @@
+/*
+ Resident Lifting Server
+*/
+
+// A standalone program: plain stdio and file descriptors are fine here.
+#define USE_STANDARD_FILE_FUNCTIONS
+
+#include "../common/warn_off.h"
+#include <idalib.hpp>
+#include <ida.hpp>
+#include <auto.hpp>
+#include <funcs.hpp>
+#include <loader.hpp>
+#include <hexrays.hpp>
+#include "../common/warn_on.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "batch_decompile.h"
+#include "batch_process.h"
+
+// lifter_server keeps IDA, the decompiler and the lifter loaded between jobs,
+// so lifting a small binary costs its analysis and decompilation only, not a
+// fresh kernel and plugin startup as with one idump per binary.
+//
+// The main process binds a Unix socket and starts -j worker processes that
+// inherit it and each accept one connection at a time. A connection is one
+// job, a few request lines ending with the binary to lift:
+//
+//   env AVX_COV=/tmp/cov.tsv     set for this job only (any number of these)
+//   scope vector                 functions with vector code; default all
+//   lift /abs/path/to/binary
+//
+// The worker opens the binary as a fresh database in its scratch directory,
+// streams one lifter_batch record per function (batch_decompile.h), closes
+// the database without saving, and ends with
+//
+//   {"summary":true,"total":N,"ok":M,"interrs":K,"time_us":T}
+//
+// sent after the database is closed, so whatever the lifter writes at
+// teardown (AVX_COV) is on disk when the client sees it. A job that fails
+// before decompiling gets {"status":"error","error":"..."} instead.
+//
+// Workers are replaced after an internal error (decompiler state is suspect
+// from then on), after --recycle jobs, and when they crash; a crash drops the
+// connection, which is how the client learns about it.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const int EXIT_DONE = 0;     // recycled
+const int EXIT_SETUP = 2;    // idalib unavailable
+const int EXIT_INTERR = 3;   // replaced after an internal error
+
+// Setup failures in a row before the server gives up.
+const int MAX_STALLS = 3;
+
+// Longest request accepted, in bytes.
+const size_t MAX_REQUEST = 64 * 1024;
+
+struct server_options_t {
+    std::string self;
+    std::string socket_path;
+    std::string scratch;          // default <socket>.d
+    std::string plugin = "lifter";
+    int jobs = 0;                 // 0: one per hardware thread
+    int recycle = 100;            // jobs per worker process
+    bool verbose = false;
+    // worker mode
+    int listen_fd = -1;
+    int slot = -1;
+};
+
+struct job_t {
+    std::vector<std::pair<std::string, std::string>> env;
+    bool all_funcs = true;
+    std::string path;
+};
+
+bool send_all(int fd, const std::string &s) {
+    size_t off = 0;
+    while (off < s.size()) {
+        ssize_t n = ::send(fd, s.data() + off, s.size() - off, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        off += (size_t) n;
+    }
+    return true;
+}
+
+bool send_error(int fd, const std::string &what) {
+    std::string rec = "{";
+    json_key(&rec, "status");
+    json_str(&rec, "error");
+    json_key(&rec, "error");
+    json_str(&rec, what.c_str());
+    rec.append("}\n");
+    return send_all(fd, rec);
+}
+
+// Read request lines up to and including "lift <path>".
+bool read_job(int fd, job_t *job, std::string *err) {
+    std::string buf;
+    for (;;) {
+        size_t nl;
+        while ((nl = buf.find('\n')) != std::string::npos) {
+            std::string line = buf.substr(0, nl);
+            buf.erase(0, nl + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.rfind("env ", 0) == 0) {
+                size_t eq = line.find('=', 4);
+                if (eq == std::string::npos || eq == 4) {
+                    *err = "bad env line: " + line;
+                    return false;
+                }
+                job->env.emplace_back(line.substr(4, eq - 4), line.substr(eq + 1));
+            } else if (line == "scope all" || line == "scope vector") {
+                job->all_funcs = line == "scope all";
+            } else if (line.rfind("lift ", 0) == 0) {
+                job->path = line.substr(5);
+                return true;
+            } else if (!line.empty()) {
+                *err = "unknown request: " + line;
+                return false;
+            }
+        }
+        if (buf.size() > MAX_REQUEST) {
+            *err = "request too long";
+            return false;
+        }
+        char chunk[4096];
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            *err = "connection closed before a lift line";
+            return false;
+        }
+        buf.append(chunk, (size_t) n);
+    }
+}
+
+// Job environment, restored when the job is done.
+class scoped_env_t {
+public:
+    explicit scoped_env_t(const std::vector<std::pair<std::string, std::string>> &env) {
+        for (const auto &kv : env) {
+            const char *old = std::getenv(kv.first.c_str());
+            saved.push_back({ kv.first, old != nullptr ? old : "", old != nullptr });
+            setenv(kv.first.c_str(), kv.second.c_str(), 1);
+        }
+    }
+    ~scoped_env_t() {
+        for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+            if (it->was_set)
+                setenv(it->name.c_str(), it->value.c_str(), 1);
+            else
+                unsetenv(it->name.c_str());
+        }
+    }
+
+private:
+    struct var_t {
+        std::string name;
+        std::string value;
+        bool was_set;
+    };
+    std::vector<var_t> saved;
+};
+
+void clear_dir(const std::string &dir) {
+    std::error_code ec;
+    for (const fs::directory_entry &e : fs::directory_iterator(dir, ec))
+        fs::remove_all(e.path(), ec);
+}
+
+// Serve one connection. Returns true if the decompiler hit an internal error.
+bool serve_job(const server_options_t &opt, const std::string &jobdir, int conn) {
+    job_t job;
+    std::string err;
+    if (!read_job(conn, &job, &err)) {
+        send_error(conn, err);
+        return false;
+    }
+    std::error_code ec;
+    if (!fs::is_regular_file(job.path, ec)) {
+        send_error(conn, "not a file: " + job.path);
+        return false;
+    }
+
+    // IDA creates the database next to its input: link the binary into the
+    // scratch directory so jobs never touch the client's directory and a
+    // crashed job's leftovers are cleared by the next one.
+    clear_dir(jobdir);
+    std::string input = (fs::path(jobdir) / fs::path(job.path).filename()).string();
+    fs::create_symlink(fs::absolute(job.path, ec), input, ec);
+    if (ec && !fs::copy_file(job.path, input, ec)) {
+        send_error(conn, "cannot stage " + job.path);
+        return false;
+    }
+
+    scoped_env_t env(job.env);
+    auto t0 = std::chrono::steady_clock::now();
+    if (open_database(input.c_str(), true) != 0) {
+        clear_dir(jobdir);
+        send_error(conn, "cannot open " + job.path);
+        return false;
+    }
+    auto_wait();
+    if (!opt.plugin.empty() && find_plugin(opt.plugin.c_str(), true) == nullptr) {
+        close_database(false);
+        clear_dir(jobdir);
+        send_error(conn, "plugin " + opt.plugin + " not found");
+        return false;
+    }
+    if (!init_hexrays_plugin()) {
+        close_database(false);
+        clear_dir(jobdir);
+        send_error(conn, "no decompiler for " + job.path);
+        return false;
+    }
+
+    std::vector<batch_item_t> items;
+    size_t nvec;
+    select_funcs(&items, job.all_funcs, &nvec);
+
+    int ok = 0, interrs = 0;
+    bool connected = true;
+    std::string rec;
+    for (size_t i = 0; i < items.size() && connected; i++) {
+        batch_status_t bs = decompile_record(&rec, (ea_t) items[i].ea);
+        ok += bs == BATCH_OK;
+        interrs += bs == BATCH_INTERR;
+        connected = send_all(conn, rec);
+    }
+    close_database(false);
+    clear_dir(jobdir);
+
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    rec = "{\"summary\":true";
+    json_int(&rec, "total", (long long) items.size());
+    json_int(&rec, "ok", ok);
+    json_int(&rec, "interrs", interrs);
+    json_int(&rec, "time_us", us);
+    rec.append("}\n");
+    if (connected)
+        send_all(conn, rec);
+    return interrs != 0;
+}
+
+int run_worker(const server_options_t &opt) {
+    std::signal(SIGPIPE, SIG_IGN);
+    std::string jobdir = (fs::path(opt.scratch) / ("slot." + std::to_string(opt.slot))).string();
+    std::error_code ec;
+    fs::create_directories(jobdir, ec);
+
+    if (init_library() != 0)
+        return EXIT_SETUP;
+    enable_console_messages(opt.verbose);
+
+    for (int served = 0; served < opt.recycle; served++) {
+        int conn = ::accept(opt.listen_fd, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                served--;
+                continue;
+            }
+            return EXIT_SETUP;
+        }
+        bool interr = serve_job(opt, jobdir, conn);
+        ::close(conn);
+        if (interr)
+            return EXIT_INTERR;
+    }
+    return EXIT_DONE;
+}
+
+//-----------------------------------------------------------------------------
+// Main process
+//-----------------------------------------------------------------------------
+
+// For the termination handler: the workers to stop and the socket to remove.
+std::vector<proc_t> *g_procs = nullptr;
+const char *g_socket_path = nullptr;
+
+void on_terminate(int sig) {
+    if (g_procs != nullptr) {
+        for (proc_t p : *g_procs)
+            if (p != NO_PROC)
+                ::kill(p, SIGTERM);
+    }
+    if (g_socket_path != nullptr)
+        ::unlink(g_socket_path);
+    ::_exit(128 + sig);
+}
+
+proc_t spawn_worker(const server_options_t &opt, int fd, int slot) {
+    std::vector<std::string> args = {
+        opt.self,
+        "--listen-fd", std::to_string(fd),
+        "--slot", std::to_string(slot),
+        "--scratch", opt.scratch,
+        "--plugin", opt.plugin,
+        "--recycle", std::to_string(opt.recycle),
+    };
+    if (opt.verbose)
+        args.push_back("-v");
+    args.push_back(opt.socket_path);
+    return spawn_process(args);
+}
+
+int run_main(const server_options_t &opt) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (opt.socket_path.size() >= sizeof(addr.sun_path)) {
+        std::fprintf(stderr, "lifter_server: socket path too long\n");
+        return 1;
+    }
+    std::copy(opt.socket_path.begin(), opt.socket_path.end(), addr.sun_path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(opt.socket_path.c_str());
+    if (fd < 0
+     || ::bind(fd, (sockaddr *) &addr, sizeof(addr)) != 0
+     || ::listen(fd, 128) != 0) {
+        std::fprintf(stderr, "lifter_server: cannot listen on %s\n", opt.socket_path.c_str());
+        return 1;
+    }
+    std::error_code ec;
+    fs::create_directories(opt.scratch, ec);
+
+    int jobs = opt.jobs > 0 ? opt.jobs : (int) std::max(1u, std::thread::hardware_concurrency());
+    std::vector<proc_t> procs(jobs, NO_PROC);
+    g_procs = &procs;
+    g_socket_path = opt.socket_path.c_str();
+    std::signal(SIGINT, on_terminate);
+    std::signal(SIGTERM, on_terminate);
+
+    for (int k = 0; k < jobs; k++)
+        procs[k] = spawn_worker(opt, fd, k);
+    std::fprintf(stderr, "lifter_server: %d workers on %s\n", jobs, opt.socket_path.c_str());
+
+    int stalls = 0;
+    for (;;) {
+        int code = 0;
+        int k = wait_any(procs, &code);
+        if (k < 0)
+            break;
+        procs[k] = NO_PROC;
+        if (code == EXIT_SETUP) {
+            if (++stalls >= MAX_STALLS) {
+                std::fprintf(stderr, "lifter_server: workers cannot start, giving up\n");
+                on_terminate(SIGTERM);
+            }
+        } else {
+            stalls = 0;
+            if (code != EXIT_DONE && code != EXIT_INTERR)
+                std::fprintf(stderr, "lifter_server: worker %d died (%d), restarting\n", k, code);
+        }
+        procs[k] = spawn_worker(opt, fd, k);
+    }
+    ::unlink(opt.socket_path.c_str());
+    return 1;
+}
+
+void usage() {
+    std::fprintf(stderr,
+        "usage: lifter_server [options] <socket>\n"
+        "  -j <n>           resident worker processes (default: one per hardware thread)\n"
+        "  --recycle <n>    jobs a worker serves before it is replaced (default 100)\n"
+        "  --plugin <name>  plugin to load for every job (default lifter, \"\" for none)\n"
+        "  --scratch <dir>  where job databases live (default <socket>.d)\n"
+        "  -v               show IDA messages\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    server_options_t opt;
+    opt.self = argv[0];
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-j" && more) opt.jobs = std::atoi(argv[++i]);
+        else if (a == "--recycle" && more) opt.recycle = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--plugin" && more) opt.plugin = argv[++i];
+        else if (a == "--scratch" && more) opt.scratch = argv[++i];
+        else if (a == "-v") opt.verbose = true;
+        else if (a == "--listen-fd" && more) opt.listen_fd = std::atoi(argv[++i]);
+        else if (a == "--slot" && more) opt.slot = std::atoi(argv[++i]);
+        else if (a[0] != '-' && opt.socket_path.empty()) opt.socket_path = a;
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (opt.socket_path.empty()) {
+        usage();
+        return 1;
+    }
+    if (opt.scratch.empty())
+        opt.scratch = opt.socket_path + ".d";
+
+    return opt.listen_fd >= 0 ? run_worker(opt) : run_main(opt);
+}
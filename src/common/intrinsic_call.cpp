@@ -0,0 +1,117 @@
+/*
+ Helper Call Builder
+*/
+
+#include "intrinsic_call.h"
+
+#if IDA_SDK_VERSION >= 750
+
+intrinsic_call_t::intrinsic_call_t(ea_t ea, const char *name, cm_t cc, int nargs) : stk_off(0) {
+    mcallinfo_t *ci = (mcallinfo_t *) qalloc(sizeof(mcallinfo_t));
+    new(ci) mcallinfo_t();
+    ci->cc = cc;
+    ci->flags = FCI_SPLOK | FCI_FINAL | FCI_PROP;
+    ci->return_type = tinfo_t(BT_VOID);
+    ci->args.reserve(nargs);
+
+    // The call owns its mcallinfo_t through the mop_f destination
+    ins = (minsn_t *) qalloc(sizeof(minsn_t));
+    new(ins) minsn_t(ea);
+    ins->opcode = m_call;
+    ins->l.make_helper(name);
+    ins->d.t = mop_f;
+    ins->d.f = ci;
+    ins->d.size = 0;
+}
+
+intrinsic_call_t::~intrinsic_call_t() {
+    if (ins != nullptr) {
+        ins->~minsn_t();
+        qfree(ins);
+    }
+}
+
+mcallarg_t &intrinsic_call_t::add_slot(const tinfo_t &ti, int size) {
+    mcallinfo_t *ci = ins->d.f;
+    mcallarg_t &ca = ci->args.push_back();
+    ca.type = ti;
+    ca.size = (decltype(ca.size)) size;
+
+    int align = size < 8 ? 8 : (size > 64 ? 64 : size);
+    stk_off = (stk_off + align - 1) & ~(align - 1);
+    ca.argloc.set_stkoff(stk_off);
+    stk_off += size;
+
+    ci->solid_args++;
+    return ca;
+}
+
+void intrinsic_call_t::add_reg(mreg_t reg, const tinfo_t &ti, int size) {
+    mcallarg_t &ca = add_slot(ti, size);
+    ca.make_reg(reg, size);
+    if (size > 8)
+        ca.set_udt();
+}
+
+void intrinsic_call_t::add_mop(const mop_t &value, const tinfo_t &ti, int size) {
+    mcallarg_t &ca = add_slot(ti, size);
+    static_cast<mop_t &>(ca) = value;
+    ca.size = size;
+    if (size > 8)
+        ca.set_udt();
+}
+
+void intrinsic_call_t::add_imm(uint64 value, const tinfo_t &ti, int size) {
+    mcallarg_t &ca = add_slot(ti, size);
+    ca.make_number(value, size);
+}
+
+void intrinsic_call_t::add_insn(minsn_t *call, const tinfo_t &ti, int size) {
+    mcallarg_t &ca = add_slot(ti, size);
+    ca.make_insn(call);
+    ca.size = size;
+    if (size > 8)
+        ca.set_udt();
+}
+
+void intrinsic_call_t::set_return_type(const tinfo_t &ti) {
+    int size = (int) ti.get_size();
+    ins->d.f->return_type = ti;
+    ins->d.size = size;
+    if (size > 8)
+        ins->d.set_udt();
+}
+
+minsn_t *intrinsic_call_t::detach() {
+    minsn_t *call = ins;
+    ins = nullptr;
+    return call;
+}
+
+minsn_t *intrinsic_call_t::emit_void(mblock_t *mb) {
+    if (ins == nullptr || mb == nullptr)
+        return nullptr;
+    ins->d.size = 0;
+    return mb->insert_into_block(detach(), mb->tail);
+}
+
+minsn_t *intrinsic_call_t::emit_to_reg(mblock_t *mb, mreg_t dst, bool fp) {
+    if (ins == nullptr || mb == nullptr || ins->d.size == 0)
+        return nullptr;
+    int size = ins->d.size;
+    minsn_t *mov = (minsn_t *) qalloc(sizeof(minsn_t));
+    new(mov) minsn_t(ins->ea);
+    mov->opcode = m_mov;
+    mov->l.make_insn(detach());
+    mov->l.size = size;
+    mov->d.make_reg(dst, size);
+    if (size > 8) {
+        mov->l.set_udt();
+        mov->d.set_udt();
+    }
+    if (fp)
+        mov->set_fpinsn();
+    return mb->insert_into_block(mov, mb->tail);
+}
+
+#endif // IDA_SDK_VERSION >= 750
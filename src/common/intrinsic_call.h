@@ -0,0 +1,54 @@
+/*
+ Helper Call Builder
+*/
+
+#pragma once
+
+#include "warn_off.h"
+#include <hexrays.hpp>
+#include "warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Builds one `name(args...)` helper call for the AVX and VMX lifters, and
+// owns it until it is inserted into a block or handed to the caller as a
+// nested operand. Argument slots are reserved up front and filled in place,
+// so a call costs one minsn_t, one mcallinfo_t and one argument array.
+//
+// Arguments get consecutive dummy stack locations (aligned to their size,
+// 8..64 bytes) because the verifier wants an argloc on every argument of a
+// CM_CC_SPECIAL call. Arguments and results wider than 8 bytes are UDT.
+class intrinsic_call_t {
+public:
+    intrinsic_call_t(ea_t ea, const char *name, cm_t cc = CM_CC_SPECIAL, int nargs = 4);
+    ~intrinsic_call_t();
+
+    intrinsic_call_t(const intrinsic_call_t &) = delete;
+    intrinsic_call_t &operator=(const intrinsic_call_t &) = delete;
+
+    void add_reg(mreg_t reg, const tinfo_t &ti, int size);
+    void add_mop(const mop_t &value, const tinfo_t &ti, int size);
+    void add_imm(uint64 value, const tinfo_t &ti, int size);
+    // Nested call argument; the builder takes ownership of `call`
+    void add_insn(minsn_t *call, const tinfo_t &ti, int size);
+
+    void set_return_type(const tinfo_t &ti);
+    int return_size() const { return ins->d.size; }
+    mcallinfo_t *info() const { return ins->d.f; }
+    bool pending() const { return ins != nullptr; }
+
+    // Give up ownership of the call, to be used as a mop_d operand
+    minsn_t *detach();
+
+    // Insert at the tail of `mb`: as a void call, or as `mov call, dst`
+    minsn_t *emit_void(mblock_t *mb);
+    minsn_t *emit_to_reg(mblock_t *mb, mreg_t dst, bool fp);
+
+private:
+    mcallarg_t &add_slot(const tinfo_t &ti, int size);
+
+    minsn_t *ins;   // the m_call; null once emitted or detached
+    int stk_off;
+};
+
+#endif // IDA_SDK_VERSION >= 750
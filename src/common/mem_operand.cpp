@@ -0,0 +1,115 @@
+/*
+ Memory Operand Address Emitter
+*/
+
+#include "mem_operand.h"
+
+#if IDA_SDK_VERSION >= 750
+
+#include "warn_off.h"
+#include <intel.hpp>
+#include "warn_on.h"
+
+namespace {
+
+// One address computed for the instruction being generated. `after` is the
+// block tail right after the computation: the register is reused only while
+// everything emitted since belongs to the same instruction and leaves it alone.
+struct addr_memo_t {
+    optype_t type;
+    uint16 phrase;
+    ea_t addr;
+    char specflag1;
+    char specflag2;
+    mreg_t reg;
+    minsn_t *after;
+};
+
+// Addresses of the instruction being generated; reset by each lifter's
+// apply(), so nothing carries over to another instruction or database
+mba_t *g_memo_mba = nullptr;
+mblock_t *g_memo_blk = nullptr;
+ea_t g_memo_ea = BADADDR;
+qvector<addr_memo_t> g_memo;
+
+int addr_size() { return inf_is_64bit() ? 8 : 4; }
+
+// Same base, index, scale and displacement (the SIB byte lives in specflag2)
+bool same_address(const addr_memo_t &m, const op_t &op) {
+    return m.type == op.type && m.phrase == op.phrase && m.addr == op.addr &&
+           m.specflag1 == op.specflag1 && m.specflag2 == op.specflag2;
+}
+
+bool still_holds(codegen_t &cdg, const addr_memo_t &m) {
+    for (minsn_t *ins = cdg.mb->tail; ins != m.after; ins = ins->prev) {
+        if (ins == nullptr || ins->ea != cdg.insn.ea)
+            return false;
+        if (ins->modifies_d() && ins->d.t == mop_r && ins->d.r < m.reg + addr_size() && m.reg < ins->d.r + ins->d.size)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void memop_reset() {
+    g_memo_mba = nullptr;
+    g_memo_blk = nullptr;
+    g_memo_ea = BADADDR;
+    g_memo.clear();
+}
+
+mreg_t memop_address(codegen_t &cdg, int opidx) {
+    const op_t &op = cdg.insn.ops[opidx];
+    if (op.type != o_mem && op.type != o_displ && op.type != o_phrase)
+        return mr_none;
+
+    if (g_memo_mba != cdg.mba || g_memo_blk != cdg.mb || g_memo_ea != cdg.insn.ea) {
+        g_memo_mba = cdg.mba;
+        g_memo_blk = cdg.mb;
+        g_memo_ea = cdg.insn.ea;
+        g_memo.clear();
+    }
+    for (const addr_memo_t &m : g_memo)
+        if (same_address(m, op) && still_holds(cdg, m))
+            return m.reg;
+
+    mreg_t reg = cdg.load_effective_address(opidx);
+    if (reg == mr_none)
+        return mr_none;
+
+    addr_memo_t &m = g_memo.push_back();
+    m.type = op.type;
+    m.phrase = op.phrase;
+    m.addr = op.addr;
+    m.specflag1 = op.specflag1;
+    m.specflag2 = op.specflag2;
+    m.reg = reg;
+    m.after = cdg.mb->tail;
+    return reg;
+}
+
+bool memop_address_arg(codegen_t &cdg, int opidx, mop_t *out) {
+    const op_t &op = cdg.insn.ops[opidx];
+    if (op.type == o_mem) {
+        out->make_number(op.addr, addr_size());
+        return true;
+    }
+    mreg_t reg = memop_address(cdg, opidx);
+    if (reg == mr_none)
+        return false;
+    out->make_reg(reg, addr_size());
+    return true;
+}
+
+mreg_t memop_segment(const insn_t &insn, const op_t &op) {
+    // fs/gs overrides never get here: the lifters decline them
+    if (op.type == o_displ || op.type == o_phrase) {
+        int base = x86_base_reg(insn, op);
+        if (base == R_sp || base == R_bp)
+            return reg2mreg(R_ss);
+    }
+    return reg2mreg(R_ds);
+}
+
+#endif // IDA_SDK_VERSION >= 750
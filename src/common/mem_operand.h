@@ -0,0 +1,37 @@
+/*
+ Memory Operand Address Emitter
+*/
+
+#pragma once
+
+#include "warn_off.h"
+#include <hexrays.hpp>
+#include "warn_on.h"
+
+#if IDA_SDK_VERSION >= 750
+
+// Shared by the AVX and VMX lifters. Handlers ask for the address of a
+// memory operand instead of calling cdg.load_effective_address() themselves:
+// the base + index*scale + disp computation is emitted once per instruction
+// and addressing mode, so a handler that reads and writes the same location
+// (masked merge stores, read-modify-write helpers) or loads several operands
+// through the same address reuses one register.
+
+// Address of memory operand `opidx` in a register, for ldx/stx offsets and
+// register arguments. Returns mr_none if the operand is not memory.
+mreg_t memop_address(codegen_t &cdg, int opidx);
+
+// Address of memory operand `opidx` as a pointer-sized helper argument.
+// Global (o_mem, including RIP-relative) operands become the constant
+// address itself, with no register or move; other forms use memop_address.
+bool memop_address_arg(codegen_t &cdg, int opidx, mop_t *out);
+
+// Segment register for an ldx/stx through `op`: SS for rsp/rbp-based
+// addresses, so Hex-Rays folds them into stack variables, DS otherwise.
+mreg_t memop_segment(const insn_t &insn, const op_t &op);
+
+// Forget the addresses of the last instruction. Lifters call it before each
+// instruction they lift, so no address outlives the block that computed it.
+void memop_reset();
+
+#endif // IDA_SDK_VERSION >= 750
@@ -16,7 +16,10 @@ using std::set;
 static const char ACTION_MARK_INLINE[] = "lifter:mark_inline";
 static const char ACTION_MARK_OUTLINE[] = "lifter:mark_outline";
 
+// Actions are registered with the kernel, not with a database: the first
+// plugmod registers them and the last one to go away removes them.
 static bool g_inline_actions_registered = false;
+static int g_inline_users = 0;
 
 //------------------------------------------------------------------------------
 // Utility: mark target function and all callers as "dirty" for Hex-Rays
@@ -143,14 +146,14 @@ static bool inline_avail() {
     return true;
 }
 
-static bool inline_active() {
+static bool inline_active(void *) {
     // Consider the component active once actions are registered.
     return g_inline_actions_registered;
 }
 
-static void inline_init() {
-    if (g_inline_actions_registered)
-        return;
+static void *inline_init(component_registry_t &) {
+    if (g_inline_users++ > 0)
+        return nullptr;
 
     // Allocate handlers - IDA takes ownership when actions are registered
     g_mark_inline_ah = new inline_action_handler_t(true);
@@ -185,10 +188,11 @@ static void inline_init() {
 
     if (!g_inline_actions_registered)
         msg("[inline] Failed to register inline toggle actions\n");
+    return nullptr;
 }
 
-static void inline_done() {
-    if (!g_inline_actions_registered)
+static void inline_done(component_registry_t &, void *) {
+    if (--g_inline_users > 0 || !g_inline_actions_registered)
         return;
 
     unregister_action(ACTION_MARK_INLINE);
@@ -3,33 +3,34 @@
 #include <vector>
 #include "../common/warn_on.h"
 
-struct stored_component_t {
-    component_desc_t d;
-    bool initialized = false;
-};
-
-static std::vector<stored_component_t> &repo() {
-    static std::vector<stored_component_t> v;
+static std::vector<component_desc_t> &descriptors() {
+    static std::vector<component_desc_t> v;
     return v;
 }
 
 void component_registry_t::register_component(const component_desc_t &d) {
-    stored_component_t sc;
-    sc.d = d;
-    sc.initialized = false;
-    repo().push_back(sc);
+    descriptors().push_back(d);
+}
+
+component_registry_t::component_registry_t() {
+    for (const component_desc_t &d: descriptors())
+        slots.push_back({&d, nullptr, false});
 }
 
-size_t component_registry_t::get_count() {
-    return repo().size();
+component_registry_t::~component_registry_t() {
+    done_all();
+}
+
+size_t component_registry_t::get_count() const {
+    return slots.size();
 }
 
 int component_registry_t::init_all() {
     int inited = 0;
-    for (stored_component_t &sc: repo()) {
-        if (sc.d.avail && sc.d.avail()) {
-            if (sc.d.init)
-                sc.d.init();
+    for (slot_t &sc: slots) {
+        if (sc.d->avail && sc.d->avail()) {
+            if (sc.d->init)
+                sc.inst = sc.d->init(*this);
             sc.initialized = true;
             ++inited;
         }
@@ -39,9 +40,10 @@ int component_registry_t::init_all() {
 
 int component_registry_t::done_all() {
     int donec = 0;
-    for (stored_component_t &sc: repo()) {
-        if (sc.initialized && sc.d.done) {
-            sc.d.done();
+    for (slot_t &sc: slots) {
+        if (sc.initialized && sc.d->done) {
+            sc.d->done(*this, sc.inst);
+            sc.inst = nullptr;
             sc.initialized = false;
             ++donec;
         }
@@ -50,12 +52,89 @@ int component_registry_t::done_all() {
 }
 
 void component_registry_t::attach_to_popup(TWidget *widget, TPopupMenu *popup, vdui_t *vu) {
-    for (stored_component_t &sc: repo()) {
-        if (sc.initialized && sc.d.attach_popup) {
-            sc.d.attach_popup(widget, popup, vu);
+    for (slot_t &sc: slots) {
+        if (sc.initialized && sc.d->attach_popup) {
+            sc.d->attach_popup(widget, popup, vu);
+        }
+    }
+}
+
+#if IDA_SDK_VERSION >= 750
+//-----------------------------------------------------------------------------
+// Combined microcode filter
+//-----------------------------------------------------------------------------
+struct stored_filter_t {
+    microcode_filter_t *f;
+    bool (*claims)(uint16 itype);
+};
+
+static const uint8 ITYPE_UNRESOLVED = 0;
+static const uint8 ITYPE_UNCLAIMED = 0xFF;
+
+struct combined_filter_t : microcode_filter_t {
+    qvector<stored_filter_t> filters;
+    qvector<uint8> owner;                  // itype -> filter index + 1, or one of the markers above
+    microcode_filter_t *matched = nullptr; // filter whose match() accepted the current insn
+
+    microcode_filter_t *lookup(uint16 it) {
+        if (it >= owner.size())
+            owner.resize(it + 1, ITYPE_UNRESOLVED);
+        if (owner[it] == ITYPE_UNRESOLVED) {
+            uint8 pick = ITYPE_UNCLAIMED;
+            for (size_t i = 0; i < filters.size(); ++i) {
+                if (filters[i].claims != nullptr && filters[i].claims(it)) {
+                    pick = uint8(i + 1);
+                    break;
+                }
+                if (filters[i].claims == nullptr && pick == ITYPE_UNCLAIMED)
+                    pick = uint8(i + 1);
+            }
+            owner[it] = pick;
         }
+        return owner[it] == ITYPE_UNCLAIMED ? nullptr : filters[owner[it] - 1].f;
+    }
+
+    bool match(codegen_t &cdg) override {
+        microcode_filter_t *f = lookup(cdg.insn.itype);
+        matched = f != nullptr && f->match(cdg) ? f : nullptr;
+        return matched != nullptr;
+    }
+
+    merror_t apply(codegen_t &cdg) override {
+        microcode_filter_t *f = matched;
+        matched = nullptr;
+        return f != nullptr ? f->apply(cdg) : MERR_INSN;
+    }
+};
+
+void component_registry_t::add_microcode_filter(microcode_filter_t *f, bool (*claims)(uint16 itype)) {
+    if (filter == nullptr) {
+        filter = new combined_filter_t();
+        install_microcode_filter(filter, true);
+    }
+    QASSERT(0xC0100, filter->filters.size() < ITYPE_UNCLAIMED - 1);
+    filter->filters.push_back({f, claims});
+    filter->owner.clear();
+}
+
+void component_registry_t::remove_microcode_filter(microcode_filter_t *f) {
+    if (filter == nullptr)
+        return;
+    for (size_t i = 0; i < filter->filters.size(); ++i) {
+        if (filter->filters[i].f == f) {
+            filter->filters.erase(filter->filters.begin() + i);
+            break;
+        }
+    }
+    filter->owner.clear();
+    filter->matched = nullptr;
+    if (filter->filters.empty()) {
+        install_microcode_filter(filter, false);
+        delete filter;
+        filter = nullptr;
     }
 }
+#endif // IDA_SDK_VERSION >= 750
 
 void component_registry_t::unregister_all_actions() {
     // If actions were registered globally, they should be unregistered here.
@@ -3,17 +3,22 @@
 #include <hexrays.hpp>
 #include "../common/warn_on.h"
 
-// Simple component registry used by lifter_plugin.cpp.
-// It collects components and offers init/done and menu hookup stubs.
+// Component registry used by lifter_plugin.cpp.
+// Descriptors are collected process-wide at static-init time, but everything
+// a component creates belongs to one registry instance, which the per-database
+// plugmod owns: init() returns the component's state for that database and
+// done() receives it back.
+
+class component_registry_t;
 
 struct component_desc_t {
     bool (*avail)();
 
-    bool (*active)();
+    bool (*active)(void *inst);
 
-    void (*init)();
+    void *(*init)(component_registry_t &reg);
 
-    void (*done)();
+    void (*done)(component_registry_t &reg, void *inst);
 
     void (*attach_popup)(TWidget *widget, TPopupMenu *popup, vdui_t *vu);
 
@@ -22,19 +27,55 @@ struct component_desc_t {
     const char *action_prefix;
 };
 
+#if IDA_SDK_VERSION >= 750
+struct combined_filter_t;
+#endif
+
 class component_registry_t {
 public:
     static void register_component(const component_desc_t &d);
 
-    static size_t get_count();
+    component_registry_t();
+
+    ~component_registry_t();
+
+    size_t get_count() const;
+
+    int init_all();
+
+    int done_all();
+
+    void attach_to_popup(TWidget *widget, TPopupMenu *popup, vdui_t *vu);
+
+    void unregister_all_actions();
+
+#if IDA_SDK_VERSION >= 750
+    // Microcode filters are not installed by components themselves: the
+    // registry owns the only filter Hex-Rays sees and dispatches through an
+    // itype -> component table, so each instruction costs one lookup however
+    // many lifters are loaded. `claims` decides, once per itype, whether the
+    // component wants that itype; the component's match() still gets the
+    // final say on operands. A null `claims` makes the component the fallback
+    // for every itype no other component claims (only one fallback is used).
+    void add_microcode_filter(microcode_filter_t *f, bool (*claims)(uint16 itype));
 
-    static int init_all();
+    void remove_microcode_filter(microcode_filter_t *f);
+#endif
 
-    static int done_all();
+private:
+    struct slot_t {
+        const component_desc_t *d;
+        void *inst;
+        bool initialized;
+    };
 
-    static void attach_to_popup(TWidget *widget, TPopupMenu *popup, vdui_t *vu);
+    qvector<slot_t> slots;
+#if IDA_SDK_VERSION >= 750
+    combined_filter_t *filter = nullptr;
+#endif
 
-    static void unregister_all_actions();
+    component_registry_t(const component_registry_t &) = delete;
+    component_registry_t &operator=(const component_registry_t &) = delete;
 };
 
 // Registration helper. Each translation unit can call this to auto-register.
@@ -39,7 +39,9 @@ static void suppress_lifter_warnings(cfunc_t *cfunc) {
     }
 }
 
-static ssize_t idaapi hexrays_callback(void *, hexrays_event_t event, va_list va) {
+static component_registry_t &components_of(void *ud);
+
+static ssize_t idaapi hexrays_callback(void *ud, hexrays_event_t event, va_list va) {
     switch (event) {
         case hxe_maturity: {
             cfunc_t *cfunc = va_arg(va, cfunc_t *);
@@ -66,11 +68,12 @@ static ssize_t idaapi hexrays_callback(void *, hexrays_event_t event, va_list va
             vdui_t *vu = va_arg(va, vdui_t *);
 
             // Add separator if we have any components
-            if (component_registry_t::get_count() > 0)
+            component_registry_t &components = components_of(ud);
+            if (components.get_count() > 0)
                 attach_action_to_popup(widget, popup, nullptr);
 
             // Attach all component actions
-            component_registry_t::attach_to_popup(widget, popup, vu);
+            components.attach_to_popup(widget, popup, vu);
             break;
         }
 
@@ -93,10 +96,15 @@ static ssize_t idaapi hexrays_callback(void *, hexrays_event_t event, va_list va
 // PLUGIN_MULTI plugmods are instantiated per-database, after the decompiler is
 // available, so init_hexrays_plugin() succeeds and the filters install. This
 // mirrors the shipped 'deobf' plugin.
+//
+// All lifter state hangs off the plugmod: the component registry, and through
+// it each component's filter and caches. Several databases opened in one
+// process (idalib batch workers) each get their own.
 //--------------------------------------------------------------------------
 
 struct lifter_plugmod_t : public plugmod_t {
     bool hexrays_ready = false;
+    component_registry_t components;
 
     lifter_plugmod_t() {
         if (!init_hexrays_plugin()) {
@@ -109,9 +117,9 @@ struct lifter_plugmod_t : public plugmod_t {
         // Install hexrays callback for popup menus / warning suppression
         install_hexrays_callback(hexrays_callback, this);
 
-        int initialized = component_registry_t::init_all();
+        int initialized = components.init_all();
         msg("[lifter] Plugin ready (%d/%d components initialized)\n",
-            initialized, (int) component_registry_t::get_count());
+            initialized, (int) components.get_count());
     }
 
     virtual ~lifter_plugmod_t() {
@@ -122,9 +130,9 @@ struct lifter_plugmod_t : public plugmod_t {
         remove_hexrays_callback(hexrays_callback, this);
 
         // Unregister all component actions
-        component_registry_t::unregister_all_actions();
+        components.unregister_all_actions();
 
-        component_registry_t::done_all();
+        components.done_all();
     }
 
     virtual bool idaapi run(size_t) override {
@@ -132,6 +140,10 @@ struct lifter_plugmod_t : public plugmod_t {
     }
 };
 
+static component_registry_t &components_of(void *ud) {
+    return static_cast<lifter_plugmod_t *>(ud)->components;
+}
+
 static plugmod_t * idaapi init(void) {
     return new lifter_plugmod_t;
 }
@@ -0,0 +1,315 @@
+/*
+ VEX/EVEX Prefix Search and Length Decoding
+*/
+
+#include "vex_prefix.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define VEX_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define VEX_TARGET(isa)
+#else
+#define VEX_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace {
+
+const size_t MAX_INSN_LEN = 15;
+
+// Opcodes of map 1 (0F) that carry an imm8 in VEX/EVEX form:
+// vpshuf*, the immediate shift groups, vcmpp*, vpinsrw/vpextrw, vshufp*.
+bool map1_has_imm8(uint8_t op) {
+    return (op >= 0x70 && op <= 0x73) || op == 0xC2 || (op >= 0xC4 && op <= 0xC6);
+}
+
+// The per-byte test every kernel implements. Needs p[0..2] readable.
+inline bool lead_plausible(const uint8_t *p, bool is64) {
+    if (!is64 && (p[1] & 0xC0) != 0xC0)
+        return false;
+    switch (p[0]) {
+        case 0xC5:
+            return true;
+        case 0xC4:
+            return uint8_t((p[1] & 0x1F) - 1) <= 2;
+        case 0x62:
+            return (p[1] & 0x08) == 0 && (p[2] & 0x04) != 0;
+        default:
+            return false;
+    }
+}
+
+// Covers tails too: offsets with fewer than three readable bytes cannot hold
+// a VEX/EVEX instruction (vzeroupper, the shortest, is three) and are skipped.
+void search_scalar(const uint8_t *buf, size_t size, size_t begin, size_t end,
+                   bool is64, std::vector<size_t> *out) {
+    for (size_t i = begin; i < end && i + 3 <= size; ++i) {
+        if (lead_plausible(buf + i, is64))
+            out->push_back(i);
+    }
+}
+
+inline unsigned lowest_bit(uint64_t m) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, m);
+    return (unsigned) idx;
+#else
+    return (unsigned) __builtin_ctzll(m);
+#endif
+}
+
+#ifdef VEX_SIMD
+
+// Lane i of the vectors below holds byte i, i+1 and i+2 of the window, so a
+// window of W lanes reads W + 2 bytes.
+
+VEX_TARGET("avx2")
+void search_avx2(const uint8_t *buf, size_t size, size_t begin, size_t end,
+                 bool is64, std::vector<size_t> *out) {
+    const __m256i c4 = _mm256_set1_epi8((char) 0xC4);
+    const __m256i c5 = _mm256_set1_epi8((char) 0xC5);
+    const __m256i c62 = _mm256_set1_epi8(0x62);
+    const __m256i m1f = _mm256_set1_epi8(0x1F);
+    const __m256i m08 = _mm256_set1_epi8(0x08);
+    const __m256i m04 = _mm256_set1_epi8(0x04);
+    const __m256i mc0 = _mm256_set1_epi8((char) 0xC0);
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi8(2);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = begin;
+    for (; i + 32 <= end && i + 34 <= size; i += 32) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *) (buf + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i *) (buf + i + 1));
+        __m256i v2 = _mm256_loadu_si256((const __m256i *) (buf + i + 2));
+
+        __m256i evex = _mm256_and_si256(_mm256_cmpeq_epi8(v0, c62),
+                       _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_and_si256(v2, m04), zero),
+                                           _mm256_cmpeq_epi8(_mm256_and_si256(v1, m08), zero)));
+        __m256i map = _mm256_sub_epi8(_mm256_and_si256(v1, m1f), one);
+        __m256i vex3 = _mm256_and_si256(_mm256_cmpeq_epi8(v0, c4),
+                                        _mm256_cmpeq_epi8(_mm256_min_epu8(map, two), map));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(evex, vex3), _mm256_cmpeq_epi8(v0, c5));
+        if (!is64)
+            hit = _mm256_and_si256(hit, _mm256_cmpeq_epi8(_mm256_and_si256(v1, mc0), mc0));
+
+        uint64_t m = (uint32_t) _mm256_movemask_epi8(hit);
+        for (; m != 0; m &= m - 1)
+            out->push_back(i + lowest_bit(m));
+    }
+    search_scalar(buf, size, i, end, is64, out);
+}
+
+VEX_TARGET("avx512f,avx512bw")
+void search_avx512bw(const uint8_t *buf, size_t size, size_t begin, size_t end,
+                     bool is64, std::vector<size_t> *out) {
+    const __m512i c4 = _mm512_set1_epi8((char) 0xC4);
+    const __m512i c5 = _mm512_set1_epi8((char) 0xC5);
+    const __m512i c62 = _mm512_set1_epi8(0x62);
+    const __m512i m1f = _mm512_set1_epi8(0x1F);
+    const __m512i m08 = _mm512_set1_epi8(0x08);
+    const __m512i m04 = _mm512_set1_epi8(0x04);
+    const __m512i mc0 = _mm512_set1_epi8((char) 0xC0);
+    const __m512i one = _mm512_set1_epi8(1);
+    const __m512i two = _mm512_set1_epi8(2);
+
+    size_t i = begin;
+    for (; i + 64 <= end && i + 66 <= size; i += 64) {
+        __m512i v0 = _mm512_loadu_si512(buf + i);
+        __m512i v1 = _mm512_loadu_si512(buf + i + 1);
+        __m512i v2 = _mm512_loadu_si512(buf + i + 2);
+
+        __mmask64 evex = _mm512_cmpeq_epi8_mask(v0, c62)
+                       & _mm512_testn_epi8_mask(v1, m08)
+                       & _mm512_test_epi8_mask(v2, m04);
+        __m512i map = _mm512_sub_epi8(_mm512_and_si512(v1, m1f), one);
+        __mmask64 vex3 = _mm512_cmpeq_epi8_mask(v0, c4) & _mm512_cmple_epu8_mask(map, two);
+        __mmask64 hit = evex | vex3 | _mm512_cmpeq_epi8_mask(v0, c5);
+        if (!is64)
+            hit &= _mm512_cmpeq_epi8_mask(_mm512_and_si512(v1, mc0), mc0);
+
+        for (uint64_t m = hit; m != 0; m &= m - 1)
+            out->push_back(i + lowest_bit(m));
+    }
+    search_scalar(buf, size, i, end, is64, out);
+}
+
+#if defined(_MSC_VER)
+bool cpu_has(vex_kernel_t k) {
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7)
+        return false;
+    __cpuid(r, 1);
+    bool osxsave = (r[2] & (1 << 27)) != 0;
+    if (!osxsave)
+        return false;
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(r, 7, 0);
+    if (k == VEXK_AVX2)
+        return (xcr0 & 0x6) == 0x6 && (r[1] & (1 << 5)) != 0;
+    // opmask, ZMM_Hi256 and Hi16_ZMM state enabled, AVX512F + AVX512BW
+    return (xcr0 & 0xE6) == 0xE6 && (r[1] & (1 << 16)) != 0 && (r[1] & (1 << 30)) != 0;
+}
+#else
+bool cpu_has(vex_kernel_t k) {
+    __builtin_cpu_init();
+    if (k == VEXK_AVX2)
+        return __builtin_cpu_supports("avx2");
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+#endif
+
+#endif // VEX_SIMD
+
+} // namespace
+
+int vex_insn_length(const uint8_t *p, size_t avail, bool is64, uint8_t *flags) {
+    if (avail < 2)
+        return 0;
+    // In 32-bit code the byte after C4/C5/62 is LES/LDS/BOUND's ModRM unless
+    // its top bits are 11 (the inverted R/X fields, always set there).
+    if (!is64 && (p[1] & 0xC0) != 0xC0)
+        return 0;
+
+    size_t n;
+    int map;
+    bool evex = false;
+    uint8_t p2 = 0;
+    switch (p[0]) {
+        case 0xC5:
+            map = 1;
+            n = 2;
+            break;
+        case 0xC4:
+            if (avail < 3)
+                return 0;
+            map = p[1] & 0x1F;
+            if (map < 1 || map > 3)
+                return 0;
+            n = 3;
+            break;
+        case 0x62:
+            if (avail < 4)
+                return 0;
+            // P0 bit 3 must be 0, P1 bit 2 must be 1, zeroing needs an opmask
+            if ((p[1] & 0x08) != 0 || (p[2] & 0x04) == 0)
+                return 0;
+            p2 = p[3];
+            if ((p2 & 0x80) != 0 && (p2 & 0x07) == 0)
+                return 0;
+            map = p[1] & 0x07;
+            if (map != 1 && map != 2 && map != 3 && map != 5 && map != 6)
+                return 0;
+            evex = true;
+            n = 4;
+            break;
+        default:
+            return 0;
+    }
+
+    if (n >= avail)
+        return 0;
+    uint8_t op = p[n++];
+    bool reg_form = true;
+    if (map != 1 || op != 0x77) {  // vzeroupper/vzeroall have no ModRM
+        if (n >= avail)
+            return 0;
+        uint8_t modrm = p[n++];
+        int mod = modrm >> 6;
+        int rm = modrm & 7;
+        reg_form = mod == 3;
+        if (!reg_form) {
+            if (rm == 4) {
+                if (n >= avail)
+                    return 0;
+                uint8_t sib = p[n++];
+                if (mod == 0 && (sib & 7) == 5)
+                    n += 4;
+            } else if (mod == 0 && rm == 5) {
+                n += 4;  // disp32 / RIP-relative
+            }
+            if (mod == 1)
+                n += 1;
+            else if (mod == 2)
+                n += 4;
+        }
+    }
+    if (map == 3 || (map == 1 && map1_has_imm8(op)))
+        n += 1;
+    if (n > avail || n > MAX_INSN_LEN)
+        return 0;
+
+    uint8_t f = 0;
+    if (evex) {
+        f |= VEXC_EVEX;
+        // L'L = 2, or EVEX.b on a register form (embedded rounding is 512-bit only)
+        if (((p2 >> 5) & 3) == 2 || (reg_form && (p2 & 0x10) != 0))
+            f |= VEXC_ZMM;
+    }
+    if (flags != nullptr)
+        *flags = f;
+    return (int) n;
+}
+
+bool vex_kernel_supported(vex_kernel_t k) {
+    switch (k) {
+        case VEXK_AUTO:
+        case VEXK_SCALAR:
+            return true;
+#ifdef VEX_SIMD
+        case VEXK_AVX2:
+        case VEXK_AVX512BW: {
+            static const bool avx2 = cpu_has(VEXK_AVX2);
+            static const bool avx512bw = cpu_has(VEXK_AVX512BW);
+            return k == VEXK_AVX2 ? avx2 : avx512bw;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+vex_kernel_t vex_kernel_best() {
+    if (vex_kernel_supported(VEXK_AVX512BW))
+        return VEXK_AVX512BW;
+    if (vex_kernel_supported(VEXK_AVX2))
+        return VEXK_AVX2;
+    return VEXK_SCALAR;
+}
+
+const char *vex_kernel_name(vex_kernel_t k) {
+    switch (k) {
+        case VEXK_AUTO: return "auto";
+        case VEXK_SCALAR: return "scalar";
+        case VEXK_AVX2: return "avx2";
+        case VEXK_AVX512BW: return "avx512bw";
+        default: return "?";
+    }
+}
+
+void vex_prefix_search(const uint8_t *buf, size_t size, size_t begin, size_t end,
+                       bool is64, std::vector<size_t> *out, vex_kernel_t kernel) {
+    if (kernel == VEXK_AUTO) {
+        static const vex_kernel_t best = vex_kernel_best();
+        kernel = best;
+    }
+    if (!vex_kernel_supported(kernel))
+        kernel = VEXK_SCALAR;
+    switch (kernel) {
+#ifdef VEX_SIMD
+        case VEXK_AVX2:
+            search_avx2(buf, size, begin, end, is64, out);
+            break;
+        case VEXK_AVX512BW:
+            search_avx512bw(buf, size, begin, end, is64, out);
+            break;
+#endif
+        default:
+            search_scalar(buf, size, begin, end, is64, out);
+            break;
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ VEX/EVEX Prefix Search and Length Decoding
+*/
+
+#pragma once
+
+// No IDA headers: the worker threads of vex_scanner.cpp run this code, and
+// test/scan builds it standalone to validate the SIMD kernels.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Candidate flags
+#define VEXC_EVEX 0x01   // EVEX-encoded
+#define VEXC_ZMM  0x02   // EVEX with a 512-bit vector length (or embedded rounding)
+
+// Length of the VEX/EVEX instruction starting at `p` (at most `avail` bytes
+// readable), or 0 if `p` does not start a plausible one. Outside 64-bit mode
+// C4/C5/62 only count when they cannot be LES/LDS/BOUND. Sets VEXC_* flags.
+int vex_insn_length(const uint8_t *p, size_t avail, bool is64, uint8_t *flags);
+
+enum vex_kernel_t {
+    VEXK_AUTO,       // best the CPU supports
+    VEXK_SCALAR,
+    VEXK_AVX2,       // vpcmpeqb + vpmovmskb, 32 bytes per step
+    VEXK_AVX512BW,   // vpcmpeqb into opmasks, 64 bytes per step
+};
+
+// Whether `k` can run on this CPU (VEXK_AUTO and VEXK_SCALAR always can).
+bool vex_kernel_supported(vex_kernel_t k);
+
+// Kernel VEXK_AUTO resolves to, and a printable name for any kernel.
+vex_kernel_t vex_kernel_best();
+const char *vex_kernel_name(vex_kernel_t k);
+
+// Append to `out`, in increasing order, the offset of every byte in
+// [begin, end) of `buf` (`size` bytes readable) that is C5, C4 with a valid
+// VEX.mmmmm, or 62 with the EVEX fixed bits in place; outside 64-bit mode the
+// next byte must also rule out LES/LDS/BOUND. Every kernel returns exactly
+// the same offsets; vex_insn_length() then decides on each of them.
+void vex_prefix_search(const uint8_t *buf, size_t size, size_t begin, size_t end,
+                       bool is64, std::vector<size_t> *out,
+                       vex_kernel_t kernel = VEXK_AUTO);
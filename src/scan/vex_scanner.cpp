@@ -0,0 +1,150 @@
+/*
+ VEX/EVEX Candidate Scanner
+*/
+
+#include "vex_scanner.h"
+
+#include "../common/warn_off.h"
+#include <ida.hpp>
+#include <bytes.hpp>
+#include <funcs.hpp>
+#include <segment.hpp>
+#include "../common/warn_on.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+// Each worker takes the next chunk of a range; candidates are attributed to
+// the chunk holding their lead byte and may read past it into the next one.
+const size_t CHUNK_SIZE = 1 << 20;
+
+struct scan_chunk_t {
+    const vex_scan_range_t *range;
+    size_t begin;
+    size_t end;
+};
+
+void scan_chunk(const scan_chunk_t &c, bool is64, std::vector<vex_candidate_t> *out) {
+    const std::vector<uint8> &bytes = c.range->bytes;
+    const uint8 *base = bytes.data();
+    std::vector<size_t> leads;
+    vex_prefix_search(base, bytes.size(), c.begin, c.end, is64, &leads);
+    for (size_t off : leads) {
+        uint8 flags;
+        int len = vex_insn_length(base + off, bytes.size() - off, is64, &flags);
+        if (len == 0)
+            continue;
+        vex_candidate_t vc;
+        vc.ea = c.range->start + off;
+        vc.len = (uint8) len;
+        vc.flags = flags;
+        out->push_back(vc);
+    }
+}
+
+} // namespace
+
+void vex_scan_ranges(std::vector<vex_candidate_t> *out,
+                     const std::vector<vex_scan_range_t> &ranges,
+                     bool is64,
+                     int nthreads) {
+    out->clear();
+
+    std::vector<scan_chunk_t> chunks;
+    for (const vex_scan_range_t &r : ranges) {
+        for (size_t off = 0; off < r.bytes.size(); off += CHUNK_SIZE) {
+            scan_chunk_t c;
+            c.range = &r;
+            c.begin = off;
+            c.end = std::min(r.bytes.size(), off + CHUNK_SIZE);
+            chunks.push_back(c);
+        }
+    }
+    if (chunks.empty())
+        return;
+
+    if (nthreads <= 0)
+        nthreads = (int) std::max(1u, std::thread::hardware_concurrency());
+    nthreads = (int) std::min<size_t>(nthreads, chunks.size());
+
+    // Results per chunk, so concatenating them in chunk order keeps each
+    // range sorted without locking.
+    std::vector<std::vector<vex_candidate_t>> found(chunks.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < chunks.size(); i = next++)
+            scan_chunk(chunks[i], is64, &found[i]);
+    };
+
+    if (nthreads == 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        pool.reserve(nthreads);
+        for (int t = 0; t < nthreads; ++t)
+            pool.emplace_back(worker);
+        for (std::thread &t : pool)
+            t.join();
+    }
+
+    for (const std::vector<vex_candidate_t> &f : found)
+        out->insert(out->end(), f.begin(), f.end());
+    // Ranges come from segments in address order, but sort anyway: callers
+    // may pass them in any order.
+    std::sort(out->begin(), out->end(),
+              [](const vex_candidate_t &a, const vex_candidate_t &b) { return a.ea < b.ea; });
+}
+
+void vex_index_build(vex_index_t *out, int nthreads) {
+    out->funcs.clear();
+    out->zmm_funcs.clear();
+    out->candidates = 0;
+    out->confirmed = 0;
+
+    std::vector<vex_scan_range_t> ranges;
+    for (int i = 0; i < get_segm_qty(); i++) {
+        segment_t *seg = getnseg(i);
+        if (seg == nullptr)
+            continue;
+        bool exec = seg->perm != 0 ? (seg->perm & SEGPERM_EXEC) != 0 : seg->type == SEG_CODE;
+        if (!exec || seg->size() == 0)
+            continue;
+        vex_scan_range_t r;
+        r.start = seg->start_ea;
+        r.bytes.resize(size_t(seg->size()));
+        if (get_bytes(r.bytes.data(), r.bytes.size(), seg->start_ea, GMB_READALL) <= 0)
+            continue;
+        ranges.push_back(std::move(r));
+    }
+
+    std::vector<vex_candidate_t> cands;
+    vex_scan_ranges(&cands, ranges, inf_is_64bit(), nthreads);
+    out->candidates = cands.size();
+
+    // A candidate is real if IDA decoded an instruction that ends where it
+    // does and starts at most two prefix bytes (segment, 67) before it.
+    for (const vex_candidate_t &vc : cands) {
+        ea_t head = get_item_head(vc.ea);
+        if (vc.ea - head > 2 || !is_code(get_flags(head)))
+            continue;
+        if (head + get_item_size(head) != vc.ea + vc.len)
+            continue;
+        ++out->confirmed;
+        func_t *pfn = get_func(head);
+        if (pfn == nullptr)
+            continue;
+        if (out->funcs.empty() || out->funcs.back() != pfn->start_ea) {
+            // Function chunks can interleave, so the list is deduplicated below
+            out->funcs.push_back(pfn->start_ea);
+        }
+        if ((vc.flags & VEXC_ZMM) != 0)
+            out->zmm_funcs.push_back(pfn->start_ea);
+    }
+    for (eavec_t *v : {&out->funcs, &out->zmm_funcs}) {
+        std::sort(v->begin(), v->end());
+        v->erase(std::unique(v->begin(), v->end()), v->end());
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ VEX/EVEX Candidate Scanner
+*/
+
+#pragma once
+
+#include "../common/warn_off.h"
+#include <pro.h>
+#include "../common/warn_on.h"
+
+#include <vector>
+
+#include "vex_prefix.h"
+
+// Answers "which functions contain AVX code" without decoding the database
+// instruction by instruction. The main thread copies each code segment's
+// bytes once; worker threads then sweep fixed-size chunks of them for VEX
+// (C4/C5) and EVEX (62) lead bytes with the SIMD kernels of vex_prefix.h,
+// keeping only those that length-decode to a complete instruction. Workers
+// touch nothing but those byte buffers: every IDA call (segment walk, byte
+// reads, head and function lookups) happens on the calling thread.
+
+struct vex_candidate_t {
+    ea_t ea;
+    uint8 len;
+    uint8 flags;
+};
+
+// A code range and its bytes, as read on the main thread.
+struct vex_scan_range_t {
+    ea_t start;
+    std::vector<uint8> bytes;
+};
+
+// Sweep `ranges` on `nthreads` workers (0: one per hardware thread) and
+// return every candidate, sorted by address. Calls no IDA API.
+void vex_scan_ranges(std::vector<vex_candidate_t> *out,
+                     const std::vector<vex_scan_range_t> &ranges,
+                     bool is64,
+                     int nthreads = 0);
+
+// Functions of the current database that need the vector lifter.
+struct vex_index_t {
+    eavec_t funcs;        // start of every function with a confirmed candidate, sorted
+    eavec_t zmm_funcs;    // the subset with a 512-bit EVEX instruction
+    size_t candidates = 0;
+    size_t confirmed = 0; // candidates that are instruction heads in code
+};
+
+// Read every code segment, scan it and map the candidates that coincide with
+// a decoded instruction back to their functions. Main thread only.
+void vex_index_build(vex_index_t *out, int nthreads = 0);
@@ -23,16 +23,20 @@
 #include <typeinf.hpp>
 #include "../common/warn_on.h"
 #include "../plugin/component_registry.h"
+#include "../common/intrinsic_call.h"
+#include "../common/mem_operand.h"
 
 #if IDA_SDK_VERSION >= 750
 
 //-----------------------------------------------------------------------------
 // Debug logging
 //-----------------------------------------------------------------------------
-static bool vmx_debug_logging = false;
+// Flag of the database whose VMX lifter was entered last: each VMXLifter
+// owns its own and repoints this on every match/apply.
+static bool *vmx_debug_logging = nullptr;
 
 #define VMX_DEBUG_LOG(fmt, ...) \
-    do { if (vmx_debug_logging) msg("[VMXLifter] " fmt "\n", ##__VA_ARGS__); } while(0)
+    do { if (vmx_debug_logging != nullptr && *vmx_debug_logging) msg("[VMXLifter] " fmt "\n", ##__VA_ARGS__); } while(0)
 
 #define VMX_ERROR_LOG(fmt, ...) \
     do { msg("[VMXLifter] ERROR: " fmt "\n", ##__VA_ARGS__); } while(0)
@@ -93,48 +97,14 @@ static bool vmx_is_no_operand(uint16 it) {
 //-----------------------------------------------------------------------------
 struct VMXIntrinsic {
     codegen_t *cdg;
-    mcallinfo_t *call_info;
-    minsn_t *call_insn;
-    minsn_t *mov_insn;
-    bool emitted;
-    int stk_off;
+    intrinsic_call_t call;
+    mreg_t return_reg;
 
     explicit VMXIntrinsic(codegen_t *cdg_, const char *name)
-        : cdg(cdg_), call_info(nullptr), call_insn(nullptr), mov_insn(nullptr),
-          emitted(false), stk_off(0) {
-        call_info = (mcallinfo_t *)qalloc(sizeof(mcallinfo_t));
-        new (call_info) mcallinfo_t();
-        call_info->cc = CM_CC_FASTCALL;
-        call_info->flags = FCI_SPLOK | FCI_FINAL | FCI_PROP;
-        call_info->return_type = tinfo_t(BT_VOID);
-
-        call_insn = (minsn_t *)qalloc(sizeof(minsn_t));
-        new (call_insn) minsn_t(cdg->insn.ea);
-        call_insn->opcode = m_call;
-        call_insn->l.make_helper(name);
-        call_insn->d.t = mop_f;
-        call_insn->d.f = call_info;
-        call_insn->d.size = 0;
-    }
-
-    ~VMXIntrinsic() {
-        if (!emitted) {
-            if (mov_insn) {
-                mov_insn->~minsn_t();
-                qfree(mov_insn);
-            } else if (call_insn) {
-                call_insn->~minsn_t();
-                qfree(call_insn);
-            } else if (call_info) {
-                call_info->~mcallinfo_t();
-                qfree(call_info);
-            }
-        }
-    }
+        : cdg(cdg_), call(cdg_->insn.ea, name, CM_CC_FASTCALL, 2), return_reg(mr_none) {}
 
     void set_return_type(const tinfo_t &ret_ti) {
-        call_info->return_type = ret_ti;
-        call_insn->d.size = (int)ret_ti.get_size();
+        call.set_return_type(ret_ti);
     }
 
     void set_return_reg(mreg_t mreg, const tinfo_t &ret_ti) {
@@ -143,49 +113,16 @@ struct VMXIntrinsic {
             VMX_ERROR_LOG("Invalid return type size %" FMT_Z, size);
             return;
         }
-
-        call_info->return_type = ret_ti;
-        call_insn->d.size = (int)size;
-
-        mov_insn = (minsn_t *)qalloc(sizeof(minsn_t));
-        new (mov_insn) minsn_t(cdg->insn.ea);
-        mov_insn->opcode = m_mov;
-        mov_insn->l.make_insn(call_insn);
-        mov_insn->l.size = call_insn->d.size;
-        mov_insn->d.make_reg(mreg, call_insn->d.size);
+        call.set_return_type(ret_ti);
+        return_reg = mreg;
     }
 
     void add_argument_reg(mreg_t mreg, const tinfo_t &arg_ti) {
-        int ti_size = (int)arg_ti.get_size();
-        mcallarg_t ca(mop_t(mreg, ti_size));
-        ca.type = arg_ti;
-        ca.size = (decltype(ca.size))ti_size;
-
-        int align = ti_size;
-        if (align < 8) align = 8;
-        stk_off = (stk_off + align - 1) & ~(align - 1);
-        ca.argloc.set_stkoff(stk_off);
-        stk_off += ca.size;
-
-        call_info->args.add(ca);
-        call_info->solid_args++;
+        call.add_reg(mreg, arg_ti, (int)arg_ti.get_size());
     }
 
     void add_argument_imm(uint64 value, type_t bt, int size) {
-        tinfo_t ti(bt);
-        mcallarg_t ca;
-        ca.make_number(value, size);
-        ca.type = ti;
-        ca.size = size;
-
-        int align = size;
-        if (align < 8) align = 8;
-        stk_off = (stk_off + align - 1) & ~(align - 1);
-        ca.argloc.set_stkoff(stk_off);
-        stk_off += ca.size;
-
-        call_info->args.add(ca);
-        call_info->solid_args++;
+        call.add_imm(value, tinfo_t(bt), size);
     }
 
     // Emit void-returning intrinsic
@@ -194,15 +131,12 @@ struct VMXIntrinsic {
             VMX_ERROR_LOG("Microblock is NULL");
             return nullptr;
         }
-        call_insn->d.size = 0;
-        minsn_t *result = cdg->mb->insert_into_block(call_insn, cdg->mb->tail);
-        emitted = true;
-        return result;
+        return call.emit_void(cdg->mb);
     }
 
     // Emit intrinsic with return value
     minsn_t *emit() {
-        if (!mov_insn) {
+        if (return_reg == mr_none) {
             VMX_ERROR_LOG("Return register not set");
             return nullptr;
         }
@@ -210,9 +144,7 @@ struct VMXIntrinsic {
             VMX_ERROR_LOG("Microblock is NULL");
             return nullptr;
         }
-        minsn_t *result = cdg->mb->insert_into_block(mov_insn, cdg->mb->tail);
-        emitted = true;
-        return result;
+        return call.emit_to_reg(cdg->mb, return_reg, false);
     }
 };
 
@@ -234,7 +166,7 @@ static tinfo_t get_ptr_type() {
 
 // Load effective address of memory operand into a register
 static mreg_t load_mem_address(codegen_t &cdg, int opidx) {
-    return cdg.load_effective_address(opidx);
+    return memop_address(cdg, opidx);
 }
 
 //-----------------------------------------------------------------------------
@@ -400,8 +332,11 @@ static merror_t handle_invvpid(codegen_t &cdg) {
 // The VMX Microcode Filter
 //-----------------------------------------------------------------------------
 struct ida_local VMXLifter : microcode_filter_t {
+    bool debug_logging = true;
+
     bool match(codegen_t &cdg) override {
         uint16 it = cdg.insn.itype;
+        vmx_debug_logging = &debug_logging;
         bool m = is_vmx_insn(it);
         if (m) {
             VMX_DEBUG_LOG("%a: MATCH itype=%u", cdg.insn.ea, it);
@@ -411,6 +346,8 @@ struct ida_local VMXLifter : microcode_filter_t {
 
     merror_t apply(codegen_t &cdg) override {
         uint16 it = cdg.insn.itype;
+        vmx_debug_logging = &debug_logging;
+        memop_reset();
         VMX_DEBUG_LOG("%a: APPLY itype=%u", cdg.insn.ea, it);
 
         switch (it) {
@@ -444,39 +381,41 @@ struct ida_local VMXLifter : microcode_filter_t {
 //-----------------------------------------------------------------------------
 // Component Registration
 //-----------------------------------------------------------------------------
-static VMXLifter *g_vmx = nullptr;
-
 static bool isVMXLifter_avail() {
     // Only support x86/x64 (metapc processor)
     return PH.id == PLFM_386;
 }
 
-static bool isVMXLifter_active() {
-    return g_vmx != nullptr;
+static bool isVMXLifter_active(void *inst) {
+    return inst != nullptr;
 }
 
+// Applies to the database whose VMX lifter was entered last.
 extern "C" void set_vmx_debug_logging(bool enabled) {
-    vmx_debug_logging = enabled;
+    if (vmx_debug_logging == nullptr)
+        return;
+    *vmx_debug_logging = enabled;
     msg("[VMXLifter] Debug logging set to %s\n", enabled ? "TRUE" : "FALSE");
 }
 
-static void VMXLifter_init() {
-    if (g_vmx) return;
-
-    vmx_debug_logging = true;
+static void *VMXLifter_init(component_registry_t &reg) {
+    VMXLifter *vmx = new VMXLifter();
+    vmx_debug_logging = &vmx->debug_logging;
     msg("[VMXLifter] Initializing VMXLifter component\n");
 
-    g_vmx = new VMXLifter();
-    install_microcode_filter(g_vmx, true);
+    reg.add_microcode_filter(vmx, is_vmx_insn);
+    return vmx;
 }
 
-static void VMXLifter_done() {
-    if (!g_vmx) return;
+static void VMXLifter_done(component_registry_t &reg, void *inst) {
+    VMXLifter *vmx = static_cast<VMXLifter *>(inst);
+    if (vmx == nullptr) return;
 
     msg("[VMXLifter] Terminating VMXLifter component\n");
-    install_microcode_filter(g_vmx, false);
-    delete g_vmx;
-    g_vmx = nullptr;
+    reg.remove_microcode_filter(vmx);
+    if (vmx_debug_logging == &vmx->debug_logging)
+        vmx_debug_logging = nullptr;
+    delete vmx;
 }
 
 static const char vmx_short_name[] = "vmx";
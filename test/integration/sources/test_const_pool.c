@@ -0,0 +1,26 @@
+#include "common.h"
+
+// Vector constants the compiler places in .rodata. The lifter should render
+// them as _mm*_set*/setr* literals rather than loads from the pool address.
+
+NOINLINE __m256 test_const_abs_ps(__m256 a) {
+    return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+}
+
+NOINLINE __m256 test_const_scale_ps(__m256 a) {
+    return _mm256_mul_ps(a, _mm256_setr_ps(1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f));
+}
+
+NOINLINE __m256d test_const_bias_pd(__m256d a) {
+    return _mm256_add_pd(a, _mm256_set1_pd(0.5));
+}
+
+NOINLINE __m256i test_const_shuffle_epi8(__m256i a) {
+    const __m256i ctl = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                         3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    return _mm256_shuffle_epi8(a, ctl);
+}
+
+NOINLINE __m128i test_const_add_epi32(__m128i a) {
+    return _mm_add_epi32(a, _mm_setr_epi32(1, 2, 3, 4));
+}
@@ -0,0 +1,70 @@
+#include "common.h"
+
+// Shuffle-control setup whose inputs are all constants. Each control vector
+// should lift as a single _mm*_set*/setr literal, leaving only the shuffle
+// that consumes the data argument.
+
+NOINLINE __m128i test_consteval_bswap32(__m128i v) {
+    // Byte-reverse each dword: control built from a base row plus a per-dword offset
+    __m128i base = _mm_setr_epi8(3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1, 0);
+    __m128i step = _mm_setr_epi32(0, 4, 8, 12);
+    __m128i ctl = _mm_add_epi8(base, _mm_shuffle_epi8(step, _mm_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4,
+                                                                          8, 8, 8, 8, 12, 12, 12, 12)));
+    return _mm_shuffle_epi8(v, ctl);
+}
+
+NOINLINE __m256i test_consteval_rotate_lanes(__m256i v) {
+    // Index vector for a dword rotation, derived from an iota
+    __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i idx = _mm256_and_si256(_mm256_add_epi32(iota, _mm256_set1_epi32(3)), _mm256_set1_epi32(7));
+    return _mm256_permutevar8x32_epi32(v, idx);
+}
+
+NOINLINE __m256i test_consteval_nibble_lut(__m256i v) {
+    // Popcount lookup row broadcast to both lanes, plus the low-nibble mask
+    __m128i row = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i lut = _mm256_inserti128_si256(_mm256_castsi128_si256(row), row, 1);
+    __m256i low = _mm256_srli_epi16(_mm256_cmpeq_epi8(v, v), 12);
+    __m256i lo = _mm256_and_si256(v, _mm256_packus_epi16(low, low));
+    return _mm256_shuffle_epi8(lut, lo);
+}
+
+NOINLINE __m128i test_consteval_widen_mask(__m128i v) {
+    // Sign-extended byte mask, unpacked and blended
+    __m128i m8 = _mm_setr_epi8(-1, 0, -1, 0, 0, -1, 0, -1, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i m16 = _mm_cvtepi8_epi16(m8);
+    __m128i sel = _mm_blend_epi16(m16, _mm_unpacklo_epi16(m16, m16), 0xF0);
+    return _mm_and_si128(v, sel);
+}
+
+NOINLINE __m512i test_consteval_ternlog(__m512i v) {
+    // a ^ (b & c) over constants, then applied to the argument
+    __m512i a = _mm512_set1_epi32(0x0F0F0F0F);
+    __m512i b = _mm512_set1_epi32(0x00FF00FF);
+    __m512i c = _mm512_set1_epi32(0x3333CCCC);
+    __m512i k = _mm512_ternarylogic_epi32(a, b, c, 0x78);
+    return _mm512_xor_si512(v, k);
+}
+
+NOINLINE __m256 test_consteval_int_to_float(__m256 v) {
+    // Exact integer-to-float table scaled onto the argument
+    __m256i n = _mm256_sub_epi32(_mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8), _mm256_set1_epi32(1));
+    return _mm256_mul_ps(v, _mm256_cvtepi32_ps(n));
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+NOINLINE void test_consteval_after_zeroall(int32_t *out) {
+    // ymm1 is a known constant (all 15s) until vzeroall; the add after it
+    // reads zeros and must not fold to a set1(30)
+    __asm__ volatile(
+        "vpcmpeqd %%ymm1, %%ymm1, %%ymm1\n\t"
+        "vpsrld $28, %%ymm1, %%ymm1\n\t"
+        "vzeroall\n\t"
+        "vpaddd %%ymm1, %%ymm1, %%ymm2\n\t"
+        "vmovdqu %%ymm2, %0\n\t"
+        : "=m"(*(__m256i *) out)
+        :
+        : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+          "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15");
+}
+#endif
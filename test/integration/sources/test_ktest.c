@@ -0,0 +1,45 @@
+#include "common.h"
+
+// kortest/ktest only set ZF and CF. Each should lift as the matching
+// _kortest{z,c}_mask*_u8 / _ktest{z,c}_mask*_u8 call, so the setcc or branch
+// after it still tests the OR (AND) of the two masks.
+
+NOINLINE int test_kortestz_w(__m512 a, __m512 b) {
+    __mmask16 lt = _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+    __mmask16 gt = _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+    return _kortestz_mask16_u8(lt, gt);
+}
+
+NOINLINE int test_kortestc_w(__m512i a, __m512i b) {
+    __mmask16 eq = _mm512_cmpeq_epi32_mask(a, b);
+    __mmask16 gt = _mm512_cmpgt_epi32_mask(a, b);
+    return _kortestc_mask16_u8(eq, gt);
+}
+
+NOINLINE int test_ktestz_b(__m512d a, __m512d b) {
+    __mmask8 lt = _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+    __mmask8 gt = _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);
+    return _ktestz_mask8_u8(lt, gt);
+}
+
+NOINLINE int test_ktestc_d(__m512i a, __m512i b) {
+    __mmask32 eq = _mm512_cmpeq_epi16_mask(a, b);
+    __mmask32 lt = _mm512_cmplt_epi16_mask(a, b);
+    return _ktestc_mask32_u8(eq, lt);
+}
+
+NOINLINE int test_kortestz_q(__m512i a, __m512i b) {
+    __mmask64 eq = _mm512_cmpeq_epi8_mask(a, b);
+    __mmask64 gt = _mm512_cmpgt_epi8_mask(a, b);
+    return _kortestz_mask64_u8(eq, gt);
+}
+
+// Branch on ZF: the loop must keep its exit condition
+NOINLINE int test_kortest_branch(const float *p, __m512 limit) {
+    int n = 0;
+    while (!_kortestz_mask16_u8(_mm512_cmp_ps_mask(_mm512_loadu_ps(p), limit, _CMP_GT_OQ), 0)) {
+        p += 16;
+        n++;
+    }
+    return n;
+}
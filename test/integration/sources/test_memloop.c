@@ -0,0 +1,94 @@
+#include "common.h"
+
+// Inlined copy/fill code built from vector load/store pairs. The loops should
+// lift as memmove/memset calls, since dst and src may alias. Straight-line
+// runs of 64 bytes or more lift as memmove when they load their source before
+// storing over it, or as memcpy within one buffer at ranges provably apart.
+
+NOINLINE void test_memloop_copy_index(char *dst, const char *src, size_t n) {
+    size_t i = 0;
+    do {
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_loadu_si256((const __m256i *) (src + i)));
+        i += 32;
+    } while (i != n);
+}
+
+NOINLINE void test_memloop_copy_unrolled(char *dst, const char *src, size_t n) {
+    size_t i = 0;
+    do {
+        __m256i a = _mm256_loadu_si256((const __m256i *) (src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *) (src + i + 32));
+        _mm256_storeu_si256((__m256i *) (dst + i), a);
+        _mm256_storeu_si256((__m256i *) (dst + i + 32), b);
+        i += 64;
+    } while (i != n);
+}
+
+NOINLINE void test_memloop_copy_pointers(char *dst, const char *src, const char *end) {
+    do {
+        _mm_storeu_si128((__m128i *) dst, _mm_loadu_si128((const __m128i *) src));
+        src += 16;
+        dst += 16;
+    } while (src != end);
+}
+
+NOINLINE void test_memloop_move_backward(char *dst, const char *src, size_t n) {
+    do {
+        n -= 32;
+        _mm256_storeu_si256((__m256i *) (dst + n), _mm256_loadu_si256((const __m256i *) (src + n)));
+    } while (n != 0);
+}
+
+NOINLINE void test_memloop_zero(char *dst, size_t n) {
+    const __m256i z = _mm256_setzero_si256();
+    size_t i = 0;
+    do {
+        _mm256_storeu_si256((__m256i *) (dst + i), z);
+        i += 32;
+    } while (i != n);
+}
+
+NOINLINE void test_memloop_fill(char *dst, size_t n, char c) {
+    const __m256i v = _mm256_set1_epi8(c);
+    size_t i = 0;
+    do {
+        _mm256_storeu_si256((__m256i *) (dst + i), v);
+        i += 32;
+    } while (i != n);
+}
+
+// 32..64 byte copy: head and overlapping tail. Each run is one 32-byte
+// store, below the threshold, so both stay vector moves.
+NOINLINE void test_memloop_copy_tail(char *dst, const char *src, size_t n) {
+    __m256i head = _mm256_loadu_si256((const __m256i *) src);
+    __m256i tail = _mm256_loadu_si256((const __m256i *) (src + n - 32));
+    _mm256_storeu_si256((__m256i *) dst, head);
+    _mm256_storeu_si256((__m256i *) (dst + n - 32), tail);
+}
+
+struct blob96 {
+    char bytes[96];
+};
+
+// Compilers emit this as interleaved load/store pairs (xmm under AVX2), and
+// two unrelated pointers give no proof that a later load misses an earlier
+// store, so it stays as vector moves.
+NOINLINE void test_memloop_struct_copy(struct blob96 *dst, const struct blob96 *src) {
+    *dst = *src;
+}
+
+// All loads come first: memmove(dst, src, 96)
+NOINLINE void test_memloop_copy_loads_first(char *dst, const char *src) {
+    __m256i a = _mm256_loadu_si256((const __m256i *) src);
+    __m256i b = _mm256_loadu_si256((const __m256i *) (src + 32));
+    __m256i c = _mm256_loadu_si256((const __m256i *) (src + 64));
+    _mm256_storeu_si256((__m256i *) dst, a);
+    _mm256_storeu_si256((__m256i *) (dst + 32), b);
+    _mm256_storeu_si256((__m256i *) (dst + 64), c);
+}
+
+// Interleaved pairs within one buffer, 128 bytes apart: memcpy(buf + 128, buf, 64)
+NOINLINE void test_memloop_copy_interleaved(char *buf) {
+    _mm256_storeu_si256((__m256i *) (buf + 128), _mm256_loadu_si256((const __m256i *) buf));
+    _mm256_storeu_si256((__m256i *) (buf + 160), _mm256_loadu_si256((const __m256i *) (buf + 32)));
+}
@@ -0,0 +1,48 @@
+#include "common.h"
+
+// Reciprocal / reciprocal-sqrt estimates refined with Newton-Raphson steps.
+// Each function should lift to a single _mm*_invsqrt_* or _mm*_div_* call.
+
+NOINLINE __m128 test_rsqrt_nr_ps128(__m128 x) {
+    __m128 y = _mm_rsqrt_ps(x);
+    __m128 t = _mm_mul_ps(_mm_mul_ps(x, y), y);
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), t));
+}
+
+NOINLINE __m256 test_rsqrt_nr_ps256(__m256 x) {
+    __m256 y = _mm256_rsqrt_ps(x);
+    __m256 hx = _mm256_mul_ps(x, _mm256_set1_ps(0.5f));
+    __m256 t = _mm256_mul_ps(_mm256_mul_ps(hx, y), y);
+    return _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), t));
+}
+
+NOINLINE __m256 test_rsqrt_nr_fma_ps256(__m256 x) {
+    __m256 y = _mm256_rsqrt_ps(x);
+    __m256 xy = _mm256_mul_ps(x, y);
+    __m256 t = _mm256_fmadd_ps(xy, y, _mm256_set1_ps(-3.0f));
+    return _mm256_mul_ps(_mm256_mul_ps(y, _mm256_set1_ps(-0.5f)), t);
+}
+
+NOINLINE __m256 test_rcp_nr_ps256(__m256 x) {
+    __m256 y = _mm256_rcp_ps(x);
+    return _mm256_mul_ps(y, _mm256_fnmadd_ps(x, y, _mm256_set1_ps(2.0f)));
+}
+
+NOINLINE __m256 test_rcp_nr2_ps256(__m256 x) {
+    __m256 two = _mm256_set1_ps(2.0f);
+    __m256 y = _mm256_rcp_ps(x);
+    y = _mm256_mul_ps(y, _mm256_fnmadd_ps(x, y, two));
+    return _mm256_mul_ps(y, _mm256_fnmadd_ps(x, y, two));
+}
+
+NOINLINE __m512 test_rsqrt14_nr_ps512(__m512 x) {
+    __m512 y = _mm512_rsqrt14_ps(x);
+    __m512 t = _mm512_mul_ps(_mm512_mul_ps(x, y), y);
+    return _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), y), _mm512_sub_ps(_mm512_set1_ps(3.0f), t));
+}
+
+NOINLINE __m512d test_rcp14_nr_pd512(__m512d x) {
+    __m512d y = _mm512_rcp14_pd(x);
+    __m512d e = _mm512_fnmadd_pd(x, y, _mm512_set1_pd(1.0));
+    return _mm512_fmadd_pd(y, e, y);
+}
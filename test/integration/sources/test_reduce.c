@@ -0,0 +1,71 @@
+#include "common.h"
+
+// Horizontal reductions written with in-lane shuffles. Each function's
+// extract/shuffle/combine tree should lift to one _mm512_reduce_* call
+// (256-bit sources widened into it) splatted with _mm_set1_*, as long as
+// only the low element of the result is used afterwards.
+
+NOINLINE float test_reduce_add_ps256(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+    return _mm_cvtss_f32(lo);
+}
+
+NOINLINE float test_reduce_max_ps256(__m256 v) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_shuffle_ps(m, m, 0x4E));
+    m = _mm_max_ps(m, _mm_shuffle_ps(m, m, 0xB1));
+    return _mm_cvtss_f32(m);
+}
+
+NOINLINE double test_reduce_add_pd256(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+    return _mm_cvtsd_f64(s);
+}
+
+NOINLINE int test_reduce_add_epi32_256(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+}
+
+NOINLINE unsigned test_reduce_or_epi32_256(__m256i v) {
+    __m128i s = _mm_or_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_or_si128(s, _mm_srli_si128(s, 8));
+    s = _mm_or_si128(s, _mm_srli_si128(s, 4));
+    return (unsigned) _mm_cvtsi128_si32(s);
+}
+
+NOINLINE float test_reduce_hadd_ps256(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_hadd_ps(s, s);
+    s = _mm_hadd_ps(s, s);
+    return _mm_cvtss_f32(s);
+}
+
+NOINLINE float test_reduce_add_ps512(__m512 v) {
+    __m256 h = _mm256_add_ps(_mm512_castps512_ps256(v), _mm512_extractf32x8_ps(v, 1));
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+NOINLINE long long test_reduce_min_epi64_512(__m512i v) {
+    __m256i h = _mm256_min_epi64(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+    __m128i s = _mm_min_epi64(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+    s = _mm_min_epi64(s, _mm_unpackhi_epi64(s, s));
+    return _mm_cvtsi128_si64(s);
+}
+
+// The partial sums in the upper lanes are returned too: stays a shuffle tree
+NOINLINE __m128 test_reduce_add_ps256_vector(__m256 v) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    return _mm_add_ss(lo, _mm_movehdup_ps(lo));
+}
@@ -0,0 +1,62 @@
+#include "common.h"
+
+// Hand-written byte scans: compare a vector of bytes, extract the match mask
+// and loop while it is empty. Each loop should lift as a strlen or memchr
+// call followed by one pass of the loop body.
+
+NOINLINE size_t test_scan_strlen_avx2(const char *s) {
+    const __m256i zero = _mm256_setzero_si256();
+    const char *p = s;
+    unsigned mask;
+    do {
+        __m256i v = _mm256_loadu_si256((const __m256i *) p);
+        mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+        p += 32;
+    } while (mask == 0);
+    return (size_t) (p - 32 - s) + __builtin_ctz(mask);
+}
+
+NOINLINE const char *test_scan_memchr_avx2(const char *s, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0;
+    unsigned mask;
+    do {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+        mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle));
+        i += 32;
+    } while (mask == 0);
+    return s + i - 32 + __builtin_ctz(mask);
+}
+
+NOINLINE size_t test_scan_strlen_sse(const char *s) {
+    const __m128i zero = _mm_setzero_si128();
+    const char *p = s;
+    unsigned mask;
+    do {
+        mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) p), zero));
+        p += 16;
+    } while (mask == 0);
+    return (size_t) (p - 16 - s) + __builtin_ctz(mask);
+}
+
+NOINLINE size_t test_scan_strlen_avx512(const char *s) {
+    const char *p = s;
+    __mmask64 m;
+    do {
+        __m512i v = _mm512_loadu_si512((const void *) p);
+        m = _mm512_testn_epi8_mask(v, v);
+        p += 64;
+    } while (m == 0);
+    return (size_t) (p - 64 - s) + (size_t) __builtin_ctzll(m);
+}
+
+NOINLINE const char *test_scan_memchr_avx512(const char *s, char c) {
+    const __m512i needle = _mm512_set1_epi8(c);
+    const char *p = s;
+    __mmask64 m;
+    do {
+        m = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void *) p), needle);
+        p += 64;
+    } while (m == 0);
+    return p - 64 + __builtin_ctzll(m);
+}
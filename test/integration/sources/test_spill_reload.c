@@ -0,0 +1,36 @@
+#include "common.h"
+
+// Debug-build shaped code: every vector temporary is spilled to the stack and
+// reloaded before its next use. The lifter forwards same-block reloads, so
+// these should decompile without stack-slot round trips.
+#if defined(__clang__)
+  #define O0_FUNC __attribute__((noinline, optnone))
+#else
+  #define O0_FUNC __attribute__((noinline, optimize("O0")))
+#endif
+
+O0_FUNC __m256 test_spill_ymm_chain(__m256 a, __m256 b) {
+    __m256 t = _mm256_add_ps(a, b);
+    __m256 u = _mm256_mul_ps(t, t);
+    return _mm256_sub_ps(u, a);
+}
+
+O0_FUNC __m128i test_spill_xmm_int(__m128i a, __m128i b) {
+    __m128i t = _mm_add_epi32(a, b);
+    __m128i u = _mm_xor_si128(t, b);
+    return _mm_and_si128(u, t);
+}
+
+O0_FUNC __m512 test_spill_zmm_chain(__m512 a, __m512 b) {
+    __m512 t = _mm512_add_ps(a, b);
+    __m512 u = _mm512_mul_ps(t, b);
+    return _mm512_max_ps(u, t);
+}
+
+// The slot is overwritten through a pointer between spill and reload, so the
+// reload must stay a memory access.
+O0_FUNC __m256 test_spill_clobbered(__m256 a, __m256 *alias) {
+    __m256 t = _mm256_add_ps(a, a);
+    *alias = _mm256_setzero_ps();
+    return _mm256_mul_ps(t, a);
+}
@@ -29,6 +29,7 @@ generator, usually gen_memfold.py) OR allowlist it with a justification.
 Usage:
     coverage_closure.py --seeds 2 --funcs 200 --idump idump
     coverage_closure.py --report-only          # don't fail, just print holes
+    coverage_closure.py --server /tmp/lifter.sock   # lift via lifter_server
 """
 import argparse
 import glob
@@ -37,6 +38,8 @@ import subprocess
 import sys
 from pathlib import Path
 
+import lifter_client
+
 HERE = Path(__file__).resolve().parent
 PREFIX = "_cov"
 FLAGS = (HERE / "flags.txt").read_text().strip()
@@ -96,6 +99,8 @@ def main():
     ap.add_argument("--seeds", type=int, default=2)
     ap.add_argument("--funcs", type=int, default=200)
     ap.add_argument("--idump", default="idump")
+    ap.add_argument("--server", default=None,
+                    help="lifter_server socket; lift there instead of running idump")
     ap.add_argument("--report-only", action="store_true",
                     help="print holes but exit 0 (for triage)")
     ap.add_argument("--keep", action="store_true")
@@ -129,13 +134,17 @@ def main():
             if so is None:
                 print(f"[cov]   skip {gen.name} s{seed}: build failed")
                 continue
-            env = dict(os.environ)
-            env["AVX_COV"] = str(cov_file)
+            cov_env = {"AVX_COV": str(cov_file)}
             # dump the manifest exactly once (first successful idump)
             if not manifest_file.exists():
-                env["AVX_COV_MANIFEST"] = str(manifest_file)
-            sh(f"{args.idump} --plugin lifter --pseudo-only --no-color {so} >/dev/null 2>&1",
-               env=env)
+                cov_env["AVX_COV_MANIFEST"] = str(manifest_file)
+            if args.server:
+                # the server applies these to this job only, and answers once
+                # the database is closed and the coverage is flushed
+                lifter_client.lift(args.server, so, env=cov_env)
+            else:
+                sh(f"{args.idump} --plugin lifter --pseudo-only --no-color {so} >/dev/null 2>&1",
+                   env={**os.environ, **cov_env})
             built += 1
             # tidy IDA db files
             for ext in (".id0", ".id1", ".id2", ".nam", ".til", ".i64"):
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Client for lifter_server: lift binaries on a resident idalib server instead
+of starting one idump per binary.
+
+The server (built next to the plugin when the SDK ships idalib) keeps IDA, the
+decompiler and the lifter loaded between jobs:
+
+    lifter_server -j 8 /tmp/lifter.sock &
+    lifter_client.py --server /tmp/lifter.sock a.so b.so
+
+lift() returns idump-style text: the pseudocode, a `name: INTERR: n` line per
+internal error, and the Total functions / Decompiled OK / Success rate footer,
+so the torture scripts scan it with the regexes they use on idump output.
+A worker that dies mid-binary counts as one more failed function.
+
+Usage:
+    lifter_client.py --server SOCK BIN [BIN ...]
+    lifter_client.py --server SOCK --json BIN      # raw server records
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import math
+import socket
+import sys
+from pathlib import Path
+
+
+def lift_records(server, binpath, env=None, scope="all", timeout=900):
+    """Yield the server's records for one binary. The last one is the summary
+    ({"summary": true, ...}) unless the job failed or the worker died."""
+    req = "".join(f"env {k}={v}\n" for k, v in (env or {}).items())
+    req += f"scope {scope}\nlift {Path(binpath).resolve()}\n"
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+        s.settimeout(timeout)
+        s.connect(str(server))
+        s.sendall(req.encode())
+        with s.makefile("r", encoding="utf-8", errors="replace") as f:
+            for line in f:
+                if line.strip():
+                    yield json.loads(line)
+
+
+def lift(server, binpath, env=None, scope="all", timeout=900):
+    """Lift one binary and render the result as idump would print it."""
+    out, total, ok, summary = [], 0, 0, None
+    try:
+        for r in lift_records(server, binpath, env, scope, timeout):
+            if r.get("summary"):
+                summary = r
+                continue
+            if "ea" not in r:
+                out.append(f"lifter_server: {r.get('error', 'job failed')}")
+                return "\n".join(out) + "\n"
+            total += 1
+            name = r.get("name") or r["ea"]
+            if r["status"] == "ok":
+                ok += 1
+                out.append(f"// {name} @ {r['ea']}")
+                out.extend(r.get("pseudocode", []))
+                out.append("")
+            elif r["status"] == "interr":
+                out.append(f"  {name}: INTERR: {r.get('interr', 0)}")
+            else:
+                out.append(f"  {name}: {r.get('error', r['status'])}")
+    except (OSError, ValueError) as e:
+        out.append(f"lifter_server: {e}")
+    if summary is None:
+        total += 1
+        out.append("lifter_server: worker died before finishing the binary")
+    # floor, so a single failure never rounds up to 100%
+    rate = math.floor(10000 * ok / total) / 100 if total else 0.0
+    out += [f"Total functions: {total}", f"Decompiled OK: {ok}",
+            f"Success rate: {rate:.2f}%"]
+    return "\n".join(out) + "\n"
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--server", required=True, help="lifter_server socket")
+    ap.add_argument("--scope", choices=("all", "vector"), default="all")
+    ap.add_argument("--json", action="store_true", help="print the raw records")
+    ap.add_argument("bins", nargs="+")
+    args = ap.parse_args()
+    for b in args.bins:
+        if args.json:
+            for r in lift_records(args.server, b, scope=args.scope):
+                print(json.dumps(r))
+        else:
+            sys.stdout.write(lift(args.server, b, scope=args.scope))
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
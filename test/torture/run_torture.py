@@ -12,6 +12,7 @@ Findings are reproducible: rerun with the printed --seed/--funcs.
 Usage:
     run_torture.py --seeds 20 --funcs 400
     run_torture.py --seed 7 --funcs 800 --keep   # one seed, keep artifacts
+    run_torture.py --seeds 20 --server /tmp/lifter.sock   # via lifter_server
 """
 from __future__ import annotations
 
@@ -23,6 +24,8 @@ import sys
 from collections import Counter
 from pathlib import Path
 
+import lifter_client
+
 HERE = Path(__file__).resolve().parent
 ANSI = re.compile(r"\x1b\[[0-9;]*m")
 ASM = re.compile(r"__asm\s*\{\s*([^}\n;]+)")
@@ -36,9 +39,12 @@ def sh(cmd, **kw):
     return subprocess.run(cmd, shell=True, text=True, capture_output=True, **kw)
 
 
-def _idump_scan(idump, sofile, outfile, keep, interesting_only=True):
-    dump = sh(f"{idump} --plugin lifter --pseudo-only --no-color {sofile}")
-    text = ANSI.sub("", dump.stdout)
+def _idump_scan(idump, sofile, outfile, keep, interesting_only=True, server=None):
+    if server:
+        text = lifter_client.lift(server, sofile)
+    else:
+        dump = sh(f"{idump} --plugin lifter --pseudo-only --no-color {sofile}")
+        text = ANSI.sub("", dump.stdout)
     Path(outfile).write_text(text)
     ok = int(m.group(1)) if (m := OKRE.search(text)) else -1
     rate = float(m.group(1)) if (m := RATE.search(text)) else -1.0
@@ -49,7 +55,7 @@ def _idump_scan(idump, sofile, outfile, keep, interesting_only=True):
     return ok, rate, interrs, asms
 
 
-def run_seed(seed, funcs, flags, idump, keep, cc):
+def run_seed(seed, funcs, flags, idump, keep, cc, server=None):
     base = HERE / f"_t{seed}"
     ok_total, rate_min, interrs, asms = 0, 100.0, [], Counter()
     # --- intrinsic corpus (C) ---
@@ -61,7 +67,7 @@ def run_seed(seed, funcs, flags, idump, keep, cc):
     if res.returncode != 0:
         return {"seed": seed, "stage": "compile-c",
                 "err": "\n".join(l for l in res.stderr.splitlines() if "error:" in l)[:2000]}
-    o, r, ie, am = _idump_scan(idump, cso, cout, keep)
+    o, r, ie, am = _idump_scan(idump, cso, cout, keep, server=server)
     ok_total += max(o, 0); rate_min = min(rate_min, r); interrs += [("c", x) for x in ie]; asms += am
     if not keep:
         for f in (cfile, cso): Path(f).unlink(missing_ok=True)
@@ -75,7 +81,7 @@ def run_seed(seed, funcs, flags, idump, keep, cc):
     if res.returncode != 0:
         return {"seed": seed, "stage": "assemble",
                 "err": "\n".join(l for l in res.stderr.splitlines() if "rror" in l)[:2000]}
-    o, r, ie, am = _idump_scan(idump, aso, aout, keep)
+    o, r, ie, am = _idump_scan(idump, aso, aout, keep, server=server)
     ok_total += max(o, 0); rate_min = min(rate_min, r); interrs += [("asm", x) for x in ie]; asms += am
     if not keep:
         for f in (afile, aso): Path(f).unlink(missing_ok=True)
@@ -90,6 +96,8 @@ def main():
     ap.add_argument("--seed", type=int, default=None, help="single seed")
     ap.add_argument("--funcs", type=int, default=400)
     ap.add_argument("--idump", default="idump")
+    ap.add_argument("--server", default=None,
+                    help="lifter_server socket; lift there instead of running idump")
     ap.add_argument("--cc", default=os.environ.get("CC", "clang"),
                     help="C compiler (default: $CC or clang)")
     ap.add_argument("--keep", action="store_true")
@@ -104,7 +112,7 @@ def main():
     all_asm = Counter()
     bad = []
     for s in seeds:
-        r = run_seed(s, args.funcs, flags, args.idump, args.keep, args.cc)
+        r = run_seed(s, args.funcs, flags, args.idump, args.keep, args.cc, args.server)
         if r["stage"] != "ok":
             print(f"[seed {s}] {r['stage']} FAILED:\n{r['err']}")
             bad.append(s)
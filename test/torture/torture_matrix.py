@@ -34,6 +34,7 @@ Usage:
     torture_matrix.py --seeds 1 --funcs 40
     torture_matrix.py --seeds 4 --funcs 200 --keep
     torture_matrix.py --seeds 1 --funcs 40 --idump /path/to/idump
+    torture_matrix.py --seeds 3 --server /tmp/lifter.sock   # via lifter_server
 """
 from __future__ import annotations
 
@@ -47,6 +48,8 @@ import sys
 from collections import Counter, defaultdict
 from pathlib import Path
 
+import lifter_client
+
 HERE = Path(__file__).resolve().parent
 PREFIX = "_mtx"  # unique artifact prefix so parallel agents don't collide
 
@@ -246,12 +249,15 @@ def gen_corpus(gen: Path, funcs: int, seed: int) -> tuple[Path, str, str]:
 
 
 # ---------------------------------------------------------------------------
-def idump_scan(idump: str, binpath: Path, outpath: Path):
+def idump_scan(idump: str, binpath: Path, outpath: Path, server: str | None = None):
     """Dump a binary, return (total, ok, rate, interrs, err_funcs, asm_counter,
-    func_seen)."""
-    r = sh(f"{idump} --plugin lifter --pseudo-only --no-color {binpath} "
-           f"2>/dev/null")
-    text = ANSI.sub("", r.stdout)
+    func_seen). With `server`, lift on lifter_server instead of running idump."""
+    if server:
+        text = lifter_client.lift(server, binpath)
+    else:
+        r = sh(f"{idump} --plugin lifter --pseudo-only --no-color {binpath} "
+               f"2>/dev/null")
+        text = ANSI.sub("", r.stdout)
     outpath.write_text(text)
     total = int(m.group(1)) if (m := TOTRE.search(text)) else -1
     ok = int(m.group(1)) if (m := OKRE.search(text)) else -1
@@ -281,6 +287,9 @@ def main():
     ap.add_argument("--seeds", type=int, default=1, help="run seeds 1..N")
     ap.add_argument("--funcs", type=int, default=40)
     ap.add_argument("--idump", default="idump")
+    ap.add_argument("--server", default=None,
+                    help="lifter_server socket; lift there instead of running "
+                         "idump (the --no-plugins INTERR triage still uses idump)")
     ap.add_argument("--keep", action="store_true",
                     help="keep artifacts of every built binary, not just "
                          "the interesting (INTERR/asm/failure) ones")
@@ -382,7 +391,7 @@ def main():
                 grand_bins += 1
                 bins_by_fmt[cfg["fmt"]] += 1
                 total, ok, rate, interrs, err_funcs, asms = \
-                    idump_scan(args.idump, binp, outp)
+                    idump_scan(args.idump, binp, outp, args.server)
                 grand_funcs += max(ok, 0)
                 all_asm.update(asms)
                 if cfg["fmt"] not in proof and ok > 0: